@@ -79,6 +79,24 @@ function(add_application_test project_name)
     add_test(NAME ${name}_hw COMMAND ${name} --gtest_filter=*HWTEST* WORKING_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}")
 endfunction()
 
+function(add_application_benchmark project_name)
+    cmake_parse_arguments(F "" "" "SOURCE" ${ARGN})
+    set(name "${project_name}_benchmark")
+    add_executable(${name} ${F_SOURCE})
+    add_executable(compute_samples::${name} ALIAS ${name})
+
+    target_link_libraries(${name}
+        PUBLIC
+        compute_samples::${project_name}_lib
+        compute_samples::timer
+        compute_samples::logging
+    )
+
+    install(TARGETS ${name} DESTINATION ".")
+
+    set_target_properties(${name} PROPERTIES FOLDER applications/${project_name})
+endfunction()
+
 function(add_kernels target)
     foreach(kernel ${ARGN})
         target_sources(${target} PRIVATE "${CMAKE_CURRENT_SOURCE_DIR}/${kernel}")
@@ -173,6 +191,24 @@ function(add_core_library_test project_name)
     add_test(NAME ${name}_hw COMMAND ${name} --gtest_filter=*HWTEST* WORKING_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}")
 endfunction()
 
+function(add_core_library_benchmark project_name)
+    cmake_parse_arguments(F "" "" "SOURCE" ${ARGN})
+    set(name "${project_name}_benchmark")
+    add_executable(${name} ${F_SOURCE})
+    add_executable(compute_samples::${name} ALIAS ${name})
+
+    target_link_libraries(${name}
+        PUBLIC
+        compute_samples::${project_name}
+        compute_samples::timer
+        compute_samples::logging
+    )
+
+    install(TARGETS ${name} DESTINATION ".")
+
+    set_target_properties(${name} PROPERTIES FOLDER core/${project_name})
+endfunction()
+
 function(add_test_suite name)
     cmake_parse_arguments(F "" "" "SOURCE" ${ARGN})
     add_executable(${name} ${F_SOURCE})
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/compute/core.hpp>
+#include <boost/compute/utility.hpp>
+#include <boost/program_options.hpp>
+
+#include "median_filter/cpu_median_filter.hpp"
+#include "ocl_utils/ocl_utils.hpp"
+#include "random/random.hpp"
+#include "logging/logging.hpp"
+
+namespace po = boost::program_options;
+namespace compute = boost::compute;
+namespace cs = compute_samples;
+
+namespace {
+struct Arguments {
+  std::string kernel_path;
+  int iterations = 0;
+  int width = 0;
+  int height = 0;
+};
+
+size_t round_up(const size_t value, const size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Bytes requested from global memory per pixel. median_filter reads the
+// whole aperture of every pixel, median_filter_tiled reads each tile with
+// its halo once. Caches serve part of the requests of median_filter, so the
+// bandwidth reported below is the one a kernel without caches would need.
+double global_bytes_per_pixel(const bool tiled) {
+  const double pixel = sizeof(uint32_t);
+  if (!tiled) {
+    return 9 * pixel + pixel;
+  }
+  const double tile = cs::median_filter_tile_size;
+  return (tile + 2) * (tile + 2) / (tile * tile) * pixel + pixel;
+}
+
+void benchmark_kernel(const Arguments &args, const bool tiled,
+                      compute::context &context,
+                      compute::command_queue &queue,
+                      const std::vector<uint32_t> &input) {
+  const size_t bytes = input.size() * sizeof(uint32_t);
+  compute::buffer input_buffer(context, bytes,
+                               compute::memory_object::read_only |
+                                   compute::memory_object::copy_host_ptr,
+                               const_cast<uint32_t *>(input.data()));
+  compute::buffer output_buffer(context, bytes,
+                                compute::memory_object::write_only);
+
+  const compute::program program =
+      tiled ? cs::build_program(context, args.kernel_path,
+                                cs::median_filter_tiled_build_options(
+                                    cs::MedianBorder::clamp, 0))
+            : cs::build_program(context, args.kernel_path);
+  compute::kernel kernel =
+      program.create_kernel(tiled ? "median_filter_tiled" : "median_filter");
+  const size_t tile = cs::median_filter_tile_size;
+  compute::extents<2> global_size = compute::dim(args.width, args.height);
+  if (tiled) {
+    kernel.set_args(input_buffer, output_buffer, args.width, args.height);
+    global_size = compute::dim(round_up(args.width, tile),
+                               round_up(args.height, tile));
+  } else {
+    kernel.set_args(input_buffer, output_buffer);
+  }
+  const compute::extents<2> local_size = compute::dim(tile, tile);
+
+  std::chrono::nanoseconds total(0);
+  for (int i = 0; i < args.iterations; ++i) {
+    compute::event event = queue.enqueue_nd_range_kernel(
+        kernel, 2, nullptr, global_size.data(),
+        tiled ? local_size.data() : nullptr);
+    event.wait();
+    total += event.duration<std::chrono::nanoseconds>();
+  }
+
+  std::vector<uint32_t> output(input.size());
+  queue.enqueue_read_buffer(output_buffer, 0, bytes, output.data());
+  std::vector<uint32_t> expected(input.size());
+  cs::CpuMedianFilter filter(0);
+  if (tiled) {
+    filter.filter(cs::ImageView<const uint32_t>(input.data(), args.width,
+                                                args.height, args.width),
+                  cs::ImageView<uint32_t>(expected.data(), args.width,
+                                          args.height, args.width),
+                  cs::MedianBorder::clamp);
+  } else {
+    filter.filter(input.data(), expected.data(), args.width, args.height);
+  }
+
+  const double seconds = total.count() * 1e-9 / args.iterations;
+  const double pixels = static_cast<double>(input.size());
+  const double bytes_per_pixel = global_bytes_per_pixel(tiled);
+  LOG_INFO << (tiled ? "median_filter_tiled" : "median_filter") << ": "
+           << seconds * 1e3 << " ms, " << pixels / seconds * 1e-6
+           << " Mpixels/s, " << bytes_per_pixel << " B/pixel requested, "
+           << pixels * bytes_per_pixel / seconds * 1e-9 << " GB/s"
+           << (output == expected ? "" : ", output differs from CPU");
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  std::vector<std::string> command_line(argv + 1, argv + argc);
+  cs::init_logging(command_line);
+
+  Arguments args;
+  po::options_description desc("Allowed options");
+  auto options = desc.add_options();
+  options("help,h", "show help message");
+  options("kernel",
+          po::value<std::string>(&args.kernel_path)
+              ->default_value("median_filter.cl"),
+          "path to kernel");
+  options("iterations", po::value<int>(&args.iterations)->default_value(20),
+          "number of runs of each kernel");
+  options("width", po::value<int>(&args.width)->default_value(4096),
+          "image width");
+  options("height", po::value<int>(&args.height)->default_value(4096),
+          "image height");
+  po::variables_map vm;
+  po::store(po::command_line_parser(command_line).options(desc).run(), vm);
+  if (vm.count("help") != 0u) {
+    std::cout << desc;
+    return 0;
+  }
+  po::notify(vm);
+
+  const compute::device device = compute::system::default_device();
+  LOG_INFO << "OpenCL device: " << device.name();
+  compute::context context(device);
+  compute::command_queue queue(context, device,
+                               compute::command_queue::enable_profiling);
+
+  const std::vector<uint32_t> input =
+      cs::generate_vector<uint32_t>(args.width * args.height, 0);
+  LOG_INFO << "Image: " << args.width << "x" << args.height;
+  benchmark_kernel(args, false, context, queue, input);
+  benchmark_kernel(args, true, context, queue, input);
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_CPU_MEDIAN_FILTER_HPP
+#define COMPUTE_SAMPLES_CPU_MEDIAN_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "image/image.hpp"
+
+namespace compute_samples {
+
+class ThreadPool;
+
+enum class MedianKernel { automatic, scalar, sse2, avx2 };
+// Pixels read outside the image by the aperture of border pixels. mirror
+// reflects at the edge pixel without repeating it, constant reads a value.
+// Values are the BORDER_MODE of median_filter.cl.
+enum class MedianBorder { clamp, mirror, constant };
+
+// Work group size of median_filter_tiled in both dimensions
+const int median_filter_tile_size = 16;
+
+// Options building median_filter.cl for median_filter_tiled, passed to
+// build_program
+std::string median_filter_tiled_build_options(const MedianBorder border,
+                                              const uint32_t border_value);
+
+// Host implementation of median_filter.cl for packed RGBA8 pixels.
+// Every kernel runs the same partial bitonic network as the OpenCL kernel on
+// each channel, the SIMD ones with packed unsigned byte min and max, so the
+// output is bit-exact with the device. Like the median_filter kernel, images
+// passed as pointers are indexed as one linear array: pixels closer than
+// width + 1 to either end are copied and the aperture of the first and last
+// columns wraps to the neighbouring row. Image views follow
+// median_filter_tiled instead, which filters every pixel and reads pixels
+// outside the image according to a border mode. Bands of rows are split
+// across threads.
+class CpuMedianFilter {
+public:
+  explicit CpuMedianFilter(const int thread_count = 1,
+                           const MedianKernel kernel = MedianKernel::automatic);
+  ~CpuMedianFilter();
+
+  CpuMedianFilter(const CpuMedianFilter &) = delete;
+  CpuMedianFilter &operator=(const CpuMedianFilter &) = delete;
+
+  // Both images hold width * height pixels without padding between rows
+  void filter(const uint32_t *input, uint32_t *output, const int width,
+              const int height);
+  // Images must have the same size and must not overlap
+  void filter(const ImageView<const uint32_t> &input,
+              const ImageView<uint32_t> &output, const MedianBorder border,
+              const uint32_t border_value = 0);
+
+  MedianKernel kernel() const { return kernel_; }
+  int thread_count() const;
+
+  static bool is_supported(const MedianKernel kernel);
+  static const char *kernel_name(const MedianKernel kernel);
+  static const char *border_name(const MedianBorder border);
+
+private:
+  void filter_padded_rows(const ImageView<const uint32_t> &padded,
+                          const ImageView<uint32_t> &output, const int begin,
+                          const int end) const;
+  void filter_range(const uint32_t *input, uint32_t *output, const int width,
+                    const size_t size, const size_t begin,
+                    const size_t end) const;
+
+  MedianKernel kernel_;
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace compute_samples
+
+#endif
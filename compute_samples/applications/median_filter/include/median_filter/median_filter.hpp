@@ -8,12 +8,15 @@
 #ifndef COMPUTE_SAMPLES_MEDIAN_FILTER_HPP
 #define COMPUTE_SAMPLES_MEDIAN_FILTER_HPP
 
+#include <cstdint>
 #include <vector>
 
 #include <boost/compute/core.hpp>
 
 #include "application/application.hpp"
 #include "image/image.hpp"
+#include "median_filter/cpu_median_filter.hpp"
+#include "median_filter/rank_filter.hpp"
 
 namespace compute_samples {
 class MedianFilterApplication : public Application {
@@ -23,13 +26,27 @@ private:
     std::string input_image_path = "";
     std::string output_image_path = "";
     std::string kernel_path = "";
+    std::string rank_kernel_path = "";
+    std::string device = "";
+    // global runs median_filter, tiled runs median_filter_tiled
+    std::string kernel_variant = "";
+    MedianBorder border = MedianBorder::clamp;
+    uint32_t border_value = 0;
+    // Runs rank_filter.cl instead of the 3x3 median_filter.cl kernel
+    bool use_rank_filter = false;
+    RankFilterOptions rank_filter;
+    int threads = 0;
     bool help = false;
   };
   Arguments
   parse_command_line(const std::vector<std::string> &command_line) const;
+  std::vector<boost::compute::kernel>
+  create_kernels(const Arguments &args,
+                 const boost::compute::context &context) const;
   void run_median_filter(const Arguments &args,
                          boost::compute::context &context,
                          boost::compute::command_queue &queue) const;
+  void run_cpu_median_filter(const Arguments &args) const;
   void write_image_to_buffer(const ImagePNG32Bit &image,
                              boost::compute::buffer &buffer,
                              boost::compute::command_queue &queue) const;
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_RANK_FILTER_HPP
+#define COMPUTE_SAMPLES_RANK_FILTER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "image/image.hpp"
+#include "median_filter/cpu_median_filter.hpp"
+
+namespace compute_samples {
+
+class ThreadPool;
+
+// Aperture of a filter pass: a square, or a single row or column of pixels
+enum class RankFilterShape { square, row, column };
+
+struct RankFilterOptions {
+  int radius = 1;
+  // Selected value as a percentile of the sorted aperture, 50 is the median
+  int percentile = 50;
+  // Filters rows and then columns with one dimensional apertures, which
+  // approximates the square aperture at a cost linear in the radius
+  bool separable = false;
+};
+
+// Apertures up to this many pixels are sorted by a network, larger ones are
+// searched through histograms
+const int rank_filter_max_network_window = 25;
+const int rank_filter_max_radius = 127;
+
+// Throws std::invalid_argument for options out of range
+void validate(const RankFilterOptions &options);
+std::vector<RankFilterShape>
+rank_filter_passes(const RankFilterOptions &options);
+// Number of pixels in the aperture of a pass
+int rank_filter_window(const int radius, const RankFilterShape shape);
+// Index of the selected value among the sorted pixels of the aperture
+int rank_filter_rank(const int window, const int percentile);
+// Options generating rank_filter.cl for a pass, passed to build_program
+std::string rank_filter_build_options(const RankFilterOptions &options,
+                                      const RankFilterShape shape);
+
+// Host implementation of rank_filter.cl for packed RGBA8 pixels, filtering
+// each channel with a (2 * radius + 1) square aperture. Pixels outside the
+// image are clamped to the nearest edge. Small apertures are sorted by the
+// odd-even transposition network of the kernel, vectorized like
+// CpuMedianFilter. Larger ones keep a histogram per column and slide the sum
+// of 2 * radius + 1 of them along each row, which costs the same for any
+// radius. Bands of rows are split across threads.
+class CpuRankFilter {
+public:
+  explicit CpuRankFilter(const RankFilterOptions &options,
+                         const int thread_count = 1,
+                         const MedianKernel kernel = MedianKernel::automatic);
+  ~CpuRankFilter();
+
+  CpuRankFilter(const CpuRankFilter &) = delete;
+  CpuRankFilter &operator=(const CpuRankFilter &) = delete;
+
+  // Images must have the same size and must not overlap
+  void filter(const ImageView<const uint32_t> &input,
+              const ImageView<uint32_t> &output);
+
+  const RankFilterOptions &options() const { return options_; }
+  MedianKernel kernel() const { return kernel_; }
+  int thread_count() const;
+
+private:
+  void filter_pass(const RankFilterShape shape,
+                   const ImageView<const uint32_t> &input,
+                   const ImageView<uint32_t> &output);
+  void filter_rows(const RankFilterShape shape,
+                   const ImageView<const uint32_t> &input,
+                   const ImageView<uint32_t> &output, const int begin,
+                   const int end) const;
+
+  RankFilterOptions options_;
+  MedianKernel kernel_;
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace compute_samples
+
+#endif
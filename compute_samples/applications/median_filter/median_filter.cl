@@ -5,6 +5,124 @@
  *
  */
 
+// Median of every channel of the 3x3 aperture in uiRGBA
+uint median9(const uint *uiRGBA) {
+  uint uiResult = 0;
+  uint uiMask = 0xFF;
+
+  for (int ch = 0; ch < 4; ch++) {
+
+    // extract next color channel
+    uint r0, r1, r2, r3, r4, r5, r6, r7, r8;
+    r0 = uiRGBA[0] & uiMask;
+    r1 = uiRGBA[1] & uiMask;
+    r2 = uiRGBA[2] & uiMask;
+    r3 = uiRGBA[3] & uiMask;
+    r4 = uiRGBA[4] & uiMask;
+    r5 = uiRGBA[5] & uiMask;
+    r6 = uiRGBA[6] & uiMask;
+    r7 = uiRGBA[7] & uiMask;
+    r8 = uiRGBA[8] & uiMask;
+
+    // perform partial bitonic sort to find current channel median
+    uint uiMin = min(r0, r1);
+    uint uiMax = max(r0, r1);
+    r0 = uiMin;
+    r1 = uiMax;
+
+    uiMin = min(r3, r2);
+    uiMax = max(r3, r2);
+    r3 = uiMin;
+    r2 = uiMax;
+
+    uiMin = min(r2, r0);
+    uiMax = max(r2, r0);
+    r2 = uiMin;
+    r0 = uiMax;
+
+    uiMin = min(r3, r1);
+    uiMax = max(r3, r1);
+    r3 = uiMin;
+    r1 = uiMax;
+
+    uiMin = min(r1, r0);
+    uiMax = max(r1, r0);
+    r1 = uiMin;
+    r0 = uiMax;
+
+    uiMin = min(r3, r2);
+    uiMax = max(r3, r2);
+    r3 = uiMin;
+    r2 = uiMax;
+
+    uiMin = min(r5, r4);
+    uiMax = max(r5, r4);
+    r5 = uiMin;
+    r4 = uiMax;
+
+    uiMin = min(r7, r8);
+    uiMax = max(r7, r8);
+    r7 = uiMin;
+    r8 = uiMax;
+
+    uiMin = min(r6, r8);
+    uiMax = max(r6, r8);
+    r6 = uiMin;
+    r8 = uiMax;
+
+    uiMin = min(r6, r7);
+    uiMax = max(r6, r7);
+    r6 = uiMin;
+    r7 = uiMax;
+
+    uiMin = min(r4, r8);
+    uiMax = max(r4, r8);
+    r4 = uiMin;
+    r8 = uiMax;
+
+    uiMin = min(r4, r6);
+    uiMax = max(r4, r6);
+    r4 = uiMin;
+    r6 = uiMax;
+
+    uiMin = min(r5, r7);
+    uiMax = max(r5, r7);
+    r5 = uiMin;
+    r7 = uiMax;
+
+    uiMin = min(r4, r5);
+    uiMax = max(r4, r5);
+    r4 = uiMin;
+    r5 = uiMax;
+
+    uiMin = min(r6, r7);
+    uiMax = max(r6, r7);
+    r6 = uiMin;
+    r7 = uiMax;
+
+    uiMin = min(r0, r8);
+    uiMax = max(r0, r8);
+    r0 = uiMin;
+    r8 = uiMax;
+
+    r4 = max(r0, r4);
+    r5 = max(r1, r5);
+
+    r6 = max(r2, r6);
+    r7 = max(r3, r7);
+
+    r4 = min(r4, r6);
+    r5 = min(r5, r7);
+
+    // store found median into result
+    uiResult |= r4;
+
+    // update channel mask
+    uiMask <<= 8;
+  }
+  return uiResult;
+}
+
 kernel void median_filter(const global uint *pSrc, global uint *pDst) {
   const int x = get_global_id(0);
   const int y = get_global_id(1);
@@ -34,123 +152,90 @@ kernel void median_filter(const global uint *pSrc, global uint *pDst) {
     uiRGBA[7] = pSrc[iNext + x];
     uiRGBA[8] = pSrc[iNext + x + 1];
 
-    uint uiResult = 0;
-    uint uiMask = 0xFF;
-
-    for (int ch = 0; ch < 4; ch++) {
-
-      // extract next color channel
-      uint r0, r1, r2, r3, r4, r5, r6, r7, r8;
-      r0 = uiRGBA[0] & uiMask;
-      r1 = uiRGBA[1] & uiMask;
-      r2 = uiRGBA[2] & uiMask;
-      r3 = uiRGBA[3] & uiMask;
-      r4 = uiRGBA[4] & uiMask;
-      r5 = uiRGBA[5] & uiMask;
-      r6 = uiRGBA[6] & uiMask;
-      r7 = uiRGBA[7] & uiMask;
-      r8 = uiRGBA[8] & uiMask;
-
-      // perform partial bitonic sort to find current channel median
-      uint uiMin = min(r0, r1);
-      uint uiMax = max(r0, r1);
-      r0 = uiMin;
-      r1 = uiMax;
-
-      uiMin = min(r3, r2);
-      uiMax = max(r3, r2);
-      r3 = uiMin;
-      r2 = uiMax;
-
-      uiMin = min(r2, r0);
-      uiMax = max(r2, r0);
-      r2 = uiMin;
-      r0 = uiMax;
-
-      uiMin = min(r3, r1);
-      uiMax = max(r3, r1);
-      r3 = uiMin;
-      r1 = uiMax;
-
-      uiMin = min(r1, r0);
-      uiMax = max(r1, r0);
-      r1 = uiMin;
-      r0 = uiMax;
-
-      uiMin = min(r3, r2);
-      uiMax = max(r3, r2);
-      r3 = uiMin;
-      r2 = uiMax;
-
-      uiMin = min(r5, r4);
-      uiMax = max(r5, r4);
-      r5 = uiMin;
-      r4 = uiMax;
-
-      uiMin = min(r7, r8);
-      uiMax = max(r7, r8);
-      r7 = uiMin;
-      r8 = uiMax;
-
-      uiMin = min(r6, r8);
-      uiMax = max(r6, r8);
-      r6 = uiMin;
-      r8 = uiMax;
-
-      uiMin = min(r6, r7);
-      uiMax = max(r6, r7);
-      r6 = uiMin;
-      r7 = uiMax;
-
-      uiMin = min(r4, r8);
-      uiMax = max(r4, r8);
-      r4 = uiMin;
-      r8 = uiMax;
-
-      uiMin = min(r4, r6);
-      uiMax = max(r4, r6);
-      r4 = uiMin;
-      r6 = uiMax;
-
-      uiMin = min(r5, r7);
-      uiMax = max(r5, r7);
-      r5 = uiMin;
-      r7 = uiMax;
-
-      uiMin = min(r4, r5);
-      uiMax = max(r4, r5);
-      r4 = uiMin;
-      r5 = uiMax;
-
-      uiMin = min(r6, r7);
-      uiMax = max(r6, r7);
-      r6 = uiMin;
-      r7 = uiMax;
-
-      uiMin = min(r0, r8);
-      uiMax = max(r0, r8);
-      r0 = uiMin;
-      r8 = uiMax;
-
-      r4 = max(r0, r4);
-      r5 = max(r1, r5);
-
-      r6 = max(r2, r6);
-      r7 = max(r3, r7);
-
-      r4 = min(r4, r6);
-      r5 = min(r5, r7);
-
-      // store found median into result
-      uiResult |= r4;
-
-      // update channel mask
-      uiMask <<= 8;
-    }
-
     // store result into memory
-    pDst[iOffset + x] = uiResult;
+    pDst[iOffset + x] = median9(uiRGBA);
   } else {
     pDst[iOffset + x] = pSrc[iOffset + x];
   }
 }
+
+// Work group size of median_filter_tiled, the tile it filters
+#ifndef TILE_WIDTH
+#define TILE_WIDTH 16
+#endif
+#ifndef TILE_HEIGHT
+#define TILE_HEIGHT 16
+#endif
+
+// Pixels read outside the image by median_filter_tiled
+#define BORDER_CLAMP 0
+#define BORDER_MIRROR 1
+#define BORDER_CONSTANT 2
+#ifndef BORDER_MODE
+#define BORDER_MODE BORDER_CLAMP
+#endif
+#ifndef BORDER_VALUE
+#define BORDER_VALUE 0
+#endif
+
+// Reflects i at the edge pixel, which is not repeated. Clamped afterwards,
+// as halos of tiles past the image edge reach further than one pixel.
+int mirror(const int i, const int size) {
+  const int reflected = abs(i);
+  return clamp(reflected >= size ? 2 * size - 2 - reflected : reflected, 0,
+               size - 1);
+}
+
+uint load_pixel(const global uint *pSrc, int x, int y, const int width,
+                const int height) {
+#if BORDER_MODE == BORDER_CONSTANT
+  if (x < 0 || y < 0 || x >= width || y >= height) {
+    return BORDER_VALUE;
+  }
+#elif BORDER_MODE == BORDER_MIRROR
+  x = mirror(x, width);
+  y = mirror(y, height);
+#else
+  x = clamp(x, 0, width - 1);
+  y = clamp(y, 0, height - 1);
+#endif
+  return pSrc[y * width + x];
+}
+
+// Filters every pixel, including the borders. Each work group loads its tile
+// with a one pixel halo into local memory once, so that every source pixel
+// is read from global memory about once instead of 9 times.
+// The global size is rounded up to whole tiles.
+__attribute__((reqd_work_group_size(TILE_WIDTH, TILE_HEIGHT, 1))) kernel void
+median_filter_tiled(const global uint *pSrc, global uint *pDst,
+                    const int width, const int height) {
+  local uint tile[TILE_HEIGHT + 2][TILE_WIDTH + 2];
+
+  const int lx = get_local_id(0);
+  const int ly = get_local_id(1);
+  const int x0 = get_group_id(0) * TILE_WIDTH - 1;
+  const int y0 = get_group_id(1) * TILE_HEIGHT - 1;
+
+  // Work items load consecutive pixels of the tile rows together
+  for (int i = ly * TILE_WIDTH + lx; i < (TILE_WIDTH + 2) * (TILE_HEIGHT + 2);
+       i += TILE_WIDTH * TILE_HEIGHT) {
+    const int tx = i % (TILE_WIDTH + 2);
+    const int ty = i / (TILE_WIDTH + 2);
+    tile[ty][tx] = load_pixel(pSrc, x0 + tx, y0 + ty, width, height);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  const int x = get_global_id(0);
+  const int y = get_global_id(1);
+  if (x >= width || y >= height) {
+    return;
+  }
+
+  uint uiRGBA[9];
+  for (int dy = 0; dy < 3; ++dy) {
+    for (int dx = 0; dx < 3; ++dx) {
+      uiRGBA[dy * 3 + dx] = tile[ly + dy][lx + dx];
+    }
+  }
+  pDst[y * width + x] = median9(uiRGBA);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+// Rank filter of packed RGBA8 pixels, generated per aperture by options:
+//   RADIUS_X, RADIUS_Y  aperture of (2 * RADIUS_X + 1) x (2 * RADIUS_Y + 1)
+//   RANK                index of the selected value among sorted pixels
+//   SORTING_NETWORK     sorts the aperture, meant for small apertures
+// Pixels outside the image are clamped to the nearest edge.
+
+#define WINDOW ((2 * RADIUS_X + 1) * (2 * RADIUS_Y + 1))
+
+uchar4 load_clamped(const global uint *pSrc, const int x, const int y,
+                    const int width, const int height) {
+  return as_uchar4(
+      pSrc[clamp(y, 0, height - 1) * width + clamp(x, 0, width - 1)]);
+}
+
+kernel void rank_filter(const global uint *pSrc, global uint *pDst) {
+  const int x = get_global_id(0);
+  const int y = get_global_id(1);
+
+  const int width = get_global_size(0);
+  const int height = get_global_size(1);
+
+#ifdef SORTING_NETWORK
+  // Channels are sorted together by vector min and max
+  uchar4 v[WINDOW];
+  int n = 0;
+  for (int dy = -RADIUS_Y; dy <= RADIUS_Y; ++dy) {
+    for (int dx = -RADIUS_X; dx <= RADIUS_X; ++dx) {
+      v[n++] = load_clamped(pSrc, x + dx, y + dy, width, height);
+    }
+  }
+
+  // Odd-even transposition sort, a sorting network of WINDOW rounds
+  for (int round = 0; round < WINDOW; ++round) {
+    for (int i = round & 1; i + 1 < WINDOW; i += 2) {
+      const uchar4 low = min(v[i], v[i + 1]);
+      v[i + 1] = max(v[i], v[i + 1]);
+      v[i] = low;
+    }
+  }
+
+  pDst[y * width + x] = as_uint(v[RANK]);
+#else
+  // Finds the selected value bit by bit from the most significant one, by
+  // counting the pixels below the candidate in every channel
+  uint4 prefix = 0;
+  for (int bit = 7; bit >= 0; --bit) {
+    const uint4 candidate = prefix | (uint4)(1u << bit);
+    uint4 below = 0;
+    for (int dy = -RADIUS_Y; dy <= RADIUS_Y; ++dy) {
+      for (int dx = -RADIUS_X; dx <= RADIUS_X; ++dx) {
+        const uint4 value =
+            convert_uint4(load_clamped(pSrc, x + dx, y + dy, width, height));
+        below += select((uint4)(0), (uint4)(1), value < candidate);
+      }
+    }
+    prefix = select(prefix, candidate, below <= (uint4)(RANK));
+  }
+
+  pDst[y * width + x] = as_uint(convert_uchar4(prefix));
+#endif
+}
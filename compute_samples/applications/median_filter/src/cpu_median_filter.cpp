@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "median_filter/cpu_median_filter.hpp"
+#include "packed_min_max.hpp"
+#include "utils/cpu_features.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The kernel masks each channel in place within 32 bits, which orders values
+// the same way as comparing the bytes alone, so packed byte min and max give
+// the same results.
+
+namespace compute_samples {
+namespace {
+// Rows filtered by a single task when an image is split across threads
+const int band_rows = 32;
+
+// Coordinate read for i outside [0, size) by the clamp and mirror borders of
+// median_filter_tiled
+int border_coordinate(const int i, const int size, const MedianBorder border) {
+  if (border == MedianBorder::mirror) {
+    const int reflected = std::abs(i);
+    return std::min(
+        std::max(reflected >= size ? 2 * size - 2 - reflected : reflected, 0),
+        size - 1);
+  }
+  return std::min(std::max(i, 0), size - 1);
+}
+
+// Partial bitonic network of median_filter.cl leaving the median in r[4].
+// The kernel also updates r[5] and r[7] at the end, which does not
+// contribute to r[4] and is left out.
+template <typename Ops> void median9(typename Ops::type (&r)[9]) {
+  Ops::exchange(r[0], r[1]);
+  Ops::exchange(r[3], r[2]);
+  Ops::exchange(r[2], r[0]);
+  Ops::exchange(r[3], r[1]);
+  Ops::exchange(r[1], r[0]);
+  Ops::exchange(r[3], r[2]);
+  Ops::exchange(r[5], r[4]);
+  Ops::exchange(r[7], r[8]);
+  Ops::exchange(r[6], r[8]);
+  Ops::exchange(r[6], r[7]);
+  Ops::exchange(r[4], r[8]);
+  Ops::exchange(r[4], r[6]);
+  Ops::exchange(r[5], r[7]);
+  Ops::exchange(r[4], r[5]);
+  Ops::exchange(r[6], r[7]);
+  Ops::exchange(r[0], r[8]);
+  Ops::keep_max(r[4], r[0]);
+  Ops::keep_max(r[6], r[2]);
+  Ops::keep_min(r[4], r[6]);
+}
+
+uint32_t median_pixel_scalar(const uint32_t *pixel, const ptrdiff_t width) {
+  const ptrdiff_t offsets[9] = {-width - 1, -width, -width + 1,
+                                -1,         0,      1,
+                                width - 1,  width,  width + 1};
+  uint32_t result = 0;
+  for (uint32_t mask = 0xff; mask != 0; mask <<= 8) {
+    uint32_t r[9];
+    for (int k = 0; k < 9; ++k) {
+      r[k] = pixel[offsets[k]] & mask;
+    }
+    median9<packed::ScalarOps>(r);
+    result |= r[4];
+  }
+  return result;
+}
+
+size_t filter_pixels_scalar(const uint32_t *input, uint32_t *output,
+                            const ptrdiff_t width, size_t i,
+                            const size_t end) {
+  for (; i < end; ++i) {
+    output[i] = median_pixel_scalar(input + i, width);
+  }
+  return i;
+}
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+template <typename Ops>
+size_t filter_pixels_packed(const uint32_t *input, uint32_t *output,
+                            const ptrdiff_t width, size_t i,
+                            const size_t end) {
+  const ptrdiff_t offsets[9] = {-width - 1, -width, -width + 1,
+                                -1,         0,      1,
+                                width - 1,  width,  width + 1};
+  for (; i + Ops::pixels <= end; i += Ops::pixels) {
+    typename Ops::type r[9];
+    for (int k = 0; k < 9; ++k) {
+      Ops::load(r[k], input + i + offsets[k]);
+    }
+    median9<Ops>(r);
+    Ops::store(output + i, r[4]);
+  }
+  return i;
+}
+
+COMPUTE_SAMPLES_TARGET("sse2")
+size_t filter_pixels_sse2(const uint32_t *input, uint32_t *output,
+                          const ptrdiff_t width, size_t i, const size_t end) {
+  return filter_pixels_packed<packed::Sse2Ops>(input, output, width, i, end);
+}
+
+COMPUTE_SAMPLES_TARGET("avx2") COMPUTE_SAMPLES_FLATTEN
+size_t filter_pixels_avx2(const uint32_t *input, uint32_t *output,
+                          const ptrdiff_t width, size_t i, const size_t end) {
+  return filter_pixels_packed<packed::Avx2Ops>(input, output, width, i, end);
+}
+#endif
+
+// Filters pixels [i, end), all of which have their whole aperture inside the
+// image
+void filter_pixels(const uint32_t *input, uint32_t *output,
+                   const ptrdiff_t width, size_t i, const size_t end,
+                   const MedianKernel kernel) {
+#if defined(COMPUTE_SAMPLES_X86_64)
+  if (kernel == MedianKernel::avx2) {
+    i = filter_pixels_avx2(input, output, width, i, end);
+  }
+  if (kernel == MedianKernel::avx2 || kernel == MedianKernel::sse2) {
+    i = filter_pixels_sse2(input, output, width, i, end);
+  }
+#else
+  (void)kernel;
+#endif
+  filter_pixels_scalar(input, output, width, i, end);
+}
+
+MedianKernel best_kernel() {
+  if (CpuMedianFilter::is_supported(MedianKernel::avx2)) {
+    return MedianKernel::avx2;
+  }
+  if (CpuMedianFilter::is_supported(MedianKernel::sse2)) {
+    return MedianKernel::sse2;
+  }
+  return MedianKernel::scalar;
+}
+} // namespace
+
+std::string median_filter_tiled_build_options(const MedianBorder border,
+                                              const uint32_t border_value) {
+  const int tile = median_filter_tile_size;
+  return "-DTILE_WIDTH=" + std::to_string(tile) +
+         " -DTILE_HEIGHT=" + std::to_string(tile) +
+         " -DBORDER_MODE=" + std::to_string(static_cast<int>(border)) +
+         " -DBORDER_VALUE=" + std::to_string(border_value) + "u";
+}
+
+CpuMedianFilter::CpuMedianFilter(const int thread_count,
+                                 const MedianKernel kernel)
+    : kernel_(kernel) {
+  if (kernel_ == MedianKernel::automatic) {
+    kernel_ = best_kernel();
+  } else if (!is_supported(kernel_)) {
+    throw std::invalid_argument(std::string("Median filter kernel is not "
+                                            "supported on this processor: ") +
+                                kernel_name(kernel_));
+  }
+  if (thread_count != 1) {
+    pool_.reset(new ThreadPool(thread_count));
+  }
+}
+
+CpuMedianFilter::~CpuMedianFilter() = default;
+
+int CpuMedianFilter::thread_count() const { return pool_ ? pool_->size() : 1; }
+
+bool CpuMedianFilter::is_supported(const MedianKernel kernel) {
+  switch (kernel) {
+  case MedianKernel::automatic:
+  case MedianKernel::scalar:
+    return true;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  case MedianKernel::sse2:
+    return cpu_features().sse2;
+  case MedianKernel::avx2:
+    return cpu_features().avx2;
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *CpuMedianFilter::kernel_name(const MedianKernel kernel) {
+  switch (kernel) {
+  case MedianKernel::automatic:
+    return "automatic";
+  case MedianKernel::scalar:
+    return "scalar";
+  case MedianKernel::sse2:
+    return "sse2";
+  case MedianKernel::avx2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+const char *CpuMedianFilter::border_name(const MedianBorder border) {
+  switch (border) {
+  case MedianBorder::clamp:
+    return "clamp";
+  case MedianBorder::mirror:
+    return "mirror";
+  case MedianBorder::constant:
+    return "constant";
+  }
+  return "unknown";
+}
+
+void CpuMedianFilter::filter_range(const uint32_t *input, uint32_t *output,
+                                   const int width, const size_t size,
+                                   const size_t begin, const size_t end) const {
+  // The kernel filters pixel i only if i - width - 1 >= 0 and
+  // i + width + 1 < size, and copies every other pixel
+  const size_t border = static_cast<size_t>(width) + 1;
+  const size_t first = std::min(std::max(begin, border), end);
+  const size_t last =
+      size > border ? std::max(first, std::min(end, size - border)) : first;
+  std::copy(input + begin, input + first, output + begin);
+  filter_pixels(input, output, width, first, last, kernel_);
+  std::copy(input + last, input + end, output + last);
+}
+
+void CpuMedianFilter::filter(const uint32_t *input, uint32_t *output,
+                             const int width, const int height) {
+  if (width < 0 || height < 0) {
+    throw std::invalid_argument("Median filter image size is negative");
+  }
+  if (input == output) {
+    throw std::invalid_argument("Median filter cannot run in place");
+  }
+  const size_t size = static_cast<size_t>(width) * height;
+  if (!pool_ || height <= band_rows) {
+    filter_range(input, output, width, size, 0, size);
+    return;
+  }
+  std::vector<std::future<void>> bands;
+  for (int y = 0; y < height; y += band_rows) {
+    const size_t begin = static_cast<size_t>(y) * width;
+    const size_t end = static_cast<size_t>(std::min(height, y + band_rows)) *
+                       static_cast<size_t>(width);
+    bands.push_back(pool_->submit([=]() {
+      filter_range(input, output, width, size, begin, end);
+    }));
+  }
+  for (std::future<void> &band : bands) {
+    band.get();
+  }
+}
+
+void CpuMedianFilter::filter(const ImageView<const uint32_t> &input,
+                             const ImageView<uint32_t> &output,
+                             const MedianBorder border,
+                             const uint32_t border_value) {
+  if (input.width() != output.width() || input.height() != output.height()) {
+    throw std::invalid_argument("Median filter images differ in size");
+  }
+  if (input.width() < 0 || input.height() < 0) {
+    throw std::invalid_argument("Median filter image size is negative");
+  }
+  if (input.data() == output.data()) {
+    throw std::invalid_argument("Median filter cannot run in place");
+  }
+  const int width = input.width();
+  const int height = input.height();
+  if (width == 0 || height == 0) {
+    return;
+  }
+
+  // Copies the image into one with a single pixel border, so that every
+  // aperture is read by the linear kernels without checking coordinates
+  const int pitch = width + 2;
+  std::vector<uint32_t> pixels(static_cast<size_t>(pitch) * (height + 2));
+  for (int y = -1; y <= height; ++y) {
+    uint32_t *row = pixels.data() + static_cast<size_t>(y + 1) * pitch + 1;
+    const bool inside = y >= 0 && y < height;
+    if (border == MedianBorder::constant) {
+      std::fill(row - 1, row + width + 1, border_value);
+      if (inside) {
+        std::copy(input.row(y), input.row(y) + width, row);
+      }
+      continue;
+    }
+    const uint32_t *source =
+        input.row(inside ? y : border_coordinate(y, height, border));
+    std::copy(source, source + width, row);
+    row[-1] = source[border_coordinate(-1, width, border)];
+    row[width] = source[border_coordinate(width, width, border)];
+  }
+  const ImageView<const uint32_t> padded(pixels.data() + pitch + 1, width,
+                                         height, pitch);
+
+  if (!pool_ || height <= band_rows) {
+    filter_padded_rows(padded, output, 0, height);
+    return;
+  }
+  std::vector<std::future<void>> bands;
+  for (int y = 0; y < height; y += band_rows) {
+    const int end = std::min(height, y + band_rows);
+    bands.push_back(pool_->submit([=, &padded, &output]() {
+      filter_padded_rows(padded, output, y, end);
+    }));
+  }
+  for (std::future<void> &band : bands) {
+    band.get();
+  }
+}
+
+void CpuMedianFilter::filter_padded_rows(
+    const ImageView<const uint32_t> &padded, const ImageView<uint32_t> &output,
+    const int begin, const int end) const {
+  for (int y = begin; y < end; ++y) {
+    filter_pixels(padded.row(y), output.row(y), padded.pitch(), 0,
+                  static_cast<size_t>(padded.width()), kernel_);
+  }
+}
+
+} // namespace compute_samples
@@ -6,8 +6,11 @@
  */
 
 #include "median_filter/median_filter.hpp"
+#include "median_filter/cpu_median_filter.hpp"
 
 #include <iostream>
+#include <string>
+#include <stdexcept>
 
 #include <boost/program_options.hpp>
 
@@ -17,11 +20,34 @@
 #include "timer/timer.hpp"
 #include "ocl_utils/ocl_utils.hpp"
 #include "logging/logging.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace po = boost::program_options;
 namespace compute = boost::compute;
 
 namespace compute_samples {
+namespace {
+void log_throughput(const ImagePNG32Bit &image, const double seconds) {
+  const double pixels = static_cast<double>(image.width()) * image.height();
+  LOG_INFO << "Filter throughput: " << pixels / seconds * 1e-6
+           << " Mpixels/s";
+}
+
+MedianBorder parse_border(const std::string &name) {
+  for (const MedianBorder border :
+       {MedianBorder::clamp, MedianBorder::mirror, MedianBorder::constant}) {
+    if (name == CpuMedianFilter::border_name(border)) {
+      return border;
+    }
+  }
+  throw std::invalid_argument("Invalid argument for border.");
+}
+
+size_t round_up(const size_t value, const size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+} // namespace
+
 Application::Status MedianFilterApplication::run_implementation(
     std::vector<std::string> &command_line) {
   const Arguments args = parse_command_line(command_line);
@@ -29,6 +55,11 @@ Application::Status MedianFilterApplication::run_implementation(
     return Status::SKIP;
   }
 
+  if (args.device == "cpu") {
+    run_cpu_median_filter(args);
+    return Status::OK;
+  }
+
   const compute::device device = compute::system::default_device();
   LOG_INFO << "OpenCL device: " << device.name();
   compute::context context(device);
@@ -55,6 +86,40 @@ MedianFilterApplication::Arguments MedianFilterApplication::parse_command_line(
           po::value<std::string>(&args.kernel_path)
               ->default_value("median_filter.cl"),
           "path to kernel");
+  options("rank-kernel",
+          po::value<std::string>(&args.rank_kernel_path)
+              ->default_value("rank_filter.cl"),
+          "path to rank filter kernel");
+  options("radius", po::value<int>(&args.rank_filter.radius),
+          "aperture radius of the rank filter, without it the 3x3 median "
+          "filter kernel runs");
+  options("percentile",
+          po::value<int>(&args.rank_filter.percentile)->default_value(50),
+          "value selected by the rank filter as a percentile of the sorted "
+          "aperture, 50 is the median");
+  options("separable",
+          po::bool_switch(&args.rank_filter.separable)->default_value(false),
+          "approximate the square aperture of the rank filter by a row pass "
+          "followed by a column pass");
+  options("kernel-variant",
+          po::value<std::string>(&args.kernel_variant)
+              ->default_value("global"),
+          "median filter kernel: global reads every aperture from global "
+          "memory, tiled stages tiles in local memory and filters borders");
+  std::string border;
+  options("border", po::value<std::string>(&border)->default_value("clamp"),
+          "pixels read outside the image by the tiled kernel: clamp, mirror "
+          "or constant");
+  options("border-value",
+          po::value<uint32_t>(&args.border_value)->default_value(0),
+          "packed RGBA pixel read outside the image by the constant border");
+  options("device",
+          po::value<std::string>(&args.device)->default_value("opencl"),
+          "device filtering the image: opencl or cpu");
+  options("threads",
+          po::value<int>(&args.threads)
+              ->default_value(ThreadPool::hardware_threads()),
+          "number of threads filtering the image on the cpu device");
 
   po::positional_options_description p;
   p.add("input-image", 1);
@@ -72,6 +137,35 @@ MedianFilterApplication::Arguments MedianFilterApplication::parse_command_line(
   }
 
   po::notify(vm);
+
+  if (args.device != "opencl" && args.device != "cpu") {
+    throw std::invalid_argument("Invalid argument for device.");
+  }
+
+  if (args.threads < 1) {
+    throw std::invalid_argument("Invalid argument for threads.");
+  }
+
+  if (args.kernel_variant != "global" && args.kernel_variant != "tiled") {
+    throw std::invalid_argument("Invalid argument for kernel-variant.");
+  }
+
+  args.border = parse_border(border);
+  if (args.kernel_variant != "tiled" &&
+      (!vm["border"].defaulted() || !vm["border-value"].defaulted())) {
+    throw std::invalid_argument("Border options need the tiled kernel.");
+  }
+
+  args.use_rank_filter = vm.count("radius") != 0u;
+  if (args.use_rank_filter) {
+    validate(args.rank_filter);
+  } else if (args.rank_filter.separable || !vm["percentile"].defaulted()) {
+    throw std::invalid_argument("Rank filter options need a radius.");
+  }
+  if (args.use_rank_filter && args.kernel_variant == "tiled") {
+    throw std::invalid_argument("Rank filter has no tiled kernel.");
+  }
+
   return args;
 }
 
@@ -88,32 +182,146 @@ void MedianFilterApplication::run_median_filter(
   LOG_INFO << "Number of channels: " << image.number_of_channels();
   timer.print("Image read");
 
-  compute::buffer input_buffer(context, size_in_bytes(image),
-                               compute::memory_object::read_only);
-  compute::buffer output_buffer(context, size_in_bytes(image),
-                                compute::memory_object::write_only);
+  // Both buffers wrap page aligned image storage, so transfers below only
+  // map and unmap the pixels instead of copying them
+  ImagePNG32Bit output_image(image.width(), image.height());
+  compute::buffer input_buffer(context, image.storage_size_in_bytes(),
+                               compute::memory_object::read_only |
+                                   compute::memory_object::use_host_ptr,
+                               image.raw_data());
+  compute::buffer output_buffer(context, output_image.storage_size_in_bytes(),
+                                compute::memory_object::write_only |
+                                    compute::memory_object::use_host_ptr,
+                                output_image.raw_data());
 
-  compute::program program = build_program(context, args.kernel_path);
-  compute::kernel kernel = program.create_kernel("median_filter");
-  kernel.set_args(input_buffer, output_buffer);
-  LOG_INFO << "Kernel path: " << args.kernel_path;
+  std::vector<compute::kernel> kernels = create_kernels(args, context);
   timer.print("Kernel created");
 
+  // Separable rank filters pass the filtered rows to the column pass
+  compute::buffer rows_buffer;
+  if (kernels.size() > 1) {
+    rows_buffer = compute::buffer(context, size_in_bytes(image));
+  }
+
   write_image_to_buffer(image, input_buffer, queue);
   timer.print("Input queued");
 
-  queue.enqueue_nd_range_kernel(
-      kernel, 2, nullptr, compute::dim(image.width(), image.height()).data(),
-      nullptr);
+  Timer kernel_timer;
+  if (args.kernel_variant == "tiled") {
+    // Work groups past the image edge only load their halo
+    const size_t tile = median_filter_tile_size;
+    kernels.front().set_args(input_buffer, output_buffer, image.width(),
+                             image.height());
+    queue.enqueue_nd_range_kernel(
+        kernels.front(), 2, nullptr,
+        compute::dim(round_up(image.width(), tile),
+                     round_up(image.height(), tile))
+            .data(),
+        compute::dim(tile, tile).data());
+  } else {
+    for (size_t i = 0; i < kernels.size(); ++i) {
+      kernels[i].set_args(i == 0 ? input_buffer : rows_buffer,
+                          i + 1 == kernels.size() ? output_buffer
+                                                  : rows_buffer);
+      queue.enqueue_nd_range_kernel(
+          kernels[i], 2, nullptr,
+          compute::dim(image.width(), image.height()).data(), nullptr);
+    }
+  }
   timer.print("Kernel queued");
 
   queue.finish();
+  log_throughput(image, kernel_timer.elapsed());
   timer.print("Kernel finished");
 
-  read_buffer_to_image(output_buffer, image, queue);
+  read_buffer_to_image(output_buffer, output_image, queue);
   timer.print("Output ready");
 
-  image.write(args.output_image_path);
+  output_image.write(args.output_image_path);
+  LOG_INFO << "Output image path: " << args.output_image_path;
+  timer.print("Report");
+
+  timer_total.print("Total");
+}
+
+std::vector<compute::kernel> MedianFilterApplication::create_kernels(
+    const MedianFilterApplication::Arguments &args,
+    const compute::context &context) const {
+  if (args.kernel_variant == "tiled") {
+    LOG_INFO << "Kernel path: " << args.kernel_path;
+    const std::string options =
+        median_filter_tiled_build_options(args.border, args.border_value);
+    LOG_INFO << "Build options: " << options;
+    const compute::program program =
+        build_program(context, args.kernel_path, options);
+    return {program.create_kernel("median_filter_tiled")};
+  }
+  if (!args.use_rank_filter) {
+    LOG_INFO << "Kernel path: " << args.kernel_path;
+    const compute::program program = build_program(context, args.kernel_path);
+    return {program.create_kernel("median_filter")};
+  }
+
+  // Every pass is a separate program generated for its aperture
+  LOG_INFO << "Kernel path: " << args.rank_kernel_path;
+  std::vector<compute::kernel> kernels;
+  for (const RankFilterShape shape : rank_filter_passes(args.rank_filter)) {
+    const std::string options =
+        rank_filter_build_options(args.rank_filter, shape);
+    LOG_INFO << "Build options: " << options;
+    const compute::program program =
+        build_program(context, args.rank_kernel_path, options);
+    kernels.push_back(program.create_kernel("rank_filter"));
+  }
+  return kernels;
+}
+
+void MedianFilterApplication::run_cpu_median_filter(
+    const MedianFilterApplication::Arguments &args) const {
+  Timer timer_total;
+  Timer timer;
+
+  ImagePNG32Bit image(args.input_image_path);
+  LOG_INFO << "Input image path: " << args.input_image_path;
+  LOG_INFO << "Image size: " << image.width() << "x" << image.height()
+           << " pixels";
+  LOG_INFO << "Number of channels: " << image.number_of_channels();
+  timer.print("Image read");
+
+  ImagePNG32Bit output_image(image.width(), image.height());
+  if (args.use_rank_filter) {
+    CpuRankFilter filter(args.rank_filter, args.threads);
+    LOG_INFO << "CPU kernel: " << CpuMedianFilter::kernel_name(filter.kernel())
+             << ", " << filter.thread_count() << " threads";
+    timer.print("Filter created");
+
+    Timer filter_timer;
+    const Image<uint32_t> &input_image = image;
+    filter.filter(input_image.view(), output_image.view());
+    log_throughput(image, filter_timer.elapsed());
+  } else {
+    CpuMedianFilter filter(args.threads);
+    LOG_INFO << "CPU kernel: " << CpuMedianFilter::kernel_name(filter.kernel())
+             << ", " << filter.thread_count() << " threads";
+    if (args.kernel_variant == "tiled") {
+      LOG_INFO << "Border: " << CpuMedianFilter::border_name(args.border);
+    }
+    timer.print("Filter created");
+
+    Timer filter_timer;
+    if (args.kernel_variant == "tiled") {
+      const Image<uint32_t> &input_image = image;
+      filter.filter(input_image.view(), output_image.view(), args.border,
+                    args.border_value);
+    } else {
+      filter.filter(image.raw_data(), output_image.raw_data(), image.width(),
+                    image.height());
+    }
+    log_throughput(image, filter_timer.elapsed());
+  }
+  timer.print("Filter finished");
+
+  output_image.write(args.output_image_path);
   LOG_INFO << "Output image path: " << args.output_image_path;
   timer.print("Report");
 
@@ -123,18 +331,24 @@ void MedianFilterApplication::run_median_filter(
 void MedianFilterApplication::write_image_to_buffer(
     const ImagePNG32Bit &image, compute::buffer &buffer,
     compute::command_queue &queue) const {
-  uint32_t *mapped_buffer = static_cast<uint32_t *>(queue.enqueue_map_buffer(
-      buffer, compute::command_queue::map_write, 0, size_in_bytes(image)));
-  std::copy(image.raw_data(), image.raw_data() + image.size(), mapped_buffer);
+  void *mapped_buffer = queue.enqueue_map_buffer(
+      buffer, compute::command_queue::map_write, 0, size_in_bytes(image));
+  // Buffers created over the image storage map back to the same pixels
+  if (mapped_buffer != image.raw_data()) {
+    std::copy(image.raw_data(), image.raw_data() + image.size(),
+              static_cast<uint32_t *>(mapped_buffer));
+  }
   queue.enqueue_unmap_buffer(buffer, mapped_buffer);
 }
 
 void MedianFilterApplication::read_buffer_to_image(
     compute::buffer &buffer, ImagePNG32Bit &image,
     compute::command_queue &queue) const {
-  uint32_t *mapped_buffer = static_cast<uint32_t *>(queue.enqueue_map_buffer(
-      buffer, compute::command_queue::map_read, 0, size_in_bytes(image)));
-  image.copy_raw_data(mapped_buffer);
+  void *mapped_buffer = queue.enqueue_map_buffer(
+      buffer, compute::command_queue::map_read, 0, size_in_bytes(image));
+  if (mapped_buffer != image.raw_data()) {
+    image.copy_raw_data(static_cast<uint32_t *>(mapped_buffer));
+  }
   queue.enqueue_unmap_buffer(buffer, mapped_buffer);
 }
 } // namespace compute_samples
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_MEDIAN_FILTER_PACKED_MIN_MAX_HPP
+#define COMPUTE_SAMPLES_MEDIAN_FILTER_PACKED_MIN_MAX_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+#include "utils/cpu_features.hpp"
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+#include <immintrin.h>
+#endif
+
+// Min and max operations of sorting networks over RGBA8 pixels. Channels are
+// independent, so min and max of packed unsigned bytes process every channel
+// of 4 (sse2) or 8 (avx2) pixels at once. The scalar operations compare one
+// channel of a pixel, masked in place within 32 bits like median_filter.cl.
+// Operations take references, so that 256-bit values are never passed by
+// value between functions compiled for different instruction sets.
+
+// GCC does not inline target specific operations into a generic network when
+// only its caller is compiled for the target, flattening the caller inlines
+// the whole network
+#if defined(__GNUC__) || defined(__clang__)
+#define COMPUTE_SAMPLES_FLATTEN __attribute__((flatten))
+#else
+#define COMPUTE_SAMPLES_FLATTEN
+#endif
+
+namespace compute_samples {
+namespace packed {
+
+struct ScalarOps {
+  typedef uint32_t type;
+  // Leaves the smaller value in a and the larger in b
+  static void exchange(type &a, type &b) {
+    const type low = std::min(a, b);
+    b = std::max(a, b);
+    a = low;
+  }
+  static void keep_max(type &a, const type &b) { a = std::max(a, b); }
+  static void keep_min(type &a, const type &b) { a = std::min(a, b); }
+};
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+struct Sse2Ops {
+  typedef __m128i type;
+  static const int pixels = 4;
+  COMPUTE_SAMPLES_TARGET("sse2")
+  static void exchange(type &a, type &b) {
+    const type low = _mm_min_epu8(a, b);
+    b = _mm_max_epu8(a, b);
+    a = low;
+  }
+  COMPUTE_SAMPLES_TARGET("sse2")
+  static void keep_max(type &a, const type &b) { a = _mm_max_epu8(a, b); }
+  COMPUTE_SAMPLES_TARGET("sse2")
+  static void keep_min(type &a, const type &b) { a = _mm_min_epu8(a, b); }
+  COMPUTE_SAMPLES_TARGET("sse2")
+  static void load(type &a, const uint32_t *pixels) {
+    a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels));
+  }
+  COMPUTE_SAMPLES_TARGET("sse2")
+  static void store(uint32_t *pixels, const type &a) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels), a);
+  }
+};
+
+struct Avx2Ops {
+  typedef __m256i type;
+  static const int pixels = 8;
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static void exchange(type &a, type &b) {
+    const type low = _mm256_min_epu8(a, b);
+    b = _mm256_max_epu8(a, b);
+    a = low;
+  }
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static void keep_max(type &a, const type &b) { a = _mm256_max_epu8(a, b); }
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static void keep_min(type &a, const type &b) { a = _mm256_min_epu8(a, b); }
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static void load(type &a, const uint32_t *pixels) {
+    a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels));
+  }
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static void store(uint32_t *pixels, const type &a) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels), a);
+  }
+};
+#endif
+
+} // namespace packed
+} // namespace compute_samples
+
+#endif
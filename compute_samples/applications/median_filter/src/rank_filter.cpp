@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "median_filter/rank_filter.hpp"
+#include "packed_min_max.hpp"
+#include "utils/cpu_features.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace compute_samples {
+namespace {
+// Rows filtered by a single task when an image is split across threads
+const int band_rows = 32;
+const int bins = 256;
+const int coarse_bins = 16;
+
+struct Aperture {
+  int radius_x;
+  int radius_y;
+  int window;
+  int rank;
+};
+
+Aperture make_aperture(const RankFilterOptions &options,
+                       const RankFilterShape shape) {
+  Aperture a;
+  a.radius_x = shape == RankFilterShape::column ? 0 : options.radius;
+  a.radius_y = shape == RankFilterShape::row ? 0 : options.radius;
+  a.window = rank_filter_window(options.radius, shape);
+  a.rank = rank_filter_rank(a.window, options.percentile);
+  return a;
+}
+
+int clamp(const int value, const int low, const int high) {
+  return std::min(std::max(value, low), high);
+}
+
+// Odd-even transposition sort of rank_filter.cl, a sorting network of
+// window rounds
+template <typename Ops> void sort_window(typename Ops::type *v, const int n) {
+  for (int round = 0; round < n; ++round) {
+    for (int i = round & 1; i + 1 < n; i += 2) {
+      Ops::exchange(v[i], v[i + 1]);
+    }
+  }
+}
+
+// rows holds the 2 * radius_y + 1 rows of the aperture, clamped to the image
+uint32_t network_pixel_scalar(const Aperture &a, const uint32_t *const *rows,
+                              const int x, const int width) {
+  uint32_t result = 0;
+  for (uint32_t mask = 0xff; mask != 0; mask <<= 8) {
+    uint32_t v[rank_filter_max_network_window];
+    int n = 0;
+    for (int k = 0; k <= 2 * a.radius_y; ++k) {
+      for (int dx = -a.radius_x; dx <= a.radius_x; ++dx) {
+        v[n++] = rows[k][clamp(x + dx, 0, width - 1)] & mask;
+      }
+    }
+    sort_window<packed::ScalarOps>(v, n);
+    result |= v[a.rank];
+  }
+  return result;
+}
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+// Filters pixels from x on whose aperture lies inside the row, up to end
+template <typename Ops>
+int network_pixels_packed(const Aperture &a, const uint32_t *const *rows,
+                          uint32_t *output, int x, const int end) {
+  for (; x + Ops::pixels <= end; x += Ops::pixels) {
+    typename Ops::type v[rank_filter_max_network_window];
+    int n = 0;
+    for (int k = 0; k <= 2 * a.radius_y; ++k) {
+      for (int dx = -a.radius_x; dx <= a.radius_x; ++dx) {
+        Ops::load(v[n++], rows[k] + x + dx);
+      }
+    }
+    sort_window<Ops>(v, n);
+    Ops::store(output + x, v[a.rank]);
+  }
+  return x;
+}
+
+COMPUTE_SAMPLES_TARGET("sse2")
+int network_pixels_sse2(const Aperture &a, const uint32_t *const *rows,
+                        uint32_t *output, const int x, const int end) {
+  return network_pixels_packed<packed::Sse2Ops>(a, rows, output, x, end);
+}
+
+COMPUTE_SAMPLES_TARGET("avx2") COMPUTE_SAMPLES_FLATTEN
+int network_pixels_avx2(const Aperture &a, const uint32_t *const *rows,
+                        uint32_t *output, const int x, const int end) {
+  return network_pixels_packed<packed::Avx2Ops>(a, rows, output, x, end);
+}
+#endif
+
+void network_row(const Aperture &a, const uint32_t *const *rows,
+                 uint32_t *output, const int width, const MedianKernel kernel) {
+  // Pixels closer than radius_x to an edge read clamped columns
+  const int begin = std::min(a.radius_x, width);
+  const int end = std::max(begin, width - a.radius_x);
+  for (int x = 0; x < begin; ++x) {
+    output[x] = network_pixel_scalar(a, rows, x, width);
+  }
+  int x = begin;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  if (kernel == MedianKernel::avx2) {
+    x = network_pixels_avx2(a, rows, output, x, end);
+  }
+  if (kernel == MedianKernel::avx2 || kernel == MedianKernel::sse2) {
+    x = network_pixels_sse2(a, rows, output, x, end);
+  }
+#else
+  (void)kernel;
+#endif
+  for (; x < width; ++x) {
+    output[x] = network_pixel_scalar(a, rows, x, width);
+  }
+}
+
+// Histogram of one channel with 256 fine bins and 16 coarse bins, each
+// coarse bin counting a segment of 16 fine ones. Counts fit 16 bits up to the
+// largest aperture of rank_filter_max_radius.
+struct Histogram {
+  uint16_t fine[bins];
+  uint16_t coarse[coarse_bins];
+};
+
+const int segment_bins = bins / coarse_bins;
+
+void count(Histogram &h, const uint32_t value, const int step) {
+  h.fine[value] = static_cast<uint16_t>(h.fine[value] + step);
+  h.coarse[value / segment_bins] =
+      static_cast<uint16_t>(h.coarse[value / segment_bins] + step);
+}
+
+// Adds sign times the n bins of column to bins
+void accumulate(uint16_t *bins, const uint16_t *column, const int n,
+                const int sign) {
+  for (int i = 0; i < n; ++i) {
+    bins[i] = static_cast<uint16_t>(bins[i] + sign * column[i]);
+  }
+}
+
+// Histogram of the aperture moving right along a row over the histograms of
+// the columns. Coarse bins follow every move. A segment of fine bins only
+// catches up when the selected value falls into it, which for natural images
+// is mostly the segment of the previous pixel, so that most moves cost 16
+// coarse and 16 fine bins.
+class ApertureHistogram {
+public:
+  ApertureHistogram(const std::vector<Histogram> &columns, const int radius)
+      : columns_(columns), radius_(radius) {}
+
+  void start_row() {
+    x_ = 0;
+    std::fill_n(coarse_, coarse_bins, uint16_t(0));
+    for (int dx = -radius_; dx <= radius_; ++dx) {
+      accumulate(coarse_, column(dx).coarse, coarse_bins, 1);
+    }
+    // Segments this far behind are summed again from the columns
+    std::fill_n(synced_, coarse_bins, x_ - 2 * radius_ - 2);
+  }
+
+  void move_right() {
+    ++x_;
+    accumulate(coarse_, column(x_ + radius_).coarse, coarse_bins, 1);
+    accumulate(coarse_, column(x_ - radius_ - 1).coarse, coarse_bins, -1);
+  }
+
+  // Value of the given rank, found through the coarse bins first
+  uint32_t select(const int rank) {
+    int seen = 0;
+    int segment = 0;
+    while (seen + coarse_[segment] <= rank) {
+      seen += coarse_[segment++];
+    }
+    sync(segment);
+    int bin = segment * segment_bins;
+    while (seen + fine_[bin] <= rank) {
+      seen += fine_[bin++];
+    }
+    return static_cast<uint32_t>(bin);
+  }
+
+private:
+  const Histogram &column(const int x) const {
+    return columns_[clamp(x, 0, static_cast<int>(columns_.size()) - 1)];
+  }
+
+  void sync(const int segment) {
+    const int first = segment * segment_bins;
+    uint16_t *fine = fine_ + first;
+    if (x_ - synced_[segment] > 2 * radius_ + 1) {
+      std::fill_n(fine, segment_bins, uint16_t(0));
+      for (int dx = -radius_; dx <= radius_; ++dx) {
+        accumulate(fine, column(x_ + dx).fine + first, segment_bins, 1);
+      }
+    } else {
+      for (int x = synced_[segment] + 1; x <= x_; ++x) {
+        accumulate(fine, column(x + radius_).fine + first, segment_bins, 1);
+        accumulate(fine, column(x - radius_ - 1).fine + first, segment_bins,
+                   -1);
+      }
+    }
+    synced_[segment] = x_;
+  }
+
+  const std::vector<Histogram> &columns_;
+  const int radius_;
+  int x_ = 0;
+  uint16_t fine_[bins];
+  uint16_t coarse_[coarse_bins];
+  // Position of the aperture at the last update of each fine segment
+  int synced_[coarse_bins];
+};
+
+// Constant time filter of Perreault and Hebert, "Median Filtering in
+// Constant Time". Column histograms move down one row per output row and the
+// aperture histogram moves right by adding and removing whole columns.
+void histogram_rows(const Aperture &a, const ImageView<const uint32_t> &input,
+                    const ImageView<uint32_t> &output, const int begin,
+                    const int end) {
+  const int width = input.width();
+  const int height = input.height();
+  std::vector<Histogram> columns(width);
+  ApertureHistogram aperture(columns, a.radius_x);
+  for (int shift = 0; shift < 32; shift += 8) {
+    const uint32_t mask = 0xffu << shift;
+    std::fill(columns.begin(), columns.end(), Histogram());
+    for (int dy = -a.radius_y; dy <= a.radius_y; ++dy) {
+      const uint32_t *row = input.row(clamp(begin + dy, 0, height - 1));
+      for (int x = 0; x < width; ++x) {
+        count(columns[x], (row[x] & mask) >> shift, 1);
+      }
+    }
+    for (int y = begin; y < end; ++y) {
+      if (y > begin) {
+        const uint32_t *removed =
+            input.row(clamp(y - a.radius_y - 1, 0, height - 1));
+        const uint32_t *added = input.row(clamp(y + a.radius_y, 0, height - 1));
+        for (int x = 0; x < width; ++x) {
+          count(columns[x], (removed[x] & mask) >> shift, -1);
+          count(columns[x], (added[x] & mask) >> shift, 1);
+        }
+      }
+      uint32_t *out = output.row(y);
+      aperture.start_row();
+      for (int x = 0; x < width; ++x) {
+        if (x > 0) {
+          aperture.move_right();
+        }
+        const uint32_t value = aperture.select(a.rank) << shift;
+        out[x] = shift == 0 ? value : (out[x] | value);
+      }
+    }
+  }
+}
+
+MedianKernel best_kernel() {
+  if (CpuMedianFilter::is_supported(MedianKernel::avx2)) {
+    return MedianKernel::avx2;
+  }
+  if (CpuMedianFilter::is_supported(MedianKernel::sse2)) {
+    return MedianKernel::sse2;
+  }
+  return MedianKernel::scalar;
+}
+} // namespace
+
+void validate(const RankFilterOptions &options) {
+  if (options.radius < 1 || options.radius > rank_filter_max_radius) {
+    throw std::invalid_argument(
+        "Invalid argument for radius. Valid range (1-" +
+        std::to_string(rank_filter_max_radius) + ").");
+  }
+  if (options.percentile < 0 || options.percentile > 100) {
+    throw std::invalid_argument(
+        "Invalid argument for percentile. Valid range (0-100).");
+  }
+}
+
+std::vector<RankFilterShape>
+rank_filter_passes(const RankFilterOptions &options) {
+  if (options.separable) {
+    return {RankFilterShape::row, RankFilterShape::column};
+  }
+  return {RankFilterShape::square};
+}
+
+int rank_filter_window(const int radius, const RankFilterShape shape) {
+  const int side = 2 * radius + 1;
+  return shape == RankFilterShape::square ? side * side : side;
+}
+
+int rank_filter_rank(const int window, const int percentile) {
+  return (percentile * (window - 1) + 50) / 100;
+}
+
+std::string rank_filter_build_options(const RankFilterOptions &options,
+                                      const RankFilterShape shape) {
+  const Aperture a = make_aperture(options, shape);
+  std::string build_options = "-DRADIUS_X=" + std::to_string(a.radius_x) +
+                              " -DRADIUS_Y=" + std::to_string(a.radius_y) +
+                              " -DRANK=" + std::to_string(a.rank);
+  if (a.window <= rank_filter_max_network_window) {
+    build_options += " -DSORTING_NETWORK";
+  }
+  return build_options;
+}
+
+CpuRankFilter::CpuRankFilter(const RankFilterOptions &options,
+                             const int thread_count, const MedianKernel kernel)
+    : options_(options), kernel_(kernel) {
+  validate(options_);
+  if (kernel_ == MedianKernel::automatic) {
+    kernel_ = best_kernel();
+  } else if (!CpuMedianFilter::is_supported(kernel_)) {
+    throw std::invalid_argument(
+        std::string("Rank filter kernel is not supported on this processor: ") +
+        CpuMedianFilter::kernel_name(kernel_));
+  }
+  if (thread_count != 1) {
+    pool_.reset(new ThreadPool(thread_count));
+  }
+}
+
+CpuRankFilter::~CpuRankFilter() = default;
+
+int CpuRankFilter::thread_count() const { return pool_ ? pool_->size() : 1; }
+
+void CpuRankFilter::filter(const ImageView<const uint32_t> &input,
+                           const ImageView<uint32_t> &output) {
+  if (input.width() != output.width() || input.height() != output.height()) {
+    throw std::invalid_argument("Rank filter images differ in size");
+  }
+  if (input.width() == 0 || input.height() == 0) {
+    return;
+  }
+  if (!options_.separable) {
+    filter_pass(RankFilterShape::square, input, output);
+    return;
+  }
+  std::vector<uint32_t> rows(static_cast<size_t>(input.width()) *
+                             input.height());
+  const ImageView<uint32_t> filtered_rows(rows.data(), input.width(),
+                                          input.height(), input.width());
+  filter_pass(RankFilterShape::row, input, filtered_rows);
+  filter_pass(RankFilterShape::column,
+              ImageView<const uint32_t>(rows.data(), input.width(),
+                                        input.height(), input.width()),
+              output);
+}
+
+void CpuRankFilter::filter_pass(const RankFilterShape shape,
+                                const ImageView<const uint32_t> &input,
+                                const ImageView<uint32_t> &output) {
+  const int height = input.height();
+  if (!pool_ || height <= band_rows) {
+    filter_rows(shape, input, output, 0, height);
+    return;
+  }
+  std::vector<std::future<void>> bands;
+  for (int y = 0; y < height; y += band_rows) {
+    const int end = std::min(height, y + band_rows);
+    bands.push_back(pool_->submit(
+        [=, &input, &output]() { filter_rows(shape, input, output, y, end); }));
+  }
+  for (std::future<void> &band : bands) {
+    band.get();
+  }
+}
+
+void CpuRankFilter::filter_rows(const RankFilterShape shape,
+                                const ImageView<const uint32_t> &input,
+                                const ImageView<uint32_t> &output,
+                                const int begin, const int end) const {
+  const Aperture a = make_aperture(options_, shape);
+  if (a.window > rank_filter_max_network_window) {
+    histogram_rows(a, input, output, begin, end);
+    return;
+  }
+  std::vector<const uint32_t *> rows(2 * a.radius_y + 1);
+  for (int y = begin; y < end; ++y) {
+    for (int k = 0; k < static_cast<int>(rows.size()); ++k) {
+      rows[k] = input.row(clamp(y + k - a.radius_y, 0, input.height() - 1));
+    }
+    network_row(a, rows.data(), output.row(y), input.width(), kernel_);
+  }
+}
+
+} // namespace compute_samples
@@ -7,6 +7,7 @@
 
 #include "gtest/gtest.h"
 #include "median_filter/median_filter.hpp"
+#include "median_filter/rank_filter.hpp"
 #include "ocl_utils/ocl_utils.hpp"
 #include "test_harness/test_harness.hpp"
 
@@ -18,3 +19,37 @@ HWTEST(MedianFilterIntegrationTests, ProgramCanBeBuilt) {
   EXPECT_NE(compute::program(),
             compute_samples::build_program(context, "median_filter.cl"));
 }
+
+HWTEST(MedianFilterIntegrationTests, TiledProgramCanBeBuilt) {
+  const compute::device device = compute::system::default_device();
+  const compute::context context(device);
+  for (const compute_samples::MedianBorder border :
+       {compute_samples::MedianBorder::clamp,
+        compute_samples::MedianBorder::mirror,
+        compute_samples::MedianBorder::constant}) {
+    const compute::program program = compute_samples::build_program(
+        context, "median_filter.cl",
+        compute_samples::median_filter_tiled_build_options(border, 0));
+    EXPECT_NE(compute::kernel(), program.create_kernel("median_filter_tiled"));
+  }
+}
+
+HWTEST(MedianFilterIntegrationTests, RankFilterProgramsCanBeBuilt) {
+  const compute::device device = compute::system::default_device();
+  const compute::context context(device);
+  compute_samples::RankFilterOptions options;
+  options.separable = true;
+  // Radius 2 sorts the square aperture, radius 3 searches it bit by bit
+  for (const int radius : {2, 3}) {
+    options.radius = radius;
+    for (const compute_samples::RankFilterShape shape :
+         {compute_samples::RankFilterShape::square,
+          compute_samples::RankFilterShape::row}) {
+      EXPECT_NE(compute::program(),
+                compute_samples::build_program(
+                    context, "rank_filter.cl",
+                    compute_samples::rank_filter_build_options(options,
+                                                               shape)));
+    }
+  }
+}
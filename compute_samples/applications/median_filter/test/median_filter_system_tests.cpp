@@ -38,3 +38,99 @@ HWTEST_F(MedianFilterSystemTests, ReturnsReferenceImage) {
   compute_samples::ImagePNG32Bit reference_image(reference_file_);
   EXPECT_EQ(output_image, reference_image);
 }
+
+TEST_F(MedianFilterSystemTests, CpuDeviceReturnsReferenceImage) {
+  compute_samples::MedianFilterApplication application;
+  std::vector<std::string> command_line = {input_file_, output_file_,
+                                           "--device", "cpu"};
+
+  EXPECT_EQ(compute_samples::Application::Status::OK,
+            application.run(command_line));
+
+  compute_samples::ImagePNG32Bit output_image(output_file_);
+  compute_samples::ImagePNG32Bit reference_image(reference_file_);
+  EXPECT_EQ(output_image, reference_image);
+}
+
+HWTEST_F(MedianFilterSystemTests, TiledKernelMatchesCpuDevice) {
+  const std::string cpu_output_file = "test_output_cpu.png";
+  for (const std::string border : {"clamp", "mirror", "constant"}) {
+    compute_samples::MedianFilterApplication application;
+    std::vector<std::string> command_line = {
+        input_file_, output_file_, "--kernel-variant", "tiled",
+        "--border",  border,       "--border-value",   "4278190335"};
+    EXPECT_EQ(compute_samples::Application::Status::OK,
+              application.run(command_line));
+
+    command_line[1] = cpu_output_file;
+    command_line.push_back("--device");
+    command_line.push_back("cpu");
+    EXPECT_EQ(compute_samples::Application::Status::OK,
+              application.run(command_line));
+
+    compute_samples::ImagePNG32Bit output_image(output_file_);
+    compute_samples::ImagePNG32Bit cpu_output_image(cpu_output_file);
+    EXPECT_EQ(output_image, cpu_output_image) << border;
+  }
+  if (std::remove(cpu_output_file.c_str()) != 0) {
+    LOG_DEBUG << "Deleting file " << cpu_output_file << " failed";
+  }
+}
+
+TEST_F(MedianFilterSystemTests, CpuDeviceRunsTiledKernel) {
+  compute_samples::MedianFilterApplication application;
+  std::vector<std::string> command_line = {
+      input_file_, output_file_, "--device", "cpu", "--kernel-variant",
+      "tiled",     "--border",   "mirror"};
+
+  EXPECT_EQ(compute_samples::Application::Status::OK,
+            application.run(command_line));
+
+  compute_samples::ImagePNG32Bit input_image(input_file_);
+  compute_samples::ImagePNG32Bit output_image(output_file_);
+  EXPECT_EQ(input_image.width(), output_image.width());
+  EXPECT_EQ(input_image.height(), output_image.height());
+}
+
+TEST_F(MedianFilterSystemTests, RejectsBorderWithoutTiledKernel) {
+  compute_samples::MedianFilterApplication application;
+  std::vector<std::string> command_line = {input_file_, output_file_,
+                                           "--device", "cpu", "--border",
+                                           "mirror"};
+
+  EXPECT_EQ(compute_samples::Application::Status::ERROR,
+            application.run(command_line));
+}
+
+TEST_F(MedianFilterSystemTests, CpuDeviceRunsRankFilter) {
+  compute_samples::MedianFilterApplication application;
+  std::vector<std::string> command_line = {
+      input_file_, output_file_, "--device", "cpu", "--radius", "4",
+      "--percentile", "25"};
+
+  EXPECT_EQ(compute_samples::Application::Status::OK,
+            application.run(command_line));
+
+  compute_samples::ImagePNG32Bit input_image(input_file_);
+  compute_samples::ImagePNG32Bit output_image(output_file_);
+  EXPECT_EQ(input_image.width(), output_image.width());
+  EXPECT_EQ(input_image.height(), output_image.height());
+}
+
+TEST_F(MedianFilterSystemTests, RejectsRankFilterOptionsWithoutRadius) {
+  compute_samples::MedianFilterApplication application;
+  std::vector<std::string> command_line = {input_file_, output_file_,
+                                           "--device", "cpu", "--separable"};
+
+  EXPECT_EQ(compute_samples::Application::Status::ERROR,
+            application.run(command_line));
+}
+
+TEST_F(MedianFilterSystemTests, RejectsUnknownDevice) {
+  compute_samples::MedianFilterApplication application;
+  std::vector<std::string> command_line = {input_file_, output_file_,
+                                           "--device", "fpga"};
+
+  EXPECT_EQ(compute_samples::Application::Status::ERROR,
+            application.run(command_line));
+}
@@ -0,0 +1,468 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include "median_filter/cpu_median_filter.hpp"
+#include "median_filter/rank_filter.hpp"
+#include "random/random.hpp"
+
+namespace cs = compute_samples;
+
+namespace {
+// Line by line transcription of median9 in median_filter.cl
+uint32_t median9_reference(const uint32_t (&uiRGBA)[9]) {
+  uint32_t uiResult = 0;
+  uint32_t uiMask = 0xFF;
+  for (int ch = 0; ch < 4; ch++) {
+    uint32_t r[9];
+    for (int i = 0; i < 9; ++i) {
+      r[i] = uiRGBA[i] & uiMask;
+    }
+    const int network[16][2] = {{0, 1}, {3, 2}, {2, 0}, {3, 1},
+                                {1, 0}, {3, 2}, {5, 4}, {7, 8},
+                                {6, 8}, {6, 7}, {4, 8}, {4, 6},
+                                {5, 7}, {4, 5}, {6, 7}, {0, 8}};
+    for (const auto &step : network) {
+      const uint32_t uiMin = std::min(r[step[0]], r[step[1]]);
+      const uint32_t uiMax = std::max(r[step[0]], r[step[1]]);
+      r[step[0]] = uiMin;
+      r[step[1]] = uiMax;
+    }
+    r[4] = std::max(r[0], r[4]);
+    r[5] = std::max(r[1], r[5]);
+    r[6] = std::max(r[2], r[6]);
+    r[7] = std::max(r[3], r[7]);
+    r[4] = std::min(r[4], r[6]);
+    r[5] = std::min(r[5], r[7]);
+    uiResult |= r[4];
+    uiMask <<= 8;
+  }
+  return uiResult;
+}
+
+// Line by line transcription of median_filter for a single work item
+void kernel_reference(const uint32_t *pSrc, uint32_t *pDst, const int x,
+                      const int y, const int width, const int height) {
+  const int iOffset = y * width;
+  const int iPrev = iOffset - width;
+  const int iNext = iOffset + width;
+  if (((iPrev + x - 1) >= 0) && ((iNext + x + 1) < (height * width))) {
+    const uint32_t uiRGBA[9] = {
+        pSrc[iPrev + x - 1],   pSrc[iPrev + x],   pSrc[iPrev + x + 1],
+        pSrc[iOffset + x - 1], pSrc[iOffset + x], pSrc[iOffset + x + 1],
+        pSrc[iNext + x - 1],   pSrc[iNext + x],   pSrc[iNext + x + 1]};
+    pDst[iOffset + x] = median9_reference(uiRGBA);
+  } else {
+    pDst[iOffset + x] = pSrc[iOffset + x];
+  }
+}
+
+// Transcription of load_pixel in median_filter.cl
+uint32_t load_pixel_reference(const std::vector<uint32_t> &pSrc, int x, int y,
+                              const int width, const int height,
+                              const cs::MedianBorder border,
+                              const uint32_t border_value) {
+  const auto mirror = [](const int i, const int size) {
+    const int reflected = std::abs(i);
+    return std::min(
+        std::max(reflected >= size ? 2 * size - 2 - reflected : reflected, 0),
+        size - 1);
+  };
+  if (border == cs::MedianBorder::constant) {
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+      return border_value;
+    }
+  } else if (border == cs::MedianBorder::mirror) {
+    x = mirror(x, width);
+    y = mirror(y, height);
+  } else {
+    x = std::min(std::max(x, 0), width - 1);
+    y = std::min(std::max(y, 0), height - 1);
+  }
+  return pSrc[y * width + x];
+}
+
+// Output of median_filter_tiled, which does not depend on the tile size
+std::vector<uint32_t> reference_tiled_filter(const std::vector<uint32_t> &input,
+                                             const int width, const int height,
+                                             const cs::MedianBorder border,
+                                             const uint32_t border_value) {
+  std::vector<uint32_t> output(input.size());
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint32_t uiRGBA[9];
+      for (int dy = 0; dy < 3; ++dy) {
+        for (int dx = 0; dx < 3; ++dx) {
+          uiRGBA[dy * 3 + dx] =
+              load_pixel_reference(input, x + dx - 1, y + dy - 1, width,
+                                   height, border, border_value);
+        }
+      }
+      output[y * width + x] = median9_reference(uiRGBA);
+    }
+  }
+  return output;
+}
+
+std::vector<uint32_t> reference_filter(const std::vector<uint32_t> &input,
+                                       const int width, const int height) {
+  std::vector<uint32_t> output(input.size());
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      kernel_reference(input.data(), output.data(), x, y, width, height);
+    }
+  }
+  return output;
+}
+
+// Selects the value of rank in every channel of a rx by ry aperture, with
+// coordinates clamped to the image
+std::vector<uint32_t> reference_rank_pass(const std::vector<uint32_t> &input,
+                                          const int width, const int height,
+                                          const int rx, const int ry,
+                                          const int percentile) {
+  const int window = (2 * rx + 1) * (2 * ry + 1);
+  const int rank = cs::rank_filter_rank(window, percentile);
+  std::vector<uint32_t> output(input.size());
+  std::vector<uint32_t> values(window);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint32_t result = 0;
+      for (int shift = 0; shift < 32; shift += 8) {
+        int n = 0;
+        for (int dy = -ry; dy <= ry; ++dy) {
+          for (int dx = -rx; dx <= rx; ++dx) {
+            const int cx = std::min(std::max(x + dx, 0), width - 1);
+            const int cy = std::min(std::max(y + dy, 0), height - 1);
+            values[n++] = (input[cy * width + cx] >> shift) & 0xff;
+          }
+        }
+        std::nth_element(values.begin(), values.begin() + rank, values.end());
+        result |= values[rank] << shift;
+      }
+      output[y * width + x] = result;
+    }
+  }
+  return output;
+}
+
+std::vector<uint32_t> reference_rank_filter(const std::vector<uint32_t> &input,
+                                            const int width, const int height,
+                                            const cs::RankFilterOptions &o) {
+  if (!o.separable) {
+    return reference_rank_pass(input, width, height, o.radius, o.radius,
+                               o.percentile);
+  }
+  const std::vector<uint32_t> rows =
+      reference_rank_pass(input, width, height, o.radius, 0, o.percentile);
+  return reference_rank_pass(rows, width, height, 0, o.radius, o.percentile);
+}
+
+std::vector<uint32_t> rank_filter(cs::CpuRankFilter &filter,
+                                  const std::vector<uint32_t> &input,
+                                  const int width, const int height) {
+  std::vector<uint32_t> output(input.size());
+  filter.filter(
+      cs::ImageView<const uint32_t>(input.data(), width, height, width),
+      cs::ImageView<uint32_t>(output.data(), width, height, width));
+  return output;
+}
+
+std::vector<cs::MedianKernel> supported_kernels() {
+  std::vector<cs::MedianKernel> kernels;
+  for (const cs::MedianKernel kernel :
+       {cs::MedianKernel::scalar, cs::MedianKernel::sse2,
+        cs::MedianKernel::avx2}) {
+    if (cs::CpuMedianFilter::is_supported(kernel)) {
+      kernels.push_back(kernel);
+    }
+  }
+  return kernels;
+}
+} // namespace
+
+TEST(CpuMedianFilterUnitTests, MatchesKernelOnEveryKernelAndSize) {
+  const int sizes[][2] = {{1, 1}, {2, 2}, {3, 3},  {4, 3},
+                          {7, 5}, {9, 4}, {17, 9}, {33, 70}};
+  for (const cs::MedianKernel kernel : supported_kernels()) {
+    cs::CpuMedianFilter filter(1, kernel);
+    for (const auto &size : sizes) {
+      const int width = size[0];
+      const int height = size[1];
+      const std::vector<uint32_t> input =
+          cs::generate_vector<uint32_t>(width * height, width + height);
+      std::vector<uint32_t> output(input.size());
+      filter.filter(input.data(), output.data(), width, height);
+      EXPECT_EQ(reference_filter(input, width, height), output)
+          << cs::CpuMedianFilter::kernel_name(kernel) << " " << width << "x"
+          << height;
+    }
+  }
+}
+
+TEST(CpuMedianFilterUnitTests, IndependentOfThreadCount) {
+  const int width = 45;
+  const int height = 131;
+  const std::vector<uint32_t> input =
+      cs::generate_vector<uint32_t>(width * height, 7);
+  const std::vector<uint32_t> expected = reference_filter(input, width, height);
+  for (const int thread_count : {2, 3, 0}) {
+    cs::CpuMedianFilter filter(thread_count);
+    std::vector<uint32_t> output(input.size());
+    filter.filter(input.data(), output.data(), width, height);
+    EXPECT_EQ(expected, output) << thread_count << " threads";
+  }
+}
+
+TEST(CpuMedianFilterUnitTests, FiltersChannelsIndependently) {
+  // A single bright pixel in every channel is removed
+  std::vector<uint32_t> input(5 * 5, 0x10203040);
+  input[12] = 0xffffffff;
+  input[6] = 0x00ff00ff;
+  std::vector<uint32_t> output(input.size());
+  cs::CpuMedianFilter filter;
+  filter.filter(input.data(), output.data(), 5, 5);
+  EXPECT_EQ(0x10203040u, output[12]);
+  EXPECT_EQ(0x10203040u, output[6]);
+  EXPECT_EQ(reference_filter(input, 5, 5), output);
+}
+
+TEST(CpuMedianFilterUnitTests, CopiesPixelsOutsideTheAperture) {
+  const int width = 6;
+  const int height = 4;
+  const std::vector<uint32_t> input =
+      cs::generate_vector<uint32_t>(width * height, 3);
+  std::vector<uint32_t> output(input.size());
+  cs::CpuMedianFilter filter;
+  filter.filter(input.data(), output.data(), width, height);
+  // Like the kernel, only the first width + 1 and last width + 1 pixels are
+  // copied, the remaining ones in the first and last column wrap around
+  for (int i = 0; i < width + 1; ++i) {
+    EXPECT_EQ(input[i], output[i]);
+    EXPECT_EQ(input[input.size() - 1 - i], output[output.size() - 1 - i]);
+  }
+}
+
+TEST(CpuMedianFilterUnitTests, AutomaticSelectsSupportedKernel) {
+  cs::CpuMedianFilter filter;
+  EXPECT_NE(cs::MedianKernel::automatic, filter.kernel());
+  EXPECT_TRUE(cs::CpuMedianFilter::is_supported(filter.kernel()));
+  EXPECT_EQ(1, filter.thread_count());
+}
+
+TEST(CpuMedianFilterUnitTests, RejectsInPlaceFiltering) {
+  std::vector<uint32_t> image(9);
+  cs::CpuMedianFilter filter;
+  EXPECT_THROW(filter.filter(image.data(), image.data(), 3, 3),
+               std::invalid_argument);
+}
+
+TEST(CpuMedianFilterUnitTests, BorderModesMatchTiledKernel) {
+  const int sizes[][2] = {{1, 1}, {2, 1}, {1, 3}, {3, 3},
+                          {8, 5}, {17, 9}, {40, 70}};
+  for (const cs::MedianKernel kernel : supported_kernels()) {
+    cs::CpuMedianFilter filter(1, kernel);
+    for (const cs::MedianBorder border :
+         {cs::MedianBorder::clamp, cs::MedianBorder::mirror,
+          cs::MedianBorder::constant}) {
+      for (const auto &size : sizes) {
+        const int width = size[0];
+        const int height = size[1];
+        const std::vector<uint32_t> input =
+            cs::generate_vector<uint32_t>(width * height, width * height);
+        std::vector<uint32_t> output(input.size());
+        filter.filter(
+            cs::ImageView<const uint32_t>(input.data(), width, height, width),
+            cs::ImageView<uint32_t>(output.data(), width, height, width),
+            border, 0x80ff0040);
+        EXPECT_EQ(reference_tiled_filter(input, width, height, border,
+                                         0x80ff0040),
+                  output)
+            << cs::CpuMedianFilter::kernel_name(kernel) << " "
+            << cs::CpuMedianFilter::border_name(border) << " " << width << "x"
+            << height;
+      }
+    }
+  }
+}
+
+TEST(CpuMedianFilterUnitTests, BorderModesIndependentOfThreadCount) {
+  const int width = 29;
+  const int height = 100;
+  const int pitch = 32;
+  std::vector<uint32_t> input =
+      cs::generate_vector<uint32_t>(pitch * height, 17);
+  std::vector<uint32_t> packed(width * height);
+  for (int y = 0; y < height; ++y) {
+    std::copy(input.begin() + y * pitch, input.begin() + y * pitch + width,
+              packed.begin() + y * width);
+  }
+  const std::vector<uint32_t> expected = reference_tiled_filter(
+      packed, width, height, cs::MedianBorder::mirror, 0);
+  for (const int thread_count : {1, 3}) {
+    cs::CpuMedianFilter filter(thread_count);
+    std::vector<uint32_t> output(pitch * height, 0);
+    filter.filter(
+        cs::ImageView<const uint32_t>(input.data(), width, height, pitch),
+        cs::ImageView<uint32_t>(output.data(), width, height, pitch),
+        cs::MedianBorder::mirror);
+    for (int y = 0; y < height; ++y) {
+      EXPECT_TRUE(std::equal(expected.begin() + y * width,
+                             expected.begin() + (y + 1) * width,
+                             output.begin() + y * pitch))
+          << thread_count << " threads, row " << y;
+    }
+  }
+}
+
+TEST(CpuMedianFilterUnitTests, BorderModesRejectImagesOfDifferentSize) {
+  std::vector<uint32_t> input(12);
+  std::vector<uint32_t> output(12);
+  cs::CpuMedianFilter filter;
+  EXPECT_THROW(
+      filter.filter(cs::ImageView<const uint32_t>(input.data(), 4, 3, 4),
+                    cs::ImageView<uint32_t>(output.data(), 3, 4, 3),
+                    cs::MedianBorder::clamp),
+      std::invalid_argument);
+}
+
+TEST(MedianFilterUnitTests, TiledBuildOptionsSelectBorder) {
+  EXPECT_EQ("-DTILE_WIDTH=16 -DTILE_HEIGHT=16 -DBORDER_MODE=0 "
+            "-DBORDER_VALUE=0u",
+            cs::median_filter_tiled_build_options(cs::MedianBorder::clamp, 0));
+  EXPECT_EQ("-DTILE_WIDTH=16 -DTILE_HEIGHT=16 -DBORDER_MODE=2 "
+            "-DBORDER_VALUE=4278190335u",
+            cs::median_filter_tiled_build_options(cs::MedianBorder::constant,
+                                                  0xff0000ff));
+}
+
+TEST(CpuRankFilterUnitTests, MatchesReferenceForEveryRadiusAndKernel) {
+  // Radius 1 and 2 are sorted by the network, larger ones use histograms
+  const int sizes[][2] = {{1, 1}, {5, 3}, {19, 11}, {40, 37}};
+  for (const cs::MedianKernel kernel : supported_kernels()) {
+    for (const int radius : {1, 2, 3, 6}) {
+      for (const int percentile : {0, 30, 50, 100}) {
+        cs::RankFilterOptions options;
+        options.radius = radius;
+        options.percentile = percentile;
+        cs::CpuRankFilter filter(options, 1, kernel);
+        for (const auto &size : sizes) {
+          const std::vector<uint32_t> input =
+              cs::generate_vector<uint32_t>(size[0] * size[1], radius);
+          EXPECT_EQ(reference_rank_filter(input, size[0], size[1], options),
+                    rank_filter(filter, input, size[0], size[1]))
+              << cs::CpuMedianFilter::kernel_name(kernel) << " radius "
+              << radius << " percentile " << percentile << " " << size[0]
+              << "x" << size[1];
+        }
+      }
+    }
+  }
+}
+
+TEST(CpuRankFilterUnitTests, SeparableMatchesReference) {
+  const int width = 53;
+  const int height = 29;
+  const std::vector<uint32_t> input =
+      cs::generate_vector<uint32_t>(width * height, 11);
+  // Radius 12 is the largest one dimensional aperture sorted by the network
+  for (const int radius : {1, 12, 13, 30}) {
+    cs::RankFilterOptions options;
+    options.radius = radius;
+    options.separable = true;
+    cs::CpuRankFilter filter(options);
+    EXPECT_EQ(reference_rank_filter(input, width, height, options),
+              rank_filter(filter, input, width, height))
+        << "radius " << radius;
+  }
+}
+
+TEST(CpuRankFilterUnitTests, IndependentOfThreadCount) {
+  const int width = 37;
+  const int height = 100;
+  const std::vector<uint32_t> input =
+      cs::generate_vector<uint32_t>(width * height, 5);
+  for (const int radius : {2, 4}) {
+    cs::RankFilterOptions options;
+    options.radius = radius;
+    const std::vector<uint32_t> expected =
+        reference_rank_filter(input, width, height, options);
+    for (const int thread_count : {2, 3}) {
+      cs::CpuRankFilter filter(options, thread_count);
+      EXPECT_EQ(expected, rank_filter(filter, input, width, height))
+          << "radius " << radius << ", " << thread_count << " threads";
+    }
+  }
+}
+
+TEST(CpuRankFilterUnitTests, ReadsPaddedRows) {
+  const int width = 9;
+  const int height = 7;
+  const int pitch = 16;
+  const std::vector<uint32_t> packed =
+      cs::generate_vector<uint32_t>(width * height, 13);
+  std::vector<uint32_t> input(pitch * height, 0xffffffff);
+  std::vector<uint32_t> output(pitch * height, 0);
+  for (int y = 0; y < height; ++y) {
+    std::copy(packed.begin() + y * width, packed.begin() + (y + 1) * width,
+              input.begin() + y * pitch);
+  }
+  for (const int radius : {1, 3}) {
+    cs::RankFilterOptions options;
+    options.radius = radius;
+    cs::CpuRankFilter filter(options);
+    filter.filter(
+        cs::ImageView<const uint32_t>(input.data(), width, height, pitch),
+        cs::ImageView<uint32_t>(output.data(), width, height, pitch));
+    const std::vector<uint32_t> expected =
+        reference_rank_filter(packed, width, height, options);
+    for (int y = 0; y < height; ++y) {
+      EXPECT_TRUE(std::equal(expected.begin() + y * width,
+                             expected.begin() + (y + 1) * width,
+                             output.begin() + y * pitch))
+          << "radius " << radius << " row " << y;
+    }
+  }
+}
+
+TEST(CpuRankFilterUnitTests, RejectsOptionsOutOfRange) {
+  cs::RankFilterOptions options;
+  options.radius = 0;
+  EXPECT_THROW(cs::CpuRankFilter filter(options), std::invalid_argument);
+  options.radius = cs::rank_filter_max_radius + 1;
+  EXPECT_THROW(cs::CpuRankFilter filter(options), std::invalid_argument);
+  options.radius = 1;
+  options.percentile = 101;
+  EXPECT_THROW(cs::CpuRankFilter filter(options), std::invalid_argument);
+}
+
+TEST(RankFilterUnitTests, BuildOptionsDescribeEachPass) {
+  const cs::RankFilterShape square = cs::RankFilterShape::square;
+  const cs::RankFilterShape row = cs::RankFilterShape::row;
+  const cs::RankFilterShape column = cs::RankFilterShape::column;
+  cs::RankFilterOptions options;
+  options.radius = 2;
+  EXPECT_EQ(std::vector<cs::RankFilterShape>{square},
+            cs::rank_filter_passes(options));
+  EXPECT_EQ("-DRADIUS_X=2 -DRADIUS_Y=2 -DRANK=12 -DSORTING_NETWORK",
+            cs::rank_filter_build_options(options, square));
+  options.radius = 3;
+  options.percentile = 0;
+  EXPECT_EQ("-DRADIUS_X=3 -DRADIUS_Y=3 -DRANK=0",
+            cs::rank_filter_build_options(options, square));
+  options.separable = true;
+  EXPECT_EQ((std::vector<cs::RankFilterShape>{row, column}),
+            cs::rank_filter_passes(options));
+  EXPECT_EQ("-DRADIUS_X=0 -DRADIUS_Y=3 -DRANK=0 -DSORTING_NETWORK",
+            cs::rank_filter_build_options(options, column));
+}
@@ -17,6 +17,7 @@
 #include <boost/compute/intel/command_queue.hpp>
 #include <boost/compute/intel/device.hpp>
 #include "ocl_utils/ocl_utils.hpp"
+#include "ocl_utils/program_registry.hpp"
 #include "logging/logging.hpp"
 #include "timer/timer.hpp"
 
@@ -108,9 +109,10 @@ UsmLinkedListApplication::parse_command_line(
 }
 
 compute::kernel_intel prepare_kernel(const compute::usm_type type) {
-  compute::context context(compute::system::default_context());
-  compute::program program = build_program(context, "usm_linked_list.cl");
-  compute::kernel_intel kernel(program.create_kernel("usm_linked_list_kernel"));
+  // Registry kernels are clones, so execution info set here stays local
+  compute::kernel_intel kernel(ProgramRegistry::instance().kernel(
+      compute::system::default_context(), "usm_linked_list.cl",
+      "usm_linked_list_kernel"));
 
   const cl_bool value = CL_TRUE;
   if (type == compute::usm_type::host) {
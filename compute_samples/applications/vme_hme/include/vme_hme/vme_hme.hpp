@@ -27,6 +27,7 @@ private:
     int width = 0;
     int height = 0;
     int frames = 0;
+    int pipeline_depth = 0;
     bool help = false;
   };
 
@@ -42,6 +43,14 @@ private:
       boost::compute::image2d &ref_4x_image,
       boost::compute::image2d &src_8x_image,
       boost::compute::image2d &ref_8x_image, int frame_idx) const;
+  void run_vme_hme_pipeline(const VmeHmeApplication::Arguments &args,
+                            boost::compute::context &context,
+                            boost::compute::command_queue &queue,
+                            boost::compute::kernel &ds_kernel,
+                            boost::compute::kernel &hme_n_kernel,
+                            boost::compute::kernel &hme_kernel,
+                            YuvCapture &capture, YuvWriter &writer,
+                            int frame_count) const;
   Arguments parse_command_line(const std::vector<std::string> &command_line);
 };
 } // namespace compute_samples
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
@@ -23,6 +24,7 @@
 #include <CL/cl_ext.h>
 
 #include "align_utils/align_utils.hpp"
+#include "yuv_utils/vme_pipeline.hpp"
 #include "timer/timer.hpp"
 #include "ocl_utils/ocl_utils.hpp"
 #include "logging/logging.hpp"
@@ -32,6 +34,35 @@ namespace po = boost::program_options;
 namespace compute = boost::compute;
 
 namespace compute_samples {
+namespace {
+compute::image_format luma_format() {
+  return compute::image_format(CL_R, CL_UNORM_INT8);
+}
+
+// Device resources of a frame in flight
+struct HmeSlot {
+  HmeSlot(const compute::context &context, int width, int height,
+          int mv_count, int mb_count)
+      : src_image(context, width, height, luma_format()),
+        src_2x_image(context, au::align_units(width, 2),
+                     au::align_units(height, 2), luma_format()),
+        src_4x_image(context, au::align_units(width, 4),
+                     au::align_units(height, 4), luma_format()),
+        src_8x_image(context, au::align_units(width, 8),
+                     au::align_units(height, 8), luma_format()),
+        mv_buffer(context, au::align64(mv_count * sizeof(cl_short2))),
+        residual_buffer(context, au::align64(mv_count * sizeof(cl_ushort))),
+        shape_buffer(context, au::align64(mb_count * sizeof(cl_uchar2))) {}
+
+  compute::image2d src_image;
+  compute::image2d src_2x_image;
+  compute::image2d src_4x_image;
+  compute::image2d src_8x_image;
+  compute::buffer mv_buffer;
+  compute::buffer residual_buffer;
+  compute::buffer shape_buffer;
+};
+} // namespace
 
 VmeHmeApplication::Arguments VmeHmeApplication::parse_command_line(
     const std::vector<std::string> &command_line) {
@@ -48,21 +79,27 @@ VmeHmeApplication::Arguments VmeHmeApplication::parse_command_line(
   options("input-yuv,i",
           po::value<std::string>(&args.input_yuv_path)
               ->default_value("goal_1280x720.yuv"),
-          "path to input yuv file");
+          "path to input yuv or y4m file");
   options("output-yuv,o",
           po::value<std::string>(&args.output_yuv_path)
               ->default_value("output_goal_1280x720.yuv"),
-          "path to output yuv with motion vectors");
+          "path to output yuv with motion vectors (written as y4m for a "
+          ".y4m extension)");
   options("qp,q", po::value<int>(&args.qp)->default_value(49),
           "quantization parameter value to use for estimation heuristics"
           "(higher for faster motion frames)");
   options("width,w", po::value<int>(&args.width)->default_value(1280),
-          "width of input yuv");
+          "width of input yuv (y4m files carry their own)");
   options("height,h", po::value<int>(&args.height)->default_value(720),
-          "height of input yuv");
+          "height of input yuv (y4m files carry their own)");
   options("frames,f", po::value<int>(&args.frames)->default_value(0),
           "number of frame to use for motion estimation (0 represents entire "
           "yuv sequence)");
+  options("pipeline-depth",
+          po::value<int>(&args.pipeline_depth)->default_value(0),
+          "number of frames processed concurrently by separate read, upload, "
+          "compute, readback, overlay and write stages (0 processes frames "
+          "serially)");
 
   po::positional_options_description p;
   p.add("input-yuv", 1);
@@ -85,6 +122,10 @@ VmeHmeApplication::Arguments VmeHmeApplication::parse_command_line(
     throw std::invalid_argument("Invalid argument for qp. Valid range (0-51).");
   }
 
+  if (args.pipeline_depth < 0) {
+    throw std::invalid_argument("Invalid argument for pipeline-depth.");
+  }
+
   return args;
 }
 
@@ -94,7 +135,7 @@ VmeHmeApplication::Arguments VmeHmeApplication::parse_command_line(
 
 Application::Status
 VmeHmeApplication::run_implementation(std::vector<std::string> &command_line) {
-  const Arguments args = parse_command_line(command_line);
+  Arguments args = parse_command_line(command_line);
   if (args.help) {
     return Status::SKIP;
   }
@@ -110,6 +151,10 @@ VmeHmeApplication::run_implementation(std::vector<std::string> &command_line) {
   }
 
   LOG_INFO << "Input yuv path: " << args.input_yuv_path;
+  // Y4M files carry their own frame size
+  YuvCapture capture(args.input_yuv_path, args.width, args.height, args.frames);
+  args.width = capture.get_width();
+  args.height = capture.get_height();
   LOG_INFO << "Frame size: " << args.width << "x" << args.height << " pixels";
 
   Timer timer_total;
@@ -126,57 +171,62 @@ VmeHmeApplication::run_implementation(std::vector<std::string> &command_line) {
   compute::kernel hme_kernel = program.create_kernel("vme_hme");
   timer.print("Kernels created");
 
-  YuvCapture capture(args.input_yuv_path, args.width, args.height, args.frames);
-  const int frame_count =
-      (args.frames) != 0 ? args.frames : capture.get_num_frames();
-  YuvWriter writer(args.width, args.height, frame_count, args.output_bmp);
-
-  PlanarImage planar_image(args.width, args.height);
-  capture.get_sample(0, planar_image);
-  timer.print("Read YUV frame 0 from disk to CPU linear memory.");
-
-  writer.append_frame(planar_image);
-
-  compute::image_format format(CL_R, CL_UNORM_INT8);
-  compute::image2d ref_image(context, args.width, args.height, format);
-  compute::image2d src_image(context, args.width, args.height, format);
-  compute::image2d src_image_8x(context, au::align_units(args.width, 8),
-                                au::align_units(args.height, 8), format);
-  compute::image2d ref_image_8x(context, au::align_units(args.width, 8),
-                                au::align_units(args.height, 8), format);
-  compute::image2d src_image_4x(context, au::align_units(args.width, 4),
-                                au::align_units(args.height, 4), format);
-  compute::image2d ref_image_4x(context, au::align_units(args.width, 4),
-                                au::align_units(args.height, 4), format);
-  compute::image2d src_image_2x(context, au::align_units(args.width, 2),
-                                au::align_units(args.height, 2), format);
-  compute::image2d ref_image_2x(context, au::align_units(args.width, 2),
-                                au::align_units(args.height, 2), format);
-  timer.print("Created opencl mem objects for downsample_3_tier kernel");
+  const int frame_count = capture.get_num_frames();
+  YuvWriter writer(args.width, args.height, 0, args.output_bmp);
+  writer.set_y4m_header(capture.get_y4m_header());
+  writer.open(args.output_yuv_path);
 
-  size_t origin[] = {0, 0, 0};
-  size_t region[] = {static_cast<size_t>(args.width),
-                     static_cast<size_t>(args.height), 1};
-  queue.enqueue_write_image(src_image, origin, region, planar_image.get_y(),
-                            planar_image.get_pitch_y());
-  timer.print("Copied frame 0 to tiled memory.");
+  if (args.pipeline_depth > 0) {
+    run_vme_hme_pipeline(args, context, queue, ds_kernel, hme_n_kernel,
+                         hme_kernel, capture, writer, frame_count);
+  } else {
+    PlanarImage planar_image(args.width, args.height);
+    capture.get_sample(0, planar_image);
+    timer.print("Read YUV frame 0 from disk to CPU linear memory.");
 
-  ds_kernel.set_args(src_image, src_image_2x, src_image_4x, src_image_8x);
-  queue.enqueue_nd_range_kernel(
-      ds_kernel, 2, nullptr,
-      compute::dim(au::align16(au::align_units(args.width, 4)),
-                   au::align_units(args.height, 16))
-          .data(),
-      compute::dim(16, 1).data());
-  timer.print("Enqueued downsample_3_tier kernel for frame 0");
-
-  for (int k = 1; k < frame_count; k++) {
-    LOG_INFO << "Processing frame " << k << "...";
-    run_vme_hme(args, context, queue, ds_kernel, hme_n_kernel, hme_kernel,
-                capture, planar_image, src_image, ref_image, src_image_2x,
-                ref_image_2x, src_image_4x, ref_image_4x, src_image_8x,
-                ref_image_8x, k);
     writer.append_frame(planar_image);
+
+    compute::image_format format(CL_R, CL_UNORM_INT8);
+    compute::image2d ref_image(context, args.width, args.height, format);
+    compute::image2d src_image(context, args.width, args.height, format);
+    compute::image2d src_image_8x(context, au::align_units(args.width, 8),
+                                  au::align_units(args.height, 8), format);
+    compute::image2d ref_image_8x(context, au::align_units(args.width, 8),
+                                  au::align_units(args.height, 8), format);
+    compute::image2d src_image_4x(context, au::align_units(args.width, 4),
+                                  au::align_units(args.height, 4), format);
+    compute::image2d ref_image_4x(context, au::align_units(args.width, 4),
+                                  au::align_units(args.height, 4), format);
+    compute::image2d src_image_2x(context, au::align_units(args.width, 2),
+                                  au::align_units(args.height, 2), format);
+    compute::image2d ref_image_2x(context, au::align_units(args.width, 2),
+                                  au::align_units(args.height, 2), format);
+    timer.print("Created opencl mem objects for downsample_3_tier kernel");
+
+    size_t origin[] = {0, 0, 0};
+    size_t region[] = {static_cast<size_t>(args.width),
+                       static_cast<size_t>(args.height), 1};
+    queue.enqueue_write_image(src_image, origin, region, planar_image.get_y(),
+                              planar_image.get_pitch_y());
+    timer.print("Copied frame 0 to tiled memory.");
+
+    ds_kernel.set_args(src_image, src_image_2x, src_image_4x, src_image_8x);
+    queue.enqueue_nd_range_kernel(
+        ds_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(args.width, 4)),
+                     au::align_units(args.height, 16))
+            .data(),
+        compute::dim(16, 1).data());
+    timer.print("Enqueued downsample_3_tier kernel for frame 0");
+
+    for (int k = 1; k < frame_count; k++) {
+      LOG_INFO << "Processing frame " << k << "...";
+      run_vme_hme(args, context, queue, ds_kernel, hme_n_kernel, hme_kernel,
+                  capture, planar_image, src_image, ref_image, src_image_2x,
+                  ref_image_2x, src_image_4x, ref_image_4x, src_image_8x,
+                  ref_image_8x, k);
+      writer.append_frame(planar_image);
+    }
   }
 
   LOG_INFO << "Wrote " << frame_count << " frames with overlaid "
@@ -316,4 +366,123 @@ void VmeHmeApplication::run_vme_hme(
   planar_image.overlay_vectors(reinterpret_cast<motion_vector *>(mvs.data()),
                                reinterpret_cast<inter_shape *>(shapes.data()));
 }
+
+void VmeHmeApplication::run_vme_hme_pipeline(
+    const VmeHmeApplication::Arguments &args, compute::context &context,
+    compute::command_queue &queue, compute::kernel &ds_kernel,
+    compute::kernel &hme_n_kernel, compute::kernel &hme_kernel,
+    YuvCapture &capture, YuvWriter &writer, int frame_count) const {
+  int width = args.width;
+  int height = args.height;
+
+  int mb_image_width = au::align_units(width, 16);
+  int mb_image_height = au::align_units(height, 16);
+  int mb_count = mb_image_width * mb_image_height;
+  int mv_image_width = mb_image_width * 4;
+  int mv_image_height = mb_image_height * 4;
+  int mv_count = mv_image_width * mv_image_height;
+
+  VmePipeline pipeline(args.pipeline_depth, width, height, mv_count,
+                       mb_count);
+  std::vector<std::unique_ptr<HmeSlot>> slots;
+  for (int i = 0; i < pipeline.slot_count(); ++i) {
+    slots.emplace_back(new HmeSlot(context, width, height, mv_count, mb_count));
+  }
+
+  // Predictors are only used between kernels of one frame, and frames are
+  // computed one after another, so all slots share them
+  uint32_t mv_8x_count = DIM_TO_MV_SZ(width, 8) * DIM_TO_MV_SZ(height, 8);
+  uint32_t mv_4x_count = DIM_TO_MV_SZ(width, 4) * DIM_TO_MV_SZ(height, 4);
+  uint32_t mv_2x_count = DIM_TO_MV_SZ(width, 2) * DIM_TO_MV_SZ(height, 2);
+  compute::buffer pred_4x_buffer(context,
+                                 au::align64(mv_8x_count * sizeof(cl_short2)));
+  compute::buffer pred_2x_buffer(context,
+                                 au::align64(mv_4x_count * sizeof(cl_short2)));
+  compute::buffer pred_buffer(context,
+                              au::align64(mv_2x_count * sizeof(cl_short2)));
+
+  // Transfers use a separate queue, so they are not ordered behind kernels
+  // of other frames
+  compute::command_queue transfer_queue(context, queue.get_device());
+
+  auto qp = static_cast<cl_uchar>(args.qp);
+  cl_uchar sad_adjustment = CL_AVC_ME_SAD_ADJUST_MODE_NONE_INTEL;
+  cl_uchar pixel_mode = CL_AVC_ME_SUBPIXEL_MODE_QPEL_INTEL;
+  auto iterations = static_cast<cl_int>(mb_image_height);
+
+  pipeline.read_from(capture);
+  pipeline.set_upload([&](int slot, const PlanarImage &image) {
+    size_t origin[] = {0, 0, 0};
+    size_t region[] = {static_cast<size_t>(width), static_cast<size_t>(height),
+                       1};
+    transfer_queue.enqueue_write_image(slots[slot]->src_image, origin, region,
+                                       image.get_y(), image.get_pitch_y());
+  });
+  pipeline.set_compute([&](int frame_idx, int slot, int reference_slot) {
+    HmeSlot &src = *slots[slot];
+    ds_kernel.set_args(src.src_image, src.src_2x_image, src.src_4x_image,
+                       src.src_8x_image);
+    queue.enqueue_nd_range_kernel(
+        ds_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 4)),
+                     au::align_units(height, 16))
+            .data(),
+        compute::dim(16, 1).data());
+    if (frame_idx == 0) {
+      queue.finish();
+      return;
+    }
+    HmeSlot &ref = *slots[reference_slot];
+
+    hme_n_kernel.set_arg(0, src.src_8x_image);
+    hme_n_kernel.set_arg(1, ref.src_8x_image);
+    hme_n_kernel.set_arg(2, sizeof(cl_mem), nullptr);
+    hme_n_kernel.set_arg(3, pred_4x_buffer);
+    queue.enqueue_nd_range_kernel(
+        hme_n_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 8)),
+                     DIM_TO_MB_SZ(height, 8))
+            .data(),
+        compute::dim(16, 1).data());
+
+    hme_n_kernel.set_args(src.src_4x_image, ref.src_4x_image, pred_4x_buffer,
+                          pred_2x_buffer);
+    queue.enqueue_nd_range_kernel(
+        hme_n_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 4)),
+                     DIM_TO_MB_SZ(height, 4))
+            .data(),
+        compute::dim(16, 1).data());
+
+    hme_n_kernel.set_args(src.src_2x_image, ref.src_2x_image, pred_2x_buffer,
+                          pred_buffer);
+    queue.enqueue_nd_range_kernel(
+        hme_n_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 2)),
+                     DIM_TO_MB_SZ(height, 2))
+            .data(),
+        compute::dim(16, 1).data());
+
+    hme_kernel.set_args(src.src_image, ref.src_image, pred_buffer,
+                        src.mv_buffer, src.residual_buffer, src.shape_buffer,
+                        qp, sad_adjustment, pixel_mode, iterations);
+    size_t local_size = 16;
+    size_t global_size = au::align16(width);
+    queue.enqueue_nd_range_kernel(hme_kernel, 1, nullptr, &global_size,
+                                  &local_size);
+    queue.finish();
+  });
+  pipeline.set_readback([&](int slot, VmeFrame &frame) {
+    HmeSlot &src = *slots[slot];
+    transfer_queue.enqueue_read_buffer(src.mv_buffer, 0,
+                                       mv_count * sizeof(cl_short2),
+                                       frame.mvs.data());
+    transfer_queue.enqueue_read_buffer(src.shape_buffer, 0,
+                                       mb_count * sizeof(cl_uchar2),
+                                       frame.shapes.data());
+  });
+  pipeline.write_to(writer);
+
+  pipeline.run(frame_count);
+}
 } // namespace compute_samples
@@ -33,6 +33,7 @@ private:
     int width = 0;
     int height = 0;
     int frames = 0;
+    int pipeline_depth = 0;
     char native = 1;
     bool help = false;
   };
@@ -60,6 +61,11 @@ private:
       compute_samples::align_utils::PageAlignedVector<cl_short2> &predictors,
       int width, int mb_count, int mv_count, uint32_t iterations,
       uint8_t interlaced, int polarity, Timer &timer) const;
+  void run_vme_interlaced_pipeline(
+      const VmeInterlacedApplication::Arguments &args,
+      boost::compute::context &context, boost::compute::command_queue &queue,
+      boost::compute::kernel &kernel, YuvCapture &capture,
+      YuvWriter &top_writer, YuvWriter &bot_writer, int frame_count) const;
   void get_field_capture_samples(YuvCapture &capture,
                                  PlanarImage &top_planar_image,
                                  PlanarImage &bot_planar_image,
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
@@ -23,6 +24,8 @@
 #include <CL/cl_ext.h>
 #include <thread>
 
+#include "align_utils/align_utils.hpp"
+#include "yuv_utils/vme_pipeline.hpp"
 #include "ocl_utils/ocl_utils.hpp"
 #include "logging/logging.hpp"
 
@@ -31,6 +34,41 @@ namespace po = boost::program_options;
 namespace compute = boost::compute;
 
 namespace compute_samples {
+namespace {
+// Device resources and field results of a frame in flight. Native mode
+// uploads the whole frame and reads its fields into the field images, split
+// mode uploads the field of the pass from the planar image of the VmeFrame.
+struct InterlacedSlot {
+  InterlacedSlot(const compute::context &context, int width, int height,
+                 int image_height, int mv_count, int mb_count)
+      : top_image(width, height / 2), bot_image(width, height / 2),
+        src_image(context, width, image_height,
+                  compute::image_format(CL_R, CL_UNORM_INT8)),
+        residual_buffer(context, au::align64(mv_count * sizeof(cl_ushort))) {
+    for (int polarity = 0; polarity < 2; ++polarity) {
+      mvs[polarity].resize(au::align64(mv_count));
+      shapes[polarity].resize(au::align64(mb_count));
+      mv_buffers[polarity] = compute::buffer(
+          context, au::align64(mv_count * sizeof(cl_short2)));
+      shape_buffers[polarity] = compute::buffer(
+          context, au::align64(mb_count * sizeof(cl_uchar2)));
+    }
+  }
+
+  PlanarImage &field_image(int polarity) {
+    return polarity == 0 ? top_image : bot_image;
+  }
+
+  PlanarImage top_image;
+  PlanarImage bot_image;
+  compute::image2d src_image;
+  au::PageAlignedVector<motion_vector> mvs[2];
+  au::PageAlignedVector<inter_shape> shapes[2];
+  compute::buffer mv_buffers[2];
+  compute::buffer shape_buffers[2];
+  compute::buffer residual_buffer;
+};
+} // namespace
 
 VmeInterlacedApplication::Arguments
 VmeInterlacedApplication::parse_command_line(
@@ -67,6 +105,11 @@ VmeInterlacedApplication::parse_command_line(
   options("frames,f", po::value<int>(&args.frames)->default_value(0),
           "number of frame to use for motion estimation (0 represents entire "
           "yuv sequence)");
+  options("pipeline-depth",
+          po::value<int>(&args.pipeline_depth)->default_value(0),
+          "number of frames processed concurrently by separate read, upload, "
+          "compute, readback, overlay and write stages (0 processes frames "
+          "serially)");
 
   po::positional_options_description p;
   p.add("input-yuv", 1);
@@ -94,6 +137,10 @@ VmeInterlacedApplication::parse_command_line(
     throw std::invalid_argument("Invalid sub-test");
   }
 
+  if (args.pipeline_depth < 0) {
+    throw std::invalid_argument("Invalid argument for pipeline-depth.");
+  }
+
   return args;
 }
 
@@ -134,72 +181,80 @@ Application::Status VmeInterlacedApplication::run_implementation(
       (args.frames) != 0 ? args.frames : capture.get_num_frames();
   const int field_height = args.height / 2;
 
-  YuvWriter top_writer(args.width, field_height, frame_count, args.output_bmp);
-  YuvWriter bot_writer(args.width, field_height, frame_count, args.output_bmp);
+  YuvWriter top_writer(args.width, field_height, 0, args.output_bmp);
+  YuvWriter bot_writer(args.width, field_height, 0, args.output_bmp);
+  top_writer.open(args.output_top_yuv_path);
+  bot_writer.open(args.output_bot_yuv_path);
 
   PlanarImage top_planar_image(args.width, field_height);
   PlanarImage bot_planar_image(args.width, field_height);
 
-  if (args.native != 0) {
-    compute::image_format format(CL_R, CL_UNORM_INT8);
-    compute::image2d ref_image(context, args.width, args.height, format);
-    compute::image2d src_image(context, args.width, args.height, format);
-
-    PlanarImage planar_image(args.width, args.height);
-    capture.get_sample(0, planar_image);
-    timer.print("Read YUV frame 0 from disk to CPU linear memory.");
-
-    size_t origin[] = {0, 0, 0};
-    size_t region[] = {static_cast<size_t>(args.width),
-                       static_cast<size_t>(args.height), 1};
-    queue.enqueue_write_image(src_image, origin, region, planar_image.get_y(),
-                              planar_image.get_pitch_y());
-    timer.print("Copied interlaced frame 0 to tiled memory.");
-
-    capture.get_sample(0, top_planar_image, true, 0);
-    capture.get_sample(0, bot_planar_image, true, 1);
-    timer.print("Read YUV field frames 0 from disk to CPU linear memory.");
-
-    top_writer.append_frame(top_planar_image);
-    bot_writer.append_frame(bot_planar_image);
-
-    for (int k = 1; k < frame_count; k++) {
-      LOG_INFO << "Processing frame " << k << "...";
-      run_vme_interlaced_native(args, context, queue, kernel, capture,
-                                planar_image, top_planar_image,
-                                bot_planar_image, src_image, ref_image, k);
-      top_writer.append_frame(top_planar_image);
-      bot_writer.append_frame(bot_planar_image);
-    }
+  if (args.pipeline_depth > 0) {
+    run_vme_interlaced_pipeline(args, context, queue, kernel, capture,
+                                top_writer, bot_writer, frame_count);
   } else {
-    compute::image_format format(CL_R, CL_UNORM_INT8);
-    compute::image2d ref_image(context, args.width, field_height, format);
-    compute::image2d src_image(context, args.width, field_height, format);
-
-    YuvWriter *field_writer[] = {&top_writer, &bot_writer};
-    PlanarImage *field_planar_image[] = {&top_planar_image, &bot_planar_image};
+    if (args.native != 0) {
+      compute::image_format format(CL_R, CL_UNORM_INT8);
+      compute::image2d ref_image(context, args.width, args.height, format);
+      compute::image2d src_image(context, args.width, args.height, format);
 
-    for (int j = 0; j < 2; j++) {
-      LOG_INFO << "Processing field polarity " << j;
-      capture.get_sample(0, *field_planar_image[j], true, j);
-      timer.print("Read YUV field frame 0 from disk to CPU linear memory.");
-
-      field_writer[j]->append_frame(*field_planar_image[j]);
+      PlanarImage planar_image(args.width, args.height);
+      capture.get_sample(0, planar_image);
+      timer.print("Read YUV frame 0 from disk to CPU linear memory.");
 
       size_t origin[] = {0, 0, 0};
       size_t region[] = {static_cast<size_t>(args.width),
-                         static_cast<size_t>(field_height), 1};
-      queue.enqueue_write_image(src_image, origin, region,
-                                field_planar_image[j]->get_y(),
-                                field_planar_image[j]->get_pitch_y());
-      timer.print("Copied field frame 0 to tiled memory.");
+                         static_cast<size_t>(args.height), 1};
+      queue.enqueue_write_image(src_image, origin, region, planar_image.get_y(),
+                                planar_image.get_pitch_y());
+      timer.print("Copied interlaced frame 0 to tiled memory.");
+
+      capture.get_sample(0, top_planar_image, true, 0);
+      capture.get_sample(0, bot_planar_image, true, 1);
+      timer.print("Read YUV field frames 0 from disk to CPU linear memory.");
+
+      top_writer.append_frame(top_planar_image);
+      bot_writer.append_frame(bot_planar_image);
 
       for (int k = 1; k < frame_count; k++) {
-        LOG_INFO << "Processing field frame " << k << "...";
-        run_vme_interlaced_split(args, context, queue, kernel, capture,
-                                 *field_planar_image[j], src_image, ref_image,
-                                 j, k);
+        LOG_INFO << "Processing frame " << k << "...";
+        run_vme_interlaced_native(args, context, queue, kernel, capture,
+                                  planar_image, top_planar_image,
+                                  bot_planar_image, src_image, ref_image, k);
+        top_writer.append_frame(top_planar_image);
+        bot_writer.append_frame(bot_planar_image);
+      }
+    } else {
+      compute::image_format format(CL_R, CL_UNORM_INT8);
+      compute::image2d ref_image(context, args.width, field_height, format);
+      compute::image2d src_image(context, args.width, field_height, format);
+
+      YuvWriter *field_writer[] = {&top_writer, &bot_writer};
+      PlanarImage *field_planar_image[] = {&top_planar_image,
+                                           &bot_planar_image};
+
+      for (int j = 0; j < 2; j++) {
+        LOG_INFO << "Processing field polarity " << j;
+        capture.get_sample(0, *field_planar_image[j], true, j);
+        timer.print("Read YUV field frame 0 from disk to CPU linear memory.");
+
         field_writer[j]->append_frame(*field_planar_image[j]);
+
+        size_t origin[] = {0, 0, 0};
+        size_t region[] = {static_cast<size_t>(args.width),
+                           static_cast<size_t>(field_height), 1};
+        queue.enqueue_write_image(src_image, origin, region,
+                                  field_planar_image[j]->get_y(),
+                                  field_planar_image[j]->get_pitch_y());
+        timer.print("Copied field frame 0 to tiled memory.");
+
+        for (int k = 1; k < frame_count; k++) {
+          LOG_INFO << "Processing field frame " << k << "...";
+          run_vme_interlaced_split(args, context, queue, kernel, capture,
+                                   *field_planar_image[j], src_image, ref_image,
+                                   j, k);
+          field_writer[j]->append_frame(*field_planar_image[j]);
+        }
       }
     }
   }
@@ -370,4 +425,130 @@ void VmeInterlacedApplication::get_field_capture_samples(
   capture.get_sample(frame_idx, bot_planar_image, true, 1);
   timer.print("Read YUV next bot frame from disk to CPU linear memory");
 }
+
+void VmeInterlacedApplication::run_vme_interlaced_pipeline(
+    const VmeInterlacedApplication::Arguments &args, compute::context &context,
+    compute::command_queue &queue, compute::kernel &kernel, YuvCapture &capture,
+    YuvWriter &top_writer, YuvWriter &bot_writer, int frame_count) const {
+  int width = args.width;
+  int height = args.height;
+  int field_height = height / 2;
+  // Native mode estimates both fields of uploaded frames, split mode uploads
+  // single fields and runs the pipeline once per polarity
+  int image_height = (args.native != 0) ? height : field_height;
+  int mb_image_width = au::align_units(width, 16);
+  int mb_image_height = (args.native != 0)
+                            ? au::align_units(height, 16) / 2
+                            : au::align_units(field_height, 16);
+  int mv_image_width = mb_image_width * 4;
+  int mv_image_height = mb_image_height * 4;
+  int mv_count = mv_image_width * mv_image_height;
+  int mb_count = mb_image_width * mb_image_height;
+
+  cl_short2 default_predictor = {0, 0};
+  au::PageAlignedVector<cl_short2> predictors(au::align64(mb_count),
+                                              default_predictor);
+  compute::buffer pred_buffer(
+      context, au::align64(mb_count * sizeof(cl_short2)),
+      CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, predictors.data());
+
+  // Transfers use a separate queue, so they are not ordered behind kernels
+  // of other frames
+  compute::command_queue transfer_queue(context, queue.get_device());
+
+  auto interlaced = static_cast<uint8_t>(args.native != 0);
+  auto iterations = static_cast<uint32_t>(mb_image_height);
+  YuvWriter *field_writer[] = {&top_writer, &bot_writer};
+
+  std::vector<std::vector<int>> passes;
+  if (args.native != 0) {
+    passes.push_back({0, 1});
+  } else {
+    passes.push_back({0});
+    passes.push_back({1});
+  }
+
+  for (const std::vector<int> &polarities : passes) {
+    // Motion vectors of both polarities are kept in the slots
+    VmePipeline pipeline(args.pipeline_depth, width, image_height, 0, 0);
+    std::vector<std::unique_ptr<InterlacedSlot>> slots;
+    for (int i = 0; i < pipeline.slot_count(); ++i) {
+      slots.emplace_back(new InterlacedSlot(context, width, height,
+                                            image_height, mv_count, mb_count));
+    }
+    auto field_image = [&](int frame_idx, VmeFrame &frame,
+                           int polarity) -> PlanarImage & {
+      if (args.native != 0) {
+        return slots[pipeline.slot(frame_idx)]->field_image(polarity);
+      }
+      return frame.planar_image;
+    };
+
+    pipeline.set_read([&](int frame_idx, VmeFrame &frame) {
+      if (args.native == 0) {
+        capture.get_sample(frame_idx, frame.planar_image, true,
+                           polarities.front());
+        return;
+      }
+      capture.get_sample(frame_idx, frame.planar_image);
+      for (int polarity : polarities) {
+        capture.get_sample(frame_idx, field_image(frame_idx, frame, polarity),
+                           true, polarity);
+      }
+    });
+    pipeline.set_upload([&](int slot, const PlanarImage &image) {
+      size_t origin[] = {0, 0, 0};
+      size_t region[] = {static_cast<size_t>(width),
+                         static_cast<size_t>(image_height), 1};
+      transfer_queue.enqueue_write_image(slots[slot]->src_image, origin,
+                                         region, image.get_y(),
+                                         image.get_pitch_y());
+    });
+    pipeline.set_compute([&](int frame_idx, int slot, int reference_slot) {
+      if (frame_idx == 0) {
+        return;
+      }
+      InterlacedSlot &src = *slots[slot];
+      InterlacedSlot &ref = *slots[reference_slot];
+      for (int polarity : polarities) {
+        kernel.set_args(src.src_image, ref.src_image, interlaced,
+                        static_cast<uint8_t>(polarity), pred_buffer,
+                        src.mv_buffers[polarity], src.residual_buffer,
+                        src.shape_buffers[polarity], iterations);
+        size_t local_size = 16;
+        size_t global_size = au::align16(width);
+        queue.enqueue_nd_range_kernel(kernel, 1, nullptr, &global_size,
+                                      &local_size);
+      }
+      queue.finish();
+    });
+    pipeline.set_readback([&](int slot, VmeFrame &) {
+      InterlacedSlot &src = *slots[slot];
+      for (int polarity : polarities) {
+        transfer_queue.enqueue_read_buffer(src.mv_buffers[polarity], 0,
+                                           mv_count * sizeof(cl_short2),
+                                           src.mvs[polarity].data());
+        transfer_queue.enqueue_read_buffer(src.shape_buffers[polarity], 0,
+                                           mb_count * sizeof(cl_uchar2),
+                                           src.shapes[polarity].data());
+      }
+    });
+    pipeline.set_overlay([&](int frame_idx, VmeFrame &frame) {
+      InterlacedSlot &src = *slots[pipeline.slot(frame_idx)];
+      for (int polarity : polarities) {
+        field_image(frame_idx, frame, polarity)
+            .overlay_vectors(src.mvs[polarity].data(),
+                             src.shapes[polarity].data());
+      }
+    });
+    pipeline.set_write([&](int frame_idx, VmeFrame &frame) {
+      for (int polarity : polarities) {
+        field_writer[polarity]->append_frame(
+            field_image(frame_idx, frame, polarity));
+      }
+    });
+
+    pipeline.run(frame_count);
+  }
+}
 } // namespace compute_samples
@@ -11,6 +11,7 @@
 #include <fstream>
 #include <istream>
 #include <iterator>
+#include <string>
 
 #include "vme_interlaced/vme_interlaced.hpp"
 #include "test_harness/test_harness.hpp"
@@ -100,3 +101,40 @@ HWTEST_F(VmeInterlacedSystemTests, ReturnsReferenceImage) {
   EXPECT_EQ(ref_top_iter, eos_top_iter);
   EXPECT_EQ(ref_bot_iter, eos_bot_iter);
 }
+
+HWTEST_F(VmeInterlacedSystemTests, PipelineMatchesSerialProcessing) {
+  for (const std::string sub_test : {"native", "split"}) {
+    std::vector<std::string> command_line = {
+        input_file_, reference_top_file_, reference_bot_file_, "--width",
+        "720",       "--height",          "480",               "-s",
+        sub_test,    "-f",                "30"};
+
+    compute_samples::VmeInterlacedApplication application;
+    EXPECT_EQ(compute_samples::Application::Status::OK,
+              application.run(command_line));
+
+    command_line[1] = output_top_file_;
+    command_line[2] = output_bot_file_;
+    command_line.push_back("--pipeline-depth");
+    command_line.push_back("3");
+    EXPECT_EQ(compute_samples::Application::Status::OK,
+              application.run(command_line));
+
+    for (const bool top : {true, false}) {
+      std::ifstream out(top ? output_top_file_ : output_bot_file_,
+                        std::ios::binary);
+      std::ifstream ref(top ? reference_top_file_ : reference_bot_file_,
+                        std::ios::binary);
+      EXPECT_TRUE(out.good() && ref.good());
+
+      std::istreambuf_iterator<char> out_iter(out);
+      std::istreambuf_iterator<char> ref_iter(ref);
+      std::istreambuf_iterator<char> eos_iter;
+      while (ref_iter != eos_iter && out_iter != eos_iter) {
+        EXPECT_EQ(*ref_iter++, *out_iter++);
+      }
+      EXPECT_EQ(out_iter, eos_iter);
+      EXPECT_EQ(ref_iter, eos_iter);
+    }
+  }
+}
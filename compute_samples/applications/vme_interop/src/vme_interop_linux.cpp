@@ -234,7 +234,8 @@ void VmeInteropApplication::run_os_specific_implementation(
   YuvCapture capture(args.input_yuv_path, args.width, args.height, args.frames);
   const size_t frame_count =
       (args.frames) != 0 ? args.frames : capture.get_num_frames();
-  YuvWriter writer(args.width, args.height, frame_count, args.output_bmp);
+  YuvWriter writer(args.width, args.height, 0, args.output_bmp);
+  writer.open(args.output_yuv_path);
 
   PlanarImage planar_image(args.width, args.height);
   capture.get_sample(0, planar_image);
@@ -27,6 +27,7 @@ private:
     int width = 0;
     int height = 0;
     int frames = 0;
+    int pipeline_depth = 0;
     bool help = false;
   };
 
@@ -42,6 +43,14 @@ private:
       boost::compute::image2d &ref_4x_image,
       boost::compute::image2d &src_8x_image,
       boost::compute::image2d &ref_8x_image, int frame_idx) const;
+  void run_vme_intra_pipeline(const VmeIntraApplication::Arguments &args,
+                              boost::compute::context &context,
+                              boost::compute::command_queue &queue,
+                              boost::compute::kernel &ds_kernel,
+                              boost::compute::kernel &hme_n_kernel,
+                              boost::compute::kernel &intra_kernel,
+                              YuvCapture &capture, YuvWriter &writer,
+                              int frame_count) const;
   void write_results_to_file(const cl_ulong *intra_modes,
                              const cl_uchar *intra_shapes,
                              const cl_ushort *intra_residuals,
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
@@ -22,6 +23,7 @@
 #include <CL/cl_ext.h>
 
 #include "align_utils/align_utils.hpp"
+#include "yuv_utils/vme_pipeline.hpp"
 #include "timer/timer.hpp"
 #include "ocl_utils/ocl_utils.hpp"
 #include "logging/logging.hpp"
@@ -31,6 +33,60 @@ namespace po = boost::program_options;
 namespace compute = boost::compute;
 
 namespace compute_samples {
+namespace {
+compute::image_format luma_format() {
+  return compute::image_format(CL_R, CL_UNORM_INT8);
+}
+
+// Device resources and intra results of a frame in flight
+struct IntraSlot {
+  IntraSlot(const compute::context &context, int width, int height,
+            int mv_count, int mb_count)
+      : src_image(context, width, height, luma_format()),
+        src_2x_image(context, au::align_units(width, 2),
+                     au::align_units(height, 2), luma_format()),
+        src_4x_image(context, au::align_units(width, 4),
+                     au::align_units(height, 4), luma_format()),
+        src_8x_image(context, au::align_units(width, 8),
+                     au::align_units(height, 8), luma_format()),
+        inter_best_residuals(au::align64(mb_count)),
+        intra_shapes(au::align64(mb_count)),
+        intra_residuals(au::align64(mb_count)),
+        intra_modes(au::align64(mb_count)),
+        mv_buffer(context, au::align64(mv_count * sizeof(cl_short2))),
+        inter_shape_buffer(context, au::align64(mb_count * sizeof(cl_uchar2))),
+        inter_residual_buffer(context,
+                              au::align64(mv_count * sizeof(cl_ushort))),
+        inter_best_residual_buffer(context,
+                                   au::align64(mb_count * sizeof(cl_ushort))),
+        intra_shape_buffer(context, au::align64(mb_count * sizeof(cl_uchar))),
+        intra_residual_buffer(context,
+                              au::align64(mb_count * sizeof(cl_ushort))),
+        intra_mode_buffer(context, au::align64(mb_count * sizeof(cl_ulong))) {}
+
+  compute::image2d src_image;
+  compute::image2d src_2x_image;
+  compute::image2d src_4x_image;
+  compute::image2d src_8x_image;
+  au::PageAlignedVector<cl_ushort> inter_best_residuals;
+  au::PageAlignedVector<cl_uchar> intra_shapes;
+  au::PageAlignedVector<cl_ushort> intra_residuals;
+  au::PageAlignedVector<cl_ulong> intra_modes;
+  compute::buffer mv_buffer;
+  compute::buffer inter_shape_buffer;
+  compute::buffer inter_residual_buffer;
+  compute::buffer inter_best_residual_buffer;
+  compute::buffer intra_shape_buffer;
+  compute::buffer intra_residual_buffer;
+  compute::buffer intra_mode_buffer;
+};
+
+template <typename T>
+void fill_buffer(compute::command_queue &queue, compute::buffer &buffer,
+                 const T value) {
+  queue.enqueue_fill_buffer(buffer, &value, sizeof(value), 0, buffer.size());
+}
+} // namespace
 
 VmeIntraApplication::Arguments VmeIntraApplication::parse_command_line(
     const std::vector<std::string> &command_line) {
@@ -62,6 +118,11 @@ VmeIntraApplication::Arguments VmeIntraApplication::parse_command_line(
   options("frames,f", po::value<int>(&args.frames)->default_value(0),
           "number of frame to use for motion estimation (0 represents entire "
           "yuv sequence)");
+  options("pipeline-depth",
+          po::value<int>(&args.pipeline_depth)->default_value(0),
+          "number of frames processed concurrently by separate read, upload, "
+          "compute, readback, overlay and write stages (0 processes frames "
+          "serially)");
 
   po::positional_options_description p;
   p.add("input-yuv", 1);
@@ -84,6 +145,10 @@ VmeIntraApplication::Arguments VmeIntraApplication::parse_command_line(
     throw std::invalid_argument("Invalid argument for qp. Valid range (0-51).");
   }
 
+  if (args.pipeline_depth < 0) {
+    throw std::invalid_argument("Invalid argument for pipeline-depth.");
+  }
+
   return args;
 }
 
@@ -175,36 +240,42 @@ Application::Status VmeIntraApplication::run_implementation(
   YuvCapture capture(args.input_yuv_path, args.width, args.height, args.frames);
   const int frame_count =
       (args.frames) != 0 ? args.frames : capture.get_num_frames();
-  YuvWriter writer(args.width, args.height, frame_count, args.output_bmp);
-
-  PlanarImage planar_image(args.width, args.height);
-  capture.get_sample(0, planar_image);
-  timer.print("Read YUV frame 0 from disk to CPU linear memory.");
-
-  compute::image_format format(CL_R, CL_UNORM_INT8);
-  compute::image2d ref_image(context, args.width, args.height, format);
-  compute::image2d src_image(context, args.width, args.height, format);
-  compute::image2d src_image_8x(context, au::align_units(args.width, 8),
-                                au::align_units(args.height, 8), format);
-  compute::image2d ref_image_8x(context, au::align_units(args.width, 8),
-                                au::align_units(args.height, 8), format);
-  compute::image2d src_image_4x(context, au::align_units(args.width, 4),
-                                au::align_units(args.height, 4), format);
-  compute::image2d ref_image_4x(context, au::align_units(args.width, 4),
-                                au::align_units(args.height, 4), format);
-  compute::image2d src_image_2x(context, au::align_units(args.width, 2),
-                                au::align_units(args.height, 2), format);
-  compute::image2d ref_image_2x(context, au::align_units(args.width, 2),
-                                au::align_units(args.height, 2), format);
-  timer.print("Created opencl mem objects for downsample_3_tier kernel");
-
-  for (int k = 0; k < frame_count; k++) {
-    LOG_INFO << "Processing frame " << k << "...";
-    run_vme_intra(args, context, queue, ds_kernel, hme_n_kernel, intra_kernel,
-                  capture, planar_image, src_image, ref_image, src_image_2x,
-                  ref_image_2x, src_image_4x, ref_image_4x, src_image_8x,
-                  ref_image_8x, k);
-    writer.append_frame(planar_image);
+  YuvWriter writer(args.width, args.height, 0, args.output_bmp);
+  writer.open(args.output_yuv_path);
+
+  if (args.pipeline_depth > 0) {
+    run_vme_intra_pipeline(args, context, queue, ds_kernel, hme_n_kernel,
+                           intra_kernel, capture, writer, frame_count);
+  } else {
+    PlanarImage planar_image(args.width, args.height);
+    capture.get_sample(0, planar_image);
+    timer.print("Read YUV frame 0 from disk to CPU linear memory.");
+
+    compute::image_format format(CL_R, CL_UNORM_INT8);
+    compute::image2d ref_image(context, args.width, args.height, format);
+    compute::image2d src_image(context, args.width, args.height, format);
+    compute::image2d src_image_8x(context, au::align_units(args.width, 8),
+                                  au::align_units(args.height, 8), format);
+    compute::image2d ref_image_8x(context, au::align_units(args.width, 8),
+                                  au::align_units(args.height, 8), format);
+    compute::image2d src_image_4x(context, au::align_units(args.width, 4),
+                                  au::align_units(args.height, 4), format);
+    compute::image2d ref_image_4x(context, au::align_units(args.width, 4),
+                                  au::align_units(args.height, 4), format);
+    compute::image2d src_image_2x(context, au::align_units(args.width, 2),
+                                  au::align_units(args.height, 2), format);
+    compute::image2d ref_image_2x(context, au::align_units(args.width, 2),
+                                  au::align_units(args.height, 2), format);
+    timer.print("Created opencl mem objects for downsample_3_tier kernel");
+
+    for (int k = 0; k < frame_count; k++) {
+      LOG_INFO << "Processing frame " << k << "...";
+      run_vme_intra(args, context, queue, ds_kernel, hme_n_kernel, intra_kernel,
+                    capture, planar_image, src_image, ref_image, src_image_2x,
+                    ref_image_2x, src_image_4x, ref_image_4x, src_image_8x,
+                    ref_image_8x, k);
+      writer.append_frame(planar_image);
+    }
   }
 
   LOG_INFO << "Wrote " << frame_count << " frames with overlaid "
@@ -378,4 +449,163 @@ void VmeIntraApplication::run_vme_intra(
                         intra_residuals.data(), inter_best_residuals.data(),
                         width, height, frame_idx);
 }
+
+void VmeIntraApplication::run_vme_intra_pipeline(
+    const VmeIntraApplication::Arguments &args, compute::context &context,
+    compute::command_queue &queue, compute::kernel &ds_kernel,
+    compute::kernel &hme_n_kernel, compute::kernel &intra_kernel,
+    YuvCapture &capture, YuvWriter &writer, int frame_count) const {
+  int width = args.width;
+  int height = args.height;
+
+  int mb_image_width = au::align_units(width, 16);
+  int mb_image_height = au::align_units(height, 16);
+  int mb_count = mb_image_width * mb_image_height;
+  int mv_image_width = mb_image_width * 4;
+  int mv_image_height = mb_image_height * 4;
+  int mv_count = mv_image_width * mv_image_height;
+
+  VmePipeline pipeline(args.pipeline_depth, width, height, mv_count,
+                       mb_count);
+  std::vector<std::unique_ptr<IntraSlot>> slots;
+  for (int i = 0; i < pipeline.slot_count(); ++i) {
+    slots.emplace_back(
+        new IntraSlot(context, width, height, mv_count, mb_count));
+  }
+
+  // Predictors are only used between kernels of one frame, and frames are
+  // computed one after another, so all slots share them
+  uint32_t mv_8x_count = DIM_TO_MV_SZ(width, 8) * DIM_TO_MV_SZ(height, 8);
+  uint32_t mv_4x_count = DIM_TO_MV_SZ(width, 4) * DIM_TO_MV_SZ(height, 4);
+  uint32_t mv_2x_count = DIM_TO_MV_SZ(width, 2) * DIM_TO_MV_SZ(height, 2);
+  compute::buffer pred_4x_buffer(context,
+                                 au::align64(mv_8x_count * sizeof(cl_short2)));
+  compute::buffer pred_2x_buffer(context,
+                                 au::align64(mv_4x_count * sizeof(cl_short2)));
+  compute::buffer pred_buffer(context,
+                              au::align64(mv_2x_count * sizeof(cl_short2)));
+
+  // Transfers use a separate queue, so they are not ordered behind kernels
+  // of other frames
+  compute::command_queue transfer_queue(context, queue.get_device());
+
+  auto qp = static_cast<cl_uchar>(args.qp);
+  cl_uchar sad_adjustment = CL_AVC_ME_SAD_ADJUST_MODE_NONE_INTEL;
+  cl_uchar pixel_mode = CL_AVC_ME_SUBPIXEL_MODE_QPEL_INTEL;
+  auto iterations = static_cast<cl_int>(mb_image_height);
+
+  // The first frame is estimated with intra prediction only
+  pipeline.set_first_frame_estimated(true);
+  pipeline.read_from(capture);
+  pipeline.set_upload([&](int slot, const PlanarImage &image) {
+    size_t origin[] = {0, 0, 0};
+    size_t region[] = {static_cast<size_t>(width), static_cast<size_t>(height),
+                       1};
+    transfer_queue.enqueue_write_image(slots[slot]->src_image, origin, region,
+                                       image.get_y(), image.get_pitch_y());
+  });
+  pipeline.set_compute([&](int frame_idx, int slot, int reference_slot) {
+    IntraSlot &src = *slots[slot];
+    ds_kernel.set_args(src.src_image, src.src_2x_image, src.src_4x_image,
+                       src.src_8x_image);
+    queue.enqueue_nd_range_kernel(
+        ds_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 4)),
+                     au::align_units(height, 16))
+            .data(),
+        compute::dim(16, 1).data());
+    IntraSlot &ref = *slots[reference_slot];
+
+    if (frame_idx > 0) {
+      hme_n_kernel.set_arg(0, src.src_8x_image);
+      hme_n_kernel.set_arg(1, ref.src_8x_image);
+      hme_n_kernel.set_arg(2, sizeof(cl_mem), nullptr);
+      hme_n_kernel.set_arg(3, pred_4x_buffer);
+      queue.enqueue_nd_range_kernel(
+          hme_n_kernel, 2, nullptr,
+          compute::dim(au::align16(au::align_units(width, 8)),
+                       DIM_TO_MB_SZ(height, 8))
+              .data(),
+          compute::dim(16, 1).data());
+
+      hme_n_kernel.set_args(src.src_4x_image, ref.src_4x_image, pred_4x_buffer,
+                            pred_2x_buffer);
+      queue.enqueue_nd_range_kernel(
+          hme_n_kernel, 2, nullptr,
+          compute::dim(au::align16(au::align_units(width, 4)),
+                       DIM_TO_MB_SZ(height, 4))
+              .data(),
+          compute::dim(16, 1).data());
+
+      hme_n_kernel.set_args(src.src_2x_image, ref.src_2x_image, pred_2x_buffer,
+                            pred_buffer);
+      queue.enqueue_nd_range_kernel(
+          hme_n_kernel, 2, nullptr,
+          compute::dim(au::align16(au::align_units(width, 2)),
+                       DIM_TO_MB_SZ(height, 2))
+              .data(),
+          compute::dim(16, 1).data());
+    }
+
+    fill_buffer(queue, src.mv_buffer, cl_short2{{0, 0}});
+    fill_buffer(queue, src.inter_shape_buffer, cl_uchar2{{0, 0}});
+    fill_buffer(queue, src.inter_residual_buffer, cl_ushort(0xFFFF));
+    fill_buffer(queue, src.inter_best_residual_buffer, cl_ushort(0xFFFF));
+    fill_buffer(queue, src.intra_shape_buffer, cl_uchar(0xFF));
+    fill_buffer(queue, src.intra_residual_buffer, cl_ushort(0xFFFF));
+    fill_buffer(queue, src.intra_mode_buffer, cl_ulong(0xFFFFFFFFFFFFFFFF));
+
+    auto intra_only = static_cast<cl_uchar>(frame_idx == 0);
+    intra_kernel.set_args(
+        src.src_image, ref.src_image, src.src_image, pred_buffer,
+        src.mv_buffer, src.inter_shape_buffer, src.inter_residual_buffer,
+        src.inter_best_residual_buffer, src.intra_shape_buffer,
+        src.intra_residual_buffer, src.intra_mode_buffer, qp, sad_adjustment,
+        pixel_mode, intra_only, iterations);
+    size_t local_size = 16;
+    size_t global_size = au::align16(width);
+    queue.enqueue_nd_range_kernel(intra_kernel, 1, nullptr, &global_size,
+                                  &local_size);
+    queue.finish();
+  });
+  pipeline.set_readback([&](int slot, VmeFrame &frame) {
+    IntraSlot &src = *slots[slot];
+    transfer_queue.enqueue_read_buffer(src.mv_buffer, 0,
+                                       mv_count * sizeof(cl_short2),
+                                       frame.mvs.data());
+    transfer_queue.enqueue_read_buffer(src.inter_shape_buffer, 0,
+                                       mb_count * sizeof(cl_uchar2),
+                                       frame.shapes.data());
+    transfer_queue.enqueue_read_buffer(src.inter_best_residual_buffer, 0,
+                                       mb_count * sizeof(cl_ushort),
+                                       src.inter_best_residuals.data());
+    transfer_queue.enqueue_read_buffer(src.intra_shape_buffer, 0,
+                                       mb_count * sizeof(cl_uchar),
+                                       src.intra_shapes.data());
+    transfer_queue.enqueue_read_buffer(src.intra_residual_buffer, 0,
+                                       mb_count * sizeof(cl_ushort),
+                                       src.intra_residuals.data());
+    transfer_queue.enqueue_read_buffer(src.intra_mode_buffer, 0,
+                                       mb_count * sizeof(cl_ulong),
+                                       src.intra_modes.data());
+  });
+  pipeline.set_overlay([&](int frame_idx, VmeFrame &frame) {
+    IntraSlot &src = *slots[pipeline.slot(frame_idx)];
+    frame.planar_image.overlay_vectors(
+        frame.mvs.data(), frame.shapes.data(),
+        reinterpret_cast<intra_shape *>(src.intra_shapes.data()),
+        reinterpret_cast<residual *>(src.inter_best_residuals.data()),
+        reinterpret_cast<residual *>(src.intra_residuals.data()));
+  });
+  pipeline.set_write([&](int frame_idx, VmeFrame &frame) {
+    IntraSlot &src = *slots[pipeline.slot(frame_idx)];
+    writer.append_frame(frame.planar_image);
+    write_results_to_file(src.intra_modes.data(), src.intra_shapes.data(),
+                          src.intra_residuals.data(),
+                          src.inter_best_residuals.data(), width, height,
+                          frame_idx);
+  });
+
+  pipeline.run(frame_count);
+}
 } // namespace compute_samples
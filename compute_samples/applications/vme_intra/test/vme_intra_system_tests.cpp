@@ -11,6 +11,7 @@
 #include <fstream>
 #include <istream>
 #include <iterator>
+#include <string>
 
 #include "vme_intra/vme_intra.hpp"
 #include "test_harness/test_harness.hpp"
@@ -24,33 +25,41 @@ protected:
     }
   }
 
+  void verify(int pipeline_depth) {
+    std::vector<std::string> command_line = {
+        input_file_, output_file_, "--width", "176", "--height",
+        "144",       "--qp",       "45",      "-f",  "50"};
+    if (pipeline_depth > 0) {
+      command_line.push_back("--pipeline-depth");
+      command_line.push_back(std::to_string(pipeline_depth));
+    }
+
+    compute_samples::VmeIntraApplication application;
+    EXPECT_EQ(compute_samples::Application::Status::OK,
+              application.run(command_line));
+
+    std::ifstream out(output_file_, std::ios::binary);
+    std::string reference_file = "intra_";
+    reference_file += input_file_;
+    std::ifstream ref(reference_file, std::ios::binary);
+    EXPECT_TRUE(out.good() && ref.good());
+    EXPECT_TRUE(!out.eof() && !ref.eof());
+
+    std::istreambuf_iterator<char> out_iter(out);
+    std::istreambuf_iterator<char> ref_iter(ref);
+    std::istreambuf_iterator<char> eos_iter;
+    while (ref_iter != eos_iter && out_iter != eos_iter) {
+      EXPECT_EQ(*ref_iter++, *out_iter++);
+    }
+
+    EXPECT_EQ(out_iter, eos_iter);
+    EXPECT_EQ(ref_iter, eos_iter);
+  }
+
   const std::string input_file_ = "foreman_176x144.yuv";
   const std::string output_file_ = "output_foreman_176x144.yuv";
 };
 
-HWTEST_F(VmeIntraSystemTests, ReturnsReferenceImage) {
-  std::vector<std::string> command_line = {
-      input_file_, output_file_, "--width", "176", "--height",
-      "144",       "--qp",       "45",      "-f",  "50"};
-
-  compute_samples::VmeIntraApplication application;
-  EXPECT_EQ(compute_samples::Application::Status::OK,
-            application.run(command_line));
-
-  std::ifstream out(output_file_, std::ios::binary);
-  std::string reference_file = "intra_";
-  reference_file += input_file_;
-  std::ifstream ref(reference_file, std::ios::binary);
-  EXPECT_TRUE(out.good() && ref.good());
-  EXPECT_TRUE(!out.eof() && !ref.eof());
-
-  std::istreambuf_iterator<char> out_iter(out);
-  std::istreambuf_iterator<char> ref_iter(ref);
-  std::istreambuf_iterator<char> eos_iter;
-  while (ref_iter != eos_iter && out_iter != eos_iter) {
-    EXPECT_EQ(*ref_iter++, *out_iter++);
-  }
+HWTEST_F(VmeIntraSystemTests, ReturnsReferenceImage) { verify(0); }
 
-  EXPECT_EQ(out_iter, eos_iter);
-  EXPECT_EQ(ref_iter, eos_iter);
-}
+HWTEST_F(VmeIntraSystemTests, PipelinedReturnsReferenceImage) { verify(3); }
@@ -13,6 +13,7 @@
 #include <boost/compute/core.hpp>
 
 #include "application/application.hpp"
+#include "yuv_utils/vector_overlay.hpp"
 #include "yuv_utils/yuv_utils.hpp"
 
 namespace compute_samples {
@@ -28,6 +29,7 @@ private:
     int width = 0;
     int height = 0;
     int frames = 0;
+    int pipeline_depth = 0;
     bool help = false;
   };
 
@@ -35,9 +37,15 @@ private:
                       boost::compute::context &context,
                       boost::compute::command_queue &queue,
                       boost::compute::kernel &kernel, YuvCapture &capture,
-                      PlanarImage &src_planar_image,
+                      VectorOverlay &overlay, PlanarImage &src_planar_image,
                       boost::compute::image2d &src_image,
                       boost::compute::image2d &ref_image, int frame_idx) const;
+  void run_vme_search_pipeline(const VmeSearchApplication::Arguments &args,
+                               boost::compute::context &context,
+                               boost::compute::command_queue &queue,
+                               boost::compute::kernel &kernel,
+                               YuvCapture &capture, YuvWriter &writer,
+                               int frame_count) const;
   Arguments parse_command_line(const std::vector<std::string> &command_line);
 };
 } // namespace compute_samples
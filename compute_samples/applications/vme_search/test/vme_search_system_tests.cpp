@@ -11,6 +11,7 @@
 #include <fstream>
 #include <istream>
 #include <iterator>
+#include <string>
 
 #include "vme_search/vme_search.hpp"
 #include "test_harness/test_harness.hpp"
@@ -24,10 +25,14 @@ protected:
     }
   }
 
-  void verify(std::string sub_test) {
+  void verify(std::string sub_test, int pipeline_depth = 0) {
     std::vector<std::string> command_line = {
         input_file_, output_file_, "--width", "176",    "--height", "144",
         "--qp",      "45",         "-s",      sub_test, "-f",       "50"};
+    if (pipeline_depth > 0) {
+      command_line.push_back("--pipeline-depth");
+      command_line.push_back(std::to_string(pipeline_depth));
+    }
 
     compute_samples::VmeSearchApplication application;
     application.run(command_line);
@@ -62,3 +67,7 @@ HWTEST_F(VmeSearchSystemTests, CostHeuristicsSearch) {
 }
 
 HWTEST_F(VmeSearchSystemTests, LargerSearch) { verify("larger_search"); }
+
+HWTEST_F(VmeSearchSystemTests, PipelinedBasicSearch) {
+  verify("basic_search", 3);
+}
@@ -13,6 +13,7 @@
 #include <boost/compute/core.hpp>
 
 #include "application/application.hpp"
+#include "yuv_utils/vector_overlay.hpp"
 #include "yuv_utils/yuv_utils.hpp"
 
 namespace compute_samples {
@@ -27,6 +28,7 @@ private:
     int width = 0;
     int height = 0;
     int frames = 0;
+    int pipeline_depth = 0;
     bool help = false;
   };
 
@@ -35,13 +37,22 @@ private:
       boost::compute::context &context, boost::compute::command_queue &queue,
       boost::compute::kernel &ds_kernel, boost::compute::kernel &hme_n_kernel,
       boost::compute::kernel &wpp_kernel, YuvCapture &capture,
-      PlanarImage &planar_image, boost::compute::image2d &src_image,
-      boost::compute::image2d &ref_image, boost::compute::image2d &src_2x_image,
+      VectorOverlay &overlay, PlanarImage &planar_image,
+      boost::compute::image2d &src_image, boost::compute::image2d &ref_image,
+      boost::compute::image2d &src_2x_image,
       boost::compute::image2d &ref_2x_image,
       boost::compute::image2d &src_4x_image,
       boost::compute::image2d &ref_4x_image,
       boost::compute::image2d &src_8x_image,
       boost::compute::image2d &ref_8x_image, int frame_idx) const;
+  void run_vme_wpp_pipeline(const VmeWppApplication::Arguments &args,
+                            boost::compute::context &context,
+                            boost::compute::command_queue &queue,
+                            boost::compute::kernel &ds_kernel,
+                            boost::compute::kernel &hme_n_kernel,
+                            boost::compute::kernel &wpp_kernel,
+                            YuvCapture &capture, YuvWriter &writer,
+                            int frame_count) const;
   Arguments parse_command_line(const std::vector<std::string> &command_line);
 };
 } // namespace compute_samples
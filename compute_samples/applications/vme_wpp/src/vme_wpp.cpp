@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
@@ -23,6 +24,7 @@
 #include <CL/cl_ext.h>
 
 #include "align_utils/align_utils.hpp"
+#include "yuv_utils/vme_pipeline.hpp"
 #include "timer/timer.hpp"
 #include "ocl_utils/ocl_utils.hpp"
 #include "logging/logging.hpp"
@@ -32,6 +34,35 @@ namespace po = boost::program_options;
 namespace compute = boost::compute;
 
 namespace compute_samples {
+namespace {
+compute::image_format luma_format() {
+  return compute::image_format(CL_R, CL_UNORM_INT8);
+}
+
+// Device resources of a frame in flight
+struct WppSlot {
+  WppSlot(const compute::context &context, int width, int height,
+          int mv_count, int mb_count)
+      : src_image(context, width, height, luma_format()),
+        src_2x_image(context, au::align_units(width, 2),
+                     au::align_units(height, 2), luma_format()),
+        src_4x_image(context, au::align_units(width, 4),
+                     au::align_units(height, 4), luma_format()),
+        src_8x_image(context, au::align_units(width, 8),
+                     au::align_units(height, 8), luma_format()),
+        mv_buffer(context, au::align64(mv_count * sizeof(cl_short2))),
+        residual_buffer(context, au::align64(mv_count * sizeof(cl_ushort))),
+        shape_buffer(context, au::align64(mb_count * sizeof(cl_uchar2))) {}
+
+  compute::image2d src_image;
+  compute::image2d src_2x_image;
+  compute::image2d src_4x_image;
+  compute::image2d src_8x_image;
+  compute::buffer mv_buffer;
+  compute::buffer residual_buffer;
+  compute::buffer shape_buffer;
+};
+} // namespace
 
 VmeWppApplication::Arguments VmeWppApplication::parse_command_line(
     const std::vector<std::string> &command_line) {
@@ -63,6 +94,11 @@ VmeWppApplication::Arguments VmeWppApplication::parse_command_line(
   options("frames,f", po::value<int>(&args.frames)->default_value(0),
           "number of frame to use for motion estimation (0 represents entire "
           "yuv sequence)");
+  options("pipeline-depth",
+          po::value<int>(&args.pipeline_depth)->default_value(0),
+          "number of frames processed concurrently by separate read, upload, "
+          "compute, readback, overlay and write stages (0 processes frames "
+          "serially)");
 
   po::positional_options_description p;
   p.add("input-yuv", 1);
@@ -85,6 +121,10 @@ VmeWppApplication::Arguments VmeWppApplication::parse_command_line(
     throw std::invalid_argument("Invalid argument for qp. Valid range (0-51).");
   }
 
+  if (args.pipeline_depth < 0) {
+    throw std::invalid_argument("Invalid argument for pipeline-depth.");
+  }
+
   return args;
 }
 
@@ -135,54 +175,61 @@ VmeWppApplication::run_implementation(std::vector<std::string> &command_line) {
   YuvCapture capture(args.input_yuv_path, args.width, args.height, args.frames);
   const int frame_count =
       (args.frames) != 0 ? args.frames : capture.get_num_frames();
-  YuvWriter writer(args.width, args.height, frame_count, args.output_bmp);
-
-  PlanarImage planar_image(args.width, args.height);
-  capture.get_sample(0, planar_image);
-  timer.print("Read YUV frame 0 from disk to CPU linear memory.");
-
-  writer.append_frame(planar_image);
-
-  compute::image_format format(CL_R, CL_UNORM_INT8);
-  compute::image2d ref_image(context, args.width, args.height, format);
-  compute::image2d src_image(context, args.width, args.height, format);
-  compute::image2d src_image_8x(context, au::align_units(args.width, 8),
-                                au::align_units(args.height, 8), format);
-  compute::image2d ref_image_8x(context, au::align_units(args.width, 8),
-                                au::align_units(args.height, 8), format);
-  compute::image2d src_image_4x(context, au::align_units(args.width, 4),
-                                au::align_units(args.height, 4), format);
-  compute::image2d ref_image_4x(context, au::align_units(args.width, 4),
-                                au::align_units(args.height, 4), format);
-  compute::image2d src_image_2x(context, au::align_units(args.width, 2),
-                                au::align_units(args.height, 2), format);
-  compute::image2d ref_image_2x(context, au::align_units(args.width, 2),
-                                au::align_units(args.height, 2), format);
-  timer.print("Created opencl mem objects for downsample_3_tier kernel");
+  YuvWriter writer(args.width, args.height, 0, args.output_bmp);
+  writer.open(args.output_yuv_path);
 
-  size_t origin[] = {0, 0, 0};
-  size_t region[] = {static_cast<size_t>(args.width),
-                     static_cast<size_t>(args.height), 1};
-  queue.enqueue_write_image(src_image, origin, region, planar_image.get_y(),
-                            planar_image.get_pitch_y());
-  timer.print("Copied frame 0 to tiled memory.");
+  if (args.pipeline_depth > 0) {
+    run_vme_wpp_pipeline(args, context, queue, ds_kernel, hme_n_kernel,
+                         wpp_kernel, capture, writer, frame_count);
+  } else {
+    PlanarImage planar_image(args.width, args.height);
+    capture.get_sample(0, planar_image);
+    timer.print("Read YUV frame 0 from disk to CPU linear memory.");
 
-  ds_kernel.set_args(src_image, src_image_2x, src_image_4x, src_image_8x);
-  queue.enqueue_nd_range_kernel(
-      ds_kernel, 2, nullptr,
-      compute::dim(au::align16(au::align_units(args.width, 4)),
-                   au::align_units(args.height, 16))
-          .data(),
-      compute::dim(16, 1).data());
-  timer.print("Enqueued downsample_3_tier kernel for frame 0");
-
-  for (int k = 1; k < frame_count; k++) {
-    LOG_INFO << "Processing frame " << k << "...";
-    run_vme_wpp(args, device, context, queue, ds_kernel, hme_n_kernel,
-                wpp_kernel, capture, planar_image, src_image, ref_image,
-                src_image_2x, ref_image_2x, src_image_4x, ref_image_4x,
-                src_image_8x, ref_image_8x, k);
     writer.append_frame(planar_image);
+
+    compute::image_format format(CL_R, CL_UNORM_INT8);
+    compute::image2d ref_image(context, args.width, args.height, format);
+    compute::image2d src_image(context, args.width, args.height, format);
+    compute::image2d src_image_8x(context, au::align_units(args.width, 8),
+                                  au::align_units(args.height, 8), format);
+    compute::image2d ref_image_8x(context, au::align_units(args.width, 8),
+                                  au::align_units(args.height, 8), format);
+    compute::image2d src_image_4x(context, au::align_units(args.width, 4),
+                                  au::align_units(args.height, 4), format);
+    compute::image2d ref_image_4x(context, au::align_units(args.width, 4),
+                                  au::align_units(args.height, 4), format);
+    compute::image2d src_image_2x(context, au::align_units(args.width, 2),
+                                  au::align_units(args.height, 2), format);
+    compute::image2d ref_image_2x(context, au::align_units(args.width, 2),
+                                  au::align_units(args.height, 2), format);
+    timer.print("Created opencl mem objects for downsample_3_tier kernel");
+
+    size_t origin[] = {0, 0, 0};
+    size_t region[] = {static_cast<size_t>(args.width),
+                       static_cast<size_t>(args.height), 1};
+    queue.enqueue_write_image(src_image, origin, region, planar_image.get_y(),
+                              planar_image.get_pitch_y());
+    timer.print("Copied frame 0 to tiled memory.");
+
+    ds_kernel.set_args(src_image, src_image_2x, src_image_4x, src_image_8x);
+    queue.enqueue_nd_range_kernel(
+        ds_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(args.width, 4)),
+                     au::align_units(args.height, 16))
+            .data(),
+        compute::dim(16, 1).data());
+    timer.print("Enqueued downsample_3_tier kernel for frame 0");
+
+    VectorOverlay overlay(0);
+    for (int k = 1; k < frame_count; k++) {
+      LOG_INFO << "Processing frame " << k << "...";
+      run_vme_wpp(args, device, context, queue, ds_kernel, hme_n_kernel,
+                  wpp_kernel, capture, overlay, planar_image, src_image,
+                  ref_image, src_image_2x, ref_image_2x, src_image_4x,
+                  ref_image_4x, src_image_8x, ref_image_8x, k);
+      writer.append_frame(planar_image);
+    }
   }
 
   LOG_INFO << "Wrote " << frame_count << " frames with overlaid "
@@ -197,12 +244,12 @@ void VmeWppApplication::run_vme_wpp(
     const VmeWppApplication::Arguments &args, compute::device &device,
     compute::context &context, compute::command_queue &queue,
     compute::kernel &ds_kernel, compute::kernel &hme_n_kernel,
-    compute::kernel &wpp_kernel, YuvCapture &capture, PlanarImage &planar_image,
-    compute::image2d &src_image, compute::image2d &ref_image,
-    compute::image2d &src_2x_image, compute::image2d &ref_2x_image,
-    compute::image2d &src_4x_image, compute::image2d &ref_4x_image,
-    compute::image2d &src_8x_image, compute::image2d &ref_8x_image,
-    int frame_idx) const {
+    compute::kernel &wpp_kernel, YuvCapture &capture, VectorOverlay &overlay,
+    PlanarImage &planar_image, compute::image2d &src_image,
+    compute::image2d &ref_image, compute::image2d &src_2x_image,
+    compute::image2d &ref_2x_image, compute::image2d &src_4x_image,
+    compute::image2d &ref_4x_image, compute::image2d &src_8x_image,
+    compute::image2d &ref_8x_image, int frame_idx) const {
   Timer timer;
 
   int width = args.width;
@@ -330,7 +377,146 @@ void VmeWppApplication::run_vme_wpp(
   queue.finish();
   timer.print("Kernel finished.");
 
-  planar_image.overlay_vectors(reinterpret_cast<motion_vector *>(mvs.data()),
-                               reinterpret_cast<inter_shape *>(shapes.data()));
+  overlay.render(reinterpret_cast<motion_vector *>(mvs.data()),
+                 reinterpret_cast<inter_shape *>(shapes.data()),
+                 luma_plane(planar_image));
+}
+
+void VmeWppApplication::run_vme_wpp_pipeline(
+    const VmeWppApplication::Arguments &args, compute::context &context,
+    compute::command_queue &queue, compute::kernel &ds_kernel,
+    compute::kernel &hme_n_kernel, compute::kernel &wpp_kernel,
+    YuvCapture &capture, YuvWriter &writer, int frame_count) const {
+  int width = args.width;
+  int height = args.height;
+
+  int mb_image_width = au::align_units(width, 16);
+  int mb_image_height = au::align_units(height, 16);
+  int mb_count = mb_image_width * mb_image_height;
+  int mv_image_width = mb_image_width * 4;
+  int mv_image_height = mb_image_height * 4;
+  int mv_count = mv_image_width * mv_image_height;
+
+  VmePipeline pipeline(args.pipeline_depth, width, height, mv_count,
+                       mb_count);
+  std::vector<std::unique_ptr<WppSlot>> slots;
+  for (int i = 0; i < pipeline.slot_count(); ++i) {
+    slots.emplace_back(new WppSlot(context, width, height, mv_count, mb_count));
+  }
+
+  // Predictors are only used between kernels of one frame, and frames are
+  // computed one after another, so all slots share them
+  uint32_t mv_8x_count = DIM_TO_MV_SZ(width, 8) * DIM_TO_MV_SZ(height, 8);
+  uint32_t mv_4x_count = DIM_TO_MV_SZ(width, 4) * DIM_TO_MV_SZ(height, 4);
+  uint32_t mv_2x_count = DIM_TO_MV_SZ(width, 2) * DIM_TO_MV_SZ(height, 2);
+  compute::buffer pred_4x_buffer(context,
+                                 au::align64(mv_8x_count * sizeof(cl_short2)));
+  compute::buffer pred_2x_buffer(context,
+                                 au::align64(mv_4x_count * sizeof(cl_short2)));
+  compute::buffer pred_buffer(context,
+                              au::align64(mv_2x_count * sizeof(cl_short2)));
+
+  uint32_t num_eu = queue.get_device().compute_units();
+  uint32_t num_threads_per_eu = 7;
+  uint32_t max_threads = num_eu * num_threads_per_eu;
+  uint32_t width_mb_sz = au::align_units(width, 16);
+  uint32_t num_blocks = (width_mb_sz < max_threads) ? width_mb_sz : max_threads;
+  uint32_t simd_size = 16;
+  compute::buffer scoreboard_buffer(
+      context, au::align64(width_mb_sz * sizeof(uint32_t)));
+
+  // Transfers use a separate queue, so they are not ordered behind kernels
+  // of other frames
+  compute::command_queue transfer_queue(context, queue.get_device());
+
+  auto qp = static_cast<cl_uchar>(args.qp);
+  cl_uchar sad_adjustment = CL_AVC_ME_SAD_ADJUST_MODE_NONE_INTEL;
+  cl_uchar pixel_mode = CL_AVC_ME_SUBPIXEL_MODE_QPEL_INTEL;
+
+  VectorOverlay overlay(0);
+
+  pipeline.read_from(capture);
+  pipeline.set_upload([&](int slot, const PlanarImage &image) {
+    size_t origin[] = {0, 0, 0};
+    size_t region[] = {static_cast<size_t>(width), static_cast<size_t>(height),
+                       1};
+    transfer_queue.enqueue_write_image(slots[slot]->src_image, origin, region,
+                                       image.get_y(), image.get_pitch_y());
+  });
+  pipeline.set_compute([&](int frame_idx, int slot, int reference_slot) {
+    WppSlot &src = *slots[slot];
+    ds_kernel.set_args(src.src_image, src.src_2x_image, src.src_4x_image,
+                       src.src_8x_image);
+    queue.enqueue_nd_range_kernel(
+        ds_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 4)),
+                     au::align_units(height, 16))
+            .data(),
+        compute::dim(16, 1).data());
+    if (frame_idx == 0) {
+      queue.finish();
+      return;
+    }
+    WppSlot &ref = *slots[reference_slot];
+
+    hme_n_kernel.set_arg(0, src.src_8x_image);
+    hme_n_kernel.set_arg(1, ref.src_8x_image);
+    hme_n_kernel.set_arg(2, sizeof(cl_mem), nullptr);
+    hme_n_kernel.set_arg(3, pred_4x_buffer);
+    queue.enqueue_nd_range_kernel(
+        hme_n_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 8)),
+                     DIM_TO_MB_SZ(height, 8))
+            .data(),
+        compute::dim(16, 1).data());
+
+    hme_n_kernel.set_args(src.src_4x_image, ref.src_4x_image, pred_4x_buffer,
+                          pred_2x_buffer);
+    queue.enqueue_nd_range_kernel(
+        hme_n_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 4)),
+                     DIM_TO_MB_SZ(height, 4))
+            .data(),
+        compute::dim(16, 1).data());
+
+    hme_n_kernel.set_args(src.src_2x_image, ref.src_2x_image, pred_2x_buffer,
+                          pred_buffer);
+    queue.enqueue_nd_range_kernel(
+        hme_n_kernel, 2, nullptr,
+        compute::dim(au::align16(au::align_units(width, 2)),
+                     DIM_TO_MB_SZ(height, 2))
+            .data(),
+        compute::dim(16, 1).data());
+
+    // The scoreboard synchronizes wavefronts and has to start cleared
+    const cl_int scoreboard_clear = 0;
+    queue.enqueue_fill_buffer(scoreboard_buffer, &scoreboard_clear,
+                              sizeof(scoreboard_clear), 0,
+                              scoreboard_buffer.size());
+    wpp_kernel.set_args(src.src_image, ref.src_image, pred_buffer,
+                        src.mv_buffer, src.residual_buffer, src.shape_buffer,
+                        scoreboard_buffer, qp, sad_adjustment, pixel_mode);
+    size_t local_size = 16;
+    size_t global_size = num_blocks * simd_size;
+    queue.enqueue_nd_range_kernel(wpp_kernel, 1, nullptr, &global_size,
+                                  &local_size);
+    queue.finish();
+  });
+  pipeline.set_readback([&](int slot, VmeFrame &frame) {
+    WppSlot &src = *slots[slot];
+    transfer_queue.enqueue_read_buffer(src.mv_buffer, 0,
+                                       mv_count * sizeof(cl_short2),
+                                       frame.mvs.data());
+    transfer_queue.enqueue_read_buffer(src.shape_buffer, 0,
+                                       mb_count * sizeof(cl_uchar2),
+                                       frame.shapes.data());
+  });
+  pipeline.set_overlay([&](int, VmeFrame &frame) {
+    overlay.render(frame.mvs.data(), frame.shapes.data(),
+                   luma_plane(frame.planar_image));
+  });
+  pipeline.write_to(writer);
+
+  pipeline.run(frame_count);
 }
 } // namespace compute_samples
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "fp_types/half.hpp"
+#include "fp_types/half_convert.hpp"
+#include "fp_types/low_precision_convert.hpp"
+#include "timer/timer.hpp"
+#include "logging/logging.hpp"
+
+namespace po = boost::program_options;
+namespace cs = compute_samples;
+
+namespace {
+struct Arguments {
+  std::string suite;
+  int size_mb = 0;
+  int iterations = 0;
+};
+
+// Sums a prefix of the output, so that the checksum does not dominate timing
+uint64_t checksum(const void *data, const size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < std::min<size_t>(size, 4096); ++i) {
+    sum += bytes[i];
+  }
+  return sum;
+}
+
+void report(const std::string &name, const size_t values, const int iterations,
+            const std::function<uint64_t()> &run) {
+  uint64_t sum = 0;
+  cs::Timer timer;
+  for (int i = 0; i < iterations; ++i) {
+    sum += run();
+  }
+  const double seconds = timer.elapsed();
+  const double gigavalues = static_cast<double>(values) * iterations / 1e9;
+  LOG_INFO << name << ": " << gigavalues / seconds
+           << " Gvalues/s (checksum " << sum << ")";
+}
+
+void benchmark_half(const Arguments &args) {
+  const size_t count = (static_cast<size_t>(args.size_mb) << 20) / 4;
+  // Values spread over the whole half range, including rounding cases
+  std::vector<float> floats(count);
+  for (size_t i = 0; i < count; ++i) {
+    floats[i] = static_cast<float>(static_cast<int>(i % 131071) - 65535) *
+                (1.0f + static_cast<float>(i % 7) / 4096.0f);
+  }
+  std::vector<cs::half> halves(count);
+  cs::convert_float_to_half(floats.data(), halves.data(), count);
+  std::vector<cs::half> half_output(count);
+  std::vector<float> float_output(count);
+  LOG_INFO << "Values: " << count;
+
+  report("half(float)", count, args.iterations, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      half_output[i] = cs::half(floats[i]);
+    }
+    return checksum(half_output.data(), count * sizeof(cs::half));
+  });
+  report("half::operator float", count, args.iterations, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      float_output[i] = static_cast<float>(halves[i]);
+    }
+    return checksum(float_output.data(), count * sizeof(float));
+  });
+
+  // Reference GEMM rounding every multiply-add to half, one value per
+  // multiply-add
+  const size_t n = 256;
+  std::vector<cs::half> c(n * n);
+  report("half gemm " + std::to_string(n), n * n * n, args.iterations, [&] {
+    std::fill(c.begin(), c.end(), cs::half(static_cast<uint16_t>(0)));
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t k = 0; k < n; ++k) {
+        const cs::half a = halves[i * n + k];
+        for (size_t j = 0; j < n; ++j) {
+          c[i * n + j] = cs::fma(a, halves[k * n + j], c[i * n + j]);
+        }
+      }
+    }
+    return checksum(c.data(), c.size() * sizeof(cs::half));
+  });
+
+  for (const cs::HalfKernel kernel :
+       {cs::HalfKernel::scalar, cs::HalfKernel::f16c, cs::HalfKernel::avx512}) {
+    if (!cs::is_half_kernel_supported(kernel)) {
+      LOG_INFO << cs::half_kernel_name(kernel) << ": not supported";
+      continue;
+    }
+    const std::string name = cs::half_kernel_name(kernel);
+    report(name + " float->half compatible", count, args.iterations, [&] {
+      cs::convert_float_to_half(floats.data(), half_output.data(), count,
+                                cs::HalfRounding::compatible, kernel);
+      return checksum(half_output.data(), count * sizeof(cs::half));
+    });
+    report(name + " float->half nearest_even", count, args.iterations, [&] {
+      cs::convert_float_to_half(floats.data(), half_output.data(), count,
+                                cs::HalfRounding::nearest_even, kernel);
+      return checksum(half_output.data(), count * sizeof(cs::half));
+    });
+    report(name + " half->float", count, args.iterations, [&] {
+      cs::convert_half_to_float(halves.data(), float_output.data(), count,
+                                kernel);
+      return checksum(float_output.data(), count * sizeof(float));
+    });
+  }
+}
+
+template <typename T>
+void benchmark_low_precision(const std::vector<float> &floats,
+                             const std::string &type, const int iterations) {
+  const size_t count = floats.size();
+  std::vector<T> values(count);
+  std::vector<float> float_output(count);
+
+  report(type + "(float)", count, iterations, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      values[i] = T(floats[i]);
+    }
+    return checksum(values.data(), count * sizeof(T));
+  });
+  for (const cs::FpKernel kernel : {cs::FpKernel::scalar, cs::FpKernel::avx2}) {
+    if (!cs::is_fp_kernel_supported(kernel)) {
+      LOG_INFO << cs::fp_kernel_name(kernel) << ": not supported";
+      continue;
+    }
+    const std::string name = std::string(cs::fp_kernel_name(kernel)) + " " +
+                             "float->" + type;
+    report(name + " nearest_even", count, iterations, [&] {
+      cs::convert_from_float(floats.data(), values.data(), count,
+                             cs::FpRounding::nearest_even, 0, kernel);
+      return checksum(values.data(), count * sizeof(T));
+    });
+    report(name + " stochastic", count, iterations, [&] {
+      cs::convert_from_float(floats.data(), values.data(), count,
+                             cs::FpRounding::stochastic, 1, kernel);
+      return checksum(values.data(), count * sizeof(T));
+    });
+    report(std::string(cs::fp_kernel_name(kernel)) + " " + type + "->float",
+           count, iterations, [&] {
+             cs::convert_to_float(values.data(), float_output.data(), count,
+                                  kernel);
+             return checksum(float_output.data(), count * sizeof(float));
+           });
+  }
+}
+
+void benchmark_low_precision(const Arguments &args) {
+  const size_t count = (static_cast<size_t>(args.size_mb) << 20) / 4;
+  std::vector<float> floats(count);
+  for (size_t i = 0; i < count; ++i) {
+    floats[i] = static_cast<float>(static_cast<int>(i % 2047) - 1023) /
+                static_cast<float>(1 + i % 13);
+  }
+  LOG_INFO << "Values: " << count;
+  benchmark_low_precision<cs::bfloat16>(floats, "bfloat16", args.iterations);
+  benchmark_low_precision<cs::tf32>(floats, "tf32", args.iterations);
+  benchmark_low_precision<cs::fp8_e4m3>(floats, "fp8_e4m3", args.iterations);
+  benchmark_low_precision<cs::fp8_e5m2>(floats, "fp8_e5m2", args.iterations);
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  std::vector<std::string> command_line(argv + 1, argv + argc);
+  cs::init_logging(command_line);
+
+  Arguments args;
+  po::options_description desc("Allowed options");
+  auto options = desc.add_options();
+  options("help,h", "show help message");
+  options("suite", po::value<std::string>(&args.suite)->default_value("all"),
+          "benchmark to run: all, half, low_precision");
+  options("size-mb", po::value<int>(&args.size_mb)->default_value(64),
+          "size of benchmarked float data in megabytes");
+  options("iterations", po::value<int>(&args.iterations)->default_value(5),
+          "number of runs per method");
+  po::variables_map vm;
+  po::store(po::command_line_parser(command_line).options(desc).run(), vm);
+  if (vm.count("help") != 0u) {
+    std::cout << desc;
+    return 0;
+  }
+  po::notify(vm);
+
+  if (args.suite == "all" || args.suite == "half") {
+    benchmark_half(args);
+  }
+  if (args.suite == "all" || args.suite == "low_precision") {
+    benchmark_low_precision(args);
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FP_TYPES_BFLOAT16_HPP
+#define COMPUTE_SAMPLES_FP_TYPES_BFLOAT16_HPP
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include "fp_types/half.hpp"
+
+namespace compute_samples {
+// Upper half of a float: 8 exponent and 7 mantissa bits. OpenCL C has no
+// bfloat16 type, kernels pass it as ushort.
+class bfloat16 {
+public:
+  bfloat16() = default;
+  explicit bfloat16(uint16_t v);
+  // Round to nearest even
+  explicit bfloat16(float v);
+  // Stochastic rounding, the low 16 bits of random are added to the
+  // discarded bits of v before truncating
+  bfloat16(float v, uint32_t random);
+  explicit bfloat16(uint32_t v);
+  explicit operator uint16_t() const;
+  explicit operator float() const;
+  explicit operator uint32_t() const;
+  bfloat16 operator-() const;
+  bool operator==(const bfloat16 &rhs) const;
+  bool nan_sensitive_eq(const bfloat16 &rhs) const;
+  bfloat16 &operator+=(const bfloat16 &rhs);
+  bfloat16 &operator*=(const bfloat16 &rhs);
+
+private:
+  uint16_t data;
+};
+bfloat16 operator+(bfloat16 lhs, const bfloat16 &rhs);
+bfloat16 operator*(bfloat16 lhs, const bfloat16 &rhs);
+
+float &operator+=(float &lhs, const bfloat16 &rhs);
+
+static_assert(sizeof(bfloat16) == 2, "bad size of bfloat16 type");
+
+template <> struct cl_scalar_type<bfloat16> { using type = bfloat16; };
+
+} // namespace compute_samples
+
+namespace std {
+template <> class numeric_limits<compute_samples::bfloat16> {
+public:
+  static const bool has_infinity = true;
+  static compute_samples::bfloat16 min() {
+    return compute_samples::bfloat16(static_cast<uint16_t>(0x0080));
+  };
+  static compute_samples::bfloat16 max() {
+    return compute_samples::bfloat16(static_cast<uint16_t>(0x7f7f));
+  };
+  static compute_samples::bfloat16 infinity() {
+    return compute_samples::bfloat16(static_cast<uint16_t>(0x7f80));
+  };
+  static compute_samples::bfloat16 lowest() {
+    return compute_samples::bfloat16(static_cast<uint16_t>(0xff7f)); // -max
+  };
+  static compute_samples::bfloat16 denorm_min() {
+    return compute_samples::bfloat16(static_cast<uint16_t>(0x0001));
+  };
+  static compute_samples::bfloat16 quiet_NaN() {
+    return compute_samples::bfloat16(static_cast<uint16_t>(0x7fc0));
+  };
+  static compute_samples::bfloat16 signaling_NaN() {
+    return compute_samples::bfloat16(static_cast<uint16_t>(0x7fa0));
+  };
+};
+template <> struct is_unsigned<compute_samples::bfloat16> {
+  static const bool value = false;
+};
+
+} // namespace std
+#endif
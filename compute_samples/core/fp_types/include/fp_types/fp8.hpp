@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FP_TYPES_FP8_HPP
+#define COMPUTE_SAMPLES_FP_TYPES_FP8_HPP
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include "fp_types/half.hpp"
+
+namespace compute_samples {
+// OCP 8-bit E4M3: 4 exponent and 3 mantissa bits, no infinities and a single
+// NaN encoding per sign. Overflows and infinities convert to NaN. OpenCL C
+// kernels pass it as uchar.
+class fp8_e4m3 {
+public:
+  fp8_e4m3() = default;
+  explicit fp8_e4m3(uint8_t v);
+  // Round to nearest even
+  explicit fp8_e4m3(float v);
+  // Stochastic rounding, as many low bits of random as v loses are added to
+  // the discarded bits of v before truncating: 20 bits for normal results,
+  // up to 31 bits for magnitudes below 2^-6, which round to subnormals
+  fp8_e4m3(float v, uint32_t random);
+  explicit fp8_e4m3(uint32_t v);
+  explicit operator uint8_t() const;
+  explicit operator float() const;
+  explicit operator uint32_t() const;
+  fp8_e4m3 operator-() const;
+  bool operator==(const fp8_e4m3 &rhs) const;
+  bool nan_sensitive_eq(const fp8_e4m3 &rhs) const;
+  fp8_e4m3 &operator+=(const fp8_e4m3 &rhs);
+  fp8_e4m3 &operator*=(const fp8_e4m3 &rhs);
+
+private:
+  uint8_t data;
+};
+fp8_e4m3 operator+(fp8_e4m3 lhs, const fp8_e4m3 &rhs);
+fp8_e4m3 operator*(fp8_e4m3 lhs, const fp8_e4m3 &rhs);
+
+float &operator+=(float &lhs, const fp8_e4m3 &rhs);
+
+// OCP 8-bit E5M2, also called bf8: the upper byte of a half with IEEE 754
+// infinities and NaNs. OpenCL C kernels pass it as uchar.
+class fp8_e5m2 {
+public:
+  fp8_e5m2() = default;
+  explicit fp8_e5m2(uint8_t v);
+  // Round to nearest even
+  explicit fp8_e5m2(float v);
+  explicit fp8_e5m2(half v);
+  // Stochastic rounding, as many low bits of random as v loses are added to
+  // the discarded bits of v before truncating: 21 bits for normal results,
+  // up to 31 bits for magnitudes below 2^-14, which round to subnormals
+  fp8_e5m2(float v, uint32_t random);
+  // Stochastic rounding of the low byte of a half like the srnd instruction,
+  // which intel_convert_f16_to_bf8_srnd uses
+  fp8_e5m2(half v, uint8_t random);
+  explicit fp8_e5m2(uint32_t v);
+  explicit operator uint8_t() const;
+  explicit operator float() const;
+  explicit operator uint32_t() const;
+  fp8_e5m2 operator-() const;
+  bool operator==(const fp8_e5m2 &rhs) const;
+  bool nan_sensitive_eq(const fp8_e5m2 &rhs) const;
+  fp8_e5m2 &operator+=(const fp8_e5m2 &rhs);
+  fp8_e5m2 &operator*=(const fp8_e5m2 &rhs);
+
+private:
+  uint8_t data;
+};
+fp8_e5m2 operator+(fp8_e5m2 lhs, const fp8_e5m2 &rhs);
+fp8_e5m2 operator*(fp8_e5m2 lhs, const fp8_e5m2 &rhs);
+
+float &operator+=(float &lhs, const fp8_e5m2 &rhs);
+
+static_assert(sizeof(fp8_e4m3) == 1, "bad size of fp8_e4m3 type");
+static_assert(sizeof(fp8_e5m2) == 1, "bad size of fp8_e5m2 type");
+
+template <> struct cl_scalar_type<fp8_e4m3> { using type = fp8_e4m3; };
+template <> struct cl_scalar_type<fp8_e5m2> { using type = fp8_e5m2; };
+
+} // namespace compute_samples
+
+namespace std {
+template <> class numeric_limits<compute_samples::fp8_e4m3> {
+public:
+  static const bool has_infinity = false;
+  static compute_samples::fp8_e4m3 min() {
+    return compute_samples::fp8_e4m3(static_cast<uint8_t>(0x08));
+  };
+  static compute_samples::fp8_e4m3 max() {
+    return compute_samples::fp8_e4m3(static_cast<uint8_t>(0x7e));
+  };
+  // There is no infinity, like for other types without one this is zero
+  static compute_samples::fp8_e4m3 infinity() {
+    return compute_samples::fp8_e4m3(static_cast<uint8_t>(0x00));
+  };
+  static compute_samples::fp8_e4m3 lowest() {
+    return compute_samples::fp8_e4m3(static_cast<uint8_t>(0xfe)); // -max
+  };
+  static compute_samples::fp8_e4m3 denorm_min() {
+    return compute_samples::fp8_e4m3(static_cast<uint8_t>(0x01));
+  };
+  static compute_samples::fp8_e4m3 quiet_NaN() {
+    return compute_samples::fp8_e4m3(static_cast<uint8_t>(0x7f));
+  };
+  // The only NaN encoding
+  static compute_samples::fp8_e4m3 signaling_NaN() { return quiet_NaN(); };
+};
+template <> struct is_unsigned<compute_samples::fp8_e4m3> {
+  static const bool value = false;
+};
+
+template <> class numeric_limits<compute_samples::fp8_e5m2> {
+public:
+  static const bool has_infinity = true;
+  static compute_samples::fp8_e5m2 min() {
+    return compute_samples::fp8_e5m2(static_cast<uint8_t>(0x04));
+  };
+  static compute_samples::fp8_e5m2 max() {
+    return compute_samples::fp8_e5m2(static_cast<uint8_t>(0x7b));
+  };
+  static compute_samples::fp8_e5m2 infinity() {
+    return compute_samples::fp8_e5m2(static_cast<uint8_t>(0x7c));
+  };
+  static compute_samples::fp8_e5m2 lowest() {
+    return compute_samples::fp8_e5m2(static_cast<uint8_t>(0xfb)); // -max
+  };
+  static compute_samples::fp8_e5m2 denorm_min() {
+    return compute_samples::fp8_e5m2(static_cast<uint8_t>(0x01));
+  };
+  static compute_samples::fp8_e5m2 quiet_NaN() {
+    return compute_samples::fp8_e5m2(static_cast<uint8_t>(0x7e));
+  };
+  static compute_samples::fp8_e5m2 signaling_NaN() {
+    return compute_samples::fp8_e5m2(static_cast<uint8_t>(0x7d));
+  };
+};
+template <> struct is_unsigned<compute_samples::fp8_e5m2> {
+  static const bool value = false;
+};
+
+} // namespace std
+#endif
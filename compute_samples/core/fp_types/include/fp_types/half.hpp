@@ -8,7 +8,10 @@
 #ifndef COMPUTE_SAMPLES_FP_TYPES_HALF_HPP
 #define COMPUTE_SAMPLES_FP_TYPES_HALF_HPP
 
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <type_traits>
 #include "ocl_utils/ocl_utils.hpp"
@@ -17,23 +20,37 @@ namespace compute_samples {
 class half {
 public:
   half() = default;
-  explicit half(uint16_t v);
+  constexpr explicit half(uint16_t v) : data(v) {}
   explicit half(float v);
   explicit half(uint32_t v);
-  explicit operator uint16_t() const;
+  constexpr explicit operator uint16_t() const { return data; }
   explicit operator float() const;
   explicit operator uint32_t() const;
-  half operator-() const;
-  bool operator==(const half &rhs) const;
-  bool nan_sensitive_eq(const half &rhs) const;
+  constexpr half operator-() const {
+    return half(static_cast<uint16_t>(data ^ 0x8000));
+  }
+  constexpr bool operator==(const half &rhs) const { return data == rhs.data; }
+  constexpr bool nan_sensitive_eq(const half &rhs) const {
+    return (is_nan() && rhs.is_nan()) || data == rhs.data;
+  }
   half &operator+=(const half &rhs);
+  half &operator-=(const half &rhs);
   half &operator*=(const half &rhs);
+  half &operator/=(const half &rhs);
 
 private:
+  constexpr bool is_nan() const { return (data & 0x7fff) > 0x7c00; }
+
   uint16_t data;
 };
 half operator+(half lhs, const half &rhs);
+half operator-(half lhs, const half &rhs);
 half operator*(half lhs, const half &rhs);
+half operator/(half lhs, const half &rhs);
+
+// a * b + c rounded once to float before the conversion, the product of two
+// halves is exact in float
+half fma(const half &a, const half &b, const half &c);
 
 float &operator+=(float &lhs, const half &rhs);
 
@@ -53,31 +70,228 @@ template <> struct cl_scalar_type<half2> { using type = half; };
 template <> struct cl_scalar_type<half4> { using type = half; };
 template <> struct cl_scalar_type<half8> { using type = half; };
 
+namespace detail {
+// Masks instead of conditional moves, which compilers vectorize reliably
+constexpr uint32_t select(const bool condition, const uint32_t if_true,
+                          const uint32_t if_false) {
+  return (if_true & (0u - condition)) | (if_false & (condition - 1u));
+}
+} // namespace detail
+
+// Conversions are inline and branch-free so that loops over halves, such as
+// host reference computations, vectorize. half(float) keeps its historical
+// rounding: nearest even without carrying out of the mantissa, and values
+// below the normal range flushed to zero.
+inline half::half(float v) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &v, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const uint32_t exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = (bits >> 13) & 0x03ff;
+  const uint32_t remainder = bits & 0x1fff;
+  // remainder + odd > 0x1000 covers both halfway cases
+  mantissa += (mantissa != 0x03ff) & (remainder + (mantissa & 1) > 0x1000);
+  uint32_t result = ((exponent - (127 - 15)) << 10) | mantissa;
+  result = detail::select(exponent > 127 + 15, 0x7c00, result);
+  result = detail::select(exponent <= 127 - 15, 0, result);
+  result = detail::select(exponent == 0, mantissa, result);
+  result = detail::select(exponent == 0xff, 0x7c00 | mantissa, result);
+  data = static_cast<uint16_t>(sign | result);
+}
+inline half::half(uint32_t v) : half(static_cast<float>(v)) {}
+inline half::operator float() const {
+  const uint32_t exponent = data & 0x7c00;
+  // Normal values rebias the exponent, infinity and NaN saturate it
+  uint32_t bits = (static_cast<uint32_t>(data & 0x7fff) + ((127 - 15) << 10))
+                  << (23 - 10);
+  bits |= detail::select(exponent == 0x7c00, 0x7f800000, 0);
+  // Zero and subnormals are mantissa * 2^-24, exact in float and computed
+  // without subnormal operands, which are slow on many processors
+  const float subnormal =
+      static_cast<float>(data & 0x03ff) * 5.9604644775390625e-08f;
+  uint32_t subnormal_bits = 0;
+  std::memcpy(&subnormal_bits, &subnormal, sizeof(subnormal_bits));
+  bits = detail::select(exponent == 0, subnormal_bits, bits);
+  bits |= static_cast<uint32_t>(data & 0x8000) << 16;
+  float result = 0.0f;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+inline half::operator uint32_t() const {
+  return static_cast<uint32_t>(static_cast<float>(*this));
+}
+inline half &half::operator+=(const half &rhs) {
+  return *this = half(static_cast<float>(*this) + static_cast<float>(rhs));
+}
+inline half &half::operator-=(const half &rhs) {
+  return *this = half(static_cast<float>(*this) - static_cast<float>(rhs));
+}
+inline half &half::operator*=(const half &rhs) {
+  return *this = half(static_cast<float>(*this) * static_cast<float>(rhs));
+}
+inline half &half::operator/=(const half &rhs) {
+  return *this = half(static_cast<float>(*this) / static_cast<float>(rhs));
+}
+inline half operator+(half lhs, const half &rhs) { return lhs += rhs; }
+inline half operator-(half lhs, const half &rhs) { return lhs -= rhs; }
+inline half operator*(half lhs, const half &rhs) { return lhs *= rhs; }
+inline half operator/(half lhs, const half &rhs) { return lhs /= rhs; }
+inline half fma(const half &a, const half &b, const half &c) {
+  return half(static_cast<float>(a) * static_cast<float>(b) +
+              static_cast<float>(c));
+}
+inline float &operator+=(float &lhs, const half &rhs) {
+  return lhs += static_cast<float>(rhs);
+}
+
+// Element-wise operators of the vector types, each lane rounds like the
+// scalar operator
+template <typename T> struct is_half_vector : std::false_type {};
+template <> struct is_half_vector<half2> : std::true_type {};
+template <> struct is_half_vector<half4> : std::true_type {};
+template <> struct is_half_vector<half8> : std::true_type {};
+
+template <typename T>
+using enable_if_half_vector_t =
+    typename std::enable_if<is_half_vector<T>::value, T>::type;
+
+template <typename T> constexpr size_t half_vector_size() {
+  return sizeof(T) / sizeof(half);
+}
+
+template <typename T>
+enable_if_half_vector_t<T> &operator+=(T &lhs, const T &rhs) {
+  for (size_t i = 0; i < half_vector_size<T>(); ++i) {
+    lhs.s[i] += rhs.s[i];
+  }
+  return lhs;
+}
+template <typename T>
+enable_if_half_vector_t<T> &operator-=(T &lhs, const T &rhs) {
+  for (size_t i = 0; i < half_vector_size<T>(); ++i) {
+    lhs.s[i] -= rhs.s[i];
+  }
+  return lhs;
+}
+template <typename T>
+enable_if_half_vector_t<T> &operator*=(T &lhs, const T &rhs) {
+  for (size_t i = 0; i < half_vector_size<T>(); ++i) {
+    lhs.s[i] *= rhs.s[i];
+  }
+  return lhs;
+}
+template <typename T>
+enable_if_half_vector_t<T> &operator/=(T &lhs, const T &rhs) {
+  for (size_t i = 0; i < half_vector_size<T>(); ++i) {
+    lhs.s[i] /= rhs.s[i];
+  }
+  return lhs;
+}
+template <typename T>
+enable_if_half_vector_t<T> operator+(T lhs, const T &rhs) {
+  return lhs += rhs;
+}
+template <typename T>
+enable_if_half_vector_t<T> operator-(T lhs, const T &rhs) {
+  return lhs -= rhs;
+}
+template <typename T>
+enable_if_half_vector_t<T> operator*(T lhs, const T &rhs) {
+  return lhs *= rhs;
+}
+template <typename T>
+enable_if_half_vector_t<T> operator/(T lhs, const T &rhs) {
+  return lhs /= rhs;
+}
+template <typename T> enable_if_half_vector_t<T> operator-(T value) {
+  for (size_t i = 0; i < half_vector_size<T>(); ++i) {
+    value.s[i] = -value.s[i];
+  }
+  return value;
+}
+template <typename T>
+enable_if_half_vector_t<T> fma(const T &a, const T &b, T c) {
+  for (size_t i = 0; i < half_vector_size<T>(); ++i) {
+    c.s[i] = fma(a.s[i], b.s[i], c.s[i]);
+  }
+  return c;
+}
+
+// Horizontal reductions accumulate in float and round once. Min and max skip
+// NaN lanes and return NaN only when all lanes are NaN.
+template <typename T>
+typename std::enable_if<is_half_vector<T>::value, half>::type
+reduce_add(const T &value) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < half_vector_size<T>(); ++i) {
+    sum += value.s[i];
+  }
+  return half(sum);
+}
+template <typename T>
+typename std::enable_if<is_half_vector<T>::value, half>::type
+reduce_min(const T &value) {
+  half result = value.s[0];
+  float min = static_cast<float>(result);
+  for (size_t i = 1; i < half_vector_size<T>(); ++i) {
+    const float lane = static_cast<float>(value.s[i]);
+    // NaN lanes are skipped explicitly, as fmin may return signaling NaNs
+    if (lane == lane && (min != min || lane < min)) {
+      result = value.s[i];
+      min = lane;
+    }
+  }
+  return result;
+}
+template <typename T>
+typename std::enable_if<is_half_vector<T>::value, half>::type
+reduce_max(const T &value) {
+  half result = value.s[0];
+  float max = static_cast<float>(result);
+  for (size_t i = 1; i < half_vector_size<T>(); ++i) {
+    const float lane = static_cast<float>(value.s[i]);
+    if (lane == lane && (max != max || lane > max)) {
+      result = value.s[i];
+      max = lane;
+    }
+  }
+  return result;
+}
+template <typename T>
+typename std::enable_if<is_half_vector<T>::value, half>::type
+dot(const T &lhs, const T &rhs) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < half_vector_size<T>(); ++i) {
+    sum += static_cast<float>(lhs.s[i]) * static_cast<float>(rhs.s[i]);
+  }
+  return half(sum);
+}
+
 } // namespace compute_samples
 
 namespace std {
 template <> class numeric_limits<compute_samples::half> {
 public:
-  static compute_samples::half min() {
+  static constexpr compute_samples::half min() {
     return compute_samples::half(static_cast<uint16_t>(0x0400));
   };
-  static compute_samples::half max() {
+  static constexpr compute_samples::half max() {
     return compute_samples::half(static_cast<uint16_t>(0x7bff));
   };
-  static compute_samples::half infinity() {
+  static constexpr compute_samples::half infinity() {
     return compute_samples::half(static_cast<uint16_t>(0x7c00));
   };
-  static compute_samples::half lowest() {
+  static constexpr compute_samples::half lowest() {
     return compute_samples::half(static_cast<uint16_t>(0xfbff)); // -max
   };
-  static compute_samples::half denorm_min() {
+  static constexpr compute_samples::half denorm_min() {
     return compute_samples::half(static_cast<uint16_t>(0x0001));
   };
   // specific quiet and signaling NaN encoding is architecture dependent
-  static compute_samples::half quiet_NaN() {
+  static constexpr compute_samples::half quiet_NaN() {
     return compute_samples::half(static_cast<uint16_t>(0x7c01));
   };
-  static compute_samples::half signaling_NaN() {
+  static constexpr compute_samples::half signaling_NaN() {
     // in F16C x86 extension f32 sNaN is converted to f16 qNaN
     // ref: Intel 64 and IA-32 Architectures Software Developer's Manual
     // Volume 1, order number 325462-069US, table 14-9
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FP_TYPES_HALF_CONVERT_HPP
+#define COMPUTE_SAMPLES_FP_TYPES_HALF_CONVERT_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "fp_types/half.hpp"
+
+namespace compute_samples {
+
+enum class HalfRounding {
+  // Same results as the half(float) constructor: values below the normal
+  // range flush to signed zero and a saturated mantissa is not rounded up
+  // into the exponent
+  compatible,
+  // IEEE 754 round to nearest even with subnormal results and quieted NaNs,
+  // as computed by the F16C vcvtps2ph instruction
+  nearest_even
+};
+
+// f16c uses 256-bit AVX2 and F16C instructions, avx512 512-bit AVX-512F ones
+enum class HalfKernel { automatic, scalar, f16c, avx512 };
+
+// Converts count consecutive values. Every kernel is bit-exact with the scalar
+// one for the selected rounding, which for compatible rounding is half(float)
+// and for the inverse conversion is half::operator float(), NaN payloads
+// included. Throws std::invalid_argument for kernels the processor does not
+// support.
+void convert_float_to_half(
+    const float *input, half *output, const size_t count,
+    const HalfRounding rounding = HalfRounding::compatible,
+    const HalfKernel kernel = HalfKernel::automatic);
+void convert_half_to_float(const half *input, float *output,
+                           const size_t count,
+                           const HalfKernel kernel = HalfKernel::automatic);
+
+std::vector<half>
+convert_float_to_half(const std::vector<float> &input,
+                      const HalfRounding rounding = HalfRounding::compatible);
+std::vector<float> convert_half_to_float(const std::vector<half> &input);
+
+bool is_half_kernel_supported(const HalfKernel kernel);
+const char *half_kernel_name(const HalfKernel kernel);
+// Fastest supported kernel, used for HalfKernel::automatic
+HalfKernel best_half_kernel();
+
+} // namespace compute_samples
+
+#endif
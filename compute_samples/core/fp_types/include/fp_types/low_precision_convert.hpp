@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FP_TYPES_LOW_PRECISION_CONVERT_HPP
+#define COMPUTE_SAMPLES_FP_TYPES_LOW_PRECISION_CONVERT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fp_types/bfloat16.hpp"
+#include "fp_types/fp8.hpp"
+#include "fp_types/tf32.hpp"
+
+namespace compute_samples {
+
+enum class FpRounding { nearest_even, stochastic };
+
+// avx2 runs the same branch-free code as scalar, compiled for 256-bit AVX2
+enum class FpKernel { automatic, scalar, avx2 };
+
+// Random bits used for element index of a stochastic batch conversion, so
+// that single values can be reproduced with the rounding constructors:
+// bfloat16(input[i], stochastic_rounding_bits(seed, i)) == output[i]
+uint32_t stochastic_rounding_bits(const uint32_t seed, const uint32_t index);
+
+// Convert count consecutive values with the same results as the constructors
+// and conversion operators of each type. Stochastic rounding draws its random
+// bits from seed and the element index. Throw std::invalid_argument for
+// kernels the processor does not support.
+void convert_from_float(const float *input, bfloat16 *output,
+                        const size_t count,
+                        const FpRounding rounding = FpRounding::nearest_even,
+                        const uint32_t seed = 0,
+                        const FpKernel kernel = FpKernel::automatic);
+void convert_from_float(const float *input, tf32 *output, const size_t count,
+                        const FpRounding rounding = FpRounding::nearest_even,
+                        const uint32_t seed = 0,
+                        const FpKernel kernel = FpKernel::automatic);
+void convert_from_float(const float *input, fp8_e4m3 *output,
+                        const size_t count,
+                        const FpRounding rounding = FpRounding::nearest_even,
+                        const uint32_t seed = 0,
+                        const FpKernel kernel = FpKernel::automatic);
+void convert_from_float(const float *input, fp8_e5m2 *output,
+                        const size_t count,
+                        const FpRounding rounding = FpRounding::nearest_even,
+                        const uint32_t seed = 0,
+                        const FpKernel kernel = FpKernel::automatic);
+
+void convert_to_float(const bfloat16 *input, float *output, const size_t count,
+                      const FpKernel kernel = FpKernel::automatic);
+void convert_to_float(const tf32 *input, float *output, const size_t count,
+                      const FpKernel kernel = FpKernel::automatic);
+void convert_to_float(const fp8_e4m3 *input, float *output, const size_t count,
+                      const FpKernel kernel = FpKernel::automatic);
+void convert_to_float(const fp8_e5m2 *input, float *output, const size_t count,
+                      const FpKernel kernel = FpKernel::automatic);
+
+template <typename T>
+std::vector<T>
+convert_from_float(const std::vector<float> &input,
+                   const FpRounding rounding = FpRounding::nearest_even,
+                   const uint32_t seed = 0) {
+  std::vector<T> output(input.size());
+  convert_from_float(input.data(), output.data(), input.size(), rounding,
+                     seed);
+  return output;
+}
+
+template <typename T>
+std::vector<float> convert_to_float(const std::vector<T> &input) {
+  std::vector<float> output(input.size());
+  convert_to_float(input.data(), output.data(), input.size());
+  return output;
+}
+
+bool is_fp_kernel_supported(const FpKernel kernel);
+const char *fp_kernel_name(const FpKernel kernel);
+
+} // namespace compute_samples
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FP_TYPES_TF32_HPP
+#define COMPUTE_SAMPLES_FP_TYPES_TF32_HPP
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include "fp_types/half.hpp"
+
+namespace compute_samples {
+// 8 exponent and 10 mantissa bits, stored like intel_convert_f32_to_tf32
+// returns it: a float with the low 13 mantissa bits cleared. The raw
+// constructor and conversion use that 32-bit pattern.
+class tf32 {
+public:
+  tf32() = default;
+  explicit tf32(uint32_t v);
+  // Round to nearest even
+  explicit tf32(float v);
+  // Stochastic rounding, the low 13 bits of random are added to the
+  // discarded bits of v before truncating
+  tf32(float v, uint32_t random);
+  explicit operator uint32_t() const;
+  explicit operator float() const;
+  tf32 operator-() const;
+  bool operator==(const tf32 &rhs) const;
+  bool nan_sensitive_eq(const tf32 &rhs) const;
+  tf32 &operator+=(const tf32 &rhs);
+  tf32 &operator*=(const tf32 &rhs);
+
+private:
+  uint32_t data;
+};
+tf32 operator+(tf32 lhs, const tf32 &rhs);
+tf32 operator*(tf32 lhs, const tf32 &rhs);
+
+float &operator+=(float &lhs, const tf32 &rhs);
+
+static_assert(sizeof(tf32) == 4, "bad size of tf32 type");
+
+template <> struct cl_scalar_type<tf32> { using type = tf32; };
+
+} // namespace compute_samples
+
+namespace std {
+template <> class numeric_limits<compute_samples::tf32> {
+public:
+  static const bool has_infinity = true;
+  static compute_samples::tf32 min() {
+    return compute_samples::tf32(static_cast<uint32_t>(0x00800000));
+  };
+  static compute_samples::tf32 max() {
+    return compute_samples::tf32(static_cast<uint32_t>(0x7f7fe000));
+  };
+  static compute_samples::tf32 infinity() {
+    return compute_samples::tf32(static_cast<uint32_t>(0x7f800000));
+  };
+  static compute_samples::tf32 lowest() {
+    return compute_samples::tf32(static_cast<uint32_t>(0xff7fe000)); // -max
+  };
+  static compute_samples::tf32 denorm_min() {
+    return compute_samples::tf32(static_cast<uint32_t>(0x00002000));
+  };
+  static compute_samples::tf32 quiet_NaN() {
+    return compute_samples::tf32(static_cast<uint32_t>(0x7fc00000));
+  };
+  static compute_samples::tf32 signaling_NaN() {
+    return compute_samples::tf32(static_cast<uint32_t>(0x7fa00000));
+  };
+};
+template <> struct is_unsigned<compute_samples::tf32> {
+  static const bool value = false;
+};
+
+} // namespace std
+#endif
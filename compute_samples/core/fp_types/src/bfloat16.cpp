@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "fp_types/bfloat16.hpp"
+#include "minifloat.hpp"
+
+namespace compute_samples {
+
+bfloat16::bfloat16(uint16_t v) : data(v) {}
+bfloat16::bfloat16(float v)
+    : data(static_cast<uint16_t>(minifloat::encode<minifloat::Bfloat16>(
+          minifloat::float_bits(v), 0, false))) {}
+bfloat16::bfloat16(float v, uint32_t random)
+    : data(static_cast<uint16_t>(minifloat::encode<minifloat::Bfloat16>(
+          minifloat::float_bits(v), random, true))) {}
+bfloat16::bfloat16(uint32_t v) : bfloat16(static_cast<float>(v)) {}
+bfloat16::operator uint16_t() const { return data; }
+bfloat16::operator float() const {
+  return minifloat::bits_float(minifloat::decode<minifloat::Bfloat16>(data));
+}
+bfloat16::operator uint32_t() const {
+  return static_cast<uint32_t>(static_cast<float>(*this));
+}
+bfloat16 bfloat16::operator-() const {
+  return bfloat16(static_cast<uint16_t>(data ^ 0x8000));
+}
+bool bfloat16::operator==(const bfloat16 &rhs) const {
+  return data == rhs.data;
+}
+bool bfloat16::nan_sensitive_eq(const bfloat16 &rhs) const {
+  const bool this_nan = (data & 0x7f80) == 0x7f80 && (data & 0x007f) != 0;
+  const bool rhs_nan =
+      (rhs.data & 0x7f80) == 0x7f80 && (rhs.data & 0x007f) != 0;
+  if (this_nan && rhs_nan) {
+    return true;
+  }
+  return data == rhs.data;
+}
+bfloat16 &bfloat16::operator+=(const bfloat16 &rhs) {
+  *this = bfloat16(static_cast<float>(*this) + static_cast<float>(rhs));
+  return *this;
+}
+bfloat16 &bfloat16::operator*=(const bfloat16 &rhs) {
+  *this = bfloat16(static_cast<float>(*this) * static_cast<float>(rhs));
+  return *this;
+}
+bfloat16 operator+(bfloat16 lhs, const bfloat16 &rhs) {
+  lhs += rhs;
+  return lhs;
+}
+bfloat16 operator*(bfloat16 lhs, const bfloat16 &rhs) {
+  lhs *= rhs;
+  return lhs;
+}
+float &operator+=(float &lhs, const bfloat16 &rhs) {
+  lhs += static_cast<float>(rhs);
+  return lhs;
+}
+
+template <> int bits<bfloat16>() { return 16; }
+
+template <> std::string to_cl_c_string<bfloat16>() { return "ushort"; };
+} // namespace compute_samples
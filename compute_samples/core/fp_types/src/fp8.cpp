@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "fp_types/fp8.hpp"
+#include "minifloat.hpp"
+
+namespace compute_samples {
+
+namespace {
+bool is_e4m3_nan(const uint8_t value) { return (value & 0x7f) == 0x7f; }
+bool is_e5m2_nan(const uint8_t value) { return (value & 0x7f) > 0x7c; }
+} // namespace
+
+fp8_e4m3::fp8_e4m3(uint8_t v) : data(v) {}
+fp8_e4m3::fp8_e4m3(float v)
+    : data(static_cast<uint8_t>(minifloat::encode<minifloat::E4m3>(
+          minifloat::float_bits(v), 0, false))) {}
+fp8_e4m3::fp8_e4m3(float v, uint32_t random)
+    : data(static_cast<uint8_t>(minifloat::encode<minifloat::E4m3>(
+          minifloat::float_bits(v), random, true))) {}
+fp8_e4m3::fp8_e4m3(uint32_t v) : fp8_e4m3(static_cast<float>(v)) {}
+fp8_e4m3::operator uint8_t() const { return data; }
+fp8_e4m3::operator float() const {
+  return minifloat::bits_float(minifloat::decode<minifloat::E4m3>(data));
+}
+fp8_e4m3::operator uint32_t() const {
+  return static_cast<uint32_t>(static_cast<float>(*this));
+}
+fp8_e4m3 fp8_e4m3::operator-() const {
+  return fp8_e4m3(static_cast<uint8_t>(data ^ 0x80));
+}
+bool fp8_e4m3::operator==(const fp8_e4m3 &rhs) const {
+  return data == rhs.data;
+}
+bool fp8_e4m3::nan_sensitive_eq(const fp8_e4m3 &rhs) const {
+  if (is_e4m3_nan(data) && is_e4m3_nan(rhs.data)) {
+    return true;
+  }
+  return data == rhs.data;
+}
+fp8_e4m3 &fp8_e4m3::operator+=(const fp8_e4m3 &rhs) {
+  *this = fp8_e4m3(static_cast<float>(*this) + static_cast<float>(rhs));
+  return *this;
+}
+fp8_e4m3 &fp8_e4m3::operator*=(const fp8_e4m3 &rhs) {
+  *this = fp8_e4m3(static_cast<float>(*this) * static_cast<float>(rhs));
+  return *this;
+}
+fp8_e4m3 operator+(fp8_e4m3 lhs, const fp8_e4m3 &rhs) {
+  lhs += rhs;
+  return lhs;
+}
+fp8_e4m3 operator*(fp8_e4m3 lhs, const fp8_e4m3 &rhs) {
+  lhs *= rhs;
+  return lhs;
+}
+float &operator+=(float &lhs, const fp8_e4m3 &rhs) {
+  lhs += static_cast<float>(rhs);
+  return lhs;
+}
+
+fp8_e5m2::fp8_e5m2(uint8_t v) : data(v) {}
+fp8_e5m2::fp8_e5m2(float v)
+    : data(static_cast<uint8_t>(minifloat::encode<minifloat::E5m2>(
+          minifloat::float_bits(v), 0, false))) {}
+fp8_e5m2::fp8_e5m2(half v) : fp8_e5m2(static_cast<float>(v)) {}
+fp8_e5m2::fp8_e5m2(float v, uint32_t random)
+    : data(static_cast<uint8_t>(minifloat::encode<minifloat::E5m2>(
+          minifloat::float_bits(v), random, true))) {}
+fp8_e5m2::fp8_e5m2(half v, uint8_t random) {
+  // E5M2 is the upper byte of a half, so only its low byte is rounded
+  const uint16_t bits = static_cast<uint16_t>(v);
+  const uint16_t sign = bits & 0x8000;
+  const uint16_t magnitude = bits & 0x7fff;
+  uint16_t result = 0;
+  if (magnitude > 0x7c00) {
+    result = static_cast<uint16_t>(0x7e00 | (magnitude & 0x0300));
+  } else {
+    result = static_cast<uint16_t>(magnitude + random) & 0xff00;
+    if (result > 0x7c00) {
+      result = 0x7c00;
+    }
+  }
+  data = static_cast<uint8_t>((sign | result) >> 8);
+}
+fp8_e5m2::fp8_e5m2(uint32_t v) : fp8_e5m2(static_cast<float>(v)) {}
+fp8_e5m2::operator uint8_t() const { return data; }
+fp8_e5m2::operator float() const {
+  return minifloat::bits_float(minifloat::decode<minifloat::E5m2>(data));
+}
+fp8_e5m2::operator uint32_t() const {
+  return static_cast<uint32_t>(static_cast<float>(*this));
+}
+fp8_e5m2 fp8_e5m2::operator-() const {
+  return fp8_e5m2(static_cast<uint8_t>(data ^ 0x80));
+}
+bool fp8_e5m2::operator==(const fp8_e5m2 &rhs) const {
+  return data == rhs.data;
+}
+bool fp8_e5m2::nan_sensitive_eq(const fp8_e5m2 &rhs) const {
+  if (is_e5m2_nan(data) && is_e5m2_nan(rhs.data)) {
+    return true;
+  }
+  return data == rhs.data;
+}
+fp8_e5m2 &fp8_e5m2::operator+=(const fp8_e5m2 &rhs) {
+  *this = fp8_e5m2(static_cast<float>(*this) + static_cast<float>(rhs));
+  return *this;
+}
+fp8_e5m2 &fp8_e5m2::operator*=(const fp8_e5m2 &rhs) {
+  *this = fp8_e5m2(static_cast<float>(*this) * static_cast<float>(rhs));
+  return *this;
+}
+fp8_e5m2 operator+(fp8_e5m2 lhs, const fp8_e5m2 &rhs) {
+  lhs += rhs;
+  return lhs;
+}
+fp8_e5m2 operator*(fp8_e5m2 lhs, const fp8_e5m2 &rhs) {
+  lhs *= rhs;
+  return lhs;
+}
+float &operator+=(float &lhs, const fp8_e5m2 &rhs) {
+  lhs += static_cast<float>(rhs);
+  return lhs;
+}
+
+template <> int bits<fp8_e4m3>() { return 8; }
+template <> int bits<fp8_e5m2>() { return 8; }
+
+template <> std::string to_cl_c_string<fp8_e4m3>() { return "uchar"; };
+template <> std::string to_cl_c_string<fp8_e5m2>() { return "uchar"; };
+} // namespace compute_samples
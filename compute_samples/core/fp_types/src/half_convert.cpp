@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "fp_types/half_convert.hpp"
+#include "utils/cpu_features.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+#include <immintrin.h>
+#endif
+
+// The compatible rounding of half(float) differs from IEEE 754, so the SIMD
+// kernels emulate it with integer instructions lane by lane:
+//   e <= 112 (below 2^-14)    signed zero
+//   e > 142 (above 65504)     signed infinity
+//   e == 0, e == 255          exponent kept, mantissa rounded
+// where the mantissa is rounded to nearest even unless it is already 0x3ff.
+// Nearest even rounding and the inverse conversion use the hardware
+// instructions, with NaNs patched afterwards because vcvtph2ps quiets them.
+
+namespace compute_samples {
+
+namespace {
+uint32_t float_bits(const float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+uint16_t float_to_half_nearest_even(const float value) {
+  const uint32_t bits = float_bits(value);
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  const uint32_t magnitude = bits & 0x7fffffff;
+  if (magnitude > 0x7f800000) {
+    return static_cast<uint16_t>(sign | 0x7e00 | ((magnitude >> 13) & 0x03ff));
+  }
+  // 65520 and above round to infinity
+  if (magnitude >= 0x477ff000) {
+    return static_cast<uint16_t>(sign | 0x7c00);
+  }
+  // Normal results, a carry out of the mantissa increments the exponent
+  if (magnitude >= 0x38800000) {
+    const uint32_t rounded = magnitude + 0x0fff + ((magnitude >> 13) & 1);
+    return static_cast<uint16_t>(sign | ((rounded - 0x38000000) >> 13));
+  }
+  // Below 2^-25 everything rounds to zero
+  const uint32_t exponent = magnitude >> 23;
+  if (exponent < 102) {
+    return sign;
+  }
+  // Subnormal results in units of 2^-24, rounding up to 0x0400 yields the
+  // smallest normal value
+  const uint32_t mantissa = (magnitude & 0x007fffff) | 0x00800000;
+  const uint32_t shift = 126 - exponent;
+  const uint32_t halfway = 1u << (shift - 1);
+  const uint32_t remainder = mantissa & ((halfway << 1) - 1);
+  uint32_t result = mantissa >> shift;
+  if (remainder > halfway || (remainder == halfway && (result & 1) != 0)) {
+    ++result;
+  }
+  return static_cast<uint16_t>(sign | result);
+}
+
+void float_to_half_scalar(const float *input, half *output, const size_t count,
+                          const HalfRounding rounding) {
+  if (rounding == HalfRounding::compatible) {
+    for (size_t i = 0; i < count; ++i) {
+      output[i] = half(input[i]);
+    }
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      output[i] = half(float_to_half_nearest_even(input[i]));
+    }
+  }
+}
+
+void half_to_float_scalar(const half *input, float *output,
+                          const size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    output[i] = static_cast<float>(input[i]);
+  }
+}
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+COMPUTE_SAMPLES_TARGET("avx2")
+__m256i float_to_half_compatible_avx2(const __m256i bits) {
+  const __m256i sign =
+      _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x8000));
+  const __m256i exponent =
+      _mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff));
+  __m256i mantissa =
+      _mm256_and_si256(_mm256_srli_epi32(bits, 13), _mm256_set1_epi32(0x3ff));
+  const __m256i remainder = _mm256_and_si256(bits, _mm256_set1_epi32(0x1fff));
+
+  // remainder + odd > 0x1000 covers both halfway cases, up is all ones
+  const __m256i odd = _mm256_and_si256(mantissa, _mm256_set1_epi32(1));
+  const __m256i up = _mm256_andnot_si256(
+      _mm256_cmpeq_epi32(mantissa, _mm256_set1_epi32(0x3ff)),
+      _mm256_cmpgt_epi32(_mm256_add_epi32(remainder, odd),
+                         _mm256_set1_epi32(0x1000)));
+  mantissa = _mm256_sub_epi32(mantissa, up);
+
+  __m256i result = _mm256_or_si256(
+      _mm256_slli_epi32(_mm256_sub_epi32(exponent, _mm256_set1_epi32(112)), 10),
+      mantissa);
+  result = _mm256_blendv_epi8(
+      result, _mm256_set1_epi32(0x7c00),
+      _mm256_cmpgt_epi32(exponent, _mm256_set1_epi32(142)));
+  result = _mm256_andnot_si256(
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(113), exponent), result);
+  result = _mm256_blendv_epi8(
+      result, mantissa, _mm256_cmpeq_epi32(exponent, _mm256_setzero_si256()));
+  result = _mm256_blendv_epi8(
+      result, _mm256_or_si256(mantissa, _mm256_set1_epi32(0x7c00)),
+      _mm256_cmpeq_epi32(exponent, _mm256_set1_epi32(0xff)));
+  return _mm256_or_si256(sign, result);
+}
+
+COMPUTE_SAMPLES_TARGET("avx2,f16c")
+size_t float_to_half_f16c(const float *input, half *output, const size_t count,
+                          const HalfRounding rounding) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i packed;
+    if (rounding == HalfRounding::compatible) {
+      const __m256i result = float_to_half_compatible_avx2(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i)));
+      packed = _mm_packus_epi32(_mm256_castsi256_si128(result),
+                                _mm256_extracti128_si256(result, 1));
+    } else {
+      packed = _mm256_cvtps_ph(_mm256_loadu_ps(input + i),
+                               _MM_FROUND_TO_NEAREST_INT);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), packed);
+  }
+  return i;
+}
+
+COMPUTE_SAMPLES_TARGET("avx2,f16c")
+size_t half_to_float_f16c(const half *input, float *output,
+                          const size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i bits =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+    const __m256 converted = _mm256_cvtph_ps(bits);
+    // Infinities and NaNs keep their payload bits unchanged
+    const __m256i wide = _mm256_cvtepu16_epi32(bits);
+    const __m256i special =
+        _mm256_cmpeq_epi32(_mm256_and_si256(wide, _mm256_set1_epi32(0x7c00)),
+                           _mm256_set1_epi32(0x7c00));
+    const __m256i exact = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_slli_epi32(
+                _mm256_and_si256(wide, _mm256_set1_epi32(0x8000)), 16),
+            _mm256_set1_epi32(0x7f800000)),
+        _mm256_slli_epi32(_mm256_and_si256(wide, _mm256_set1_epi32(0x3ff)),
+                          13));
+    _mm256_storeu_ps(output + i,
+                     _mm256_blendv_ps(converted, _mm256_castsi256_ps(exact),
+                                      _mm256_castsi256_ps(special)));
+  }
+  return i;
+}
+
+// GCC 12 reports the deliberately undefined pass-through operands of AVX-512
+// intrinsics as uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+COMPUTE_SAMPLES_TARGET("avx512f")
+__m512i float_to_half_compatible_avx512(const __m512i bits) {
+  const __m512i sign =
+      _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(0x8000));
+  const __m512i exponent =
+      _mm512_and_si512(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(0xff));
+  __m512i mantissa =
+      _mm512_and_si512(_mm512_srli_epi32(bits, 13), _mm512_set1_epi32(0x3ff));
+  const __m512i remainder = _mm512_and_si512(bits, _mm512_set1_epi32(0x1fff));
+
+  const __m512i odd = _mm512_and_si512(mantissa, _mm512_set1_epi32(1));
+  const __mmask16 up =
+      _mm512_cmpgt_epi32_mask(_mm512_add_epi32(remainder, odd),
+                              _mm512_set1_epi32(0x1000)) &
+      _mm512_cmpneq_epi32_mask(mantissa, _mm512_set1_epi32(0x3ff));
+  mantissa = _mm512_mask_add_epi32(mantissa, up, mantissa,
+                                   _mm512_set1_epi32(1));
+
+  __m512i result = _mm512_or_si512(
+      _mm512_slli_epi32(_mm512_sub_epi32(exponent, _mm512_set1_epi32(112)), 10),
+      mantissa);
+  result = _mm512_mask_mov_epi32(
+      result, _mm512_cmpgt_epi32_mask(exponent, _mm512_set1_epi32(142)),
+      _mm512_set1_epi32(0x7c00));
+  result = _mm512_maskz_mov_epi32(
+      _mm512_cmpgt_epi32_mask(exponent, _mm512_set1_epi32(112)), result);
+  result = _mm512_mask_mov_epi32(
+      result, _mm512_cmpeq_epi32_mask(exponent, _mm512_setzero_si512()),
+      mantissa);
+  result = _mm512_mask_or_epi32(
+      result, _mm512_cmpeq_epi32_mask(exponent, _mm512_set1_epi32(0xff)),
+      mantissa, _mm512_set1_epi32(0x7c00));
+  return _mm512_or_si512(sign, result);
+}
+
+COMPUTE_SAMPLES_TARGET("avx512f")
+size_t float_to_half_avx512(const float *input, half *output,
+                            const size_t count, const HalfRounding rounding) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i packed;
+    if (rounding == HalfRounding::compatible) {
+      packed = _mm512_cvtepi32_epi16(
+          float_to_half_compatible_avx512(_mm512_loadu_si512(input + i)));
+    } else {
+      packed = _mm512_cvtps_ph(_mm512_loadu_ps(input + i),
+                               _MM_FROUND_TO_NEAREST_INT);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), packed);
+  }
+  return i;
+}
+
+COMPUTE_SAMPLES_TARGET("avx512f")
+size_t half_to_float_avx512(const half *input, float *output,
+                            const size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m256i bits =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i));
+    const __m512 converted = _mm512_cvtph_ps(bits);
+    const __m512i wide = _mm512_cvtepu16_epi32(bits);
+    const __mmask16 special = _mm512_cmpeq_epi32_mask(
+        _mm512_and_si512(wide, _mm512_set1_epi32(0x7c00)),
+        _mm512_set1_epi32(0x7c00));
+    const __m512i exact = _mm512_or_si512(
+        _mm512_or_si512(
+            _mm512_slli_epi32(
+                _mm512_and_si512(wide, _mm512_set1_epi32(0x8000)), 16),
+            _mm512_set1_epi32(0x7f800000)),
+        _mm512_slli_epi32(_mm512_and_si512(wide, _mm512_set1_epi32(0x3ff)),
+                          13));
+    _mm512_storeu_ps(output + i,
+                     _mm512_mask_blend_ps(special, converted,
+                                          _mm512_castsi512_ps(exact)));
+  }
+  return i;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+HalfKernel select_kernel(const HalfKernel kernel) {
+  if (kernel == HalfKernel::automatic) {
+    return best_half_kernel();
+  }
+  if (!is_half_kernel_supported(kernel)) {
+    throw std::invalid_argument(
+        std::string("Half conversion kernel is not supported on this "
+                    "processor: ") +
+        half_kernel_name(kernel));
+  }
+  return kernel;
+}
+} // namespace
+
+void convert_float_to_half(const float *input, half *output,
+                           const size_t count, const HalfRounding rounding,
+                           const HalfKernel kernel) {
+  size_t done = 0;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  switch (select_kernel(kernel)) {
+  case HalfKernel::avx512:
+    done = float_to_half_avx512(input, output, count, rounding);
+    break;
+  case HalfKernel::f16c:
+    done = float_to_half_f16c(input, output, count, rounding);
+    break;
+  default:
+    break;
+  }
+#else
+  select_kernel(kernel);
+#endif
+  float_to_half_scalar(input + done, output + done, count - done, rounding);
+}
+
+void convert_half_to_float(const half *input, float *output,
+                           const size_t count, const HalfKernel kernel) {
+  size_t done = 0;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  switch (select_kernel(kernel)) {
+  case HalfKernel::avx512:
+    done = half_to_float_avx512(input, output, count);
+    break;
+  case HalfKernel::f16c:
+    done = half_to_float_f16c(input, output, count);
+    break;
+  default:
+    break;
+  }
+#else
+  select_kernel(kernel);
+#endif
+  half_to_float_scalar(input + done, output + done, count - done);
+}
+
+std::vector<half> convert_float_to_half(const std::vector<float> &input,
+                                        const HalfRounding rounding) {
+  std::vector<half> output(input.size());
+  convert_float_to_half(input.data(), output.data(), input.size(), rounding);
+  return output;
+}
+
+std::vector<float> convert_half_to_float(const std::vector<half> &input) {
+  std::vector<float> output(input.size());
+  convert_half_to_float(input.data(), output.data(), input.size());
+  return output;
+}
+
+bool is_half_kernel_supported(const HalfKernel kernel) {
+  switch (kernel) {
+  case HalfKernel::automatic:
+  case HalfKernel::scalar:
+    return true;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  case HalfKernel::f16c:
+    return cpu_features().avx2 && cpu_features().f16c;
+  case HalfKernel::avx512:
+    return cpu_features().avx512f;
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *half_kernel_name(const HalfKernel kernel) {
+  switch (kernel) {
+  case HalfKernel::automatic:
+    return "automatic";
+  case HalfKernel::scalar:
+    return "scalar";
+  case HalfKernel::f16c:
+    return "f16c";
+  case HalfKernel::avx512:
+    return "avx512";
+  default:
+    return "unknown";
+  }
+}
+
+HalfKernel best_half_kernel() {
+  if (is_half_kernel_supported(HalfKernel::avx512)) {
+    return HalfKernel::avx512;
+  }
+  if (is_half_kernel_supported(HalfKernel::f16c)) {
+    return HalfKernel::f16c;
+  }
+  return HalfKernel::scalar;
+}
+
+} // namespace compute_samples
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "fp_types/low_precision_convert.hpp"
+#include "utils/cpu_features.hpp"
+#include "minifloat.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// Every kernel compiles the same branch-free loops from minifloat.hpp, the
+// avx2 one with AVX2 enabled so that the compiler vectorizes them with
+// variable shifts and blends. Results are therefore identical by
+// construction.
+
+namespace compute_samples {
+
+namespace {
+// Format, storage type and left shift of the encoding in the storage
+template <typename F, typename Raw, int Shift> struct Layout {
+  typedef F format;
+  typedef Raw raw;
+  static const int shift = Shift;
+};
+typedef Layout<minifloat::Bfloat16, uint16_t, 0> Bfloat16Layout;
+typedef Layout<minifloat::Tf32, uint32_t, 23 - minifloat::Tf32::mantissa_bits>
+    Tf32Layout;
+typedef Layout<minifloat::E4m3, uint8_t, 0> E4m3Layout;
+typedef Layout<minifloat::E5m2, uint8_t, 0> E5m2Layout;
+
+// Murmur3 finalizer of the seeded index
+inline uint32_t mix(const uint32_t seed, const uint32_t index) {
+  uint32_t x = seed ^ (index * 0x9e3779b9u);
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  return x;
+}
+
+template <typename L, bool Stochastic, typename T>
+inline void encode_loop(const float *input, T *output, const size_t count,
+                        const uint32_t seed) {
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, input + i, sizeof(bits));
+    const uint32_t random =
+        Stochastic ? mix(seed, static_cast<uint32_t>(i)) : 0;
+    const typename L::raw raw = static_cast<typename L::raw>(
+        minifloat::encode<typename L::format>(bits, random, Stochastic)
+        << L::shift);
+    std::memcpy(static_cast<void *>(output + i), &raw, sizeof(raw));
+  }
+}
+
+// 8-bit formats are decoded with a table of every value
+template <typename L> struct DecodeTable {
+  DecodeTable() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      values[i] = minifloat::decode<typename L::format>(i);
+    }
+  }
+  uint32_t values[256];
+};
+
+template <typename L, typename T>
+inline void decode_loop(const T *input, float *output, const size_t count) {
+  if (sizeof(typename L::raw) == 1) {
+    static const DecodeTable<L> table;
+    for (size_t i = 0; i < count; ++i) {
+      uint8_t raw = 0;
+      std::memcpy(&raw, input + i, sizeof(raw));
+      std::memcpy(output + i, &table.values[raw], sizeof(float));
+    }
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    typename L::raw raw = 0;
+    std::memcpy(&raw, input + i, sizeof(raw));
+    const uint32_t bits =
+        minifloat::decode<typename L::format>(raw >> L::shift);
+    std::memcpy(output + i, &bits, sizeof(bits));
+  }
+}
+
+template <typename L, typename T>
+void encode_scalar(const float *input, T *output, const size_t count,
+                   const bool stochastic, const uint32_t seed) {
+  if (stochastic) {
+    encode_loop<L, true>(input, output, count, seed);
+  } else {
+    encode_loop<L, false>(input, output, count, seed);
+  }
+}
+
+template <typename L, typename T>
+void decode_scalar(const T *input, float *output, const size_t count) {
+  decode_loop<L>(input, output, count);
+}
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+template <typename L, typename T>
+COMPUTE_SAMPLES_TARGET("avx2")
+void encode_avx2(const float *input, T *output, const size_t count,
+                 const bool stochastic, const uint32_t seed) {
+  if (stochastic) {
+    encode_loop<L, true>(input, output, count, seed);
+  } else {
+    encode_loop<L, false>(input, output, count, seed);
+  }
+}
+
+template <typename L, typename T>
+COMPUTE_SAMPLES_TARGET("avx2")
+void decode_avx2(const T *input, float *output, const size_t count) {
+  decode_loop<L>(input, output, count);
+}
+#endif
+
+FpKernel select_kernel(const FpKernel kernel) {
+  if (kernel == FpKernel::automatic) {
+    return is_fp_kernel_supported(FpKernel::avx2) ? FpKernel::avx2
+                                                  : FpKernel::scalar;
+  }
+  if (!is_fp_kernel_supported(kernel)) {
+    throw std::invalid_argument(
+        std::string("Floating point conversion kernel is not supported on "
+                    "this processor: ") +
+        fp_kernel_name(kernel));
+  }
+  return kernel;
+}
+
+template <typename L, typename T>
+void encode(const float *input, T *output, const size_t count,
+            const FpRounding rounding, const uint32_t seed,
+            const FpKernel kernel) {
+  const bool stochastic = rounding == FpRounding::stochastic;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  if (select_kernel(kernel) == FpKernel::avx2) {
+    encode_avx2<L>(input, output, count, stochastic, seed);
+    return;
+  }
+#else
+  select_kernel(kernel);
+#endif
+  encode_scalar<L>(input, output, count, stochastic, seed);
+}
+
+template <typename L, typename T>
+void decode(const T *input, float *output, const size_t count,
+            const FpKernel kernel) {
+#if defined(COMPUTE_SAMPLES_X86_64)
+  if (select_kernel(kernel) == FpKernel::avx2) {
+    decode_avx2<L>(input, output, count);
+    return;
+  }
+#else
+  select_kernel(kernel);
+#endif
+  decode_scalar<L>(input, output, count);
+}
+} // namespace
+
+uint32_t stochastic_rounding_bits(const uint32_t seed, const uint32_t index) {
+  return mix(seed, index);
+}
+
+void convert_from_float(const float *input, bfloat16 *output,
+                        const size_t count, const FpRounding rounding,
+                        const uint32_t seed, const FpKernel kernel) {
+  encode<Bfloat16Layout>(input, output, count, rounding, seed, kernel);
+}
+void convert_from_float(const float *input, tf32 *output, const size_t count,
+                        const FpRounding rounding, const uint32_t seed,
+                        const FpKernel kernel) {
+  encode<Tf32Layout>(input, output, count, rounding, seed, kernel);
+}
+void convert_from_float(const float *input, fp8_e4m3 *output,
+                        const size_t count, const FpRounding rounding,
+                        const uint32_t seed, const FpKernel kernel) {
+  encode<E4m3Layout>(input, output, count, rounding, seed, kernel);
+}
+void convert_from_float(const float *input, fp8_e5m2 *output,
+                        const size_t count, const FpRounding rounding,
+                        const uint32_t seed, const FpKernel kernel) {
+  encode<E5m2Layout>(input, output, count, rounding, seed, kernel);
+}
+
+void convert_to_float(const bfloat16 *input, float *output, const size_t count,
+                      const FpKernel kernel) {
+  decode<Bfloat16Layout>(input, output, count, kernel);
+}
+void convert_to_float(const tf32 *input, float *output, const size_t count,
+                      const FpKernel kernel) {
+  decode<Tf32Layout>(input, output, count, kernel);
+}
+void convert_to_float(const fp8_e4m3 *input, float *output, const size_t count,
+                      const FpKernel kernel) {
+  decode<E4m3Layout>(input, output, count, kernel);
+}
+void convert_to_float(const fp8_e5m2 *input, float *output, const size_t count,
+                      const FpKernel kernel) {
+  decode<E5m2Layout>(input, output, count, kernel);
+}
+
+bool is_fp_kernel_supported(const FpKernel kernel) {
+  switch (kernel) {
+  case FpKernel::automatic:
+  case FpKernel::scalar:
+    return true;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  case FpKernel::avx2:
+    return cpu_features().avx2;
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *fp_kernel_name(const FpKernel kernel) {
+  switch (kernel) {
+  case FpKernel::automatic:
+    return "automatic";
+  case FpKernel::scalar:
+    return "scalar";
+  case FpKernel::avx2:
+    return "avx2";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace compute_samples
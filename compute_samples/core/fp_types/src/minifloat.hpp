@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FP_TYPES_MINIFLOAT_HPP
+#define COMPUTE_SAMPLES_FP_TYPES_MINIFLOAT_HPP
+
+#include <cstdint>
+#include <cstring>
+
+// Conversions between float and narrower binary floating point formats.
+// Encodings are right aligned: the sign is bit exponent_bits + mantissa_bits.
+// The functions are branch-free so that loops over them vectorize.
+
+namespace compute_samples {
+namespace minifloat {
+
+// Formats without infinity use the all ones encoding as their only NaN and
+// convert overflows and infinities to it, like the OCP 8-bit E4M3 format
+template <int ExponentBits, int MantissaBits, bool Infinity> struct Format {
+  static const int exponent_bits = ExponentBits;
+  static const int mantissa_bits = MantissaBits;
+  static const bool infinity = Infinity;
+  static const int bias = (1 << (ExponentBits - 1)) - 1;
+  // Float mantissa bits dropped from normal values
+  static const int shift = 23 - MantissaBits;
+  static const uint32_t exponent_mask = (1u << ExponentBits) - 1;
+  static const uint32_t mantissa_mask = (1u << MantissaBits) - 1;
+  static const uint32_t magnitude_mask =
+      (1u << (ExponentBits + MantissaBits)) - 1;
+  static const uint32_t infinity_encoding = exponent_mask << MantissaBits;
+  static const uint32_t nan_encoding =
+      Infinity ? infinity_encoding | (1u << (MantissaBits - 1))
+               : magnitude_mask;
+  // Largest rounded magnitude, everything above is infinity or NaN
+  static const uint32_t limit = Infinity ? infinity_encoding : magnitude_mask;
+};
+
+typedef Format<8, 7, true> Bfloat16;
+typedef Format<8, 10, true> Tf32;
+typedef Format<4, 3, false> E4m3;
+typedef Format<5, 2, true> E5m2;
+
+inline uint32_t float_bits(const float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+inline float bits_float(const uint32_t bits) {
+  float value = 0.0f;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Rounds to nearest even, or stochastically by adding the low bits of random
+// below the kept precision and truncating. NaNs are quieted and keep the
+// leading payload bits.
+template <typename F>
+inline uint32_t encode(const uint32_t bits, const uint32_t random,
+                       const bool stochastic) {
+  const uint32_t sign = (bits >> 31) << (F::exponent_bits + F::mantissa_bits);
+  const uint32_t magnitude = bits & 0x7fffffff;
+  const uint32_t exponent = magnitude >> 23;
+  // Values below the normal range of the format lose k more bits
+  const int min_normal = 128 - F::bias;
+  const int effective = static_cast<int>(exponent + (exponent == 0 ? 1 : 0));
+  int k = min_normal - effective;
+  k = k < 0 ? 0 : k;
+  k = k > 31 - F::shift ? 31 - F::shift : k;
+  const uint32_t significand =
+      (magnitude & 0x007fffff) | (exponent != 0 ? 0x00800000u : 0u);
+  const uint32_t rebiased =
+      magnitude - (static_cast<uint32_t>(127 - F::bias) << 23);
+  const uint32_t x = k > 0 ? significand : rebiased;
+  const int shift = F::shift + k;
+
+  const uint32_t dropped = (1u << shift) - 1;
+  const uint32_t nearest = (dropped >> 1) + ((x >> shift) & 1);
+  const uint32_t increment = stochastic ? random & dropped : nearest;
+  const uint32_t limit = F::limit;
+  uint32_t result = (x + increment) >> shift;
+  result = result > limit ? limit : result;
+
+  uint32_t nan = F::nan_encoding;
+  if (F::infinity) {
+    nan |= (magnitude >> F::shift) & F::mantissa_mask;
+  }
+  return sign | (magnitude > 0x7f800000 ? nan : result);
+}
+
+// Exact, the result is a float bit pattern
+template <typename F> inline uint32_t decode(const uint32_t value) {
+  const uint32_t sign = ((value >> (F::exponent_bits + F::mantissa_bits)) & 1)
+                        << 31;
+  const uint32_t exponent = (value >> F::mantissa_bits) & F::exponent_mask;
+  const uint32_t mantissa = value & F::mantissa_mask;
+  uint32_t result =
+      ((exponent + (127 - F::bias)) << 23) | (mantissa << F::shift);
+  if (F::bias != 127) {
+    // Subnormals are normal floats, mantissa * 2^(1 - bias - mantissa_bits)
+    const float scale =
+        bits_float(static_cast<uint32_t>(128 - F::bias - F::mantissa_bits)
+                   << 23);
+    const uint32_t subnormal =
+        float_bits(static_cast<float>(mantissa) * scale);
+    result = exponent == 0 ? subnormal : result;
+  }
+  if (F::infinity) {
+    result = exponent == F::exponent_mask
+                 ? 0x7f800000 | (mantissa << F::shift)
+                 : result;
+  } else {
+    const uint32_t magnitude = value & F::magnitude_mask;
+    result = magnitude == F::magnitude_mask ? 0x7fc00000 : result;
+  }
+  return sign | result;
+}
+
+} // namespace minifloat
+} // namespace compute_samples
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "fp_types/tf32.hpp"
+#include "minifloat.hpp"
+
+namespace compute_samples {
+
+namespace {
+const int float_shift = 23 - minifloat::Tf32::mantissa_bits;
+}
+
+tf32::tf32(uint32_t v) : data(v) {}
+tf32::tf32(float v)
+    : data(minifloat::encode<minifloat::Tf32>(minifloat::float_bits(v), 0,
+                                              false)
+           << float_shift) {}
+tf32::tf32(float v, uint32_t random)
+    : data(minifloat::encode<minifloat::Tf32>(minifloat::float_bits(v),
+                                              random, true)
+           << float_shift) {}
+tf32::operator uint32_t() const { return data; }
+tf32::operator float() const {
+  return minifloat::bits_float(data & ~((1u << float_shift) - 1));
+}
+tf32 tf32::operator-() const { return tf32(data ^ 0x80000000u); }
+bool tf32::operator==(const tf32 &rhs) const { return data == rhs.data; }
+bool tf32::nan_sensitive_eq(const tf32 &rhs) const {
+  const bool this_nan = (data & 0x7fffffff) > 0x7f800000;
+  const bool rhs_nan = (rhs.data & 0x7fffffff) > 0x7f800000;
+  if (this_nan && rhs_nan) {
+    return true;
+  }
+  return data == rhs.data;
+}
+tf32 &tf32::operator+=(const tf32 &rhs) {
+  *this = tf32(static_cast<float>(*this) + static_cast<float>(rhs));
+  return *this;
+}
+tf32 &tf32::operator*=(const tf32 &rhs) {
+  *this = tf32(static_cast<float>(*this) * static_cast<float>(rhs));
+  return *this;
+}
+tf32 operator+(tf32 lhs, const tf32 &rhs) {
+  lhs += rhs;
+  return lhs;
+}
+tf32 operator*(tf32 lhs, const tf32 &rhs) {
+  lhs *= rhs;
+  return lhs;
+}
+float &operator+=(float &lhs, const tf32 &rhs) {
+  lhs += static_cast<float>(rhs);
+  return lhs;
+}
+
+// Bits of the format, the storage is a 32-bit float
+template <> int bits<tf32>() { return 19; }
+
+template <> std::string to_cl_c_string<tf32>() { return "float"; };
+} // namespace compute_samples
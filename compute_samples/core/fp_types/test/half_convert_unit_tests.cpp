@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "fp_types/half_convert.hpp"
+#include "fp_types/common.hpp"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace cs = compute_samples;
+
+namespace {
+
+uint32_t float_to_uint32(const float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+std::vector<cs::half> all_halves() {
+  std::vector<cs::half> values(1 << 16);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = cs::half(static_cast<uint16_t>(i));
+  }
+  return values;
+}
+
+// Every sign, exponent and leading mantissa bit pattern combined with low
+// halves around the rounding boundaries
+std::vector<float> float_sweep() {
+  const uint32_t low_bits[] = {0x0000, 0x0001, 0x0fff, 0x1000, 0x1001, 0x1fff,
+                               0x2000, 0x3000, 0x7fff, 0xe000, 0xefff, 0xffff};
+  std::vector<float> values;
+  for (uint32_t high = 0; high < (1u << 16); ++high) {
+    for (const uint32_t low : low_bits) {
+      values.push_back(cs::uint32_to_float((high << 16) | low));
+    }
+  }
+  return values;
+}
+
+std::vector<cs::HalfKernel> supported_kernels() {
+  std::vector<cs::HalfKernel> kernels;
+  for (const cs::HalfKernel kernel :
+       {cs::HalfKernel::scalar, cs::HalfKernel::f16c, cs::HalfKernel::avx512}) {
+    if (cs::is_half_kernel_supported(kernel)) {
+      kernels.push_back(kernel);
+    }
+  }
+  return kernels;
+}
+
+bool is_subnormal(const uint16_t value) {
+  return (value & 0x7c00) == 0 && (value & 0x03ff) != 0;
+}
+
+bool is_signaling_nan(const uint16_t value) {
+  return (value & 0x7e00) == 0x7c00 && (value & 0x01ff) != 0;
+}
+
+class HalfConvert : public testing::TestWithParam<cs::HalfKernel> {
+protected:
+  std::vector<cs::half> to_half(const std::vector<float> &input,
+                                const cs::HalfRounding rounding) const {
+    std::vector<cs::half> output(input.size());
+    cs::convert_float_to_half(input.data(), output.data(), input.size(),
+                              rounding, GetParam());
+    return output;
+  }
+
+  std::vector<float> to_float(const std::vector<cs::half> &input) const {
+    std::vector<float> output(input.size());
+    cs::convert_half_to_float(input.data(), output.data(), input.size(),
+                              GetParam());
+    return output;
+  }
+};
+
+TEST_P(HalfConvert, HalfToFloatMatchesOperatorFloat) {
+  const std::vector<cs::half> input = all_halves();
+  const std::vector<float> output = to_float(input);
+  for (size_t i = 0; i < input.size(); ++i) {
+    ASSERT_EQ(float_to_uint32(static_cast<float>(input[i])),
+              float_to_uint32(output[i]))
+        << "half 0x" << std::hex << i;
+  }
+}
+
+TEST_P(HalfConvert, CompatibleRoundTrip) {
+  const std::vector<cs::half> output = to_half(
+      to_float(all_halves()), cs::HalfRounding::compatible);
+  for (size_t i = 0; i < output.size(); ++i) {
+    const uint16_t value = static_cast<uint16_t>(i);
+    // half(float) flushes values below the normal range to signed zero
+    const uint16_t expected =
+        is_subnormal(value) ? static_cast<uint16_t>(value & 0x8000) : value;
+    ASSERT_EQ(expected, static_cast<uint16_t>(output[i]))
+        << "half 0x" << std::hex << i;
+  }
+}
+
+TEST_P(HalfConvert, NearestEvenRoundTrip) {
+  const std::vector<cs::half> output = to_half(
+      to_float(all_halves()), cs::HalfRounding::nearest_even);
+  for (size_t i = 0; i < output.size(); ++i) {
+    const uint16_t value = static_cast<uint16_t>(i);
+    const uint16_t expected = is_signaling_nan(value)
+                                  ? static_cast<uint16_t>(value | 0x0200)
+                                  : value;
+    ASSERT_EQ(expected, static_cast<uint16_t>(output[i]))
+        << "half 0x" << std::hex << i;
+  }
+}
+
+TEST_P(HalfConvert, CompatibleMatchesConstructor) {
+  const std::vector<float> input = float_sweep();
+  const std::vector<cs::half> output =
+      to_half(input, cs::HalfRounding::compatible);
+  for (size_t i = 0; i < input.size(); ++i) {
+    ASSERT_EQ(static_cast<uint16_t>(cs::half(input[i])),
+              static_cast<uint16_t>(output[i]))
+        << "float 0x" << std::hex << float_to_uint32(input[i]);
+  }
+}
+
+TEST_P(HalfConvert, NearestEvenMatchesScalar) {
+  const std::vector<float> input = float_sweep();
+  std::vector<cs::half> expected(input.size());
+  cs::convert_float_to_half(input.data(), expected.data(), input.size(),
+                            cs::HalfRounding::nearest_even,
+                            cs::HalfKernel::scalar);
+  const std::vector<cs::half> output =
+      to_half(input, cs::HalfRounding::nearest_even);
+  for (size_t i = 0; i < input.size(); ++i) {
+    ASSERT_EQ(static_cast<uint16_t>(expected[i]),
+              static_cast<uint16_t>(output[i]))
+        << "float 0x" << std::hex << float_to_uint32(input[i]);
+  }
+}
+
+TEST_P(HalfConvert, NearestEvenRounding) {
+  const std::vector<float> input{
+      cs::uint32_to_float(0x477fefff), // largest value below 65520
+      cs::uint32_to_float(0x477ff000), // 65520 rounds to infinity
+      cs::uint32_to_float(0x33800000), // 2^-24
+      cs::uint32_to_float(0x33000000), // 2^-25 ties to zero
+      cs::uint32_to_float(0x33000001),
+      cs::uint32_to_float(0x387fe000), // rounds up to the smallest normal
+      cs::uint32_to_float(0x3f801000), // 1 + 2^-11 ties to 1
+      cs::uint32_to_float(0x3f803000), // 1 + 3 * 2^-11 ties to 1 + 2^-9
+      cs::uint32_to_float(0x3fffffff), // carries into the exponent
+      cs::uint32_to_float(0x7f800001), // NaN with low payload stays NaN
+      cs::uint32_to_float(0xff800000)};
+  const std::vector<uint16_t> expected{0x7bff, 0x7c00, 0x0001, 0x0000,
+                                       0x0001, 0x0400, 0x3c00, 0x3c02,
+                                       0x4000, 0x7e00, 0xfc00};
+  const std::vector<cs::half> output =
+      to_half(input, cs::HalfRounding::nearest_even);
+  for (size_t i = 0; i < input.size(); ++i) {
+    EXPECT_EQ(expected[i], static_cast<uint16_t>(output[i]))
+        << "float 0x" << std::hex << float_to_uint32(input[i]);
+  }
+}
+
+TEST_P(HalfConvert, UnalignedTails) {
+  const std::vector<float> input = float_sweep();
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t count = 0; count < 40; ++count) {
+      std::vector<cs::half> output(count + 1, cs::half(uint16_t(0x1234)));
+      cs::convert_float_to_half(input.data() + 1000 + offset, output.data(),
+                                count, cs::HalfRounding::compatible,
+                                GetParam());
+      for (size_t i = 0; i < count; ++i) {
+        ASSERT_EQ(static_cast<uint16_t>(cs::half(input[1000 + offset + i])),
+                  static_cast<uint16_t>(output[i]));
+      }
+      EXPECT_EQ(0x1234, static_cast<uint16_t>(output[count]));
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Half, HalfConvert, testing::ValuesIn(supported_kernels()),
+    [](const testing::TestParamInfo<cs::HalfKernel> &info) {
+      return std::string(cs::half_kernel_name(info.param));
+    });
+
+TEST(HalfConvert, VectorOverloads) {
+  const std::vector<float> input{1.0f, -2.0f, 0.5f};
+  const std::vector<cs::half> output = cs::convert_float_to_half(input);
+  ASSERT_EQ(input.size(), output.size());
+  EXPECT_EQ(0x3c00, static_cast<uint16_t>(output[0]));
+  EXPECT_EQ(0xc000, static_cast<uint16_t>(output[1]));
+  EXPECT_EQ(0x3800, static_cast<uint16_t>(output[2]));
+  EXPECT_EQ(input, cs::convert_half_to_float(output));
+}
+
+TEST(HalfConvert, UnsupportedKernelThrows) {
+  for (const cs::HalfKernel kernel :
+       {cs::HalfKernel::f16c, cs::HalfKernel::avx512}) {
+    if (!cs::is_half_kernel_supported(kernel)) {
+      float value = 1.0f;
+      cs::half output;
+      EXPECT_THROW(cs::convert_float_to_half(&value, &output, 1,
+                                             cs::HalfRounding::compatible,
+                                             kernel),
+                   std::invalid_argument);
+    }
+  }
+}
+
+} // namespace
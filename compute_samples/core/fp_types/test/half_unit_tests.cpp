@@ -10,6 +10,7 @@
 #include "gtest/gtest.h"
 #include "utils/utils.hpp"
 
+#include <cmath>
 #include <limits>
 
 namespace cs = compute_samples;
@@ -147,4 +148,110 @@ TEST(Half, NanSensitiveComparisonNanInf) {
   EXPECT_FALSE(h1.nan_sensitive_eq(h2));
 }
 
+TEST(Half, SubtractionAndDivision) {
+  const cs::half x_hf(1.5f);
+  const cs::half y_hf(-2.0f);
+  EXPECT_EQ(cs::half(3.5f), x_hf - y_hf);
+  EXPECT_EQ(cs::half(-0.75f), x_hf / y_hf);
+}
+
+TEST(Half, FusedMultiplyAdd) {
+  // (1 + 3 * 2^-10)^2 - 1 is 3 * 2^-9 + 9 * 2^-20, rounding the product to
+  // half first loses the last term
+  const cs::half x(uint16_t(0x3c03));
+  const cs::half c(uint16_t(0xbc00));
+  EXPECT_EQ(uint16_t(0x1e02), static_cast<uint16_t>(cs::fma(x, x, c)));
+  EXPECT_EQ(uint16_t(0x1e00), static_cast<uint16_t>(x * x + c));
+}
+
+TEST(Half, Constexpr) {
+  constexpr cs::half one(uint16_t(0x3c00));
+  static_assert(static_cast<uint16_t>(-one) == 0xbc00, "");
+  static_assert(one == cs::half(uint16_t(0x3c00)), "");
+  static_assert(std::numeric_limits<cs::half>::max().nan_sensitive_eq(
+                    cs::half(uint16_t(0x7bff))),
+                "");
+  EXPECT_EQ(uint16_t(0x3c00), static_cast<uint16_t>(one));
+}
+
+TEST(Half, FloatConversionOfEveryValue) {
+  for (uint32_t i = 0; i < (1u << 16); ++i) {
+    const cs::half h(static_cast<uint16_t>(i));
+    const uint16_t exponent = (i >> 10) & 0x1f;
+    const uint16_t mantissa = i & 0x3ff;
+    const float magnitude =
+        exponent == 0x1f
+            ? std::numeric_limits<float>::infinity()
+            : std::ldexp(static_cast<float>(exponent == 0 ? mantissa
+                                                          : mantissa | 0x400),
+                         (exponent == 0 ? 1 : exponent) - 25);
+    const float value = (i & 0x8000) != 0 ? -magnitude : magnitude;
+    if (exponent == 0x1f && mantissa != 0) {
+      EXPECT_TRUE(std::isnan(static_cast<float>(h))) << std::hex << i;
+    } else {
+      ASSERT_EQ(value, static_cast<float>(h)) << std::hex << i;
+      ASSERT_EQ(std::signbit(value), std::signbit(static_cast<float>(h)));
+    }
+  }
+}
+
+template <typename T> class HalfVector : public testing::Test {};
+typedef testing::Types<cs::half2, cs::half4, cs::half8> HalfVectorTypes;
+TYPED_TEST_SUITE(HalfVector, HalfVectorTypes);
+
+template <typename T> T make_vector(const float first, const float step) {
+  T value;
+  for (size_t i = 0; i < cs::half_vector_size<T>(); ++i) {
+    value.s[i] = cs::half(first + step * static_cast<float>(i));
+  }
+  return value;
+}
+
+TYPED_TEST(HalfVector, ElementWiseOperators) {
+  const TypeParam x = make_vector<TypeParam>(1.0f, 0.5f);
+  const TypeParam y = make_vector<TypeParam>(-2.0f, 0.25f);
+  const TypeParam sum = x + y;
+  const TypeParam difference = x - y;
+  const TypeParam product = x * y;
+  const TypeParam quotient = x / y;
+  const TypeParam negation = -x;
+  for (size_t i = 0; i < cs::half_vector_size<TypeParam>(); ++i) {
+    EXPECT_EQ(x.s[i] + y.s[i], sum.s[i]);
+    EXPECT_EQ(x.s[i] - y.s[i], difference.s[i]);
+    EXPECT_EQ(x.s[i] * y.s[i], product.s[i]);
+    EXPECT_EQ(x.s[i] / y.s[i], quotient.s[i]);
+    EXPECT_EQ(-x.s[i], negation.s[i]);
+  }
+}
+
+TYPED_TEST(HalfVector, FusedMultiplyAdd) {
+  const TypeParam x = make_vector<TypeParam>(1.0f, 0.5f);
+  const TypeParam y = make_vector<TypeParam>(-2.0f, 0.25f);
+  const TypeParam z = make_vector<TypeParam>(0.125f, 1.0f);
+  const TypeParam result = cs::fma(x, y, z);
+  for (size_t i = 0; i < cs::half_vector_size<TypeParam>(); ++i) {
+    EXPECT_EQ(cs::fma(x.s[i], y.s[i], z.s[i]), result.s[i]);
+  }
+}
+
+TYPED_TEST(HalfVector, Reductions) {
+  const size_t size = cs::half_vector_size<TypeParam>();
+  const float n = static_cast<float>(size);
+  const TypeParam x = make_vector<TypeParam>(-1.0f, 0.5f);
+  // -1 + 0.5 * (0 + 1 + ... + n - 1)
+  EXPECT_EQ(cs::half(-n + 0.25f * n * (n - 1.0f)), cs::reduce_add(x));
+  EXPECT_EQ(cs::half(-1.0f), cs::reduce_min(x));
+  EXPECT_EQ(cs::half(-1.0f + 0.5f * (n - 1.0f)), cs::reduce_max(x));
+  const TypeParam ones = make_vector<TypeParam>(1.0f, 0.0f);
+  EXPECT_EQ(cs::reduce_add(x), cs::dot(x, ones));
+}
+
+TYPED_TEST(HalfVector, ReductionsIgnoreNan) {
+  TypeParam x = make_vector<TypeParam>(2.0f, -1.0f);
+  x.s[0] = std::numeric_limits<cs::half>::quiet_NaN();
+  const float n = static_cast<float>(cs::half_vector_size<TypeParam>());
+  EXPECT_EQ(cs::half(1.0f), cs::reduce_max(x));
+  EXPECT_EQ(cs::half(3.0f - n), cs::reduce_min(x));
+}
+
 } // namespace
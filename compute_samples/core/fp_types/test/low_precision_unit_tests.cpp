@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "fp_types/low_precision_convert.hpp"
+#include "fp_types/common.hpp"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace cs = compute_samples;
+
+namespace {
+
+uint32_t float_to_uint32(const float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Raw encoding of each type, as the constructor from it takes
+template <typename T> struct Raw;
+template <> struct Raw<cs::bfloat16> {
+  typedef uint16_t type;
+  static const uint32_t count = 1u << 16;
+  static const int shift = 0;
+  static const int min_exponent = -126;
+};
+template <> struct Raw<cs::tf32> {
+  typedef uint32_t type;
+  static const uint32_t count = 1u << 19;
+  static const int shift = 13;
+  static const int min_exponent = -126;
+};
+template <> struct Raw<cs::fp8_e4m3> {
+  typedef uint8_t type;
+  static const uint32_t count = 1u << 8;
+  static const int shift = 0;
+  static const int min_exponent = -6;
+};
+template <> struct Raw<cs::fp8_e5m2> {
+  typedef uint8_t type;
+  static const uint32_t count = 1u << 8;
+  static const int shift = 0;
+  static const int min_exponent = -14;
+};
+
+template <typename T> T from_raw(const uint32_t encoding) {
+  return T(static_cast<typename Raw<T>::type>(encoding << Raw<T>::shift));
+}
+
+template <typename T> uint32_t to_raw(const T value) {
+  return static_cast<uint32_t>(static_cast<typename Raw<T>::type>(value)) >>
+         Raw<T>::shift;
+}
+
+std::vector<float> float_sweep() {
+  const uint32_t low_bits[] = {0x0000, 0x0001, 0x07ff, 0x0800, 0x0801,
+                               0x0fff, 0x1000, 0x8000, 0xffff};
+  std::vector<float> values;
+  for (uint32_t high = 0; high < (1u << 16); ++high) {
+    for (const uint32_t low : low_bits) {
+      values.push_back(cs::uint32_to_float((high << 16) | low));
+    }
+  }
+  return values;
+}
+
+template <typename T> class LowPrecision : public testing::Test {};
+typedef testing::Types<cs::bfloat16, cs::tf32, cs::fp8_e4m3, cs::fp8_e5m2>
+    LowPrecisionTypes;
+TYPED_TEST_SUITE(LowPrecision, LowPrecisionTypes);
+
+TYPED_TEST(LowPrecision, EveryEncodingRoundTrips) {
+  for (uint32_t encoding = 0; encoding < Raw<TypeParam>::count; ++encoding) {
+    const TypeParam value = from_raw<TypeParam>(encoding);
+    const float converted = static_cast<float>(value);
+    const TypeParam round_trip(converted);
+    if (std::isnan(converted)) {
+      EXPECT_TRUE(round_trip.nan_sensitive_eq(value)) << encoding;
+    } else {
+      ASSERT_EQ(encoding, to_raw(round_trip)) << converted;
+    }
+  }
+}
+
+TYPED_TEST(LowPrecision, NumericLimits) {
+  typedef std::numeric_limits<TypeParam> limits;
+  const float max = static_cast<float>(limits::max());
+  EXPECT_EQ(-max, static_cast<float>(limits::lowest()));
+  EXPECT_EQ(max, static_cast<float>(TypeParam(max)));
+  EXPECT_GT(static_cast<float>(limits::min()), 0.0f);
+  EXPECT_EQ(std::ldexp(1.0f, Raw<TypeParam>::min_exponent),
+            static_cast<float>(limits::min()));
+  EXPECT_GT(static_cast<float>(limits::denorm_min()), 0.0f);
+  EXPECT_LT(static_cast<float>(limits::denorm_min()),
+            static_cast<float>(limits::min()));
+  EXPECT_TRUE(std::isnan(static_cast<float>(limits::quiet_NaN())));
+  EXPECT_TRUE(std::isnan(static_cast<float>(limits::signaling_NaN())));
+  if (limits::has_infinity) {
+    EXPECT_TRUE(std::isinf(static_cast<float>(limits::infinity())));
+  }
+}
+
+TYPED_TEST(LowPrecision, Overflow) {
+  const float infinity = std::numeric_limits<float>::infinity();
+  const float converted = static_cast<float>(TypeParam(infinity));
+  const float overflow = static_cast<float>(
+      TypeParam(std::numeric_limits<float>::max()));
+  if (std::numeric_limits<TypeParam>::has_infinity) {
+    EXPECT_EQ(infinity, converted);
+    EXPECT_EQ(infinity, overflow);
+  } else {
+    EXPECT_TRUE(std::isnan(converted));
+    EXPECT_TRUE(std::isnan(overflow));
+  }
+  EXPECT_TRUE(std::isnan(static_cast<float>(
+      TypeParam(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+TYPED_TEST(LowPrecision, StochasticRoundingBounds) {
+  const std::vector<float> input = float_sweep();
+  for (const float value : input) {
+    if (std::isnan(value) ||
+        std::fabs(value) > static_cast<float>(
+                               std::numeric_limits<TypeParam>::max())) {
+      continue;
+    }
+    const float down = static_cast<float>(TypeParam(value, 0u));
+    const float up = static_cast<float>(TypeParam(value, 0xffffffffu));
+    ASSERT_LE(std::fabs(down), std::fabs(value)) << value;
+    ASSERT_GE(std::fabs(up), std::fabs(value)) << value;
+    const float random = static_cast<float>(TypeParam(value, 0x12345678u));
+    ASSERT_TRUE(random == down || random == up) << value;
+  }
+}
+
+TYPED_TEST(LowPrecision, StochasticRoundingIsUnbiased) {
+  // Not representable in any of the formats
+  const float value = 4.0f / 3.0f;
+  const float down = static_cast<float>(TypeParam(value, 0u));
+  const float up = static_cast<float>(TypeParam(value, 0xffffffffu));
+  ASSERT_LT(down, up);
+  const uint32_t count = 100000;
+  double sum = 0.0;
+  for (uint32_t i = 0; i < count; ++i) {
+    sum += static_cast<float>(
+        TypeParam(value, cs::stochastic_rounding_bits(7, i)));
+  }
+  EXPECT_NEAR(value, sum / count, (up - down) * 0.01);
+}
+
+TYPED_TEST(LowPrecision, BatchMatchesConstructors) {
+  const std::vector<float> input = float_sweep();
+  for (const cs::FpKernel kernel : {cs::FpKernel::scalar, cs::FpKernel::avx2}) {
+    if (!cs::is_fp_kernel_supported(kernel)) {
+      continue;
+    }
+    std::vector<TypeParam> nearest(input.size());
+    std::vector<TypeParam> stochastic(input.size());
+    std::vector<float> output(input.size());
+    cs::convert_from_float(input.data(), nearest.data(), input.size(),
+                           cs::FpRounding::nearest_even, 0, kernel);
+    cs::convert_from_float(input.data(), stochastic.data(), input.size(),
+                           cs::FpRounding::stochastic, 3, kernel);
+    cs::convert_to_float(nearest.data(), output.data(), nearest.size(),
+                         kernel);
+    for (size_t i = 0; i < input.size(); ++i) {
+      ASSERT_EQ(to_raw(TypeParam(input[i])), to_raw(nearest[i]))
+          << cs::fp_kernel_name(kernel) << " " << input[i];
+      const TypeParam expected(
+          input[i],
+          cs::stochastic_rounding_bits(3, static_cast<uint32_t>(i)));
+      ASSERT_EQ(to_raw(expected), to_raw(stochastic[i]))
+          << cs::fp_kernel_name(kernel) << " " << input[i];
+      ASSERT_EQ(float_to_uint32(static_cast<float>(nearest[i])),
+                float_to_uint32(output[i]))
+          << cs::fp_kernel_name(kernel) << " " << input[i];
+    }
+  }
+}
+
+TYPED_TEST(LowPrecision, VectorOverloads) {
+  const std::vector<float> input{1.0f, -2.0f, 0.5f, 0.0f};
+  EXPECT_EQ(input, cs::convert_to_float(
+                       cs::convert_from_float<TypeParam>(input)));
+}
+
+TEST(LowPrecision, NearestEvenTies) {
+  EXPECT_EQ(0x3f80, static_cast<uint16_t>(
+                        cs::bfloat16(cs::uint32_to_float(0x3f808000))));
+  EXPECT_EQ(0x3f82, static_cast<uint16_t>(
+                        cs::bfloat16(cs::uint32_to_float(0x3f818000))));
+  EXPECT_EQ(0x3f800000u, static_cast<uint32_t>(
+                             cs::tf32(cs::uint32_to_float(0x3f801000))));
+  EXPECT_EQ(0x3f804000u, static_cast<uint32_t>(
+                             cs::tf32(cs::uint32_to_float(0x3f803000))));
+  EXPECT_EQ(0x3f802000u, static_cast<uint32_t>(
+                             cs::tf32(cs::uint32_to_float(0x3f801001))));
+  // 464 lies halfway between the E4M3 maximum and the first overflow
+  EXPECT_EQ(448.0f, static_cast<float>(cs::fp8_e4m3(464.0f)));
+  EXPECT_TRUE(std::isnan(static_cast<float>(cs::fp8_e4m3(465.0f))));
+  // 61440 lies halfway between the E5M2 maximum, which is odd, and infinity
+  EXPECT_EQ(57344.0f, static_cast<float>(cs::fp8_e5m2(61439.0f)));
+  EXPECT_TRUE(std::isinf(static_cast<float>(cs::fp8_e5m2(61440.0f))));
+  // Subnormals
+  EXPECT_EQ(0x01, static_cast<uint8_t>(cs::fp8_e4m3(std::ldexp(1.0f, -9))));
+  EXPECT_EQ(0x00, static_cast<uint8_t>(cs::fp8_e4m3(std::ldexp(1.0f, -10))));
+  EXPECT_EQ(0x02, static_cast<uint8_t>(cs::fp8_e5m2(std::ldexp(3.0f, -17))));
+}
+
+TEST(LowPrecision, HalfToE5m2StochasticRounding) {
+  for (uint32_t bits = 0; bits < (1u << 16); ++bits) {
+    const cs::half value(static_cast<uint16_t>(bits));
+    const uint8_t down = static_cast<uint8_t>(cs::fp8_e5m2(value, 0));
+    const float converted = static_cast<float>(value);
+    if (std::isnan(converted)) {
+      EXPECT_TRUE(std::isnan(static_cast<float>(cs::fp8_e5m2(down))));
+      continue;
+    }
+    ASSERT_EQ(bits >> 8, down);
+    // Any non-zero low byte rounds up to the next magnitude
+    uint32_t up = down;
+    if ((bits & 0xff) != 0) {
+      up = (down & 0x80) | std::min<uint32_t>((down & 0x7f) + 1, 0x7c);
+    }
+    ASSERT_EQ(up, static_cast<uint8_t>(cs::fp8_e5m2(value, 0xff)));
+    // Rounding the half through float gives the same result when the half
+    // is normal and its low byte lines up with bit 13 of the float
+    if ((bits & 0x7c00) != 0) {
+      for (uint32_t random = 0; random < 256; random += 37) {
+        ASSERT_EQ(static_cast<uint8_t>(cs::fp8_e5m2(converted, random << 13)),
+                  static_cast<uint8_t>(cs::fp8_e5m2(
+                      value, static_cast<uint8_t>(random))));
+      }
+    }
+  }
+}
+
+TEST(LowPrecision, OpenClTypes) {
+  EXPECT_EQ("ushort", cs::to_cl_c_string<cs::bfloat16>());
+  EXPECT_EQ("float", cs::to_cl_c_string<cs::tf32>());
+  EXPECT_EQ("uchar", cs::to_cl_c_string<cs::fp8_e4m3>());
+  EXPECT_EQ("uchar", cs::to_cl_c_string<cs::fp8_e5m2>());
+  EXPECT_EQ(16, cs::bits<cs::bfloat16>());
+  EXPECT_EQ(19, cs::bits<cs::tf32>());
+  EXPECT_EQ(8, cs::bits<cs::fp8_e5m2>());
+}
+
+TEST(LowPrecision, Arithmetic) {
+  const cs::bfloat16 a(1.5f);
+  const cs::bfloat16 b(-2.0f);
+  EXPECT_EQ(-3.0f, static_cast<float>(a * b));
+  EXPECT_EQ(-0.5f, static_cast<float>(a + b));
+  EXPECT_EQ(-1.5f, static_cast<float>(-a));
+  float sum = 1.0f;
+  sum += cs::fp8_e4m3(0.5f);
+  EXPECT_EQ(1.5f, sum);
+}
+
+} // namespace
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "image/image.hpp"
+#include "image/image_batch.hpp"
+#include "timer/timer.hpp"
+#include "logging/logging.hpp"
+
+namespace po = boost::program_options;
+namespace cs = compute_samples;
+
+namespace {
+struct Arguments {
+  std::string suite;
+  int iterations = 0;
+  int images = 0;
+  int width = 0;
+  int height = 0;
+  int max_threads = 0;
+};
+
+// Smooth gradients with some noise, so that zlib has realistic work to do
+cs::ImagePNG32Bit generate_image(const int width, const int height,
+                                 const int seed) {
+  cs::ImagePNG32Bit image(width, height);
+  uint32_t state = 2654435761u * static_cast<uint32_t>(seed + 1);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      state = state * 1664525u + 1013904223u;
+      const uint32_t noise = (state >> 28) & 0x7;
+      const uint32_t r = (x + noise) & 0xFF;
+      const uint32_t g = (y + noise) & 0xFF;
+      const uint32_t b = (x + y + seed) & 0xFF;
+      image.set_pixel(x, y, (r << 24) | (g << 16) | (b << 8) | 0xFF);
+    }
+  }
+  return image;
+}
+
+std::vector<std::string> image_paths(const int count,
+                                     const std::string &prefix) {
+  std::vector<std::string> paths;
+  for (int i = 0; i < count; ++i) {
+    paths.push_back(prefix + std::to_string(i) + ".png");
+  }
+  return paths;
+}
+
+void remove_files(const std::vector<std::string> &paths) {
+  for (const std::string &path : paths) {
+    if (std::remove(path.c_str()) != 0) {
+      LOG_DEBUG << "Deleting file " << path << " failed";
+    }
+  }
+}
+
+void benchmark_threads(const Arguments &args, const int threads,
+                       const std::vector<cs::ImagePNG32Bit> &images) {
+  const std::vector<std::string> paths =
+      image_paths(args.images, "image_benchmark_" + std::to_string(threads));
+  cs::ImageBatchIO batch(threads);
+
+  cs::Timer write_timer;
+  for (std::future<void> &result : batch.write_png(paths, images)) {
+    result.get();
+  }
+  const double write_seconds = write_timer.elapsed();
+
+  cs::Timer read_timer;
+  size_t pixels = 0;
+  for (std::future<cs::ImagePNG32Bit> &result : batch.read_png(paths)) {
+    pixels += result.get().size();
+  }
+  const double read_seconds = read_timer.elapsed();
+
+  LOG_INFO << "Threads: " << threads
+           << ", write: " << args.images / write_seconds << " images/s"
+           << ", read: " << args.images / read_seconds << " images/s"
+           << " (" << pixels << " pixels)";
+  remove_files(paths);
+}
+void benchmark_batch(const Arguments &args) {
+  std::vector<cs::ImagePNG32Bit> images;
+  for (int i = 0; i < args.images; ++i) {
+    images.push_back(generate_image(args.width, args.height, i));
+  }
+  LOG_INFO << "Images: " << args.images << " of " << args.width << "x"
+           << args.height;
+
+  for (int threads = 1; threads <= args.max_threads; threads *= 2) {
+    benchmark_threads(args, threads, images);
+  }
+}
+
+template <typename ImageType>
+void benchmark_load(const Arguments &args, const std::string &name,
+                    const std::string &path, const uint32_t *pixels) {
+  ImageType output(args.width, args.height);
+  output.write(path, pixels);
+
+  cs::Timer timer;
+  size_t checksum = 0;
+  for (int i = 0; i < args.iterations; ++i) {
+    ImageType input(path);
+    checksum += input.get_pixel(args.width / 2, args.height / 2);
+  }
+  const double seconds = timer.elapsed() / args.iterations;
+  const double megabytes = output.size_in_bytes() / 1e6;
+  LOG_INFO << name << ": " << seconds * 1e3 << " ms, " << megabytes / seconds
+           << " MB/s (checksum " << checksum << ")";
+  remove_files({path});
+}
+
+void benchmark_load(const Arguments &args) {
+  const cs::ImagePNG32Bit image = generate_image(args.width, args.height, 0);
+  LOG_INFO << "Loading " << args.width << "x" << args.height << " image";
+  benchmark_load<cs::ImagePNG32Bit>(args, "ImagePNG32Bit",
+                                    "image_benchmark.png", image.raw_data());
+  benchmark_load<cs::ImageBMP32Bit>(args, "ImageBMP32Bit",
+                                    "image_benchmark.bmp", image.raw_data());
+  benchmark_load<cs::ImageRaw32Bit>(args, "ImageRaw32Bit",
+                                    "image_benchmark.raw", image.raw_data());
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  std::vector<std::string> command_line(argv + 1, argv + argc);
+  cs::init_logging(command_line);
+
+  Arguments args;
+  po::options_description desc("Allowed options");
+  auto options = desc.add_options();
+  options("help,h", "show help message");
+  options("suite", po::value<std::string>(&args.suite)->default_value("all"),
+          "benchmark to run: all, batch, load");
+  options("iterations", po::value<int>(&args.iterations)->default_value(5),
+          "number of loads per format");
+  options("images", po::value<int>(&args.images)->default_value(64),
+          "number of images in a batch");
+  options("width", po::value<int>(&args.width)->default_value(1024),
+          "image width");
+  options("height", po::value<int>(&args.height)->default_value(1024),
+          "image height");
+  options("max-threads",
+          po::value<int>(&args.max_threads)
+              ->default_value(cs::ThreadPool::hardware_threads()),
+          "largest thread count, counts are doubled starting from 1");
+  po::variables_map vm;
+  po::store(po::command_line_parser(command_line).options(desc).run(), vm);
+  if (vm.count("help") != 0u) {
+    std::cout << desc;
+    return 0;
+  }
+  po::notify(vm);
+
+  if (args.suite == "all" || args.suite == "batch") {
+    benchmark_batch(args);
+  }
+  if (args.suite == "all" || args.suite == "load") {
+    benchmark_load(args);
+  }
+  return 0;
+}
@@ -8,15 +8,46 @@
 #ifndef COMPUTE_SAMPLES_IMAGE_HPP
 #define COMPUTE_SAMPLES_IMAGE_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#include "align_utils/align_utils.hpp"
+
 namespace compute_samples {
+
+// Non-owning access to rows of pixels. Rows start pitch pixels apart, which
+// may be more than width when rows are padded.
+template <typename T> class ImageView {
+public:
+  ImageView(T *data, const int width, const int height, const int pitch)
+      : data_(data), width_(width), height_(height), pitch_(pitch) {}
+
+  T *data() const { return data_; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+  int pitch() const { return pitch_; }
+  T *row(const int y) const { return data_ + static_cast<size_t>(y) * pitch_; }
+  T &operator()(const int x, const int y) const { return row(y)[x]; }
+
+private:
+  T *data_;
+  int width_;
+  int height_;
+  int pitch_;
+};
+
 template <typename T> class Image {
 public:
   virtual ~Image() = default;
   virtual bool read(const std::string &image_path) = 0;
+  // Parses only the header, so that callers can size their own buffer
+  virtual bool read_info(const std::string &image_path) = 0;
+  // Decodes row by row into data, which must hold width() * height() pixels
+  // as reported by read_info
+  virtual bool read(const std::string &image_path, T *data) = 0;
   virtual bool write(const std::string &image_path) = 0;
   virtual bool write(const std::string &image_path, const T *data) = 0;
   virtual int width() const = 0;
@@ -32,15 +63,74 @@ public:
   virtual void copy_raw_data(const T *data) = 0;
   virtual T *raw_data() = 0;
   virtual const T *raw_data() const = 0;
+  // Distance between rows of raw_data() in pixels
+  virtual int pitch() const = 0;
+  // Bytes allocated for raw_data(). The storage is page aligned and padded to
+  // whole cache lines, so it can back a CL_MEM_USE_HOST_PTR buffer directly.
+  virtual int storage_size_in_bytes() const = 0;
+
+  ImageView<T> view() {
+    return ImageView<T>(raw_data(), width(), height(), pitch());
+  }
+  ImageView<const T> view() const {
+    return ImageView<const T>(raw_data(), width(), height(), pitch());
+  }
+  T *row(const int y) { return view().row(y); }
+  const T *row(const int y) const { return view().row(y); }
 };
 
+namespace detail {
+template <typename T>
+using ImageStorage = align_utils::PageAlignedVector<T>;
+
+// Number of elements allocated for rows of pitch pixels, rounded up to whole
+// cache lines
+template <typename T>
+size_t storage_elements(const int pitch, const int height) {
+  const size_t cache_line = 64;
+  const size_t bytes = static_cast<size_t>(pitch) * height * sizeof(T);
+  return ((bytes + cache_line - 1) / cache_line) * cache_line / sizeof(T);
+}
+
+template <typename T>
+void copy_rows(const ImageView<const T> &source,
+               const ImageView<T> &destination) {
+  for (int y = 0; y < source.height(); ++y) {
+    std::copy(source.row(y), source.row(y) + source.width(),
+              destination.row(y));
+  }
+}
+
+template <typename T> std::vector<T> packed_rows(const ImageView<const T> &v) {
+  std::vector<T> pixels(static_cast<size_t>(v.width()) * v.height());
+  copy_rows(v, ImageView<T>(pixels.data(), v.width(), v.height(), v.width()));
+  return pixels;
+}
+
+template <typename T>
+bool equal_rows(const ImageView<const T> &lhs, const ImageView<const T> &rhs) {
+  if (lhs.width() != rhs.width() || lhs.height() != rhs.height()) {
+    return false;
+  }
+  for (int y = 0; y < lhs.height(); ++y) {
+    if (!std::equal(lhs.row(y), lhs.row(y) + lhs.width(), rhs.row(y))) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace detail
+
 template <typename T> class ImagePNG : public Image<T> {
 public:
   ImagePNG();
   ImagePNG(const std::string &image_path);
   ImagePNG(const int width, const int height);
+  ImagePNG(const int width, const int height, const int pitch);
   ImagePNG(const int width, const int height, const std::vector<T> &data);
   bool read(const std::string &image_path) override;
+  bool read_info(const std::string &image_path) override;
+  bool read(const std::string &image_path, T *data) override;
   bool write(const std::string &image_path) override;
   bool write(const std::string &image_path, const T *data) override;
   int width() const override;
@@ -56,13 +146,18 @@ public:
   void copy_raw_data(const T *data) override;
   T *raw_data() override;
   const T *raw_data() const override;
+  int pitch() const override;
+  int storage_size_in_bytes() const override;
 
   bool operator==(const ImagePNG &rhs) const;
 
 private:
-  std::vector<T> pixels_;
+  void allocate();
+
+  detail::ImageStorage<T> pixels_;
   int width_;
   int height_;
+  int pitch_;
 };
 
 typedef ImagePNG<uint32_t> ImagePNG32Bit;
@@ -72,8 +167,11 @@ public:
   ImageBMP();
   ImageBMP(const std::string &image_path);
   ImageBMP(const int width, const int height);
+  ImageBMP(const int width, const int height, const int pitch);
   ImageBMP(const int width, const int height, const std::vector<T> &data);
   bool read(const std::string &image_path) override;
+  bool read_info(const std::string &image_path) override;
+  bool read(const std::string &image_path, T *data) override;
   bool write(const std::string &image_path) override;
   bool write(const std::string &image_path, const T *data) override;
   int width() const override;
@@ -89,18 +187,79 @@ public:
   void copy_raw_data(const T *data) override;
   T *raw_data() override;
   const T *raw_data() const override;
+  int pitch() const override;
+  int storage_size_in_bytes() const override;
 
   bool operator==(const ImageBMP &rhs) const;
 
 private:
-  std::vector<T> pixels_;
+  void allocate();
+
+  detail::ImageStorage<T> pixels_;
   int width_;
   int height_;
+  int pitch_;
 };
 
 typedef ImageBMP<uint8_t> ImageBMP8Bit;
 typedef ImageBMP<uint32_t> ImageBMP32Bit;
 
+// Channel order of pixels stored in ImageRaw files
+enum class RawLayout : uint32_t {
+  gray8 = 1,
+  rgba8 = 2, // packed as 0xRRGGBBAA, like ImagePNG32Bit
+  argb8 = 3  // packed as 0xAARRGGBB, like ImageBMP32Bit
+};
+
+// Uncompressed image with a small header holding width, height, pitch,
+// channel layout and a checksum of the pixel data. Files are written with a
+// single write and read through a memory mapping, so loading costs one copy.
+template <typename T> class ImageRaw : public Image<T> {
+public:
+  ImageRaw();
+  ImageRaw(const std::string &image_path);
+  ImageRaw(const int width, const int height);
+  ImageRaw(const int width, const int height, const int pitch);
+  ImageRaw(const int width, const int height, const std::vector<T> &data);
+  bool read(const std::string &image_path) override;
+  bool read_info(const std::string &image_path) override;
+  bool read(const std::string &image_path, T *data) override;
+  bool write(const std::string &image_path) override;
+  bool write(const std::string &image_path, const T *data) override;
+  int width() const override;
+  int height() const override;
+  int number_of_channels() const override;
+  int bits_per_channel() const override;
+  int bits_per_pixel() const override;
+  int size() const override;
+  int size_in_bytes() const override;
+  T get_pixel(const int x, const int y) const override;
+  void set_pixel(const int x, const int y, const T data) override;
+  std::vector<T> get_pixels() const override;
+  void copy_raw_data(const T *data) override;
+  T *raw_data() override;
+  const T *raw_data() const override;
+  int pitch() const override;
+  int storage_size_in_bytes() const override;
+
+  RawLayout layout() const;
+  void set_layout(const RawLayout layout);
+
+  bool operator==(const ImageRaw &rhs) const;
+
+private:
+  void allocate();
+
+  detail::ImageStorage<T> pixels_;
+  int width_;
+  int height_;
+  int pitch_;
+  RawLayout layout_;
+};
+
+typedef ImageRaw<uint8_t> ImageRaw8Bit;
+typedef ImageRaw<uint32_t> ImageRaw32Bit;
+
 template <typename T> int size_in_bytes(const Image<T> &i) {
   return i.size_in_bytes();
 }
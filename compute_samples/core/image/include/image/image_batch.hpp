@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_IMAGE_BATCH_HPP
+#define COMPUTE_SAMPLES_IMAGE_BATCH_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "image/image.hpp"
+#include "utils/thread_pool.hpp"
+
+namespace compute_samples {
+
+// Decodes and encodes many PNG images concurrently.
+// Every image is still handled by a single thread, so the speed-up comes
+// from overlapping independent images. Submission blocks while the pixels of
+// queued and running requests exceed max_bytes_in_flight, which bounds memory
+// used by work that has not completed yet. Completed images are owned by the
+// returned futures, so callers streaming large batches should consume them
+// while submitting.
+class ImageBatchIO {
+public:
+  // Zero threads selects the number of hardware threads
+  explicit ImageBatchIO(const int thread_count = 0,
+                        const size_t max_bytes_in_flight = 256 << 20);
+
+  ImageBatchIO(const ImageBatchIO &) = delete;
+  ImageBatchIO &operator=(const ImageBatchIO &) = delete;
+
+  std::future<ImagePNG32Bit> read_png(const std::string &image_path);
+  std::vector<std::future<ImagePNG32Bit>>
+  read_png(const std::vector<std::string> &image_paths);
+
+  std::future<void> write_png(const std::string &image_path,
+                              ImagePNG32Bit image);
+  std::vector<std::future<void>>
+  write_png(const std::vector<std::string> &image_paths,
+            std::vector<ImagePNG32Bit> images);
+
+  int thread_count() const;
+  size_t max_bytes_in_flight() const;
+
+private:
+  void acquire(const size_t bytes);
+  void release(const size_t bytes);
+
+  const size_t max_bytes_in_flight_;
+  size_t bytes_in_flight_ = 0;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  ThreadPool pool_;
+};
+
+} // namespace compute_samples
+
+#endif
@@ -7,12 +7,52 @@
 
 #include "image/image.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+
 #include <boost/gil/extension/io/png.hpp>
 #include <boost/gil/extension/io/bmp.hpp>
+#include <boost/predef/other/endian.h>
 namespace gil = boost::gil;
 
 namespace compute_samples {
-template <typename T> ImagePNG<T>::ImagePNG() : width_(0), height_(0) {}
+namespace {
+// Rows decoded at once when pixels need an intermediate buffer
+const int strip_rows = 64;
+
+// Pixel layouts matching the memory order of packed 32-bit pixels, so that
+// codecs can read and write rows in place
+#if BOOST_ENDIAN_LITTLE_BYTE
+typedef gil::abgr8_pixel_t rgba32_pixel_t;
+typedef gil::bgra8_pixel_t argb32_pixel_t;
+#else
+typedef gil::rgba8_pixel_t rgba32_pixel_t;
+typedef gil::argb8_pixel_t argb32_pixel_t;
+#endif
+
+template <typename Pixel, typename T>
+typename gil::type_from_x_iterator<Pixel *>::view_t
+packed_view(T *data, const int width, const int height, const int pitch) {
+  return gil::interleaved_view(width, height, reinterpret_cast<Pixel *>(data),
+                               pitch * sizeof(T));
+}
+
+template <typename Pixel, typename T>
+typename gil::type_from_x_iterator<Pixel *>::view_t
+packed_view(T *data, const int width, const int height) {
+  return packed_view<Pixel>(data, width, height, width);
+}
+
+int checked_pitch(const int width, const int pitch) {
+  if (pitch < width) {
+    throw std::invalid_argument("Image pitch is smaller than its width");
+  }
+  return pitch;
+}
+} // namespace
+
+template <typename T>
+ImagePNG<T>::ImagePNG() : width_(0), height_(0), pitch_(0) {}
 
 template <typename T> ImagePNG<T>::ImagePNG(const std::string &image_path) {
   read(image_path);
@@ -20,43 +60,58 @@ template <typename T> ImagePNG<T>::ImagePNG(const std::string &image_path) {
 
 template <typename T>
 ImagePNG<T>::ImagePNG(const int width, const int height)
-    : width_(width), height_(height) {
-  pixels_.resize(size());
+    : width_(width), height_(height), pitch_(width) {
+  allocate();
+}
+
+template <typename T>
+ImagePNG<T>::ImagePNG(const int width, const int height, const int pitch)
+    : width_(width), height_(height), pitch_(checked_pitch(width, pitch)) {
+  allocate();
 }
 
 template <typename T>
 ImagePNG<T>::ImagePNG(const int width, const int height,
                       const std::vector<T> &data)
-    : width_(width), height_(height), pixels_(data) {}
+    : width_(width), height_(height), pitch_(width) {
+  allocate();
+  std::copy(data.begin(), data.begin() + std::min<size_t>(data.size(), size()),
+            pixels_.begin());
+}
 
-template <> bool ImagePNG<uint32_t>::read(const std::string &image_path) {
-  gil::rgba8_image_t image;
-  gil::read_and_convert_image(image_path, image, gil::png_tag());
-  gil::rgba8_view_t view = gil::view(image);
-  for (gil::rgba8_pixel_t pixel : view) {
-    uint32_t raw_pixel =
-        (pixel[0] << 24) + (pixel[1] << 16) + (pixel[2] << 8) + pixel[3];
-    pixels_.push_back(raw_pixel);
-  }
-  width_ = static_cast<int>(view.width());
-  height_ = static_cast<int>(view.height());
+template <typename T> void ImagePNG<T>::allocate() {
+  pixels_.assign(detail::storage_elements<T>(pitch_, height_), T());
+}
+
+template <typename T>
+bool ImagePNG<T>::read_info(const std::string &image_path) {
+  const auto info = gil::read_image_info(image_path, gil::png_tag());
+  width_ = static_cast<int>(info._info._width);
+  height_ = static_cast<int>(info._info._height);
+  return false;
+}
+
+template <>
+bool ImagePNG<uint32_t>::read(const std::string &image_path, uint32_t *data) {
+  read_info(image_path);
+  gil::read_and_convert_view(
+      image_path, packed_view<rgba32_pixel_t>(data, width(), height()),
+      gil::png_tag());
   return false;
 }
 
+template <> bool ImagePNG<uint32_t>::read(const std::string &image_path) {
+  read_info(image_path);
+  pitch_ = width_;
+  allocate();
+  return read(image_path, pixels_.data());
+}
+
 template <> bool ImagePNG<uint32_t>::write(const std::string &image_path) {
-  gil::rgba8_image_t image(width(), height());
-  std::vector<gil::rgba8_pixel_t> channels;
-  const gil::rgba8_view_t &view = gil::view(image);
-  for (int id = 0; id < static_cast<int>(pixels_.size()); ++id) {
-    uint32_t raw_pixel = pixels_[id];
-    gil::rgba8_pixel_t pixel;
-    pixel[3] = raw_pixel & 0xFF;
-    pixel[2] = (raw_pixel >> 8) & 0xFF;
-    pixel[1] = (raw_pixel >> 16) & 0xFF;
-    pixel[0] = (raw_pixel >> 24) & 0xFF;
-    view[id] = pixel;
-  }
-  gil::write_view(image_path, view, gil::png_tag());
+  gil::write_view(image_path,
+                  packed_view<const rgba32_pixel_t>(pixels_.data(), width(),
+                                                    height(), pitch()),
+                  gil::png_tag());
   return false;
 }
 
@@ -85,25 +140,25 @@ template <typename T> int ImagePNG<T>::size() const {
 }
 
 template <typename T> int ImagePNG<T>::size_in_bytes() const {
-  return static_cast<int>(pixels_.size() * sizeof(T));
+  return static_cast<int>(static_cast<size_t>(pitch_) * height_ * sizeof(T));
 }
 
 template <typename T> T ImagePNG<T>::get_pixel(const int x, const int y) const {
-  return pixels_[y * width() + x];
+  return pixels_[y * pitch_ + x];
 }
 
 template <typename T>
 void ImagePNG<T>::set_pixel(const int x, const int y, const T data) {
-  pixels_[y * width() + x] = data;
+  pixels_[y * pitch_ + x] = data;
 }
 
-template <typename T>
-std::vector<T> compute_samples::ImagePNG<T>::get_pixels() const {
-  return pixels_;
+template <typename T> std::vector<T> ImagePNG<T>::get_pixels() const {
+  return detail::packed_rows(this->view());
 }
 
 template <typename T> void ImagePNG<T>::copy_raw_data(const T *data) {
-  std::copy(data, data + size(), std::begin(pixels_));
+  detail::copy_rows(ImageView<const T>(data, width_, height_, width_),
+                    this->view());
 }
 
 template <typename T> T *ImagePNG<T>::raw_data() { return pixels_.data(); }
@@ -112,14 +167,21 @@ template <typename T> const T *ImagePNG<T>::raw_data() const {
   return pixels_.data();
 }
 
+template <typename T> int ImagePNG<T>::pitch() const { return pitch_; }
+
+template <typename T> int ImagePNG<T>::storage_size_in_bytes() const {
+  return static_cast<int>(pixels_.size() * sizeof(T));
+}
+
 template <typename T>
 bool ImagePNG<T>::operator==(const ImagePNG<T> &rhs) const {
-  return pixels_ == rhs.pixels_;
+  return detail::equal_rows(this->view(), rhs.view());
 }
 
 template class ImagePNG<uint32_t>;
 
-template <typename T> ImageBMP<T>::ImageBMP() : width_(0), height_(0) {}
+template <typename T>
+ImageBMP<T>::ImageBMP() : width_(0), height_(0), pitch_(0) {}
 
 template <typename T> ImageBMP<T>::ImageBMP(const std::string &image_path) {
   read(image_path);
@@ -127,73 +189,94 @@ template <typename T> ImageBMP<T>::ImageBMP(const std::string &image_path) {
 
 template <typename T>
 ImageBMP<T>::ImageBMP(const int width, const int height)
-    : width_(width), height_(height) {
-  pixels_.resize(size());
+    : width_(width), height_(height), pitch_(width) {
+  allocate();
+}
+
+template <typename T>
+ImageBMP<T>::ImageBMP(const int width, const int height, const int pitch)
+    : width_(width), height_(height), pitch_(checked_pitch(width, pitch)) {
+  allocate();
 }
 
 template <typename T>
 ImageBMP<T>::ImageBMP(const int width, const int height,
                       const std::vector<T> &data)
-    : width_(width), height_(height), pixels_(data) {}
+    : width_(width), height_(height), pitch_(width) {
+  allocate();
+  std::copy(data.begin(), data.begin() + std::min<size_t>(data.size(), size()),
+            pixels_.begin());
+}
 
-template <typename T> bool ImageBMP<T>::read(const std::string &image_path) {
-  gil::argb8_image_t image;
-  gil::read_and_convert_image(image_path, image, gil::bmp_tag());
-  gil::argb8_view_t view = gil::view(image);
-  for (gil::argb8_pixel_t pixel : view) {
-    uint32_t raw_pixel =
-        (pixel[0] << 24) + (pixel[1] << 16) + (pixel[2] << 8) + pixel[3];
-    pixels_.push_back(raw_pixel);
-  }
-  width_ = static_cast<int>(view.width());
-  height_ = static_cast<int>(view.height());
+template <typename T> void ImageBMP<T>::allocate() {
+  pixels_.assign(detail::storage_elements<T>(pitch_, height_), T());
+}
+
+template <typename T>
+bool ImageBMP<T>::read_info(const std::string &image_path) {
+  const auto info = gil::read_image_info(image_path, gil::bmp_tag());
+  width_ = static_cast<int>(info._info._width);
+  height_ = static_cast<int>(info._info._height);
   return false;
 }
 
-template <> bool ImageBMP<uint8_t>::read(const std::string &image_path) {
-  gil::argb8_image_t image;
-  gil::read_and_convert_image(image_path, image, gil::bmp_tag());
-  gil::argb8_view_t view = gil::view(image);
-  for (gil::argb8_pixel_t pixel : view) {
-    uint8_t raw_pixel = pixel[1];
-    pixels_.push_back(raw_pixel);
+template <typename T>
+bool ImageBMP<T>::read(const std::string &image_path, T *data) {
+  read_info(image_path);
+  gil::read_and_convert_view(
+      image_path, packed_view<argb32_pixel_t>(data, width(), height()),
+      gil::bmp_tag());
+  return false;
+}
+
+template <>
+bool ImageBMP<uint8_t>::read(const std::string &image_path, uint8_t *data) {
+  // The file is opened once and its header read once for all strips
+  typedef gil::detail::read_and_convert<gil::default_color_converter>
+      read_and_convert_t;
+  auto reader = gil::make_reader(image_path,
+                                 gil::image_read_settings<gil::bmp_tag>(),
+                                 read_and_convert_t());
+  width_ = static_cast<int>(reader._info._width);
+  height_ = static_cast<int>(reader._info._height);
+  // Only the red channel is kept, so rows are decoded into a small strip
+  gil::argb8_image_t strip(width(), std::min(strip_rows, height()));
+  for (int y = 0; y < height(); y += strip_rows) {
+    const int rows = std::min(strip_rows, height() - y);
+    reader._settings = gil::image_read_settings<gil::bmp_tag>(
+        gil::point_t(0, y), gil::point_t(width(), rows));
+    const gil::argb8_view_t strip_view =
+        gil::subimage_view(gil::view(strip), 0, 0, width(), rows);
+    gil::read_and_convert_view(reader, strip_view);
+    gil::copy_pixels(gil::nth_channel_view(strip_view, 1),
+                     packed_view<gil::gray8_pixel_t>(
+                         data + static_cast<size_t>(y) * width(), width(),
+                         rows));
   }
-  width_ = static_cast<int>(view.width());
-  height_ = static_cast<int>(view.height());
   return false;
 }
 
+template <typename T> bool ImageBMP<T>::read(const std::string &image_path) {
+  read_info(image_path);
+  pitch_ = width_;
+  allocate();
+  return read(image_path, pixels_.data());
+}
+
 template <typename T> bool ImageBMP<T>::write(const std::string &image_path) {
-  gil::argb8_image_t image(width(), height());
-  std::vector<gil::argb8_pixel_t> channels;
-  const gil::argb8_view_t &view = gil::view(image);
-  for (int id = 0; id < static_cast<int>(pixels_.size()); ++id) {
-    uint32_t raw_pixel = pixels_[id];
-    gil::argb8_pixel_t pixel;
-    pixel[3] = raw_pixel & 0xFF;
-    pixel[2] = (raw_pixel >> 8) & 0xFF;
-    pixel[1] = (raw_pixel >> 16) & 0xFF;
-    pixel[0] = (raw_pixel >> 24) & 0xFF;
-    view[id] = pixel;
-  }
-  gil::write_view(image_path, view, gil::bmp_tag());
+  gil::write_view(image_path,
+                  packed_view<const argb32_pixel_t>(pixels_.data(), width(),
+                                                    height(), pitch()),
+                  gil::bmp_tag());
   return false;
 }
 
 template <> bool ImageBMP<uint8_t>::write(const std::string &image_path) {
-  gil::argb8_image_t image(width(), height());
-  std::vector<gil::argb8_pixel_t> channels;
-  const gil::argb8_view_t &view = gil::view(image);
-  for (int id = 0; id < static_cast<int>(pixels_.size()); ++id) {
-    uint32_t raw_pixel = pixels_[id];
-    gil::argb8_pixel_t pixel;
-    pixel[3] = raw_pixel & 0xFF;
-    pixel[2] = raw_pixel & 0xFF;
-    pixel[1] = raw_pixel & 0xFF;
-    pixel[0] = raw_pixel & 0xFF;
-    view[id] = pixel;
-  }
-  gil::write_view(image_path, view, gil::bmp_tag());
+  const auto gray_view = packed_view<const gil::gray8_pixel_t>(
+      pixels_.data(), width(), height(), pitch());
+  gil::write_view(image_path,
+                  gil::color_converted_view<gil::bgr8_pixel_t>(gray_view),
+                  gil::bmp_tag());
   return false;
 }
 
@@ -222,24 +305,25 @@ template <typename T> int ImageBMP<T>::size() const {
 }
 
 template <typename T> int ImageBMP<T>::size_in_bytes() const {
-  return static_cast<int>(pixels_.size() * sizeof(T));
+  return static_cast<int>(static_cast<size_t>(pitch_) * height_ * sizeof(T));
 }
 
 template <typename T> T ImageBMP<T>::get_pixel(const int x, const int y) const {
-  return pixels_[y * width() + x];
+  return pixels_[y * pitch_ + x];
 }
 
 template <typename T>
 void ImageBMP<T>::set_pixel(const int x, const int y, const T data) {
-  pixels_[y * width() + x] = data;
+  pixels_[y * pitch_ + x] = data;
 }
 
 template <typename T> std::vector<T> ImageBMP<T>::get_pixels() const {
-  return pixels_;
+  return detail::packed_rows(this->view());
 }
 
 template <typename T> void ImageBMP<T>::copy_raw_data(const T *data) {
-  std::copy(data, data + size(), std::begin(pixels_));
+  detail::copy_rows(ImageView<const T>(data, width_, height_, width_),
+                    this->view());
 }
 
 template <typename T> T *ImageBMP<T>::raw_data() { return pixels_.data(); }
@@ -248,8 +332,14 @@ template <typename T> const T *ImageBMP<T>::raw_data() const {
   return pixels_.data();
 }
 
+template <typename T> int ImageBMP<T>::pitch() const { return pitch_; }
+
+template <typename T> int ImageBMP<T>::storage_size_in_bytes() const {
+  return static_cast<int>(pixels_.size() * sizeof(T));
+}
+
 template <typename T> bool ImageBMP<T>::operator==(const ImageBMP &rhs) const {
-  return pixels_ == rhs.pixels_;
+  return detail::equal_rows(this->view(), rhs.view());
 }
 
 template class ImageBMP<uint8_t>;
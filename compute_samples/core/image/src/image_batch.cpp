@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "image/image_batch.hpp"
+#include "logging/logging.hpp"
+
+#include <stdexcept>
+
+namespace compute_samples {
+
+namespace {
+// Decoded size read from the header only. Unreadable files are charged
+// nothing here and report their error through the future instead.
+size_t png_size_in_bytes(const std::string &image_path) {
+  try {
+    ImagePNG32Bit header;
+    header.read_info(image_path);
+    return static_cast<size_t>(header.size()) * sizeof(uint32_t);
+  } catch (const std::exception &) {
+    return 0;
+  }
+}
+} // namespace
+
+ImageBatchIO::ImageBatchIO(const int thread_count,
+                           const size_t max_bytes_in_flight)
+    : max_bytes_in_flight_(max_bytes_in_flight), pool_(thread_count) {}
+
+std::future<ImagePNG32Bit>
+ImageBatchIO::read_png(const std::string &image_path) {
+  const size_t bytes = png_size_in_bytes(image_path);
+  acquire(bytes);
+  return pool_.submit([this, image_path, bytes]() {
+    try {
+      ImagePNG32Bit image(image_path);
+      release(bytes);
+      return image;
+    } catch (...) {
+      release(bytes);
+      throw;
+    }
+  });
+}
+
+std::vector<std::future<ImagePNG32Bit>>
+ImageBatchIO::read_png(const std::vector<std::string> &image_paths) {
+  std::vector<std::future<ImagePNG32Bit>> images;
+  images.reserve(image_paths.size());
+  for (const std::string &image_path : image_paths) {
+    images.push_back(read_png(image_path));
+  }
+  return images;
+}
+
+std::future<void> ImageBatchIO::write_png(const std::string &image_path,
+                                          ImagePNG32Bit image) {
+  const size_t bytes = static_cast<size_t>(image.size_in_bytes());
+  acquire(bytes);
+  return pool_.submit(
+      [this, image_path, bytes, image = std::move(image)]() mutable {
+        try {
+          image.write(image_path);
+          release(bytes);
+        } catch (...) {
+          release(bytes);
+          throw;
+        }
+      });
+}
+
+std::vector<std::future<void>>
+ImageBatchIO::write_png(const std::vector<std::string> &image_paths,
+                        std::vector<ImagePNG32Bit> images) {
+  if (image_paths.size() != images.size()) {
+    throw std::invalid_argument(
+        "Number of image paths does not match number of images");
+  }
+  std::vector<std::future<void>> results;
+  results.reserve(images.size());
+  for (size_t i = 0; i < images.size(); ++i) {
+    results.push_back(write_png(image_paths[i], std::move(images[i])));
+  }
+  return results;
+}
+
+int ImageBatchIO::thread_count() const { return pool_.size(); }
+
+size_t ImageBatchIO::max_bytes_in_flight() const {
+  return max_bytes_in_flight_;
+}
+
+void ImageBatchIO::acquire(const size_t bytes) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // A request larger than the whole budget runs alone instead of waiting
+  // forever
+  condition_.wait(lock, [this, bytes] {
+    return bytes_in_flight_ == 0 ||
+           bytes_in_flight_ + bytes <= max_bytes_in_flight_;
+  });
+  bytes_in_flight_ += bytes;
+  LOG_TRACE << "Bytes in flight: " << bytes_in_flight_;
+}
+
+void ImageBatchIO::release(const size_t bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bytes_in_flight_ -= bytes;
+  }
+  condition_.notify_all();
+}
+
+} // namespace compute_samples
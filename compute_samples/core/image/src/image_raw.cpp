@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "image/image.hpp"
+#include "utils/mapped_file.hpp"
+#include "logging/logging.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace compute_samples {
+
+namespace {
+const char raw_magic[8] = {'C', 'S', 'R', 'A', 'W', 'I', 'M', 'G'};
+const uint32_t raw_version = 1;
+// Pixel data starts at a cache line boundary of the mapping
+const uint32_t raw_data_offset = 64;
+
+// Stored in host byte order, which is little-endian on all supported targets
+struct RawHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t layout;
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch;
+  uint32_t bits_per_pixel;
+  uint32_t data_offset;
+  uint32_t reserved;
+  uint64_t checksum;
+};
+static_assert(sizeof(RawHeader) <= raw_data_offset,
+              "Raw image header overlaps pixel data");
+
+// Fletcher-64 over 32-bit words, with a partial last word padded with zeros
+uint64_t raw_checksum(const uint8_t *data, const size_t size) {
+  const uint64_t modulus = 0xFFFFFFFFu;
+  // Largest number of words which cannot overflow the sums between reductions
+  const size_t block_words = 92679;
+  const size_t words = size / sizeof(uint32_t);
+  uint64_t sum1 = 0;
+  uint64_t sum2 = 0;
+  for (size_t i = 0; i < words;) {
+    const size_t end = std::min(words, i + block_words);
+    for (; i < end; ++i) {
+      uint32_t word = 0;
+      std::memcpy(&word, data + i * sizeof(uint32_t), sizeof(word));
+      sum1 += word;
+      sum2 += sum1;
+    }
+    sum1 %= modulus;
+    sum2 %= modulus;
+  }
+  const size_t tail = size % sizeof(uint32_t);
+  if (tail != 0) {
+    uint32_t word = 0;
+    std::memcpy(&word, data + words * sizeof(uint32_t), tail);
+    sum1 = (sum1 + word) % modulus;
+    sum2 = (sum2 + sum1) % modulus;
+  }
+  return (sum2 << 32) | sum1;
+}
+
+bool read_header(const MappedFile &file, const std::string &image_path,
+                 const int bits_per_pixel, RawHeader &header) {
+  if (file.size() < sizeof(header)) {
+    LOG_ERROR << "Raw image is too small: " << image_path;
+    return false;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, raw_magic, sizeof(raw_magic)) != 0 ||
+      header.version != raw_version) {
+    LOG_ERROR << "Not a supported raw image: " << image_path;
+    return false;
+  }
+  if (header.bits_per_pixel != static_cast<uint32_t>(bits_per_pixel)) {
+    LOG_ERROR << "Raw image has " << header.bits_per_pixel
+              << " bits per pixel, expected " << bits_per_pixel << ": "
+              << image_path;
+    return false;
+  }
+  const uint64_t row_size =
+      static_cast<uint64_t>(header.width) * header.bits_per_pixel / 8;
+  const uint64_t data_size =
+      static_cast<uint64_t>(header.pitch) * header.height;
+  if (header.pitch < row_size || header.width > INT32_MAX ||
+      header.height > INT32_MAX || header.data_offset < sizeof(header) ||
+      header.data_offset + data_size > file.size()) {
+    LOG_ERROR << "Raw image header does not match file size: " << image_path;
+    return false;
+  }
+  return true;
+}
+
+// Copies rows of the mapped pixel data of a checked header to the data,
+// dropping the padding of the pitch
+template <typename T>
+bool read_pixels(const MappedFile &file, const std::string &image_path,
+                 const RawHeader &header, T *data) {
+  const uint8_t *source = file.data() + header.data_offset;
+  const size_t data_size = static_cast<size_t>(header.pitch) * header.height;
+  if (raw_checksum(source, data_size) != header.checksum) {
+    LOG_ERROR << "Raw image checksum mismatch: " << image_path;
+    return false;
+  }
+
+  const size_t row_size = static_cast<size_t>(header.width) * sizeof(T);
+  if (header.pitch == row_size) {
+    std::memcpy(data, source, data_size);
+  } else {
+    for (uint32_t y = 0; y < header.height; ++y) {
+      std::memcpy(data + static_cast<size_t>(y) * header.width,
+                  source + static_cast<size_t>(y) * header.pitch, row_size);
+    }
+  }
+  return true;
+}
+
+template <typename T> RawLayout default_layout() { return RawLayout::rgba8; }
+template <> RawLayout default_layout<uint8_t>() { return RawLayout::gray8; }
+} // namespace
+
+template <typename T>
+ImageRaw<T>::ImageRaw()
+    : width_(0), height_(0), pitch_(0), layout_(default_layout<T>()) {}
+
+template <typename T>
+ImageRaw<T>::ImageRaw(const std::string &image_path)
+    : width_(0), height_(0), pitch_(0), layout_(default_layout<T>()) {
+  if (read(image_path)) {
+    throw std::runtime_error("Failed to read raw image: " + image_path);
+  }
+}
+
+template <typename T>
+ImageRaw<T>::ImageRaw(const int width, const int height)
+    : width_(width), height_(height), pitch_(width),
+      layout_(default_layout<T>()) {
+  allocate();
+}
+
+template <typename T>
+ImageRaw<T>::ImageRaw(const int width, const int height, const int pitch)
+    : width_(width), height_(height), pitch_(pitch),
+      layout_(default_layout<T>()) {
+  if (pitch < width) {
+    throw std::invalid_argument("Image pitch is smaller than its width");
+  }
+  allocate();
+}
+
+template <typename T>
+ImageRaw<T>::ImageRaw(const int width, const int height,
+                      const std::vector<T> &data)
+    : width_(width), height_(height), pitch_(width),
+      layout_(default_layout<T>()) {
+  allocate();
+  std::copy(data.begin(), data.begin() + std::min<size_t>(data.size(), size()),
+            pixels_.begin());
+}
+
+template <typename T> void ImageRaw<T>::allocate() {
+  pixels_.assign(detail::storage_elements<T>(pitch_, height_), T());
+}
+
+template <typename T>
+bool ImageRaw<T>::read_info(const std::string &image_path) {
+  MappedFile file;
+  RawHeader header = {};
+  if (!file.open(image_path) ||
+      !read_header(file, image_path, bits_per_pixel(), header)) {
+    return true;
+  }
+  width_ = static_cast<int>(header.width);
+  height_ = static_cast<int>(header.height);
+  layout_ = static_cast<RawLayout>(header.layout);
+  return false;
+}
+
+template <typename T>
+bool ImageRaw<T>::read(const std::string &image_path, T *data) {
+  MappedFile file;
+  RawHeader header = {};
+  if (!file.open(image_path) ||
+      !read_header(file, image_path, bits_per_pixel(), header)) {
+    return true;
+  }
+  width_ = static_cast<int>(header.width);
+  height_ = static_cast<int>(header.height);
+  layout_ = static_cast<RawLayout>(header.layout);
+  return !read_pixels(file, image_path, header, data);
+}
+
+// Maps the file once for its header and its pixels
+template <typename T> bool ImageRaw<T>::read(const std::string &image_path) {
+  MappedFile file;
+  RawHeader header = {};
+  if (!file.open(image_path) ||
+      !read_header(file, image_path, bits_per_pixel(), header)) {
+    return true;
+  }
+  width_ = static_cast<int>(header.width);
+  height_ = static_cast<int>(header.height);
+  layout_ = static_cast<RawLayout>(header.layout);
+  pitch_ = width_;
+  allocate();
+  return !read_pixels(file, image_path, header, pixels_.data());
+}
+
+template <typename T> bool ImageRaw<T>::write(const std::string &image_path) {
+  const size_t data_size = static_cast<size_t>(size_in_bytes());
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(pixels_.data());
+
+  std::vector<uint8_t> header_block(raw_data_offset, 0);
+  RawHeader header = {};
+  std::memcpy(header.magic, raw_magic, sizeof(raw_magic));
+  header.version = raw_version;
+  header.layout = static_cast<uint32_t>(layout_);
+  header.width = static_cast<uint32_t>(width_);
+  header.height = static_cast<uint32_t>(height_);
+  header.pitch = static_cast<uint32_t>(pitch_ * sizeof(T));
+  header.bits_per_pixel = static_cast<uint32_t>(bits_per_pixel());
+  header.data_offset = raw_data_offset;
+  header.checksum = raw_checksum(data, data_size);
+  std::memcpy(header_block.data(), &header, sizeof(header));
+
+  std::ofstream stream(image_path, std::ios::binary);
+  if (!stream.good()) {
+    LOG_ERROR << "Failed to open file: " << image_path;
+    return true;
+  }
+  stream.write(reinterpret_cast<const char *>(header_block.data()),
+               header_block.size());
+  stream.write(reinterpret_cast<const char *>(data), data_size);
+  if (!stream.good()) {
+    LOG_ERROR << "Failed to write file: " << image_path;
+    return true;
+  }
+  return false;
+}
+
+template <typename T>
+bool ImageRaw<T>::write(const std::string &image_path, const T *data) {
+  copy_raw_data(data);
+  return write(image_path);
+}
+
+template <typename T> int ImageRaw<T>::width() const { return width_; }
+
+template <typename T> int ImageRaw<T>::height() const { return height_; }
+
+template <typename T> int ImageRaw<T>::number_of_channels() const {
+  return bits_per_pixel() / bits_per_channel();
+}
+
+template <typename T> int ImageRaw<T>::bits_per_channel() const { return 8; }
+
+template <typename T> int ImageRaw<T>::bits_per_pixel() const {
+  return std::numeric_limits<T>::digits;
+}
+
+template <typename T> int ImageRaw<T>::size() const {
+  return width() * height();
+}
+
+template <typename T> int ImageRaw<T>::size_in_bytes() const {
+  return static_cast<int>(static_cast<size_t>(pitch_) * height_ * sizeof(T));
+}
+
+template <typename T> T ImageRaw<T>::get_pixel(const int x, const int y) const {
+  return pixels_[y * pitch_ + x];
+}
+
+template <typename T>
+void ImageRaw<T>::set_pixel(const int x, const int y, const T data) {
+  pixels_[y * pitch_ + x] = data;
+}
+
+template <typename T> std::vector<T> ImageRaw<T>::get_pixels() const {
+  return detail::packed_rows(this->view());
+}
+
+template <typename T> void ImageRaw<T>::copy_raw_data(const T *data) {
+  detail::copy_rows(ImageView<const T>(data, width_, height_, width_),
+                    this->view());
+}
+
+template <typename T> T *ImageRaw<T>::raw_data() { return pixels_.data(); }
+
+template <typename T> const T *ImageRaw<T>::raw_data() const {
+  return pixels_.data();
+}
+
+template <typename T> int ImageRaw<T>::pitch() const { return pitch_; }
+
+template <typename T> int ImageRaw<T>::storage_size_in_bytes() const {
+  return static_cast<int>(pixels_.size() * sizeof(T));
+}
+
+template <typename T> RawLayout ImageRaw<T>::layout() const { return layout_; }
+
+template <typename T> void ImageRaw<T>::set_layout(const RawLayout layout) {
+  layout_ = layout;
+}
+
+template <typename T> bool ImageRaw<T>::operator==(const ImageRaw &rhs) const {
+  return layout_ == rhs.layout_ && detail::equal_rows(this->view(), rhs.view());
+}
+
+template class ImageRaw<uint8_t>;
+template class ImageRaw<uint32_t>;
+
+} // namespace compute_samples
@@ -6,9 +6,12 @@
  */
 
 #include "image/image.hpp"
+#include "image/image_batch.hpp"
 #include "gtest/gtest.h"
 #include "logging/logging.hpp"
 
+#include <fstream>
+
 TEST(ImageIntegrationTests, ReadsPNGFile) {
   compute_samples::ImagePNG32Bit image("rgb_brg_3x2.png");
   const std::vector<uint32_t> pixels = {
@@ -114,3 +117,167 @@ TEST(ImageIntegrationTests, WritesColorBMPFile) {
 
   EXPECT_EQ(image.get_pixels(), pixels);
 }
+
+TEST(ImageIntegrationTests, ReadsPNGFileIntoBuffer) {
+  compute_samples::ImagePNG32Bit image;
+  image.read_info("rgb_brg_3x2.png");
+  ASSERT_EQ(image.width(), 3);
+  ASSERT_EQ(image.height(), 2);
+
+  std::vector<uint32_t> data(image.size());
+  image.read("rgb_brg_3x2.png", data.data());
+  const std::vector<uint32_t> pixels = {
+      0xFF0000FF, //
+      0x00FF00FF, //
+      0x0000FFFF, //
+      0x0000FFFF, //
+      0xFF0000FF, //
+      0x00FF00FF  //
+  };
+  EXPECT_EQ(data, pixels);
+}
+
+TEST(ImageIntegrationTests, WritesTallGrayscaleBMPFile) {
+  const int width = 5;
+  const int height = 150;
+  std::vector<uint8_t> pixels(width * height);
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = static_cast<uint8_t>(i * 7);
+  }
+  compute_samples::ImageBMP8Bit image(width, height);
+  image.write("output.bmp", pixels.data());
+
+  compute_samples::ImageBMP8Bit output("output.bmp");
+  EXPECT_EQ(output.get_pixels(), pixels);
+  if (std::remove("output.bmp") != 0) {
+    LOG_DEBUG << "Deleting file output.bmp failed";
+  }
+}
+
+TEST(ImageIntegrationTests, ReadsPNGFilesInBatch) {
+  compute_samples::ImageBatchIO batch(4);
+  const std::vector<std::string> paths(8, "rgb_brg_3x2.png");
+  const compute_samples::ImagePNG32Bit reference("rgb_brg_3x2.png");
+  for (std::future<compute_samples::ImagePNG32Bit> &image :
+       batch.read_png(paths)) {
+    EXPECT_EQ(image.get(), reference);
+  }
+}
+
+TEST(ImageIntegrationTests, WritesPNGFilesInBatch) {
+  // Budget of a single image forces requests to wait for each other
+  compute_samples::ImageBatchIO batch(4, 3 * 2 * sizeof(uint32_t));
+  std::vector<std::string> paths;
+  std::vector<compute_samples::ImagePNG32Bit> images;
+  for (uint32_t i = 0; i < 8; ++i) {
+    paths.push_back("output" + std::to_string(i) + ".png");
+    images.emplace_back(3, 2, std::vector<uint32_t>(6, 0x01020300 + i));
+  }
+  const std::vector<compute_samples::ImagePNG32Bit> expected = images;
+  for (std::future<void> &result : batch.write_png(paths, images)) {
+    result.get();
+  }
+
+  std::vector<std::future<compute_samples::ImagePNG32Bit>> outputs =
+      batch.read_png(paths);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    EXPECT_EQ(outputs[i].get(), expected[i]);
+    if (std::remove(paths[i].c_str()) != 0) {
+      LOG_DEBUG << "Deleting file " << paths[i] << " failed";
+    }
+  }
+}
+
+TEST(ImageIntegrationTests, BatchReadReportsMissingFile) {
+  compute_samples::ImageBatchIO batch(2);
+  std::future<compute_samples::ImagePNG32Bit> image =
+      batch.read_png("not_existing_file.png");
+  EXPECT_ANY_THROW(image.get());
+}
+
+TEST(ImageIntegrationTests, WritesColorRawFile) {
+  const std::vector<uint32_t> pixels = {
+      0xFF0000FF, //
+      0x00FF00FF, //
+      0x0000FFFF, //
+      0x0000FFFF, //
+      0xFF0000FF, //
+      0x00FF00FF  //
+  };
+  compute_samples::ImageRaw32Bit image(3, 2);
+  EXPECT_FALSE(image.write("output.raw", pixels.data()));
+
+  compute_samples::ImageRaw32Bit output("output.raw");
+  EXPECT_EQ(output.width(), 3);
+  EXPECT_EQ(output.height(), 2);
+  EXPECT_EQ(output.layout(), compute_samples::RawLayout::rgba8);
+  EXPECT_EQ(output.get_pixels(), pixels);
+  if (std::remove("output.raw") != 0) {
+    LOG_DEBUG << "Deleting file output.raw failed";
+  }
+}
+
+TEST(ImageIntegrationTests, ReadsGrayscaleRawFileIntoBuffer) {
+  const std::vector<uint8_t> pixels = {0x00, 0xFF, 0x00, 0xFF, 0xFF,
+                                       0xFF, 0x00, 0x00, 0x12};
+  compute_samples::ImageRaw8Bit image(3, 3, pixels);
+  EXPECT_FALSE(image.write("output.raw"));
+
+  compute_samples::ImageRaw8Bit output;
+  EXPECT_FALSE(output.read_info("output.raw"));
+  std::vector<uint8_t> data(output.size());
+  EXPECT_FALSE(output.read("output.raw", data.data()));
+  EXPECT_EQ(data, pixels);
+  if (std::remove("output.raw") != 0) {
+    LOG_DEBUG << "Deleting file output.raw failed";
+  }
+}
+
+TEST(ImageIntegrationTests, RejectsCorruptedRawFile) {
+  compute_samples::ImageRaw32Bit image(4, 4);
+  image.set_pixel(1, 2, 0x12345678);
+  EXPECT_FALSE(image.write("output.raw"));
+
+  std::fstream file("output.raw",
+                    std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(-1, std::ios::end);
+  file.put('\x01');
+  file.close();
+
+  compute_samples::ImageRaw32Bit output;
+  EXPECT_TRUE(output.read("output.raw"));
+  if (std::remove("output.raw") != 0) {
+    LOG_DEBUG << "Deleting file output.raw failed";
+  }
+}
+
+TEST(ImageIntegrationTests, RejectsRawFileWithDifferentPixelSize) {
+  compute_samples::ImageRaw8Bit image(4, 4);
+  EXPECT_FALSE(image.write("output.raw"));
+
+  compute_samples::ImageRaw32Bit output;
+  EXPECT_TRUE(output.read("output.raw"));
+  if (std::remove("output.raw") != 0) {
+    LOG_DEBUG << "Deleting file output.raw failed";
+  }
+}
+
+TEST(ImageIntegrationTests, WritesPitchedPNGFile) {
+  const std::vector<uint32_t> pixels = {
+      0xFF0000FF, //
+      0x00FF00FF, //
+      0x0000FFFF, //
+      0x0000FFFF, //
+      0xFF0000FF, //
+      0x00FF00FF  //
+  };
+  compute_samples::ImagePNG32Bit image(3, 2, 64);
+  image.write("output.png", pixels.data());
+
+  compute_samples::ImagePNG32Bit output("output.png");
+  EXPECT_EQ(output.pitch(), 3);
+  EXPECT_EQ(output.get_pixels(), pixels);
+  if (std::remove("output.png") != 0) {
+    LOG_DEBUG << "Deleting file output.png failed";
+  }
+}
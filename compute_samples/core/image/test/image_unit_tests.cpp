@@ -8,6 +8,10 @@
 #include "image/image.hpp"
 #include "gtest/gtest.h"
 
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
 TEST(ImagePNG32Bit, GetPixel) {
   const std::vector<uint32_t> pixels = {
       0xFF0000FF, //
@@ -122,7 +126,9 @@ TEST(ImageBMP8Bit, SetPixel) {
 template <typename T> class SizeInBytes : public testing::Test {};
 typedef testing::Types<compute_samples::ImagePNG32Bit,
                        compute_samples::ImageBMP8Bit,
-                       compute_samples::ImageBMP32Bit>
+                       compute_samples::ImageBMP32Bit,
+                       compute_samples::ImageRaw8Bit,
+                       compute_samples::ImageRaw32Bit>
     ImageTypes;
 TYPED_TEST_SUITE(SizeInBytes, ImageTypes);
 
@@ -140,3 +146,45 @@ TYPED_TEST(SizeInBytes, MultiplePixels) {
   const TypeParam image(2, 2);
   EXPECT_EQ(image.size_in_bytes(), compute_samples::size_in_bytes(image));
 }
+
+template <typename T> class PitchedStorage : public testing::Test {};
+TYPED_TEST_SUITE(PitchedStorage, ImageTypes);
+
+TYPED_TEST(PitchedStorage, DefaultPitchIsWidth) {
+  const TypeParam image(3, 2);
+  EXPECT_EQ(3, image.pitch());
+  EXPECT_EQ(image.raw_data() + 3, image.row(1));
+}
+
+TYPED_TEST(PitchedStorage, StorageIsPageAligned) {
+  const TypeParam image(5, 7);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(image.raw_data()) % 4096);
+  EXPECT_EQ(0, image.storage_size_in_bytes() % 64);
+  EXPECT_LE(image.size_in_bytes(), image.storage_size_in_bytes());
+}
+
+TYPED_TEST(PitchedStorage, RowsArePitchApart) {
+  TypeParam image(3, 2, 16);
+  EXPECT_EQ(16, image.pitch());
+  EXPECT_EQ(image.raw_data() + 16, image.row(1));
+  EXPECT_EQ(image.pitch() * image.height() *
+                static_cast<int>(sizeof(*image.raw_data())),
+            image.size_in_bytes());
+}
+
+TYPED_TEST(PitchedStorage, PixelsIgnorePadding) {
+  using T = typename std::remove_pointer<decltype(
+      std::declval<TypeParam>().raw_data())>::type;
+  const std::vector<T> pixels = {1, 2, 3, 4, 5, 6};
+  TypeParam image(3, 2, 8);
+  image.copy_raw_data(pixels.data());
+  EXPECT_EQ(pixels, image.get_pixels());
+  EXPECT_EQ(T(5), image.get_pixel(1, 1));
+  EXPECT_EQ(T(5), image.row(1)[1]);
+  EXPECT_EQ(T(5), image.view()(1, 1));
+  EXPECT_EQ(image, TypeParam(3, 2, pixels));
+}
+
+TYPED_TEST(PitchedStorage, PitchSmallerThanWidthThrows) {
+  EXPECT_THROW(TypeParam(4, 2, 3), std::invalid_argument);
+}
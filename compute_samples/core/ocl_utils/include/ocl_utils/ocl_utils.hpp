@@ -8,17 +8,66 @@
 #ifndef COMPUTE_SAMPLES_OCL_UTILS_HPP
 #define COMPUTE_SAMPLES_OCL_UTILS_HPP
 
+#include <future>
 #include <vector>
 
 #include <boost/compute/core.hpp>
 
+#include "utils/fat_binary.hpp"
+#include "utils/mapped_file.hpp"
+
 namespace compute_samples {
+// Builds the program and logs the build log when it fails
+void try_build(boost::compute::program &program, const std::string &options);
+// Built through program_cache() when it is enabled
 boost::compute::program
 build_program(const boost::compute::context &context, const std::string &file,
               const std::string &options = std::string());
+// Program built from a file and the time its build took
+struct ProgramBuild {
+  std::string file;
+  std::string options;
+  boost::compute::program program;
+  double seconds = 0.0;
+};
+ProgramBuild build_program_timed(const boost::compute::context &context,
+                                 const std::string &file,
+                                 const std::string &options = "");
+// Starts building the programs concurrently on a pool of worker threads and
+// returns a future per file, in the order of files. Futures rethrow build
+// errors
+std::vector<std::future<ProgramBuild>>
+build_programs_async(const boost::compute::context &context,
+                     const std::vector<std::string> &files,
+                     const std::string &options = "");
+// Logs the build time of each program, slowest first
+void log_program_builds(const std::vector<ProgramBuild> &builds);
 boost::compute::program build_program_il(const boost::compute::context &context,
                                          const std::string &file,
                                          const std::string &options = "");
+boost::compute::program build_program_il(const boost::compute::context &context,
+                                         const MappedFile &il,
+                                         const std::string &options = "");
+// Builds the program from a native binary of the fat binary, which skips
+// compilation. Binaries made for one of fat_binary_targets() of the device
+// are tried first and the others next, as drivers reject binaries of other
+// devices. The SPIR-V of the fat binary is built when no native binary is
+// accepted or the context has multiple devices.
+boost::compute::program
+build_program_fat_binary(const boost::compute::context &context,
+                         const FatBinary &binary,
+                         const std::string &options = "");
+boost::compute::program
+build_program_fat_binary(const boost::compute::context &context,
+                         const std::string &file,
+                         const std::string &options = "");
+// Names of the device which ocloc accepts as a target: its IP version and
+// PCI device ID when the driver reports them, and the device name
+std::vector<std::string>
+fat_binary_targets(const boost::compute::device &device);
+boost::compute::buffer
+create_buffer_from_mapped_file(const boost::compute::context &context,
+                               const MappedFile &file);
 
 struct cl_char3 {
   ::cl_char3 data;
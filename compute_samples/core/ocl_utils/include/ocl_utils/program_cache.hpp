@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_PROGRAM_CACHE_HPP
+#define COMPUTE_SAMPLES_PROGRAM_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <boost/compute/core.hpp>
+
+#include "utils/file_cache.hpp"
+
+namespace compute_samples {
+
+struct ProgramCacheStatistics {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  // Programs built by the driver, either on a miss or on a binary the driver
+  // rejected
+  double compile_seconds = 0.0;
+  // Programs created from binaries found in the cache
+  double load_seconds = 0.0;
+};
+
+// Program binaries kept across processes in a FileCache. Entries are keyed by
+// the SHA-256 of the IL or of the source with the files it includes, see
+// source_digest, the build options and the name, version and driver version
+// of the device and its platform, so updated drivers never load stale
+// binaries. Only contexts with a single device are cached,
+// others are always built from source. Binaries the driver rejects are
+// rebuilt and replaced.
+class ProgramBinaryCache {
+public:
+  explicit ProgramBinaryCache(
+      const std::string &directory,
+      const uint64_t max_size = FileCache::default_max_size);
+
+  ProgramBinaryCache(const ProgramBinaryCache &) = delete;
+  ProgramBinaryCache &operator=(const ProgramBinaryCache &) = delete;
+
+  boost::compute::program build(const boost::compute::context &context,
+                                const std::string &source,
+                                const std::string &options = "");
+  boost::compute::program build_il(const boost::compute::context &context,
+                                   const void *il, const size_t size,
+                                   const std::string &options = "");
+
+  ProgramCacheStatistics statistics() const;
+  const FileCache &file_cache() const { return cache_; }
+  FileCache &file_cache() { return cache_; }
+
+private:
+  template <typename Create>
+  boost::compute::program build(const boost::compute::context &context,
+                                const std::string &kind,
+                                const std::string &digest,
+                                const std::string &options,
+                                const Create &create);
+
+  FileCache cache_;
+  mutable std::mutex mutex_;
+  ProgramCacheStatistics statistics_;
+};
+
+// Cache used by build_program and build_program_il. It is enabled on first use
+// when the COMPUTE_SAMPLES_PROGRAM_CACHE environment variable names a
+// directory, limited to COMPUTE_SAMPLES_PROGRAM_CACHE_SIZE megabytes if set.
+// Returns null while disabled.
+std::shared_ptr<ProgramBinaryCache> program_cache();
+void enable_program_cache(
+    const std::string &directory,
+    const uint64_t max_size = FileCache::default_max_size);
+void disable_program_cache();
+
+} // namespace compute_samples
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_PROGRAM_REGISTRY_HPP
+#define COMPUTE_SAMPLES_PROGRAM_REGISTRY_HPP
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <boost/compute/core.hpp>
+
+#include "ocl_utils/ocl_utils.hpp"
+
+namespace compute_samples {
+
+struct ProgramRegistryStatistics {
+  uint64_t programs_built = 0;
+  uint64_t programs_reused = 0;
+  uint64_t kernels_created = 0;
+  uint64_t kernels_cloned = 0;
+  // Time callers spent waiting for programs which were not built yet, and
+  // for programs found built
+  double cold_seconds = 0.0;
+  double warm_seconds = 0.0;
+};
+
+// Process-wide programs built by build_program from files. Each file is built
+// once per context and build options, also when several threads ask for it
+// at once, and may be built ahead by build_programs_async. With OpenCL 2.1
+// kernels are cloned from one created per program and name, otherwise each
+// call creates one, so that callers set their arguments and execution info
+// independently. Contexts are identified by their handle, which stays valid
+// as the registry holds their programs.
+class ProgramRegistry {
+public:
+  static ProgramRegistry &instance();
+
+  ProgramRegistry();
+  ~ProgramRegistry();
+
+  ProgramRegistry(const ProgramRegistry &) = delete;
+  ProgramRegistry &operator=(const ProgramRegistry &) = delete;
+
+  // Build errors are rethrown to every caller asking for the program
+  boost::compute::program program(const boost::compute::context &context,
+                                  const std::string &file,
+                                  const std::string &options = "");
+  // Starts building the program on a background thread unless it is known
+  std::shared_future<ProgramBuild>
+  program_async(const boost::compute::context &context,
+                const std::string &file, const std::string &options = "");
+  // Starts building all programs which are not known yet, concurrently, so
+  // that later calls find them built
+  void warm_up(const boost::compute::context &context,
+               const std::vector<std::string> &files,
+               const std::string &options = "");
+  boost::compute::kernel kernel(const boost::compute::context &context,
+                                const std::string &file,
+                                const std::string &name,
+                                const std::string &options = "");
+
+  ProgramRegistryStatistics statistics() const;
+  // Also logs the build time of each program built successfully
+  void log_statistics() const;
+  // Releases all programs and kernels
+  void clear();
+
+private:
+  using ProgramKey = std::tuple<cl_context, std::string, std::string>;
+  using KernelKey = std::tuple<cl_context, std::string, std::string,
+                               std::string>;
+
+  std::shared_future<ProgramBuild>
+  find_or_build(const boost::compute::context &context,
+                const std::string &file, const std::string &options,
+                const bool background, bool &known);
+
+  mutable std::mutex mutex_;
+  std::map<ProgramKey, std::shared_future<ProgramBuild>> programs_;
+  std::map<KernelKey, boost::compute::kernel> kernels_;
+  ProgramRegistryStatistics statistics_;
+};
+
+} // namespace compute_samples
+
+#endif
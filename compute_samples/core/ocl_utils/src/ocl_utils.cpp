@@ -6,12 +6,46 @@
  */
 
 #include "ocl_utils/ocl_utils.hpp"
+#include "ocl_utils/program_cache.hpp"
+#include "utils/thread_pool.hpp"
 #include "utils/utils.hpp"
 #include "logging/logging.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef CL_DEVICE_IP_VERSION_INTEL
+#define CL_DEVICE_IP_VERSION_INTEL 0x4250
+#endif
+#ifndef CL_DEVICE_ID_INTEL
+#define CL_DEVICE_ID_INTEL 0x4251
+#endif
+
 namespace compute = boost::compute;
 
 namespace compute_samples {
+namespace {
+std::string read_source_file(const std::string &file) {
+  std::ifstream stream(file);
+  if (stream.fail()) {
+    throw std::ios_base::failure("Failed to open program file: " + file);
+  }
+  return std::string(std::istreambuf_iterator<char>(stream),
+                     std::istreambuf_iterator<char>());
+}
+
+// Drivers build programs concurrently, so the pool has a thread per core
+ThreadPool &build_pool() {
+  static ThreadPool pool;
+  return pool;
+}
+} // namespace
+
 void try_build(compute::program &program, const std::string &options) {
   LOG_ENTER_FUNCTION
   LOG_DEBUG << "Build options: " << options;
@@ -36,6 +70,14 @@ compute::program build_program(const compute::context &context,
   LOG_DEBUG << "Program file: " << file;
   LOG_DEBUG << "Build options: " << options;
 
+  const std::shared_ptr<ProgramBinaryCache> cache = program_cache();
+  if (cache) {
+    compute::program program =
+        cache->build(context, read_source_file(file), options);
+    LOG_EXIT_FUNCTION
+    return program;
+  }
+
   compute::program program =
       compute::program::create_with_source_file(file, context);
   LOG_DEBUG << "Program successfully created with source file";
@@ -45,6 +87,61 @@ compute::program build_program(const compute::context &context,
   return program;
 }
 
+ProgramBuild build_program_timed(const compute::context &context,
+                                 const std::string &file,
+                                 const std::string &options) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  ProgramBuild build;
+  build.file = file;
+  build.options = options;
+  build.program = build_program(context, file, options);
+  build.seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  return build;
+}
+
+std::vector<std::future<ProgramBuild>>
+build_programs_async(const compute::context &context,
+                     const std::vector<std::string> &files,
+                     const std::string &options) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "Programs: " << files.size();
+  LOG_DEBUG << "Build options: " << options;
+
+  std::vector<std::future<ProgramBuild>> builds;
+  builds.reserve(files.size());
+  for (const std::string &file : files) {
+    builds.push_back(build_pool().submit([context, file, options]() {
+      return build_program_timed(context, file, options);
+    }));
+  }
+
+  LOG_EXIT_FUNCTION
+  return builds;
+}
+
+void log_program_builds(const std::vector<ProgramBuild> &builds) {
+  std::vector<const ProgramBuild *> sorted;
+  double total = 0.0;
+  for (const ProgramBuild &build : builds) {
+    sorted.push_back(&build);
+    total += build.seconds;
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const ProgramBuild *a, const ProgramBuild *b) {
+                     return a->seconds > b->seconds;
+                   });
+
+  LOG_INFO << "Programs: " << builds.size() << ", build time: " << total * 1e3
+           << " ms";
+  for (const ProgramBuild *build : sorted) {
+    LOG_INFO << "  " << build->seconds * 1e3 << " ms " << build->file
+             << (build->options.empty() ? "" : " ") << build->options;
+  }
+}
+
 compute::program build_program_il(const compute::context &context,
                                   const std::string &file,
                                   const std::string &options) {
@@ -52,8 +149,30 @@ compute::program build_program_il(const compute::context &context,
   LOG_DEBUG << "Program file: " << file;
   LOG_DEBUG << "Build options: " << options;
 
+  const MappedFile il(file);
+  compute::program program = build_program_il(context, il, options);
+
+  LOG_EXIT_FUNCTION
+  return program;
+}
+
+compute::program build_program_il(const compute::context &context,
+                                  const MappedFile &il,
+                                  const std::string &options) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "IL size: " << il.size();
+  LOG_DEBUG << "Build options: " << options;
+
+  const std::shared_ptr<ProgramBinaryCache> cache = program_cache();
+  if (cache) {
+    compute::program program =
+        cache->build_il(context, il.data(), il.size(), options);
+    LOG_EXIT_FUNCTION
+    return program;
+  }
+
   compute::program program =
-      compute::program::create_with_il_file(file, context);
+      compute::program::create_with_il(il.data(), il.size(), context);
   LOG_DEBUG << "Program successfully created with il file";
   try_build(program, options);
 
@@ -61,6 +180,104 @@ compute::program build_program_il(const compute::context &context,
   return program;
 }
 
+compute::program build_program_fat_binary(const compute::context &context,
+                                          const FatBinary &binary,
+                                          const std::string &options) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "Fat binary entries: " << binary.entries().size();
+  LOG_DEBUG << "Build options: " << options;
+
+  if (context.get_devices().size() == 1) {
+    const std::vector<std::string> targets =
+        fat_binary_targets(context.get_device());
+    std::vector<const FatBinaryEntry *> matching;
+    std::vector<const FatBinaryEntry *> others;
+    for (const FatBinaryEntry &entry : binary.entries()) {
+      if (entry.format != FatBinaryFormat::native) {
+        continue;
+      }
+      const bool matches = std::find(targets.begin(), targets.end(),
+                                     entry.target) != targets.end();
+      (matches ? matching : others).push_back(&entry);
+    }
+    matching.insert(matching.end(), others.begin(), others.end());
+
+    for (const FatBinaryEntry *entry : matching) {
+      try {
+        compute::program program = compute::program::create_with_binary(
+            entry->data.data(), entry->data.size(), context);
+        program.build(options);
+        LOG_DEBUG << "Program built from native binary for " << entry->target;
+        LOG_EXIT_FUNCTION
+        return program;
+      } catch (const compute::opencl_error &error) {
+        LOG_DEBUG << "Native binary for " << entry->target
+                  << " rejected: " << error.what();
+      }
+    }
+  }
+
+  const FatBinaryEntry *spirv = binary.spirv();
+  if (spirv == nullptr) {
+    throw std::runtime_error("Fat binary has no binary for the device");
+  }
+  compute::program program = compute::program::create_with_il(
+      spirv->data.data(), spirv->data.size(), context);
+  LOG_DEBUG << "Program created with SPIR-V of fat binary";
+  try_build(program, options);
+
+  LOG_EXIT_FUNCTION
+  return program;
+}
+
+compute::program build_program_fat_binary(const compute::context &context,
+                                          const std::string &file,
+                                          const std::string &options) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "Program file: " << file;
+
+  compute::program program =
+      build_program_fat_binary(context, FatBinary::load(file), options);
+
+  LOG_EXIT_FUNCTION
+  return program;
+}
+
+std::vector<std::string> fat_binary_targets(const compute::device &device) {
+  std::vector<std::string> targets;
+  if (device.supports_extension("cl_intel_device_attribute_query")) {
+    try {
+      const cl_uint ip = device.get_info<cl_uint>(CL_DEVICE_IP_VERSION_INTEL);
+      targets.push_back(std::to_string(ip >> 22) + "." +
+                        std::to_string((ip >> 12) & 0x3ff) + "." +
+                        std::to_string(ip & 0xfff));
+      std::stringstream id;
+      id << "0x" << std::hex << std::setw(4) << std::setfill('0')
+         << device.get_info<cl_uint>(CL_DEVICE_ID_INTEL);
+      targets.push_back(id.str());
+    } catch (const compute::opencl_error &error) {
+      LOG_DEBUG << "Device attribute query failed: " << error.what();
+    }
+  }
+  targets.push_back(device.name());
+  return targets;
+}
+
+compute::buffer create_buffer_from_mapped_file(const compute::context &context,
+                                               const MappedFile &file) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "Mapped size: " << file.mapped_size();
+
+  // Whole pages are wrapped, so drivers can use the mapping without a copy
+  compute::buffer buffer(context, file.mapped_size(),
+                         compute::memory_object::read_only |
+                             compute::memory_object::use_host_ptr,
+                         file.mapped_data());
+
+  LOG_EXIT_FUNCTION
+  return buffer;
+}
+
 template <> std::string to_cl_c_string<cl_int>() { return "int"; }
 template <> std::string to_cl_c_string<cl_int2>() { return "int2"; }
 template <> std::string to_cl_c_string<cl_int4>() { return "int4"; }
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "ocl_utils/program_cache.hpp"
+#include "ocl_utils/ocl_utils.hpp"
+#include "utils/sha256.hpp"
+#include "utils/source_digest.hpp"
+#include "logging/logging.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+namespace compute = boost::compute;
+
+namespace compute_samples {
+namespace {
+std::mutex program_cache_mutex;
+std::shared_ptr<ProgramBinaryCache> global_program_cache;
+bool program_cache_configured = false;
+
+double seconds_since(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Binaries are only valid for the same device and driver
+std::string device_key(const compute::device &device) {
+  const compute::platform platform = device.platform();
+  return device.name() + "\n" + device.version() + "\n" +
+         device.driver_version() + "\n" + platform.name() + "\n" +
+         platform.version();
+}
+
+uint64_t environment_max_size() {
+  const char *size = std::getenv("COMPUTE_SAMPLES_PROGRAM_CACHE_SIZE");
+  if (size == nullptr) {
+    return FileCache::default_max_size;
+  }
+  try {
+    return static_cast<uint64_t>(std::stoull(size)) << 20;
+  } catch (const std::exception &) {
+    LOG_WARNING << "Invalid COMPUTE_SAMPLES_PROGRAM_CACHE_SIZE: " << size;
+    return FileCache::default_max_size;
+  }
+}
+} // namespace
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string &directory,
+                                       const uint64_t max_size)
+    : cache_(directory, max_size) {}
+
+template <typename Create>
+compute::program ProgramBinaryCache::build(const compute::context &context,
+                                           const std::string &kind,
+                                           const std::string &digest,
+                                           const std::string &options,
+                                           const Create &create) {
+  LOG_ENTER_FUNCTION
+  if (context.get_devices().size() != 1) {
+    LOG_DEBUG << "Program cache skipped for a context with multiple devices";
+    compute::program program = create();
+    try_build(program, options);
+    LOG_EXIT_FUNCTION
+    return program;
+  }
+
+  const std::string key = kind + "\n" + digest + "\n" + options + "\n" +
+                          device_key(context.get_device());
+  std::vector<uint8_t> binary;
+  if (cache_.load(key, binary)) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    try {
+      compute::program program = compute::program::create_with_binary(
+          binary.data(), binary.size(), context);
+      program.build(options);
+      const double seconds = seconds_since(start);
+      LOG_DEBUG << "Program loaded from cache in " << seconds * 1e3 << " ms";
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++statistics_.hits;
+        statistics_.load_seconds += seconds;
+      }
+      LOG_EXIT_FUNCTION
+      return program;
+    } catch (const compute::opencl_error &error) {
+      LOG_WARNING << "Cached program binary rejected: " << error.what();
+    }
+  }
+
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  compute::program program = create();
+  try_build(program, options);
+  const double seconds = seconds_since(start);
+  LOG_DEBUG << "Program compiled in " << seconds * 1e3 << " ms";
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++statistics_.misses;
+    statistics_.compile_seconds += seconds;
+  }
+
+  const std::vector<unsigned char> program_binary = program.binary();
+  cache_.store(key,
+               std::vector<uint8_t>(program_binary.begin(),
+                                    program_binary.end()));
+  LOG_EXIT_FUNCTION
+  return program;
+}
+
+compute::program ProgramBinaryCache::build(const compute::context &context,
+                                           const std::string &source,
+                                           const std::string &options) {
+  // The driver resolves includes of the source from the working directory
+  // and the -I options
+  std::vector<std::string> directories = {"."};
+  const std::vector<std::string> option_directories =
+      include_directories(options);
+  directories.insert(directories.end(), option_directories.begin(),
+                     option_directories.end());
+  return build(context, "source", source_digest(source, directories), options,
+               [&]() {
+                 return compute::program::create_with_source(source, context);
+               });
+}
+
+compute::program ProgramBinaryCache::build_il(const compute::context &context,
+                                              const void *il,
+                                              const size_t size,
+                                              const std::string &options) {
+  return build(context, "il", sha256(il, size), options, [&]() {
+    return compute::program::create_with_il(il, size, context);
+  });
+}
+
+ProgramCacheStatistics ProgramBinaryCache::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+std::shared_ptr<ProgramBinaryCache> program_cache() {
+  std::lock_guard<std::mutex> lock(program_cache_mutex);
+  if (!program_cache_configured) {
+    program_cache_configured = true;
+    const char *directory = std::getenv("COMPUTE_SAMPLES_PROGRAM_CACHE");
+    if (directory != nullptr && *directory != '\0') {
+      LOG_DEBUG << "Program cache directory: " << directory;
+      global_program_cache = std::make_shared<ProgramBinaryCache>(
+          directory, environment_max_size());
+    }
+  }
+  return global_program_cache;
+}
+
+void enable_program_cache(const std::string &directory,
+                          const uint64_t max_size) {
+  std::lock_guard<std::mutex> lock(program_cache_mutex);
+  program_cache_configured = true;
+  global_program_cache =
+      std::make_shared<ProgramBinaryCache>(directory, max_size);
+}
+
+void disable_program_cache() {
+  std::lock_guard<std::mutex> lock(program_cache_mutex);
+  program_cache_configured = true;
+  global_program_cache.reset();
+}
+
+} // namespace compute_samples
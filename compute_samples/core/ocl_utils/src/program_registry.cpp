@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "ocl_utils/program_registry.hpp"
+#include "logging/logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace compute = boost::compute;
+
+namespace compute_samples {
+
+ProgramRegistry &ProgramRegistry::instance() {
+  static ProgramRegistry registry;
+  return registry;
+}
+
+ProgramRegistry::ProgramRegistry() = default;
+
+ProgramRegistry::~ProgramRegistry() = default;
+
+compute::program ProgramRegistry::program(const compute::context &context,
+                                          const std::string &file,
+                                          const std::string &options) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  bool known = false;
+  const std::shared_future<ProgramBuild> program =
+      find_or_build(context, file, options, false, known);
+  const bool ready = program.wait_for(std::chrono::seconds(0)) ==
+                     std::future_status::ready;
+  program.wait();
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    (known && ready ? statistics_.warm_seconds : statistics_.cold_seconds) +=
+        seconds;
+  }
+  return program.get().program;
+}
+
+std::shared_future<ProgramBuild>
+ProgramRegistry::program_async(const compute::context &context,
+                               const std::string &file,
+                               const std::string &options) {
+  bool known = false;
+  return find_or_build(context, file, options, true, known);
+}
+
+void ProgramRegistry::warm_up(const compute::context &context,
+                              const std::vector<std::string> &files,
+                              const std::string &options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> unknown;
+  for (const std::string &file : files) {
+    const ProgramKey key(context.get(), file, options);
+    if (programs_.count(key) == 0 &&
+        std::find(unknown.begin(), unknown.end(), file) == unknown.end()) {
+      unknown.push_back(file);
+    }
+  }
+  LOG_DEBUG << "Programs warmed up: " << unknown.size();
+
+  std::vector<std::future<ProgramBuild>> builds =
+      build_programs_async(context, unknown, options);
+  for (size_t i = 0; i < unknown.size(); ++i) {
+    programs_.emplace(ProgramKey(context.get(), unknown[i], options),
+                      builds[i].share());
+  }
+  statistics_.programs_built += unknown.size();
+}
+
+compute::kernel ProgramRegistry::kernel(const compute::context &context,
+                                        const std::string &file,
+                                        const std::string &name,
+                                        const std::string &options) {
+  const compute::program program = this->program(context, file, options);
+#if defined(BOOST_COMPUTE_CL_VERSION_2_1)
+  const KernelKey key(context.get(), file, options, name);
+  compute::kernel prototype;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = kernels_.find(key);
+    if (found != kernels_.end()) {
+      prototype = found->second;
+    }
+  }
+  if (prototype.get() == nullptr) {
+    prototype = program.create_kernel(name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++statistics_.kernels_created;
+    prototype = kernels_.emplace(key, prototype).first->second;
+  }
+
+  // The prototype is never handed out, as clones copy its arguments
+  try {
+    compute::kernel kernel = prototype.clone();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++statistics_.kernels_cloned;
+    return kernel;
+  } catch (const compute::opencl_error &error) {
+    LOG_DEBUG << "Kernel clone failed: " << error.what();
+  }
+#endif
+  compute::kernel kernel = program.create_kernel(name);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++statistics_.kernels_created;
+  return kernel;
+}
+
+ProgramRegistryStatistics ProgramRegistry::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+void ProgramRegistry::log_statistics() const {
+  std::vector<ProgramBuild> builds;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &program : programs_) {
+      if (program.second.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready) {
+        continue;
+      }
+      try {
+        builds.push_back(program.second.get());
+      } catch (...) {
+        // Build errors were logged by the build
+      }
+    }
+  }
+  log_program_builds(builds);
+
+  const ProgramRegistryStatistics s = statistics();
+  LOG_INFO << "Programs built: " << s.programs_built
+           << ", reused: " << s.programs_reused
+           << ", cold wait: " << s.cold_seconds * 1e3
+           << " ms, warm wait: " << s.warm_seconds * 1e3
+           << " ms, kernels created: " << s.kernels_created
+           << ", cloned: " << s.kernels_cloned;
+}
+
+void ProgramRegistry::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  kernels_.clear();
+  programs_.clear();
+}
+
+std::shared_future<ProgramBuild>
+ProgramRegistry::find_or_build(const compute::context &context,
+                               const std::string &file,
+                               const std::string &options,
+                               const bool background, bool &known) {
+  const ProgramKey key(context.get(), file, options);
+  std::promise<ProgramBuild> promise;
+  std::shared_future<ProgramBuild> program;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = programs_.find(key);
+    if (found != programs_.end()) {
+      ++statistics_.programs_reused;
+      known = true;
+      return found->second;
+    }
+    ++statistics_.programs_built;
+    LOG_DEBUG << "Program registered: " << file << " " << options;
+    if (background) {
+      program = build_programs_async(context, {file}, options).front().share();
+      programs_.emplace(key, program);
+      return program;
+    }
+    program = promise.get_future().share();
+    programs_.emplace(key, program);
+  }
+
+  // Built outside of the lock, other callers wait for the future
+  try {
+    promise.set_value(build_program_timed(context, file, options));
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+  }
+  return program;
+}
+
+} // namespace compute_samples
@@ -6,6 +6,8 @@
  */
 
 #include "ocl_utils/ocl_utils.hpp"
+#include "ocl_utils/program_cache.hpp"
+#include "ocl_utils/program_registry.hpp"
 #include "gtest/gtest.h"
 
 #include "utils/utils.hpp"
@@ -73,6 +75,21 @@ HWTEST_F(BuildProgram, ValidProgramSpirV) {
             cs::build_program_il(context, spv_file, "-cl-std=CL2.0"));
 }
 
+HWTEST_F(BuildProgram, ValidProgramSpirVFromMappedFile) {
+  std::vector<uint8_t> spriv_file_source = {
+      0x03, 0x02, 0x23, 0x07, 0x00, 0x00, 0x01, 0x00, 0x03, 0x00, 0x0b, 0x00,
+      0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x00, 0x02, 0x00,
+      0x04, 0x00, 0x00, 0x00, 0x11, 0x00, 0x02, 0x00, 0x06, 0x00, 0x00, 0x00,
+      0x0b, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x00, 0x4f, 0x70, 0x65, 0x6e,
+      0x43, 0x4c, 0x2e, 0x73, 0x74, 0x64, 0x00, 0x00, 0x0e, 0x00, 0x03, 0x00,
+      0x02, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00,
+      0x03, 0x00, 0x00, 0x00, 0x70, 0x8e, 0x01, 0x00};
+  compute_samples::save_binary_file(spriv_file_source, spv_file);
+  const cs::MappedFile il(spv_file);
+  EXPECT_NE(compute::program(),
+            cs::build_program_il(context, il, "-cl-std=CL2.0"));
+}
+
 HWTEST_F(BuildProgram, InvalidProgramSpirV) {
   std::vector<uint8_t> spriv_file_source = {
       0x0A, 0x02, 0x23, 0x07, 0x00, 0x00, 0x01, 0x00, 0x03, 0x00, 0x0b, 0x00,
@@ -86,3 +103,208 @@ HWTEST_F(BuildProgram, InvalidProgramSpirV) {
   EXPECT_THROW(cs::build_program_il(context, spv_file, "-cl-std=CL2.0"),
                compute::opencl_error);
 }
+
+class ProgramCache : public BuildProgram {
+protected:
+  void SetUp() override {
+    BuildProgram::SetUp();
+    cs::enable_program_cache(cache_directory);
+    cs::program_cache()->file_cache().clear();
+  }
+
+  void TearDown() override {
+    cs::program_cache()->file_cache().clear();
+    cs::disable_program_cache();
+    BuildProgram::TearDown();
+  }
+
+  const std::string cache_directory = "program_cache";
+};
+
+HWTEST_F(ProgramCache, SecondBuildLoadsBinary) {
+  const char source[] = BOOST_COMPUTE_STRINGIZE_SOURCE(
+      kernel void my_kernel(global int *x) { x[0] = VALUE; });
+  cs::save_text_file(source, cl_file);
+
+  EXPECT_NE(compute::program(),
+            cs::build_program(context, cl_file, "-DVALUE=1"));
+  const compute::program program =
+      cs::build_program(context, cl_file, "-DVALUE=1");
+  EXPECT_NE(compute::kernel(), program.create_kernel("my_kernel"));
+
+  const cs::ProgramCacheStatistics statistics =
+      cs::program_cache()->statistics();
+  EXPECT_EQ(1u, statistics.misses);
+  EXPECT_EQ(1u, statistics.hits);
+  EXPECT_GT(statistics.compile_seconds, 0.0);
+}
+
+HWTEST_F(ProgramCache, BuildOptionsArePartOfKey) {
+  const char source[] = BOOST_COMPUTE_STRINGIZE_SOURCE(
+      kernel void my_kernel(global int *x) { x[0] = VALUE; });
+  cs::save_text_file(source, cl_file);
+
+  cs::build_program(context, cl_file, "-DVALUE=1");
+  cs::build_program(context, cl_file, "-DVALUE=2");
+  EXPECT_EQ(2u, cs::program_cache()->statistics().misses);
+  EXPECT_EQ(0u, cs::program_cache()->statistics().hits);
+}
+
+HWTEST_F(ProgramCache, EditedIncludeIsMiss) {
+  const char source[] =
+      "#include \"program_cache_value.h\"\n"
+      "kernel void my_kernel(global int *x) { x[0] = VALUE; }";
+  cs::save_text_file(source, cl_file);
+  cs::save_text_file("#define VALUE 1\n", "program_cache_value.h");
+  cs::build_program(context, cl_file);
+  cs::build_program(context, cl_file);
+  cs::save_text_file("#define VALUE 2\n", "program_cache_value.h");
+  cs::build_program(context, cl_file);
+  std::remove("program_cache_value.h");
+
+  EXPECT_EQ(2u, cs::program_cache()->statistics().misses);
+  EXPECT_EQ(1u, cs::program_cache()->statistics().hits);
+}
+
+HWTEST_F(ProgramCache, InvalidProgramIsNotStored) {
+  const char source[] =
+      BOOST_COMPUTE_STRINGIZE_SOURCE(kernel invalid_type my_kernel(){});
+  cs::save_text_file(source, cl_file);
+  EXPECT_THROW(cs::build_program(context, cl_file), compute::opencl_error);
+  EXPECT_THROW(cs::build_program(context, cl_file), compute::opencl_error);
+  EXPECT_EQ(0u, cs::program_cache()->file_cache().statistics().stores);
+}
+
+HWTEST_F(BuildProgram, BuildsProgramsAsynchronously) {
+  const std::vector<std::string> files = {"kernel_0.cl", "kernel_1.cl",
+                                          "kernel_2.cl"};
+  for (const std::string &file : files) {
+    cs::save_text_file(
+        "kernel void my_kernel(global int *x) { x[0] = VALUE; }", file);
+  }
+
+  std::vector<std::future<cs::ProgramBuild>> futures =
+      cs::build_programs_async(context, files, "-DVALUE=1");
+  ASSERT_EQ(files.size(), futures.size());
+  std::vector<cs::ProgramBuild> builds;
+  for (size_t i = 0; i < futures.size(); ++i) {
+    builds.push_back(futures[i].get());
+    EXPECT_EQ(files[i], builds[i].file);
+    EXPECT_EQ("-DVALUE=1", builds[i].options);
+    EXPECT_NE(compute::program(), builds[i].program);
+    EXPECT_LE(0.0, builds[i].seconds);
+  }
+  cs::log_program_builds(builds);
+
+  for (const std::string &file : files) {
+    std::remove(file.c_str());
+  }
+}
+
+HWTEST_F(BuildProgram, AsynchronousBuildRethrowsErrors) {
+  const char source[] =
+      BOOST_COMPUTE_STRINGIZE_SOURCE(kernel invalid_type my_kernel(){});
+  cs::save_text_file(source, cl_file);
+  std::vector<std::future<cs::ProgramBuild>> builds =
+      cs::build_programs_async(context, {cl_file});
+  ASSERT_EQ(1u, builds.size());
+  EXPECT_THROW(builds.front().get(), compute::opencl_error);
+}
+
+HWTEST_F(BuildProgram, FatBinaryNativeBinary) {
+  const char source[] = BOOST_COMPUTE_STRINGIZE_SOURCE(
+      kernel void my_kernel(global int *x) { x[0] = 1; });
+  cs::save_text_file(source, cl_file);
+  const std::vector<unsigned char> native =
+      cs::build_program(context, cl_file).binary();
+
+  // The binary made for the device is rejected, so the other one is tried
+  cs::FatBinary binary;
+  binary.add(cs::FatBinaryFormat::native, "other_device",
+             std::vector<uint8_t>(native.begin(), native.end()));
+  binary.add(cs::FatBinaryFormat::native,
+             cs::fat_binary_targets(device).front(), {1, 2, 3, 4});
+  const compute::program program =
+      cs::build_program_fat_binary(context, binary);
+  EXPECT_EQ("my_kernel", program.create_kernel("my_kernel").name());
+}
+
+HWTEST_F(BuildProgram, FatBinaryWithoutAcceptedBinary) {
+  cs::FatBinary binary;
+  binary.add(cs::FatBinaryFormat::native,
+             cs::fat_binary_targets(device).front(), {1, 2, 3, 4});
+  EXPECT_THROW(cs::build_program_fat_binary(context, binary),
+               std::runtime_error);
+}
+
+class ProgramRegistry : public BuildProgram {
+protected:
+  void TearDown() override {
+    registry.clear();
+    BuildProgram::TearDown();
+  }
+
+  cs::ProgramRegistry registry;
+};
+
+HWTEST_F(ProgramRegistry, BuildsProgramOnce) {
+  const char source[] = BOOST_COMPUTE_STRINGIZE_SOURCE(
+      kernel void my_kernel(global int *x) { x[0] = 1; });
+  cs::save_text_file(source, cl_file);
+
+  const compute::program program = registry.program(context, cl_file);
+  EXPECT_EQ(program, registry.program(context, cl_file));
+  EXPECT_NE(program, registry.program(context, cl_file, "-DVALUE=1"));
+
+  const cs::ProgramRegistryStatistics statistics = registry.statistics();
+  EXPECT_EQ(2u, statistics.programs_built);
+  EXPECT_EQ(1u, statistics.programs_reused);
+}
+
+HWTEST_F(ProgramRegistry, KernelsAreIndependent) {
+  const char source[] = BOOST_COMPUTE_STRINGIZE_SOURCE(
+      kernel void my_kernel(global int *x) { x[0] = 1; });
+  cs::save_text_file(source, cl_file);
+
+  const compute::kernel first = registry.kernel(context, cl_file, "my_kernel");
+  const compute::kernel second =
+      registry.kernel(context, cl_file, "my_kernel");
+  EXPECT_NE(first.get(), second.get());
+  EXPECT_EQ("my_kernel", second.name());
+  EXPECT_EQ(1u, registry.statistics().programs_built);
+}
+
+HWTEST_F(ProgramRegistry, BuildsInBackground) {
+  const char source[] = BOOST_COMPUTE_STRINGIZE_SOURCE(
+      kernel void my_kernel(global int *x) { x[0] = 1; });
+  cs::save_text_file(source, cl_file);
+
+  std::shared_future<cs::ProgramBuild> program =
+      registry.program_async(context, cl_file);
+  EXPECT_EQ(program.get().program, registry.program(context, cl_file));
+  EXPECT_EQ(1u, registry.statistics().programs_built);
+}
+
+HWTEST_F(ProgramRegistry, WarmsUpProgramsOnce) {
+  const char source[] = BOOST_COMPUTE_STRINGIZE_SOURCE(
+      kernel void my_kernel(global int *x) { x[0] = 1; });
+  cs::save_text_file(source, cl_file);
+
+  registry.warm_up(context, {cl_file, cl_file});
+  registry.warm_up(context, {cl_file});
+  EXPECT_NE(compute::program(), registry.program(context, cl_file));
+
+  const cs::ProgramRegistryStatistics statistics = registry.statistics();
+  EXPECT_EQ(1u, statistics.programs_built);
+  EXPECT_EQ(1u, statistics.programs_reused);
+}
+
+HWTEST_F(ProgramRegistry, RethrowsBuildErrors) {
+  const char source[] =
+      BOOST_COMPUTE_STRINGIZE_SOURCE(kernel invalid_type my_kernel(){});
+  cs::save_text_file(source, cl_file);
+  EXPECT_THROW(registry.program(context, cl_file), compute::opencl_error);
+  EXPECT_THROW(registry.kernel(context, cl_file, "my_kernel"),
+               compute::opencl_error);
+  EXPECT_EQ(1u, registry.statistics().programs_built);
+}
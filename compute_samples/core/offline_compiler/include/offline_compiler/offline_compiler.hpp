@@ -8,16 +8,76 @@
 #ifndef COMPUTE_SAMPLES_OFFLINE_COMPILER_HPP
 #define COMPUTE_SAMPLES_OFFLINE_COMPILER_HPP
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "utils/fat_binary.hpp"
+#include "utils/file_cache.hpp"
+
 namespace compute_samples {
 
+struct OfflineCompilerStatistics {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  // Misses compiled through the ocloc library instead of the ocloc process
+  uint64_t library_compilations = 0;
+  double hit_seconds = 0.0;
+  double miss_seconds = 0.0;
+};
+
+const char default_offline_compiler_device[] = "skl";
+
+// Compiles the file into a SPIR-V file next to it, with the extension
+// replaced by .spv, and returns its path
 std::string generate_spirv(const std::string &path,
                            const std::string &build_options = std::string());
 std::vector<uint8_t>
 generate_spirv_from_source(const std::string &source,
                            const std::string &build_options = std::string());
+// Compiles the source with ocloc for the device. ocloc works in a temporary
+// directory of its own, so concurrent callers never share files, and the
+// same source is compiled by one thread of the process at a time. Results
+// are reused from spirv_cache() when it is enabled. Throws
+// std::runtime_error when compilation fails.
+std::vector<uint8_t>
+compile_spirv(const std::string &source,
+              const std::string &build_options = std::string(),
+              const std::string &device = default_offline_compiler_device);
+// Native binary of the source for the device, compiled and cached together
+// with its SPIR-V like compile_spirv
+std::vector<uint8_t>
+compile_native(const std::string &source,
+               const std::string &build_options = std::string(),
+               const std::string &device = default_offline_compiler_device);
+// Compiles the source for all devices concurrently and packages the native
+// binary of each device, named as passed to ocloc, with one SPIR-V entry.
+// Throws std::invalid_argument for an empty list of devices.
+FatBinary compile_fat_binary(const std::string &source,
+                             const std::vector<std::string> &devices,
+                             const std::string &build_options = std::string());
+
+// Cache used by the functions above. It is enabled on first use when the
+// COMPUTE_SAMPLES_SPIRV_CACHE environment variable names a directory,
+// limited to COMPUTE_SAMPLES_SPIRV_CACHE_SIZE megabytes if set. Entries hold
+// the SPIR-V and native binary of a compilation, keyed by the SHA-256 of the
+// source with the files it includes through the -I options, see
+// source_digest, the build options and the device. Returns null while
+// disabled.
+std::shared_ptr<FileCache> spirv_cache();
+void enable_spirv_cache(const std::string &directory,
+                        const uint64_t max_size = FileCache::default_max_size);
+void disable_spirv_cache();
+
+// Compiles in process through the ocloc library at the path instead of
+// running the ocloc executable. The COMPUTE_SAMPLES_OCLOC_LIBRARY environment
+// variable selects the library on first use. An empty path selects the
+// executable. Returns false and keeps the executable when the library cannot
+// be loaded.
+bool use_offline_compiler_library(const std::string &path);
+
+OfflineCompilerStatistics offline_compiler_statistics();
 
 } // namespace compute_samples
 
@@ -5,33 +5,146 @@
  *
  */
 
+#include "offline_compiler/offline_compiler.hpp"
+#include "utils/source_digest.hpp"
+#include "utils/temporary_directory.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/utils.hpp"
+#include "logging/logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <fstream>
-#include "logging/logging.hpp"
-#include "utils/utils.hpp"
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
 
 namespace compute_samples {
+namespace {
+// Entry points of the ocloc library, declared by ocloc_api.h
+using OclocInvoke = int (*)(uint32_t, const char **, uint32_t,
+                            const uint8_t **, const uint64_t *, const char **,
+                            uint32_t, const uint8_t **, const uint64_t *,
+                            const char **, uint32_t *, uint8_t ***,
+                            uint64_t **, char ***);
+using OclocFreeOutput = int (*)(uint32_t *, uint8_t ***, uint64_t **,
+                                char ***);
 
-std::string generate_spirv(const std::string &path,
-                           const std::string &build_options) {
-  const std::string log_file = "command_log.txt";
-  const std::string spv_file = "kernel";
+struct OclocLibrary {
+  OclocInvoke invoke = nullptr;
+  OclocFreeOutput free_output = nullptr;
+};
 
-  std::string command_line = "ocloc -file " + path +
-                             " -device skl -output_no_suffix -output " +
-                             spv_file;
-  if (!build_options.empty()) {
-    command_line += " -options \"" + build_options + "\"";
+std::mutex offline_compiler_mutex;
+std::shared_ptr<FileCache> global_spirv_cache;
+bool spirv_cache_configured = false;
+OclocLibrary ocloc_library;
+bool ocloc_library_configured = false;
+OfflineCompilerStatistics statistics;
+
+// Cache keys being compiled, so that each source is compiled once and other
+// threads load it from the cache
+std::mutex compiling_mutex;
+std::condition_variable compiling_done;
+std::set<std::string> compiling;
+
+class CompilationLock {
+public:
+  explicit CompilationLock(const std::string &key) : key_(key) {
+    std::unique_lock<std::mutex> lock(compiling_mutex);
+    compiling_done.wait(lock, [this]() { return compiling.count(key_) == 0; });
+    compiling.insert(key_);
+  }
+  ~CompilationLock() {
+    {
+      std::lock_guard<std::mutex> lock(compiling_mutex);
+      compiling.erase(key_);
+    }
+    compiling_done.notify_all();
   }
-  command_line += " > " + log_file + " 2>&1";
-  LOG_DEBUG << "Offline compiler command: " << command_line;
 
-  const int return_code = std::system(command_line.c_str());
-  const std::string log = load_text_file(log_file);
-  if (std::remove(log_file.c_str()) != 0) {
-    LOG_DEBUG << "Deleting file " << log_file.c_str() << " failed";
+  CompilationLock(const CompilationLock &) = delete;
+  CompilationLock &operator=(const CompilationLock &) = delete;
+
+private:
+  std::string key_;
+};
+
+double seconds_since(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+uint64_t environment_max_size() {
+  const char *size = std::getenv("COMPUTE_SAMPLES_SPIRV_CACHE_SIZE");
+  if (size == nullptr) {
+    return FileCache::default_max_size;
+  }
+  try {
+    return static_cast<uint64_t>(std::stoull(size)) << 20;
+  } catch (const std::exception &) {
+    LOG_WARNING << "Invalid COMPUTE_SAMPLES_SPIRV_CACHE_SIZE: " << size;
+    return FileCache::default_max_size;
   }
+}
 
+// Libraries stay loaded until the process exits
+bool load_ocloc_library(const std::string &path, OclocLibrary &library) {
+#if defined(_WIN32)
+  HMODULE module = LoadLibraryA(path.c_str());
+  if (module == nullptr) {
+    LOG_WARNING << "Loading " << path << " failed";
+    return false;
+  }
+  library.invoke =
+      reinterpret_cast<OclocInvoke>(GetProcAddress(module, "oclocInvoke"));
+  library.free_output = reinterpret_cast<OclocFreeOutput>(
+      GetProcAddress(module, "oclocFreeOutput"));
+#else
+  void *module = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (module == nullptr) {
+    LOG_WARNING << "Loading " << path << " failed: " << dlerror();
+    return false;
+  }
+  library.invoke = reinterpret_cast<OclocInvoke>(dlsym(module, "oclocInvoke"));
+  library.free_output =
+      reinterpret_cast<OclocFreeOutput>(dlsym(module, "oclocFreeOutput"));
+#endif
+  if (library.invoke == nullptr || library.free_output == nullptr) {
+    LOG_WARNING << "Library " << path << " has no ocloc entry points";
+    library = OclocLibrary();
+    return false;
+  }
+  LOG_DEBUG << "Offline compiler library: " << path;
+  return true;
+}
+
+OclocLibrary offline_compiler_library() {
+  std::lock_guard<std::mutex> lock(offline_compiler_mutex);
+  if (!ocloc_library_configured) {
+    ocloc_library_configured = true;
+    const char *path = std::getenv("COMPUTE_SAMPLES_OCLOC_LIBRARY");
+    if (path != nullptr && *path != '\0') {
+      load_ocloc_library(path, ocloc_library);
+    }
+  }
+  return ocloc_library;
+}
+
+void check_result(const int return_code, const std::string &log) {
   if (return_code != 0) {
     LOG_ERROR << "Offline compiler return code: " << return_code;
     LOG_ERROR << "Offline compiler log:\n" << log;
@@ -39,29 +152,363 @@ std::string generate_spirv(const std::string &path,
   }
   LOG_DEBUG << "Offline compiler return code: " << return_code;
   LOG_DEBUG << "Offline compiler log:\n" << log;
+}
+
+// Adds the outputs ocloc produced, so that missing outputs have no entries
+FatBinary ocloc_outputs(const std::string &device,
+                        const std::vector<uint8_t> &spirv,
+                        const std::vector<uint8_t> &binary) {
+  FatBinary outputs;
+  if (!spirv.empty()) {
+    outputs.add(FatBinaryFormat::spirv, device, spirv);
+  }
+  if (!binary.empty()) {
+    outputs.add(FatBinaryFormat::native, device, binary);
+  }
+  return outputs;
+}
+
+// Empty for outputs ocloc did not produce, such as binaries of SPIR-V only
+// compilations, which are not errors
+std::vector<uint8_t> load_output_file(const std::string &path) {
+  if (!std::ifstream(path, std::ios::binary).good()) {
+    return {};
+  }
+  return load_binary_file(path);
+}
+
+// Quotes the argument for the shell, so that spaces and quotes in paths and
+// build options reach ocloc unchanged
+std::string shell_argument(const std::string &argument) {
+#if defined(_WIN32)
+  // Backslashes are literal unless they precede a quote
+  std::string quoted = "\"";
+  size_t backslashes = 0;
+  for (const char c : argument) {
+    if (c == '\\') {
+      ++backslashes;
+      continue;
+    }
+    quoted.append(c == '"' ? 2 * backslashes + 1 : backslashes, '\\');
+    backslashes = 0;
+    quoted += c;
+  }
+  quoted.append(2 * backslashes, '\\');
+  return quoted + "\"";
+#else
+  std::string quoted = "'";
+  for (const char c : argument) {
+    if (c == '\'') {
+      quoted += "'\\''";
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "'";
+#endif
+}
+
+FatBinary compile_with_process(const std::string &source,
+                               const std::string &build_options,
+                               const std::string &device) {
+  const TemporaryDirectory directory("offline_compiler");
+  const std::string cl_file = directory.file("kernel.cl");
+  const std::string log_file = directory.file("command_log.txt");
+  save_text_file(source, cl_file);
+
+  std::string command_line =
+      "ocloc -file " + shell_argument(cl_file) + " -device " +
+      shell_argument(device) + " -output_no_suffix -out_dir " +
+      shell_argument(directory.path()) + " -output kernel";
+  if (!build_options.empty()) {
+    command_line += " -options " + shell_argument(build_options);
+  }
+  command_line += " > " + shell_argument(log_file) + " 2>&1";
+  LOG_DEBUG << "Offline compiler command: " << command_line;
+
+  const int return_code = std::system(command_line.c_str());
+  check_result(return_code, load_text_file(log_file));
+  return ocloc_outputs(device, load_output_file(directory.file("kernel.spv")),
+                       load_output_file(directory.file("kernel.bin")));
+}
+
+bool has_extension(const std::string &name, const std::string &extension) {
+  return name.size() > extension.size() &&
+         name.compare(name.size() - extension.size(), extension.size(),
+                      extension) == 0;
+}
+
+FatBinary compile_with_library(const OclocLibrary &library,
+                               const std::string &source,
+                               const std::string &build_options,
+                               const std::string &device) {
+  std::vector<const char *> arguments = {
+      "ocloc", "-file", "kernel.cl", "-device", device.c_str(),
+      "-output_no_suffix", "-output", "kernel"};
+  if (!build_options.empty()) {
+    arguments.push_back("-options");
+    arguments.push_back(build_options.c_str());
+  }
+
+  // Sources are passed with their terminating null character
+  const uint8_t *source_data =
+      reinterpret_cast<const uint8_t *>(source.c_str());
+  const uint64_t source_size = source.size() + 1;
+  const char *source_name = "kernel.cl";
+  uint32_t output_count = 0;
+  uint8_t **output_data = nullptr;
+  uint64_t *output_sizes = nullptr;
+  char **output_names = nullptr;
+  const int return_code = library.invoke(
+      static_cast<uint32_t>(arguments.size()), arguments.data(), 1,
+      &source_data, &source_size, &source_name, 0, nullptr, nullptr, nullptr,
+      &output_count, &output_data, &output_sizes, &output_names);
+
+  std::vector<uint8_t> spirv;
+  std::vector<uint8_t> binary;
+  std::string log;
+  for (uint32_t i = 0; i < output_count; ++i) {
+    const std::string name = output_names[i];
+    const uint8_t *begin = output_data[i];
+    const uint8_t *end = output_data[i] + output_sizes[i];
+    if (has_extension(name, ".spv")) {
+      spirv.assign(begin, end);
+    } else if (has_extension(name, ".bin")) {
+      binary.assign(begin, end);
+    } else if (name == "stdout.log") {
+      log.assign(begin, end);
+    }
+  }
+  library.free_output(&output_count, &output_data, &output_sizes,
+                      &output_names);
+
+  check_result(return_code, log);
+  return ocloc_outputs(device, spirv, binary);
+}
+
+FatBinary compile(const std::string &source, const std::string &build_options,
+                  const std::string &device) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  const OclocLibrary library = offline_compiler_library();
+  const bool in_process = library.invoke != nullptr;
+  const FatBinary outputs =
+      in_process ? compile_with_library(library, source, build_options, device)
+                 : compile_with_process(source, build_options, device);
+  const double seconds = seconds_since(start);
+  LOG_DEBUG << "Compiled for " << device << " in " << seconds * 1e3 << " ms";
+
+  std::lock_guard<std::mutex> lock(offline_compiler_mutex);
+  ++statistics.misses;
+  statistics.library_compilations += in_process ? 1 : 0;
+  statistics.miss_seconds += seconds;
+  return outputs;
+}
+
+// SPIR-V and native binary of the source for the device, which are cached
+// together as a fat binary
+FatBinary compile_cached(const std::string &source,
+                         const std::string &build_options,
+                         const std::string &device) {
+  const std::shared_ptr<FileCache> cache = spirv_cache();
+  if (!cache) {
+    return compile(source, build_options, device);
+  }
+
+  // ocloc compiles a copy of the source, so its includes are only found
+  // through the -I options
+  const std::string key = "ocloc\n" +
+                          source_digest(source,
+                                        include_directories(build_options)) +
+                          "\n" + build_options + "\n" + device;
+  const CompilationLock compilation(key);
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<uint8_t> entry;
+  if (cache->load(key, entry)) {
+    try {
+      const FatBinary outputs = FatBinary::parse(entry);
+      const double seconds = seconds_since(start);
+      LOG_DEBUG << "Loaded from cache in " << seconds * 1e3 << " ms";
+      std::lock_guard<std::mutex> lock(offline_compiler_mutex);
+      ++statistics.hits;
+      statistics.hit_seconds += seconds;
+      return outputs;
+    } catch (const std::runtime_error &error) {
+      LOG_WARNING << "Cached offline compiler outputs rejected: "
+                  << error.what();
+    }
+  }
 
-  return spv_file + ".spv";
+  const FatBinary outputs = compile(source, build_options, device);
+  cache->store(key, outputs.serialize());
+  return outputs;
+}
+} // namespace
+
+std::string generate_spirv(const std::string &path,
+                           const std::string &build_options) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "Kernel file: " << path;
+
+  std::ifstream stream(path, std::ios::binary);
+  if (stream.fail()) {
+    LOG_ERROR << "Failed to open kernel file: " << path;
+    throw std::runtime_error("Offline compiler failed");
+  }
+  const std::string source((std::istreambuf_iterator<char>(stream)),
+                           std::istreambuf_iterator<char>());
+
+  // The source is compiled from a copy, so headers next to it are found
+  // through an include path, quoted as the directory may contain spaces
+  const size_t slash = path.find_last_of("/\\");
+  const std::string directory =
+      slash == std::string::npos ? "."
+                                 : slash == 0 ? "/" : path.substr(0, slash);
+  std::string include = "-I \"";
+  for (const char c : directory) {
+    include += c == '"' ? "\\\"" : std::string(1, c);
+  }
+  include += "\"";
+  const std::string options =
+      build_options + (build_options.empty() ? "" : " ") + include;
+
+  const size_t dot = path.find_last_of('.');
+  const bool has_extension =
+      dot != std::string::npos && (slash == std::string::npos || dot > slash);
+  const std::string spv_path =
+      (has_extension ? path.substr(0, dot) : path) + ".spv";
+  save_binary_file(compile_spirv(source, options), spv_path);
+
+  LOG_EXIT_FUNCTION
+  return spv_path;
 }
 
 std::vector<uint8_t>
 generate_spirv_from_source(const std::string &source,
                            const std::string &build_options) {
   LOG_DEBUG << "Source code passed to offline compiler: " << source;
+  return compile_spirv(source, build_options);
+}
 
-  const std::string cl_path = "kernel.cl";
-  save_text_file(source, cl_path);
+std::vector<uint8_t> compile_spirv(const std::string &source,
+                                   const std::string &build_options,
+                                   const std::string &device) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "Build options: " << build_options;
+  LOG_DEBUG << "Device: " << device;
 
-  const std::string spv_path = generate_spirv(cl_path, build_options);
-  const std::vector<uint8_t> spirv = load_binary_file(spv_path);
+  const FatBinary outputs = compile_cached(source, build_options, device);
+  if (outputs.spirv() == nullptr) {
+    throw std::runtime_error("Offline compiler produced no SPIR-V");
+  }
+
+  LOG_EXIT_FUNCTION
+  return outputs.spirv()->data;
+}
+
+std::vector<uint8_t> compile_native(const std::string &source,
+                                    const std::string &build_options,
+                                    const std::string &device) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "Build options: " << build_options;
+  LOG_DEBUG << "Device: " << device;
 
-  if (std::remove(cl_path.c_str()) != 0) {
-    LOG_DEBUG << "Deleting file " << cl_path.c_str() << " failed";
+  const FatBinary outputs = compile_cached(source, build_options, device);
+  const FatBinaryEntry *binary = outputs.find(FatBinaryFormat::native, device);
+  if (binary == nullptr) {
+    throw std::runtime_error("Offline compiler produced no native binary");
   }
-  if (std::remove(spv_path.c_str()) != 0) {
-    LOG_DEBUG << "Deleting file " << spv_path.c_str() << " failed";
+
+  LOG_EXIT_FUNCTION
+  return binary->data;
+}
+
+FatBinary compile_fat_binary(const std::string &source,
+                             const std::vector<std::string> &devices,
+                             const std::string &build_options) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "Build options: " << build_options;
+  LOG_DEBUG << "Devices: " << devices.size();
+
+  if (devices.empty()) {
+    throw std::invalid_argument("No devices to compile for");
+  }
+
+  ThreadPool pool(std::min(static_cast<int>(devices.size()),
+                           ThreadPool::hardware_threads()));
+  std::vector<std::future<FatBinary>> outputs;
+  for (const std::string &device : devices) {
+    outputs.push_back(pool.submit([&source, &build_options, device]() {
+      return compile_cached(source, build_options, device);
+    }));
   }
 
-  return spirv;
+  // SPIR-V does not depend on the device, so one copy serves all devices
+  FatBinary fat_binary;
+  for (size_t i = 0; i < devices.size(); ++i) {
+    const FatBinary output = outputs[i].get();
+    const FatBinaryEntry *binary =
+        output.find(FatBinaryFormat::native, devices[i]);
+    if (binary == nullptr) {
+      throw std::runtime_error("No native binary for device: " + devices[i]);
+    }
+    fat_binary.add(FatBinaryFormat::native, devices[i], binary->data);
+    if (fat_binary.spirv() == nullptr && output.spirv() != nullptr) {
+      fat_binary.add(FatBinaryFormat::spirv, devices[i],
+                     output.spirv()->data);
+    }
+  }
+
+  LOG_EXIT_FUNCTION
+  return fat_binary;
+}
+
+std::shared_ptr<FileCache> spirv_cache() {
+  std::lock_guard<std::mutex> lock(offline_compiler_mutex);
+  if (!spirv_cache_configured) {
+    spirv_cache_configured = true;
+    const char *directory = std::getenv("COMPUTE_SAMPLES_SPIRV_CACHE");
+    if (directory != nullptr && *directory != '\0') {
+      LOG_DEBUG << "SPIR-V cache directory: " << directory;
+      global_spirv_cache =
+          std::make_shared<FileCache>(directory, environment_max_size());
+    }
+  }
+  return global_spirv_cache;
+}
+
+void enable_spirv_cache(const std::string &directory,
+                        const uint64_t max_size) {
+  std::lock_guard<std::mutex> lock(offline_compiler_mutex);
+  spirv_cache_configured = true;
+  global_spirv_cache = std::make_shared<FileCache>(directory, max_size);
+}
+
+void disable_spirv_cache() {
+  std::lock_guard<std::mutex> lock(offline_compiler_mutex);
+  spirv_cache_configured = true;
+  global_spirv_cache.reset();
+}
+
+bool use_offline_compiler_library(const std::string &path) {
+  std::lock_guard<std::mutex> lock(offline_compiler_mutex);
+  ocloc_library_configured = true;
+  if (path.empty()) {
+    ocloc_library = OclocLibrary();
+    return true;
+  }
+  OclocLibrary library;
+  if (!load_ocloc_library(path, library)) {
+    return false;
+  }
+  ocloc_library = library;
+  return true;
+}
+
+OfflineCompilerStatistics offline_compiler_statistics() {
+  std::lock_guard<std::mutex> lock(offline_compiler_mutex);
+  return statistics;
 }
 
 } // namespace compute_samples
@@ -6,7 +6,9 @@
  */
 
 #include <fstream>
+#include <future>
 #include "logging/logging.hpp"
+#include "utils/temporary_directory.hpp"
 #include "utils/utils.hpp"
 #include "offline_compiler/offline_compiler.hpp"
 #include "test_harness/test_harness.hpp"
@@ -51,6 +53,22 @@ HWTEST(OfflineCompilerIntegrationTests, GenerateSPIRVFromFileWithBuildOptions) {
   }
 }
 
+HWTEST(OfflineCompilerIntegrationTests,
+       GenerateSPIRVFromFileInDirectoryWithSpaces) {
+  const cs::TemporaryDirectory directory("offline compiler's");
+  const std::string source = "kernel void my_kernel(){int x = MY_VARIABLE;}";
+  const std::string cl_path = directory.file("kernel.cl");
+  cs::save_text_file(source, cl_path);
+
+  const std::string spv_path =
+      cs::generate_spirv(cl_path, "-DMY_VARIABLE=3 -DNAME=\"a 'b'\"");
+
+  EXPECT_EQ(directory.file("kernel.spv"), spv_path);
+  std::ifstream spv_file(spv_path.c_str());
+  EXPECT_TRUE(spv_file.good());
+  EXPECT_TRUE(spv_file.peek() != std::ifstream::traits_type::eof());
+}
+
 HWTEST(OfflineCompilerIntegrationTests, GenerateSPIRVFromFileInvalidPath) {
   const std::string cl_path = "not_existing.cl";
   EXPECT_THROW(cs::generate_spirv(cl_path), std::runtime_error);
@@ -84,3 +102,99 @@ HWTEST(OfflineCompilerIntegrationTests, GenerateSPIRVFromSourceInvalidKernel) {
   const std::string source = "kernel void xyz";
   EXPECT_THROW(cs::generate_spirv_from_source(source), std::runtime_error);
 }
+
+class SpirvCache : public testing::Test {
+protected:
+  void SetUp() override {
+    cs::enable_spirv_cache(directory_);
+    cs::spirv_cache()->clear();
+  }
+
+  void TearDown() override {
+    cs::spirv_cache()->clear();
+    cs::disable_spirv_cache();
+  }
+
+  const std::string directory_ = "spirv_cache_test";
+  const std::string source_ = "kernel void my_kernel(){}";
+};
+
+HWTEST_F(SpirvCache, SecondCompilationLoadsSPIRV) {
+  const cs::OfflineCompilerStatistics before =
+      cs::offline_compiler_statistics();
+  const std::vector<uint8_t> compiled = cs::compile_spirv(source_);
+  EXPECT_EQ(compiled, cs::compile_spirv(source_));
+  cs::compile_spirv(source_, "-DMY_VARIABLE=3");
+
+  const cs::OfflineCompilerStatistics after = cs::offline_compiler_statistics();
+  EXPECT_EQ(before.hits + 1, after.hits);
+  EXPECT_EQ(before.misses + 2, after.misses);
+}
+
+HWTEST_F(SpirvCache, EditedIncludeIsMiss) {
+  const std::string cl_path = "kernel.cl";
+  const std::string header_path = "spirv_cache_value.h";
+  cs::save_text_file("#include \"spirv_cache_value.h\"\n"
+                     "kernel void my_kernel(){int x = VALUE;}",
+                     cl_path);
+  cs::save_text_file("#define VALUE 1\n", header_path);
+  const cs::OfflineCompilerStatistics before =
+      cs::offline_compiler_statistics();
+  cs::generate_spirv(cl_path);
+  cs::generate_spirv(cl_path);
+  cs::save_text_file("#define VALUE 2\n", header_path);
+  const std::string spv_path = cs::generate_spirv(cl_path);
+
+  const cs::OfflineCompilerStatistics after = cs::offline_compiler_statistics();
+  EXPECT_EQ(before.hits + 1, after.hits);
+  EXPECT_EQ(before.misses + 2, after.misses);
+
+  for (const std::string &path : {cl_path, header_path, spv_path}) {
+    if (std::remove(path.c_str()) != 0) {
+      LOG_DEBUG << "Deleting file " << path << " failed";
+    }
+  }
+}
+
+HWTEST_F(SpirvCache, ConcurrentCompilationsOfSameSourceCompileOnce) {
+  const cs::OfflineCompilerStatistics before =
+      cs::offline_compiler_statistics();
+  std::future<std::vector<uint8_t>> first =
+      std::async(std::launch::async, [this]() {
+        return cs::compile_spirv(source_);
+      });
+  std::future<std::vector<uint8_t>> second =
+      std::async(std::launch::async, [this]() {
+        return cs::compile_spirv(source_);
+      });
+  EXPECT_EQ(first.get(), second.get());
+
+  const cs::OfflineCompilerStatistics after = cs::offline_compiler_statistics();
+  EXPECT_EQ(before.hits + 1, after.hits);
+  EXPECT_EQ(before.misses + 1, after.misses);
+}
+
+TEST(OfflineCompilerIntegrationTests, NotExistingLibraryIsRejected) {
+  EXPECT_FALSE(cs::use_offline_compiler_library("not_existing_library"));
+  EXPECT_TRUE(cs::use_offline_compiler_library(""));
+}
+
+HWTEST(OfflineCompilerIntegrationTests, CompileFatBinaryForDevices) {
+  const std::string source = "kernel void my_kernel(){}";
+  const std::vector<std::string> devices = {"skl", "tgllp"};
+  const cs::FatBinary binary = cs::compile_fat_binary(source, devices);
+
+  ASSERT_NE(nullptr, binary.spirv());
+  EXPECT_FALSE(binary.spirv()->data.empty());
+  for (const std::string &device : devices) {
+    const cs::FatBinaryEntry *native =
+        binary.find(cs::FatBinaryFormat::native, device);
+    ASSERT_NE(nullptr, native);
+    EXPECT_EQ(cs::compile_native(source, "", device), native->data);
+  }
+}
+
+TEST(OfflineCompilerIntegrationTests, CompileFatBinaryWithoutDevicesThrows) {
+  EXPECT_THROW(cs::compile_fat_binary("kernel void my_kernel(){}", {}),
+               std::invalid_argument);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "random/random.hpp"
+#include "timer/timer.hpp"
+#include "logging/logging.hpp"
+
+namespace po = boost::program_options;
+namespace cs = compute_samples;
+
+namespace {
+struct Arguments {
+  int size_mb = 0;
+  int iterations = 0;
+  int max_threads = 0;
+};
+
+// Sums a prefix of the output, so that the checksum does not dominate timing
+template <typename T> double checksum(const std::vector<T> &data) {
+  double sum = 0.0;
+  for (size_t i = 0; i < std::min<size_t>(data.size(), 1024); ++i) {
+    sum += static_cast<double>(data[i]);
+  }
+  return sum;
+}
+
+void report(const std::string &name, const size_t bytes, const int iterations,
+            const std::function<double()> &run) {
+  double sum = 0.0;
+  cs::Timer timer;
+  for (int i = 0; i < iterations; ++i) {
+    sum += run();
+  }
+  const double seconds = timer.elapsed();
+  const double gigabytes = static_cast<double>(bytes) * iterations / 1e9;
+  LOG_INFO << name << ": " << gigabytes / seconds << " GB/s (checksum " << sum
+           << ")";
+}
+
+// Distribution of the standard library matching the range of T
+template <typename T>
+using std_distribution =
+    typename std::conditional<std::is_floating_point<T>::value,
+                              std::uniform_real_distribution<T>,
+                              std::uniform_int_distribution<T>>::type;
+
+template <typename T>
+void benchmark_type(const std::string &type, const Arguments &args,
+                    const T min, const T max) {
+  const size_t count = (static_cast<size_t>(args.size_mb) << 20) / sizeof(T);
+  const size_t bytes = count * sizeof(T);
+  std::vector<T> data(count);
+
+  report(type + " std::default_random_engine", bytes, args.iterations, [&] {
+    std::default_random_engine engine(1);
+    std_distribution<T> distribution(min, max);
+    std::generate(data.begin(), data.end(),
+                  [&] { return distribution(engine); });
+    return checksum(data);
+  });
+  for (int threads = 1; threads <= args.max_threads; threads *= 2) {
+    report(type + " philox, " + std::to_string(threads) + " threads", bytes,
+           args.iterations, [&] {
+             cs::fill_random(data.data(), data.size(), min, max, 1, threads);
+             return checksum(data);
+           });
+  }
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  std::vector<std::string> command_line(argv + 1, argv + argc);
+  cs::init_logging(command_line);
+
+  Arguments args;
+  po::options_description desc("Allowed options");
+  auto options = desc.add_options();
+  options("help,h", "show help message");
+  options("size-mb", po::value<int>(&args.size_mb)->default_value(64),
+          "size of generated data of each type in megabytes");
+  options("iterations", po::value<int>(&args.iterations)->default_value(5),
+          "number of runs per method");
+  options("max-threads",
+          po::value<int>(&args.max_threads)
+              ->default_value(std::max(
+                  1, static_cast<int>(std::thread::hardware_concurrency()))),
+          "largest thread count, counts are doubled starting from 1");
+  po::variables_map vm;
+  po::store(po::command_line_parser(command_line).options(desc).run(), vm);
+  if (vm.count("help") != 0u) {
+    std::cout << desc;
+    return 0;
+  }
+  po::notify(vm);
+
+  // uint8_t has no standard distribution, so uint16_t is the narrowest type
+  benchmark_type<uint16_t>("uint16_t", args, 0, 1000);
+  benchmark_type<uint32_t>("uint32_t", args, 0,
+                           std::numeric_limits<uint32_t>::max());
+  benchmark_type<uint64_t>("uint64_t", args, 0,
+                           std::numeric_limits<uint64_t>::max());
+  benchmark_type<float>("float", args, -1.0f, 1.0f);
+  benchmark_type<double>("double", args, -1.0, 1.0);
+  return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_PHILOX_HPP
+#define COMPUTE_SAMPLES_PHILOX_HPP
+
+#include <array>
+#include <cstdint>
+
+namespace compute_samples {
+
+// Philox4x32-10 counter-based generator from Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3". Every output block is a pure function of the
+// key and the counter, so blocks can be generated in any order and on any
+// number of threads.
+class Philox4x32 {
+public:
+  using counter_type = std::array<uint32_t, 4>;
+  using key_type = std::array<uint32_t, 2>;
+  using result_type = std::array<uint32_t, 4>;
+
+  explicit Philox4x32(const key_type &key) : key_(key) {}
+  explicit Philox4x32(const uint64_t seed)
+      : key_{{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}} {
+  }
+
+  result_type operator()(const counter_type &counter) const {
+    result_type state = counter;
+    key_type key = key_;
+    for (int round = 0; round < 10; ++round) {
+      const uint64_t product0 = uint64_t(0xd2511f53) * state[0];
+      const uint64_t product1 = uint64_t(0xcd9e8d57) * state[2];
+      state = {{static_cast<uint32_t>(product1 >> 32) ^ state[1] ^ key[0],
+                static_cast<uint32_t>(product1),
+                static_cast<uint32_t>(product0 >> 32) ^ state[3] ^ key[1],
+                static_cast<uint32_t>(product0)}};
+      key[0] += 0x9e3779b9;
+      key[1] += 0xbb67ae85;
+    }
+    return state;
+  }
+
+  // Block number block of the stream, the high counter words are zero
+  result_type operator()(const uint64_t block) const {
+    return (*this)(counter_type{{static_cast<uint32_t>(block),
+                                 static_cast<uint32_t>(block >> 32), 0, 0}});
+  }
+
+private:
+  key_type key_;
+};
+
+} // namespace compute_samples
+
+#endif
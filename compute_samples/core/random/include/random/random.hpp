@@ -8,30 +8,101 @@
 #ifndef COMPUTE_SAMPLES_RANDOM_HPP
 #define COMPUTE_SAMPLES_RANDOM_HPP
 
-#include <vector>
-#include <random>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <limits>
-#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "random/philox.hpp"
+
+// Element index of seed is generated from Philox4x32 block index / lanes,
+// where lanes is 4 for types of up to 32 bits and 2 for 64-bit types. Every
+// value is therefore a pure function of seed and index: the same seed always
+// reproduces the same data, on any number of threads.
 
 namespace compute_samples {
+
+namespace detail {
+template <typename T>
+using random_word_t =
+    typename std::conditional<sizeof(T) <= 4, uint32_t, uint64_t>::type;
+
+inline void random_word(const Philox4x32::result_type &block,
+                        const size_t lane, uint32_t &word) {
+  word = block[lane];
+}
+
+inline void random_word(const Philox4x32::result_type &block,
+                        const size_t lane, uint64_t &word) {
+  word = block[2 * lane] | (static_cast<uint64_t>(block[2 * lane + 1]) << 32);
+}
+
+// High 64 bits of the 128-bit product
+inline uint64_t multiply_high(const uint64_t a, const uint64_t b) {
+  const uint64_t a_low = a & 0xffffffff;
+  const uint64_t a_high = a >> 32;
+  const uint64_t b_low = b & 0xffffffff;
+  const uint64_t b_high = b >> 32;
+  const uint64_t cross = (a_low * b_low >> 32) + (a_high * b_low & 0xffffffff) +
+                         a_low * b_high;
+  return a_high * b_high + (a_high * b_low >> 32) + (cross >> 32);
+}
+
+// Integers scale the random word by the size of [min, max] and keep the high
+// part. The bias is below size / 2^32 or size / 2^64, negligible for data.
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, T>::type
+uniform(const random_word_t<T> word, const T min, const T max) {
+  using U = typename std::make_unsigned<T>::type;
+  const uint64_t range = static_cast<U>(static_cast<U>(max) - min);
+  uint64_t offset = 0;
+  if (sizeof(T) <= 4) {
+    offset = (word * (range + 1)) >> 32;
+  } else {
+    offset = range == std::numeric_limits<uint64_t>::max()
+                 ? word
+                 : multiply_high(word, range + 1);
+  }
+  return static_cast<T>(static_cast<U>(static_cast<U>(min) + offset));
+}
+
+// Floating point values use as many random bits as the mantissa holds
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value, T>::type
+uniform(const random_word_t<T> word, const T min, const T max) {
+  const int bits = std::numeric_limits<T>::digits;
+  const T unit = static_cast<T>(word >> (sizeof(word) * 8 - bits)) /
+                 static_cast<T>(random_word_t<T>(1) << bits);
+  const T value = min + unit * (max - min);
+  return value > max ? max : value;
+}
+
+// Runs fill(begin, end) over [0, count) split between threads, zero selects
+// the number of hardware threads. Small counts run on the calling thread.
+void fill_in_parallel(const size_t count, const int thread_count,
+                      const std::function<void(size_t, size_t)> &fill);
+} // namespace detail
+
+// Value index of the stream of seed, uniformly distributed in [min, max]
+template <typename T>
+T generate_value(const T min, const T max, const int seed,
+                 const uint64_t index) {
+  using W = detail::random_word_t<T>;
+  const uint64_t lanes = sizeof(Philox4x32::result_type) / sizeof(W);
+  const Philox4x32::result_type block =
+      Philox4x32(static_cast<uint32_t>(seed))(index / lanes);
+  W word = 0;
+  detail::random_word(block, static_cast<size_t>(index % lanes), word);
+  return detail::uniform<T>(word, min, max);
+}
+
+// First value of the stream of seed
 template <typename T>
 T generate_value(const T min, const T max, const int seed) {
-  static std::default_random_engine engine(seed);
-  std::uniform_int_distribution<T> distribution(min, max);
-  return distribution(engine);
-}
-
-template <>
-int8_t generate_value<int8_t>(const int8_t min, const int8_t max,
-                              const int seed);
-template <>
-uint8_t generate_value<uint8_t>(const uint8_t min, const uint8_t max,
-                                const int seed);
-template <>
-float generate_value<float>(const float min, const float max, const int seed);
-template <>
-double generate_value<double>(const double min, const double max,
-                              const int seed);
+  return generate_value(min, max, seed, 0);
+}
 
 template <typename T> T generate_value(const int seed) {
   const T min = std::numeric_limits<T>::min();
@@ -39,21 +110,46 @@ template <typename T> T generate_value(const int seed) {
   return generate_value(min, max, seed);
 }
 
+// Fills data with values 0 to size - 1 of the stream of seed
+template <typename T>
+void fill_random(T *data, const size_t size, const T min, const T max,
+                 const int seed, const int thread_count = 0) {
+  using W = detail::random_word_t<T>;
+  const size_t lanes = sizeof(Philox4x32::result_type) / sizeof(W);
+  const Philox4x32 philox(static_cast<uint32_t>(seed));
+  detail::fill_in_parallel(size, thread_count, [&](size_t i, const size_t end) {
+    // Whole blocks in the middle, partial ones at both ends
+    for (; i < end && (i % lanes != 0 || end - i < lanes); ++i) {
+      data[i] = generate_value(min, max, seed, i);
+    }
+    for (; i + lanes <= end; i += lanes) {
+      const Philox4x32::result_type block = philox(i / lanes);
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        W word = 0;
+        detail::random_word(block, lane, word);
+        data[i + lane] = detail::uniform<T>(word, min, max);
+      }
+    }
+    for (; i < end; ++i) {
+      data[i] = generate_value(min, max, seed, i);
+    }
+  });
+}
+
 template <typename T>
 std::vector<T> generate_vector(const int size, const T min, const T max,
-                               const int seed) {
+                               const int seed, const int thread_count = 0) {
   std::vector<T> data(size);
-  std::generate(data.begin(), data.end(),
-                [&] { return generate_value<T>(min, max, seed); });
+  fill_random(data.data(), data.size(), min, max, seed, thread_count);
   return data;
 }
 
 template <typename T>
-std::vector<T> generate_vector(const int size, const int seed) {
-  std::vector<T> data(size);
-  std::generate(data.begin(), data.end(),
-                [&] { return generate_value<T>(seed); });
-  return data;
+std::vector<T> generate_vector(const int size, const int seed,
+                               const int thread_count = 0) {
+  const T min = std::numeric_limits<T>::min();
+  const T max = std::numeric_limits<T>::max();
+  return generate_vector(size, min, max, seed, thread_count);
 }
 
 } // namespace compute_samples
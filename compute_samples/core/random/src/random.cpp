@@ -7,34 +7,49 @@
 
 #include "random/random.hpp"
 
-namespace compute_samples {
-template <>
-int8_t generate_value<int8_t>(const int8_t min, const int8_t max,
-                              const int seed) {
-  return static_cast<int8_t>(generate_value<int32_t>(min, max, seed));
-}
+#include <algorithm>
+#include <system_error>
+#include <thread>
 
-template <>
-uint8_t generate_value<uint8_t>(const uint8_t min, const uint8_t max,
-                                const int seed) {
-  return static_cast<uint8_t>(generate_value<uint32_t>(min, max, seed));
-}
+namespace compute_samples {
+namespace detail {
 
-template <>
-float generate_value<float>(const float min, const float max, const int seed) {
-  static std::default_random_engine engine(seed);
-  std::uniform_real_distribution<float> distribution(
-      min, std::nextafter(max, std::numeric_limits<float>::max()));
-  return distribution(engine);
-}
+void fill_in_parallel(const size_t count, const int thread_count,
+                      const std::function<void(size_t, size_t)> &fill) {
+  // Smallest share of a thread, starting threads costs more below it.
+  // A multiple of every lane count so that blocks are not split.
+  const size_t minimum_chunk = size_t(1) << 16;
+  const size_t requested =
+      thread_count > 0
+          ? static_cast<size_t>(thread_count)
+          : std::max<size_t>(1, std::thread::hardware_concurrency());
+  const size_t threads = std::max<size_t>(
+      1, std::min(requested, count / minimum_chunk));
+  if (threads == 1) {
+    fill(0, count);
+    return;
+  }
 
-template <>
-double generate_value<double>(const double min, const double max,
-                              const int seed) {
-  static std::default_random_engine engine(seed);
-  std::uniform_real_distribution<double> distribution(
-      min, std::nextafter(max, std::numeric_limits<double>::max()));
-  return distribution(engine);
+  // Shares rounded up to whole chunks, the calling thread takes the last one
+  const size_t chunks = (count + minimum_chunk - 1) / minimum_chunk;
+  const size_t share = (chunks + threads - 1) / threads * minimum_chunk;
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  size_t begin = 0;
+  for (size_t i = 0; i + 1 < threads && begin + share < count; ++i) {
+    try {
+      workers.emplace_back(fill, begin, begin + share);
+    } catch (const std::system_error &) {
+      // Out of threads, the calling thread fills the rest
+      break;
+    }
+    begin += share;
+  }
+  fill(begin, count);
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
 }
 
+} // namespace detail
 } // namespace compute_samples
@@ -6,9 +6,12 @@
  */
 
 #include "random/random.hpp"
+#include "random/philox.hpp"
 #include "gtest/gtest.h"
 
+#include <array>
 #include <limits>
+#include <vector>
 
 namespace cs = compute_samples;
 
@@ -116,3 +119,86 @@ TYPED_TEST(GenerateVector, WithExpectedSize) {
       cs::generate_vector<TypeParam>(this->size, this->seed);
   EXPECT_EQ(this->size, vector.size());
 }
+
+TYPED_TEST(GenerateVector, ReproducibleFromSeed) {
+  const std::vector<TypeParam> first =
+      cs::generate_vector<TypeParam>(this->size, this->seed);
+  EXPECT_EQ(first, cs::generate_vector<TypeParam>(this->size, this->seed));
+  EXPECT_NE(first, cs::generate_vector<TypeParam>(this->size, this->seed + 1));
+}
+
+TYPED_TEST(GenerateVector, ElementsMatchGenerateValue) {
+  const TypeParam min = 1;
+  const TypeParam max = 100;
+  const std::vector<TypeParam> vector =
+      cs::generate_vector(this->size, min, max, this->seed);
+  for (size_t i = 0; i < vector.size(); ++i) {
+    EXPECT_EQ(cs::generate_value(min, max, this->seed, i), vector[i]);
+  }
+  EXPECT_EQ(cs::generate_value(min, max, this->seed), vector[0]);
+}
+
+TYPED_TEST(GenerateVector, IndependentOfThreadCount) {
+  // Not a multiple of the chunk or block size, so shares end mid block
+  const int size = (1 << 18) + 3;
+  const TypeParam min = std::numeric_limits<TypeParam>::min();
+  const TypeParam max = std::numeric_limits<TypeParam>::max();
+  const std::vector<TypeParam> expected =
+      cs::generate_vector(size, min, max, this->seed, 1);
+  for (const int threads : {2, 3, 8}) {
+    EXPECT_EQ(expected,
+              cs::generate_vector(size, min, max, this->seed, threads));
+  }
+  std::vector<TypeParam> tail(size - 5);
+  cs::fill_random(tail.data(), tail.size(), min, max, this->seed, 3);
+  EXPECT_TRUE(std::equal(tail.begin(), tail.end(), expected.begin()));
+}
+
+TYPED_TEST(GenerateIntegerVector, CoversSmallRangeUniformly) {
+  const int size = 40000;
+  const std::vector<TypeParam> vector = cs::generate_vector(
+      size, TypeParam(0), TypeParam(3), this->seed);
+  std::array<int, 4> histogram{};
+  for (const TypeParam value : vector) {
+    ++histogram[static_cast<size_t>(value)];
+  }
+  for (const int count : histogram) {
+    EXPECT_NEAR(size / 4, count, size / 100);
+  }
+}
+
+TEST(GenerateVector, FullRangeUsesHighBits) {
+  const std::vector<uint64_t> vector =
+      cs::generate_vector<uint64_t>(1000, 0);
+  uint64_t all = 0;
+  for (const uint64_t value : vector) {
+    all |= value;
+  }
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), all);
+}
+
+TEST(Philox4x32, KnownAnswers) {
+  // Test vectors of the Random123 reference implementation
+  const cs::Philox4x32::counter_type zeros{{0, 0, 0, 0}};
+  EXPECT_EQ((cs::Philox4x32::result_type{
+                {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}}),
+            cs::Philox4x32(cs::Philox4x32::key_type{{0, 0}})(zeros));
+  const cs::Philox4x32::counter_type ones{
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}};
+  EXPECT_EQ((cs::Philox4x32::result_type{
+                {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}}),
+            cs::Philox4x32(cs::Philox4x32::key_type{{0xffffffff, 0xffffffff}})(
+                ones));
+  const cs::Philox4x32::counter_type pi{
+      {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+  EXPECT_EQ((cs::Philox4x32::result_type{
+                {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}}),
+            cs::Philox4x32(cs::Philox4x32::key_type{{0xa4093822, 0x299f31d0}})(
+                pi));
+}
+
+TEST(Philox4x32, BlockCounter) {
+  const cs::Philox4x32 philox(uint64_t(0x0123456789abcdef));
+  const cs::Philox4x32::counter_type counter{{0x89abcdef, 0x01234567, 0, 0}};
+  EXPECT_EQ(philox(counter), philox(uint64_t(0x0123456789abcdef)));
+}
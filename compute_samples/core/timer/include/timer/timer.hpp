@@ -15,6 +15,7 @@ class Timer {
 public:
   Timer();
   void print(const std::string &event_name);
+  double elapsed() const;
 
 private:
   boost::timer::cpu_timer timer_;
@@ -19,4 +19,9 @@ void Timer::print(const std::string &event_name) {
            << timer_.format(timer::default_places, timer_format_);
   timer_.start();
 }
+
+double Timer::elapsed() const {
+  const timer::nanosecond_type wall = timer_.elapsed().wall;
+  return static_cast<double>(wall) * 1e-9;
+}
 } // namespace compute_samples
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <numeric>
+
+#include <boost/program_options.hpp>
+
+#include "utils/utils.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/cpu_features.hpp"
+#include "timer/timer.hpp"
+#include "logging/logging.hpp"
+
+namespace po = boost::program_options;
+namespace cs = compute_samples;
+
+namespace {
+struct Arguments {
+  std::string suite;
+  int size_mb = 0;
+  int iterations = 0;
+  std::string file;
+};
+
+// Touches every byte so that lazily mapped pages are actually read
+uint64_t checksum(const uint8_t *data, const size_t size) {
+  return std::accumulate(data, data + size, uint64_t(0));
+}
+
+void report(const std::string &name, const size_t bytes, const int iterations,
+            const std::function<uint64_t()> &run) {
+  uint64_t sum = 0;
+  cs::Timer timer;
+  for (int i = 0; i < iterations; ++i) {
+    sum += run();
+  }
+  const double seconds = timer.elapsed();
+  const double gigabytes = static_cast<double>(bytes) * iterations / 1e9;
+  LOG_INFO << name << ": " << gigabytes / seconds << " GB/s (checksum " << sum
+           << ")";
+}
+
+void benchmark_mapped_file(const Arguments &args) {
+  std::string path = args.file;
+  const bool generated = path.empty();
+  if (generated) {
+    path = "utils_benchmark.bin";
+    std::vector<uint8_t> data(static_cast<size_t>(args.size_mb) << 20);
+    std::iota(data.begin(), data.end(), uint8_t(0));
+    cs::save_binary_file(data, path);
+  }
+  const size_t bytes = cs::MappedFile(path).size();
+  LOG_INFO << "File: " << path << ", " << bytes << " bytes";
+
+  report("load_binary_file", bytes, args.iterations, [&] {
+    const std::vector<uint8_t> data = cs::load_binary_file(path);
+    return checksum(data.data(), data.size());
+  });
+  report("MappedFile", bytes, args.iterations, [&] {
+    const cs::MappedFile file(path);
+    return checksum(file.data(), file.size());
+  });
+
+  if (generated && std::remove(path.c_str()) != 0) {
+    LOG_DEBUG << "Deleting file " << path.c_str() << " failed";
+  }
+}
+
+// Element-wise implementation used by pack_vector before it was vectorized
+template <typename OUTPUT_TYPE, typename INPUT_TYPE>
+std::vector<OUTPUT_TYPE>
+legacy_pack_vector(const std::vector<INPUT_TYPE> &input, const int step) {
+  const size_t size_ratio = sizeof(OUTPUT_TYPE) / sizeof(INPUT_TYPE);
+  std::vector<OUTPUT_TYPE> output(input.size() / size_ratio);
+  const size_t columns = static_cast<size_t>(step);
+  const size_t rows = output.size() / columns;
+  for (size_t y = 0; y < rows; ++y) {
+    for (size_t x = 0; x < columns; ++x) {
+      std::vector<INPUT_TYPE> tmp(size_ratio);
+      for (size_t i = 0; i < tmp.size(); ++i) {
+        tmp[i] = input[y * columns * size_ratio + x + i * columns];
+      }
+      std::memcpy(&output[y * columns + x], tmp.data(), sizeof(OUTPUT_TYPE));
+    }
+  }
+  return output;
+}
+
+template <typename OUTPUT_TYPE, typename INPUT_TYPE>
+std::vector<OUTPUT_TYPE>
+legacy_unpack_vector(const std::vector<INPUT_TYPE> &input, const int step) {
+  const size_t size_ratio = sizeof(INPUT_TYPE) / sizeof(OUTPUT_TYPE);
+  std::vector<OUTPUT_TYPE> output(input.size() * size_ratio);
+  const size_t columns = static_cast<size_t>(step);
+  const size_t rows = input.size() / columns;
+  for (size_t y = 0; y < rows; ++y) {
+    for (size_t x = 0; x < columns; ++x) {
+      std::vector<OUTPUT_TYPE> tmp(size_ratio);
+      std::memcpy(tmp.data(), &input[y * columns + x], sizeof(INPUT_TYPE));
+      size_t output_offset = x + y * columns * size_ratio;
+      for (size_t i = 0; i < tmp.size(); ++i) {
+        output[output_offset] = tmp[i];
+        output_offset += columns;
+      }
+    }
+  }
+  return output;
+}
+
+template <typename Narrow, typename Wide>
+void benchmark_pack_vector(const Arguments &args, const std::string &name) {
+  const int step = 64;
+  const size_t bytes = static_cast<size_t>(args.size_mb) << 20;
+  std::vector<Narrow> narrow(bytes / sizeof(Narrow));
+  std::iota(narrow.begin(), narrow.end(), Narrow(0));
+  const std::vector<Wide> wide = cs::pack_vector<Wide>(narrow, step);
+
+  // Only a prefix is summed, so that the checksum does not dominate timing
+  const auto sum = [](const void *data, const size_t size) {
+    return checksum(static_cast<const uint8_t *>(data),
+                    std::min<size_t>(size, 4096));
+  };
+  report(name + " legacy_pack_vector", bytes, args.iterations, [&] {
+    const std::vector<Wide> out = legacy_pack_vector<Wide>(narrow, step);
+    return sum(out.data(), out.size() * sizeof(Wide));
+  });
+  report(name + " pack_vector", bytes, args.iterations, [&] {
+    const std::vector<Wide> out = cs::pack_vector<Wide>(narrow, step);
+    return sum(out.data(), out.size() * sizeof(Wide));
+  });
+  report(name + " legacy_unpack_vector", bytes, args.iterations, [&] {
+    const std::vector<Narrow> out = legacy_unpack_vector<Narrow>(wide, step);
+    return sum(out.data(), out.size() * sizeof(Narrow));
+  });
+  report(name + " unpack_vector", bytes, args.iterations, [&] {
+    const std::vector<Narrow> out = cs::unpack_vector<Narrow>(wide, step);
+    return sum(out.data(), out.size() * sizeof(Narrow));
+  });
+}
+
+void benchmark_pack_vector(const Arguments &args) {
+  LOG_INFO << "AVX2 enabled: " << cs::cpu_features().avx2;
+  benchmark_pack_vector<uint8_t, uint32_t>(args, "8->32");
+  benchmark_pack_vector<uint8_t, uint64_t>(args, "8->64");
+  benchmark_pack_vector<uint16_t, uint32_t>(args, "16->32");
+  benchmark_pack_vector<uint16_t, uint64_t>(args, "16->64");
+  benchmark_pack_vector<uint32_t, uint64_t>(args, "32->64");
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  std::vector<std::string> command_line(argv + 1, argv + argc);
+  cs::init_logging(command_line);
+
+  Arguments args;
+  po::options_description desc("Allowed options");
+  auto options = desc.add_options();
+  options("help,h", "show help message");
+  options("suite", po::value<std::string>(&args.suite)->default_value("all"),
+          "benchmark to run: all, mapped_file, pack_vector");
+  options("size-mb", po::value<int>(&args.size_mb)->default_value(64),
+          "size of benchmarked data in megabytes");
+  options("iterations", po::value<int>(&args.iterations)->default_value(5),
+          "number of runs per method");
+  options("file", po::value<std::string>(&args.file)->default_value(""),
+          "existing file to map instead of a generated one");
+  po::variables_map vm;
+  po::store(po::command_line_parser(command_line).options(desc).run(), vm);
+  if (vm.count("help") != 0u) {
+    std::cout << desc;
+    return 0;
+  }
+  po::notify(vm);
+
+  if (args.suite == "all" || args.suite == "mapped_file") {
+    benchmark_mapped_file(args);
+  }
+  if (args.suite == "all" || args.suite == "pack_vector") {
+    benchmark_pack_vector(args);
+  }
+  return 0;
+}
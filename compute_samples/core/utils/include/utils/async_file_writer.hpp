@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_ASYNC_FILE_WRITER_HPP
+#define COMPUTE_SAMPLES_ASYNC_FILE_WRITER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace compute_samples {
+
+// Sequential file output written by a background thread.
+// Data is copied into a bounded pool of aligned chunks, so write() blocks
+// only while max_bytes_in_flight are queued and memory use does not depend on
+// the length of the stream. Direct I/O bypasses the page cache (O_DIRECT on
+// Linux, FILE_FLAG_NO_BUFFERING on Windows) when the file system supports it,
+// otherwise the file is written buffered and is_direct() returns false.
+// Every direct write is a whole aligned chunk, and the padding of the last
+// chunk is truncated by close().
+class AsyncFileWriter {
+public:
+  static const size_t alignment = 4096;
+  static const size_t chunk_size = 1 << 20;
+
+  AsyncFileWriter() = default;
+  ~AsyncFileWriter();
+
+  AsyncFileWriter(const AsyncFileWriter &) = delete;
+  AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+
+  bool open(const std::string &file_path,
+            const size_t max_bytes_in_flight = 64 << 20,
+            const bool direct_io = false);
+  // Returns false once any earlier write has failed
+  bool write(const void *data, const size_t size);
+  // Waits for queued data and returns false if any write failed
+  bool close();
+
+  bool is_open() const { return is_open_; }
+  bool is_direct() const { return direct_; }
+  uint64_t size() const { return size_; }
+
+private:
+  struct Chunk {
+    std::vector<uint8_t> storage;
+    uint8_t *data = nullptr;
+    size_t used = 0;
+  };
+
+  bool open_file(const std::string &file_path, const bool direct_io);
+  bool write_file(const uint8_t *data, const size_t size);
+  bool truncate_file(const uint64_t size);
+  void close_file();
+  void queue_current();
+  void worker();
+
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+  std::vector<Chunk *> free_chunks_;
+  std::deque<Chunk *> queued_chunks_;
+  Chunk *current_ = nullptr;
+  std::string file_path_;
+  uint64_t size_ = 0;
+  bool is_open_ = false;
+  bool direct_ = false;
+  bool stopping_ = false;
+  bool failed_ = false;
+  std::mutex mutex_;
+  std::condition_variable free_condition_;
+  std::condition_variable queued_condition_;
+  std::thread thread_;
+#if defined(_WIN32)
+  void *file_ = nullptr;
+#else
+  int file_ = -1;
+#endif
+};
+
+} // namespace compute_samples
+
+#endif
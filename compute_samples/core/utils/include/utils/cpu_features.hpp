@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_CPU_FEATURES_HPP
+#define COMPUTE_SAMPLES_CPU_FEATURES_HPP
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define COMPUTE_SAMPLES_X86_64 1
+#endif
+
+// Enables instruction set extensions for a single function, so that SIMD code
+// paths can be selected at runtime without raising the baseline of the build.
+#if defined(__GNUC__) || defined(__clang__)
+#define COMPUTE_SAMPLES_TARGET(extensions) __attribute__((target(extensions)))
+#else
+#define COMPUTE_SAMPLES_TARGET(extensions)
+#endif
+
+namespace compute_samples {
+
+struct CpuFeatures {
+  bool sse2 = false;
+  bool ssse3 = false;
+  bool sse41 = false;
+  bool avx2 = false;
+  bool f16c = false;
+  bool avx512f = false;
+  bool avx512bw = false;
+  bool avx512fp16 = false;
+};
+
+// Features supported by both the processor and the operating system
+const CpuFeatures &cpu_features();
+
+} // namespace compute_samples
+
+#endif
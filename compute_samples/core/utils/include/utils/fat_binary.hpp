@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FAT_BINARY_HPP
+#define COMPUTE_SAMPLES_FAT_BINARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace compute_samples {
+
+enum class FatBinaryFormat : uint32_t { spirv = 0, native = 1 };
+
+struct FatBinaryEntry {
+  FatBinaryFormat format = FatBinaryFormat::spirv;
+  // Device the entry was compiled for, as named to the offline compiler
+  std::string target;
+  std::vector<uint8_t> data;
+};
+
+// Binaries of one program for several devices in a single file. The file
+// starts with an index of the format, target, offset and size of each entry,
+// followed by the data of the entries. Parsing throws std::runtime_error for
+// data which is not a fat binary or is truncated.
+class FatBinary {
+public:
+  void add(const FatBinaryFormat format, const std::string &target,
+           const std::vector<uint8_t> &data);
+  const std::vector<FatBinaryEntry> &entries() const { return entries_; }
+  // Returns null when there is no such entry
+  const FatBinaryEntry *find(const FatBinaryFormat format,
+                             const std::string &target) const;
+  const FatBinaryEntry *spirv() const;
+
+  std::vector<uint8_t> serialize() const;
+  static FatBinary parse(const uint8_t *data, const size_t size);
+  static FatBinary parse(const std::vector<uint8_t> &data) {
+    return parse(data.data(), data.size());
+  }
+
+  void save(const std::string &file_path) const;
+  static FatBinary load(const std::string &file_path);
+
+private:
+  std::vector<FatBinaryEntry> entries_;
+};
+
+} // namespace compute_samples
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FILE_CACHE_HPP
+#define COMPUTE_SAMPLES_FILE_CACHE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace compute_samples {
+
+struct FileCacheStatistics {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t stores = 0;
+  uint64_t evictions = 0;
+};
+
+// Content-addressed store of binary data in a directory shared by processes.
+// Entries are named by the SHA-256 of their key and hold the key itself, so
+// that a damaged entry or a different key is a miss. Entries are written to a
+// temporary file and renamed into place, so concurrent processes read either
+// a whole entry or none. Stores and loads record the time of use in the
+// entry header and stores evict the least recently used entries once the
+// entries take more than max_size bytes. Stores also remove temporary files
+// left behind for an hour by crashed processes. Failures to access the
+// directory are logged and make the cache behave as empty.
+class FileCache {
+public:
+  static const uint64_t default_max_size = 256ull << 20;
+
+  explicit FileCache(const std::string &directory,
+                     const uint64_t max_size = default_max_size);
+
+  FileCache(const FileCache &) = delete;
+  FileCache &operator=(const FileCache &) = delete;
+
+  bool load(const std::string &key, std::vector<uint8_t> &data);
+  bool store(const std::string &key, const std::vector<uint8_t> &data);
+  void remove(const std::string &key);
+  void clear();
+
+  // Bytes taken by all entries, including ones stored by other processes
+  uint64_t size() const;
+  const std::string &directory() const { return directory_; }
+  uint64_t max_size() const { return max_size_; }
+  FileCacheStatistics statistics() const;
+
+private:
+  std::string entry_path(const std::string &key) const;
+  void evict();
+
+  std::string directory_;
+  uint64_t max_size_;
+  mutable std::mutex mutex_;
+  FileCacheStatistics statistics_;
+};
+
+} // namespace compute_samples
+
+#endif
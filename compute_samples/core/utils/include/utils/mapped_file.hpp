@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_MAPPED_FILE_HPP
+#define COMPUTE_SAMPLES_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace compute_samples {
+
+// Read-only memory mapping of a whole file.
+// The mapping starts at a page boundary and the last page is zero-filled past
+// the end of the file, so mapped_data() and mapped_size() may be used as host
+// memory for CL_MEM_USE_HOST_PTR buffers without copying the file contents.
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &file_path);
+  ~MappedFile();
+
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool open(const std::string &file_path);
+  void close();
+  bool is_open() const { return is_open_; }
+
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const uint8_t *begin() const { return data_; }
+  const uint8_t *end() const { return data_ + size_; }
+  const uint8_t &operator[](const size_t i) const { return data_[i]; }
+  const char *chars() const { return reinterpret_cast<const char *>(data_); }
+
+  void *mapped_data() const;
+  size_t mapped_size() const;
+
+  // Asks the operating system to read the given range ahead of access.
+  // Returns immediately; ranges outside of the file are clipped.
+  void prefetch(const size_t offset, const size_t length) const;
+
+  static size_t page_size();
+
+private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  bool is_open_ = false;
+#if defined(_WIN32)
+  void *mapping_handle_ = nullptr;
+#endif
+};
+
+} // namespace compute_samples
+
+#endif
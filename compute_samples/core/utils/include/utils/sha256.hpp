@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_SHA256_HPP
+#define COMPUTE_SAMPLES_SHA256_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace compute_samples {
+
+// Incremental SHA-256 (FIPS 180-4), used to name content-addressed files
+class Sha256 {
+public:
+  Sha256();
+
+  void update(const void *data, const size_t size);
+  void update(const std::string &data) { update(data.data(), data.size()); }
+  // Pads the message, so that no update may follow
+  std::array<uint8_t, 32> digest();
+  // Lower case hexadecimal digest
+  std::string hex_digest();
+
+private:
+  void process_block(const uint8_t *block);
+
+  uint32_t state_[8];
+  uint8_t block_[64];
+  size_t block_size_ = 0;
+  uint64_t length_ = 0;
+};
+
+std::string sha256(const void *data, const size_t size);
+std::string sha256(const std::string &data);
+
+} // namespace compute_samples
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_SOURCE_DIGEST_HPP
+#define COMPUTE_SAMPLES_SOURCE_DIGEST_HPP
+
+#include <string>
+#include <vector>
+
+namespace compute_samples {
+
+// Directories of the -I options, given either as "-I dir" or as "-Idir",
+// where the directory may be quoted as "-I \"a dir\""
+std::vector<std::string> include_directories(const std::string &options);
+
+// SHA-256 of the source together with the files it includes, so that cache
+// keys change when an included file does. Includes of the source are looked
+// up in the directories, includes of included files first in the directory
+// of the including file. Includes which are not found, such as headers
+// provided by the compiler, contribute only their names. Conditional
+// compilation is ignored, every include directive found is hashed.
+std::string source_digest(const std::string &source,
+                          const std::vector<std::string> &directories);
+
+} // namespace compute_samples
+
+#endif
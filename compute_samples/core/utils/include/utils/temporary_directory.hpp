@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_TEMPORARY_DIRECTORY_HPP
+#define COMPUTE_SAMPLES_TEMPORARY_DIRECTORY_HPP
+
+#include <string>
+
+namespace compute_samples {
+
+// Directory with a unique name in the temporary directory of the system, so
+// that concurrent processes and threads never share files. It is removed
+// together with the files in it on destruction; subdirectories are not
+// supported. Throws std::runtime_error when it cannot be created.
+class TemporaryDirectory {
+public:
+  explicit TemporaryDirectory(const std::string &prefix = "compute_samples");
+  ~TemporaryDirectory();
+
+  TemporaryDirectory(const TemporaryDirectory &) = delete;
+  TemporaryDirectory &operator=(const TemporaryDirectory &) = delete;
+
+  const std::string &path() const { return path_; }
+  // Path of a file in the directory
+  std::string file(const std::string &name) const;
+
+private:
+  std::string path_;
+};
+
+} // namespace compute_samples
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_THREAD_POOL_HPP
+#define COMPUTE_SAMPLES_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace compute_samples {
+
+// Fixed set of worker threads executing tasks in submission order.
+// Exceptions thrown by a task are delivered through its future.
+// The destructor finishes all queued tasks before joining the workers.
+class ThreadPool {
+public:
+  // Zero selects the number of hardware threads
+  explicit ThreadPool(const int thread_count = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> submit(F &&task) {
+    using result_type = typename std::result_of<F()>::type;
+    auto packaged = std::make_shared<std::packaged_task<result_type()>>(
+        std::forward<F>(task));
+    std::future<result_type> result = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return result;
+  }
+
+  int size() const { return static_cast<int>(threads_.size()); }
+
+  static int hardware_threads();
+
+private:
+  void enqueue(std::function<void()> task);
+  void worker();
+
+  std::vector<std::thread> threads_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_ = false;
+};
+
+} // namespace compute_samples
+
+#endif
@@ -16,7 +16,10 @@
 #include <cstring>
 
 namespace compute_samples {
+class MappedFile;
+
 std::string load_text_file(const std::string &file_path);
+std::string load_text_file(const MappedFile &file);
 void save_text_file(const std::string data, const std::string &file_path);
 
 std::vector<uint8_t> load_binary_file(const std::string &file_path);
@@ -27,6 +30,17 @@ template <typename T> int size_in_bytes(const std::vector<T> &v) {
   return static_cast<int>(sizeof(T) * v.size());
 }
 
+namespace detail {
+// Moves rows of `streams` consecutive blocks of `columns` elements into rows of
+// `columns` groups of `streams` elements each, or back for deinterleave.
+void interleave_elements(const void *input, void *output,
+                         const size_t element_size, const size_t streams,
+                         const size_t columns, const size_t rows);
+void deinterleave_elements(const void *input, void *output,
+                           const size_t element_size, const size_t streams,
+                           const size_t columns, const size_t rows);
+} // namespace detail
+
 template <typename OUTPUT_TYPE, typename INPUT_TYPE>
 std::vector<OUTPUT_TYPE> pack_vector(const std::vector<INPUT_TYPE> &input,
                                      const int step) {
@@ -41,21 +55,8 @@ std::vector<OUTPUT_TYPE> pack_vector(const std::vector<INPUT_TYPE> &input,
   const size_t columns = static_cast<size_t>(step);
   const size_t rows = output.size() / columns;
 
-  for (size_t y = 0; y < rows; ++y) {
-    for (size_t x = 0; x < columns; ++x) {
-      std::vector<INPUT_TYPE> tmp(size_ratio);
-      for (size_t i = 0; i < tmp.size(); ++i) {
-        const size_t row_offset = y * columns * size_ratio;
-        const size_t column_offset = x;
-        const size_t element_offset = i * columns;
-        const size_t input_offset = row_offset + column_offset + element_offset;
-        tmp[i] = input[input_offset];
-      }
-      const size_t output_offset = y * columns + x;
-      std::memcpy(&output[output_offset], tmp.data(), sizeof(OUTPUT_TYPE));
-    }
-  }
-
+  detail::interleave_elements(input.data(), output.data(), sizeof(INPUT_TYPE),
+                              size_ratio, columns, rows);
   return output;
 }
 
@@ -73,18 +74,9 @@ std::vector<OUTPUT_TYPE> unpack_vector(const std::vector<INPUT_TYPE> &input,
   const size_t columns = static_cast<size_t>(step);
   const size_t rows = input.size() / columns;
 
-  for (size_t y = 0; y < rows; ++y) {
-    for (size_t x = 0; x < columns; ++x) {
-      std::vector<OUTPUT_TYPE> tmp(size_ratio);
-      const int input_offset = y * columns + x;
-      std::memcpy(tmp.data(), &input[input_offset], sizeof(INPUT_TYPE));
-      size_t output_offset = x + y * columns * size_ratio;
-      for (size_t i = 0; i < tmp.size(); ++i) {
-        output[output_offset] = tmp[i];
-        output_offset += columns;
-      }
-    }
-  }
+  detail::deinterleave_elements(input.data(), output.data(),
+                                sizeof(OUTPUT_TYPE), size_ratio, columns,
+                                rows);
   return output;
 }
 
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "utils/async_file_writer.hpp"
+#include "logging/logging.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace compute_samples {
+
+const size_t AsyncFileWriter::alignment;
+const size_t AsyncFileWriter::chunk_size;
+
+AsyncFileWriter::~AsyncFileWriter() { close(); }
+
+bool AsyncFileWriter::open(const std::string &file_path,
+                           const size_t max_bytes_in_flight,
+                           const bool direct_io) {
+  close();
+  if (!open_file(file_path, direct_io)) {
+    LOG_ERROR << "Failed to open file for writing: " << file_path;
+    return false;
+  }
+  file_path_ = file_path;
+  size_ = 0;
+  stopping_ = false;
+  failed_ = false;
+
+  // One chunk is filled by the caller while another one is written
+  const size_t chunk_count =
+      std::max<size_t>(2, max_bytes_in_flight / chunk_size);
+  chunks_.clear();
+  free_chunks_.clear();
+  for (size_t i = 0; i < chunk_count; ++i) {
+    std::unique_ptr<Chunk> chunk(new Chunk());
+    chunk->storage.resize(chunk_size + alignment);
+    const uintptr_t address =
+        reinterpret_cast<uintptr_t>(chunk->storage.data());
+    chunk->data =
+        chunk->storage.data() + (alignment - address % alignment) % alignment;
+    free_chunks_.push_back(chunk.get());
+    chunks_.push_back(std::move(chunk));
+  }
+
+  is_open_ = true;
+  thread_ = std::thread(&AsyncFileWriter::worker, this);
+  return true;
+}
+
+bool AsyncFileWriter::write(const void *data, const size_t size) {
+  const uint8_t *source = static_cast<const uint8_t *>(data);
+  size_t remaining = size;
+  while (remaining > 0) {
+    if (current_ == nullptr) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      free_condition_.wait(lock, [this] { return !free_chunks_.empty(); });
+      if (failed_) {
+        return false;
+      }
+      current_ = free_chunks_.back();
+      free_chunks_.pop_back();
+      current_->used = 0;
+    }
+    const size_t count = std::min(remaining, chunk_size - current_->used);
+    std::memcpy(current_->data + current_->used, source, count);
+    current_->used += count;
+    source += count;
+    remaining -= count;
+    size_ += count;
+    if (current_->used == chunk_size) {
+      queue_current();
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !failed_;
+}
+
+bool AsyncFileWriter::close() {
+  if (!is_open_) {
+    return true;
+  }
+  if (current_ != nullptr && current_->used > 0) {
+    queue_current();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  queued_condition_.notify_one();
+  thread_.join();
+
+  // Direct writes were padded to whole blocks
+  if (direct_ && size_ % alignment != 0 && !truncate_file(size_)) {
+    LOG_ERROR << "Failed to truncate file: " << file_path_;
+    failed_ = true;
+  }
+  close_file();
+  current_ = nullptr;
+  chunks_.clear();
+  free_chunks_.clear();
+  is_open_ = false;
+  return !failed_;
+}
+
+void AsyncFileWriter::queue_current() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_chunks_.push_back(current_);
+  }
+  current_ = nullptr;
+  queued_condition_.notify_one();
+}
+
+void AsyncFileWriter::worker() {
+  for (;;) {
+    Chunk *chunk = nullptr;
+    bool failed = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queued_condition_.wait(
+          lock, [this] { return stopping_ || !queued_chunks_.empty(); });
+      if (queued_chunks_.empty()) {
+        return;
+      }
+      chunk = queued_chunks_.front();
+      queued_chunks_.pop_front();
+      failed = failed_;
+    }
+
+    // Chunks are still drained after a failure, so that writers do not block
+    if (!failed) {
+      size_t size = chunk->used;
+      if (direct_) {
+        std::memset(chunk->data + size, 0,
+                    (alignment - size % alignment) % alignment);
+        size += (alignment - size % alignment) % alignment;
+      }
+      failed = !write_file(chunk->data, size);
+      if (failed) {
+        LOG_ERROR << "Failed to write file: " << file_path_;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      failed_ = failed_ || failed;
+      free_chunks_.push_back(chunk);
+    }
+    free_condition_.notify_one();
+  }
+}
+
+#if defined(_WIN32)
+bool AsyncFileWriter::open_file(const std::string &file_path,
+                                const bool direct_io) {
+  direct_ = false;
+  if (direct_io) {
+    HANDLE file = CreateFileA(file_path.c_str(), GENERIC_WRITE, 0, nullptr,
+                              CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING,
+                              nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+      file_ = file;
+      direct_ = true;
+      return true;
+    }
+    // Network shares and some file systems reject unbuffered handles
+    LOG_DEBUG << "Direct I/O is not supported for file: " << file_path;
+  }
+  HANDLE file = CreateFileA(file_path.c_str(), GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  file_ = file;
+  return true;
+}
+
+bool AsyncFileWriter::write_file(const uint8_t *data, const size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    DWORD count = 0;
+    if (WriteFile(static_cast<HANDLE>(file_), data + written,
+                  static_cast<DWORD>(size - written), &count,
+                  nullptr) == 0) {
+      return false;
+    }
+    written += count;
+  }
+  return true;
+}
+
+bool AsyncFileWriter::truncate_file(const uint64_t size) {
+  LARGE_INTEGER position;
+  position.QuadPart = static_cast<LONGLONG>(size);
+  return SetFilePointerEx(static_cast<HANDLE>(file_), position, nullptr,
+                          FILE_BEGIN) != 0 &&
+         SetEndOfFile(static_cast<HANDLE>(file_)) != 0;
+}
+
+void AsyncFileWriter::close_file() {
+  if (file_ != nullptr) {
+    CloseHandle(static_cast<HANDLE>(file_));
+  }
+  file_ = nullptr;
+}
+#else
+bool AsyncFileWriter::open_file(const std::string &file_path,
+                                const bool direct_io) {
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  direct_ = false;
+#if defined(O_DIRECT)
+  if (direct_io) {
+    file_ = ::open(file_path.c_str(), flags | O_DIRECT, 0644);
+    if (file_ >= 0) {
+      direct_ = true;
+      return true;
+    }
+    // File systems like tmpfs reject O_DIRECT
+    LOG_DEBUG << "Direct I/O is not supported for file: " << file_path;
+  }
+#else
+  if (direct_io) {
+    LOG_DEBUG << "Direct I/O is not supported on this platform";
+  }
+#endif
+  file_ = ::open(file_path.c_str(), flags, 0644);
+  return file_ >= 0;
+}
+
+bool AsyncFileWriter::write_file(const uint8_t *data, const size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    const ssize_t count = ::write(file_, data + written, size - written);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    written += static_cast<size_t>(count);
+  }
+  return true;
+}
+
+bool AsyncFileWriter::truncate_file(const uint64_t size) {
+  return ftruncate(file_, static_cast<off_t>(size)) == 0;
+}
+
+void AsyncFileWriter::close_file() {
+  if (file_ >= 0) {
+    ::close(file_);
+  }
+  file_ = -1;
+}
+#endif
+
+} // namespace compute_samples
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "utils/cpu_features.hpp"
+#include "logging/logging.hpp"
+
+#include <cstdint>
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace compute_samples {
+
+namespace {
+#if defined(COMPUTE_SAMPLES_X86_64)
+void cpuid(const uint32_t leaf, const uint32_t subleaf, uint32_t registers[4]) {
+#if defined(_MSC_VER)
+  int values[4] = {};
+  __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; ++i) {
+    registers[i] = static_cast<uint32_t>(values[i]);
+  }
+#else
+  __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2],
+                registers[3]);
+#endif
+}
+
+uint64_t xgetbv() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax = 0;
+  uint32_t edx = 0;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+bool bit(const uint32_t value, const int position) {
+  return ((value >> position) & 1u) != 0;
+}
+#endif
+
+CpuFeatures detect_cpu_features() {
+  CpuFeatures features;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  uint32_t registers[4] = {};
+  cpuid(0, 0, registers);
+  const uint32_t max_leaf = registers[0];
+
+  cpuid(1, 0, registers);
+  const uint32_t ecx1 = registers[2];
+  const uint32_t edx1 = registers[3];
+  features.sse2 = bit(edx1, 26);
+  features.ssse3 = bit(ecx1, 9);
+  features.sse41 = bit(ecx1, 19);
+
+  // AVX state has to be enabled by the operating system
+  const bool osxsave = bit(ecx1, 27);
+  const uint64_t xcr0 = osxsave ? xgetbv() : 0;
+  const bool avx_state = (xcr0 & 0x06) == 0x06;
+  const bool avx512_state = (xcr0 & 0xe6) == 0xe6;
+  const bool avx = bit(ecx1, 28) && avx_state;
+  features.f16c = avx && bit(ecx1, 29);
+
+  if (max_leaf >= 7) {
+    cpuid(7, 0, registers);
+    const uint32_t ebx7 = registers[1];
+    const uint32_t edx7 = registers[3];
+    features.avx2 = avx && bit(ebx7, 5);
+    features.avx512f = avx512_state && bit(ebx7, 16);
+    features.avx512bw = features.avx512f && bit(ebx7, 30);
+    features.avx512fp16 = features.avx512bw && bit(edx7, 23);
+  }
+#endif
+  LOG_DEBUG << "CPU features: sse2=" << features.sse2
+            << " ssse3=" << features.ssse3 << " sse41=" << features.sse41
+            << " avx2=" << features.avx2 << " f16c=" << features.f16c
+            << " avx512f=" << features.avx512f
+            << " avx512bw=" << features.avx512bw
+            << " avx512fp16=" << features.avx512fp16;
+  return features;
+}
+} // namespace
+
+const CpuFeatures &cpu_features() {
+  static const CpuFeatures features = detect_cpu_features();
+  return features;
+}
+
+} // namespace compute_samples
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "utils/fat_binary.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/utils.hpp"
+#include "logging/logging.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace compute_samples {
+namespace {
+const char fat_binary_magic[4] = {'C', 'S', 'F', 'B'};
+const uint32_t fat_binary_version = 1;
+
+template <typename T>
+void write_value(std::vector<uint8_t> &output, const T value) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+  output.insert(output.end(), bytes, bytes + sizeof(T));
+}
+
+class Reader {
+public:
+  Reader(const uint8_t *data, const size_t size) : data_(data), size_(size) {}
+
+  template <typename T> T value() {
+    T value;
+    std::memcpy(&value, bytes(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  const uint8_t *bytes(const size_t count) {
+    if (count > size_ - offset_) {
+      throw std::runtime_error("Fat binary is truncated");
+    }
+    const uint8_t *bytes = data_ + offset_;
+    offset_ += count;
+    return bytes;
+  }
+
+private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+} // namespace
+
+void FatBinary::add(const FatBinaryFormat format, const std::string &target,
+                    const std::vector<uint8_t> &data) {
+  FatBinaryEntry entry;
+  entry.format = format;
+  entry.target = target;
+  entry.data = data;
+  entries_.push_back(entry);
+}
+
+const FatBinaryEntry *FatBinary::find(const FatBinaryFormat format,
+                                      const std::string &target) const {
+  for (const FatBinaryEntry &entry : entries_) {
+    if (entry.format == format && entry.target == target) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+const FatBinaryEntry *FatBinary::spirv() const {
+  for (const FatBinaryEntry &entry : entries_) {
+    if (entry.format == FatBinaryFormat::spirv) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<uint8_t> FatBinary::serialize() const {
+  std::vector<uint8_t> output(fat_binary_magic,
+                              fat_binary_magic + sizeof(fat_binary_magic));
+  write_value(output, fat_binary_version);
+  write_value(output, static_cast<uint32_t>(entries_.size()));
+
+  uint64_t offset = output.size();
+  for (const FatBinaryEntry &entry : entries_) {
+    offset += 2 * sizeof(uint32_t) + entry.target.size() + 2 * sizeof(uint64_t);
+  }
+  for (const FatBinaryEntry &entry : entries_) {
+    write_value(output, static_cast<uint32_t>(entry.format));
+    write_value(output, static_cast<uint32_t>(entry.target.size()));
+    output.insert(output.end(), entry.target.begin(), entry.target.end());
+    write_value(output, offset);
+    write_value(output, static_cast<uint64_t>(entry.data.size()));
+    offset += entry.data.size();
+  }
+  for (const FatBinaryEntry &entry : entries_) {
+    output.insert(output.end(), entry.data.begin(), entry.data.end());
+  }
+  return output;
+}
+
+FatBinary FatBinary::parse(const uint8_t *data, const size_t size) {
+  Reader reader(data, size);
+  if (size < sizeof(fat_binary_magic) ||
+      std::memcmp(reader.bytes(sizeof(fat_binary_magic)), fat_binary_magic,
+                  sizeof(fat_binary_magic)) != 0) {
+    throw std::runtime_error("Not a fat binary");
+  }
+  const uint32_t version = reader.value<uint32_t>();
+  if (version != fat_binary_version) {
+    throw std::runtime_error("Unsupported fat binary version: " +
+                             std::to_string(version));
+  }
+
+  FatBinary binary;
+  const uint32_t count = reader.value<uint32_t>();
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint32_t format = reader.value<uint32_t>();
+    if (format > static_cast<uint32_t>(FatBinaryFormat::native)) {
+      throw std::runtime_error("Unknown fat binary format: " +
+                               std::to_string(format));
+    }
+    const uint32_t target_size = reader.value<uint32_t>();
+    const char *target =
+        reinterpret_cast<const char *>(reader.bytes(target_size));
+    const uint64_t offset = reader.value<uint64_t>();
+    const uint64_t entry_size = reader.value<uint64_t>();
+    if (offset > size || entry_size > size - offset) {
+      throw std::runtime_error("Fat binary is truncated");
+    }
+    FatBinaryEntry entry;
+    entry.format = static_cast<FatBinaryFormat>(format);
+    entry.target.assign(target, target_size);
+    entry.data.assign(data + offset, data + offset + entry_size);
+    binary.entries_.push_back(entry);
+  }
+  return binary;
+}
+
+void FatBinary::save(const std::string &file_path) const {
+  LOG_DEBUG << "Fat binary entries: " << entries_.size();
+  save_binary_file(serialize(), file_path);
+}
+
+FatBinary FatBinary::load(const std::string &file_path) {
+  MappedFile file;
+  if (!file.open(file_path)) {
+    throw std::runtime_error("Failed to open fat binary: " + file_path);
+  }
+  return parse(file.data(), file.size());
+}
+
+} // namespace compute_samples
@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "utils/file_cache.hpp"
+#include "utils/sha256.hpp"
+#include "logging/logging.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace compute_samples {
+namespace {
+const char entry_magic[4] = {'C', 'S', 'F', 'C'};
+const uint32_t entry_version = 2;
+// The use sequence follows the magic and the version
+const std::streamoff sequence_offset = 8;
+const char entry_extension[] = ".bin";
+const char temporary_extension[] = ".tmp";
+// Temporary files this old were left behind by crashed processes
+const uint64_t stale_temporary_seconds = 60 * 60;
+
+struct File {
+  std::string path;
+  uint64_t size = 0;
+  // Modification time in units of the platform
+  uint64_t time = 0;
+  // Use sequence of entries, only read for eviction
+  uint64_t sequence = 0;
+};
+
+#if defined(_WIN32)
+bool is_directory(const std::string &path) {
+  const DWORD attributes = GetFileAttributesA(path.c_str());
+  return attributes != INVALID_FILE_ATTRIBUTES &&
+         (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+bool make_directory(const std::string &path) {
+  return _mkdir(path.c_str()) == 0;
+}
+
+// Times are in 100 ns units since 1601
+const uint64_t time_units_per_second = 10000000;
+
+uint64_t current_time() {
+  FILETIME time;
+  GetSystemTimeAsFileTime(&time);
+  return static_cast<uint64_t>(time.dwHighDateTime) << 32 |
+         time.dwLowDateTime;
+}
+
+std::vector<File> list_files(const std::string &directory,
+                             const char *extension) {
+  std::vector<File> files;
+  WIN32_FIND_DATAA data;
+  HANDLE find =
+      FindFirstFileA((directory + "\\*" + extension).c_str(), &data);
+  if (find == INVALID_HANDLE_VALUE) {
+    return files;
+  }
+  do {
+    if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+      File file;
+      file.path = directory + "/" + data.cFileName;
+      file.size = static_cast<uint64_t>(data.nFileSizeHigh) << 32 |
+                  data.nFileSizeLow;
+      file.time = static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime)
+                      << 32 |
+                  data.ftLastWriteTime.dwLowDateTime;
+      files.push_back(file);
+    }
+  } while (FindNextFileA(find, &data) != 0);
+  FindClose(find);
+  return files;
+}
+
+bool replace_file(const std::string &from, const std::string &to) {
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+int process_id() { return _getpid(); }
+#else
+bool is_directory(const std::string &path) {
+  struct stat status;
+  return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+bool make_directory(const std::string &path) {
+  return mkdir(path.c_str(), 0755) == 0;
+}
+
+// Times are in nanoseconds since 1970
+const uint64_t time_units_per_second = 1000000000;
+
+uint64_t current_time() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count());
+}
+
+std::vector<File> list_files(const std::string &directory,
+                             const char *extension) {
+  std::vector<File> files;
+  DIR *dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    return files;
+  }
+  const size_t extension_size = std::strlen(extension);
+  while (const dirent *entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.size() <= extension_size ||
+        name.compare(name.size() - extension_size, extension_size,
+                     extension) != 0) {
+      continue;
+    }
+    File file;
+    file.path = directory + "/" + name;
+    struct stat status;
+    if (stat(file.path.c_str(), &status) != 0 || !S_ISREG(status.st_mode)) {
+      continue;
+    }
+    file.size = static_cast<uint64_t>(status.st_size);
+#if defined(__APPLE__)
+    const timespec &time = status.st_mtimespec;
+#else
+    const timespec &time = status.st_mtim;
+#endif
+    file.time = static_cast<uint64_t>(time.tv_sec) * 1000000000ull +
+                static_cast<uint64_t>(time.tv_nsec);
+    files.push_back(file);
+  }
+  closedir(dir);
+  return files;
+}
+
+bool replace_file(const std::string &from, const std::string &to) {
+  return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+int process_id() { return static_cast<int>(getpid()); }
+#endif
+
+// Creates the directory and its missing parents
+bool make_directories(const std::string &path) {
+  for (size_t i = 1; i <= path.size(); ++i) {
+    if (i == path.size() || path[i] == '/' || path[i] == '\\') {
+      const std::string parent = path.substr(0, i);
+      if (!is_directory(parent)) {
+        make_directory(parent);
+      }
+    }
+  }
+  return is_directory(path);
+}
+
+// Unique within the directory, so concurrent writers never share a file
+std::string temporary_path(const std::string &path) {
+  static std::atomic<unsigned> counter(0);
+  return path + "." + std::to_string(process_id()) + "." +
+         std::to_string(counter++) + temporary_extension;
+}
+
+// Orders the uses of entries. Modification times of some file systems are
+// too coarse to tell subsequent uses apart, so the sequence is the time of
+// use in nanoseconds, made strictly increasing within the process.
+uint64_t next_sequence() {
+  static std::atomic<uint64_t> last_sequence(0);
+  const uint64_t now = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count());
+  uint64_t last = last_sequence.load();
+  uint64_t sequence = 0;
+  do {
+    sequence = std::max(now, last + 1);
+  } while (!last_sequence.compare_exchange_weak(last, sequence));
+  return sequence;
+}
+
+template <typename T> void write_value(std::ostream &file, const T value) {
+  file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> bool read_value(std::istream &file, T &value) {
+  return static_cast<bool>(
+      file.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+bool read_header(std::istream &file, uint64_t &sequence) {
+  char magic[sizeof(entry_magic)];
+  uint32_t version = 0;
+  return file.read(magic, sizeof(magic)) && read_value(file, version) &&
+         std::memcmp(magic, entry_magic, sizeof(magic)) == 0 &&
+         version == entry_version && read_value(file, sequence);
+}
+
+// Zero for damaged entries, which are evicted first
+uint64_t read_sequence(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  uint64_t sequence = 0;
+  return read_header(file, sequence) ? sequence : 0;
+}
+
+// A concurrent update of the same entry only changes the eviction order
+void write_sequence(const std::string &path) {
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  file.seekp(sequence_offset);
+  write_value(file, next_sequence());
+}
+
+bool read_entry(const std::string &path, const std::string &key,
+                std::vector<uint8_t> &data) {
+  std::ifstream file(path, std::ios::binary);
+  uint64_t sequence = 0;
+  uint32_t key_size = 0;
+  if (!read_header(file, sequence) || !read_value(file, key_size) ||
+      key_size != key.size()) {
+    return false;
+  }
+  std::string entry_key(key_size, '\0');
+  uint64_t size = 0;
+  if (!file.read(&entry_key[0], key_size) || entry_key != key ||
+      !read_value(file, size)) {
+    return false;
+  }
+  data.resize(static_cast<size_t>(size));
+  return size == 0 ||
+         static_cast<bool>(file.read(reinterpret_cast<char *>(data.data()),
+                                     static_cast<std::streamsize>(size)));
+}
+} // namespace
+
+FileCache::FileCache(const std::string &directory, const uint64_t max_size)
+    : directory_(directory), max_size_(max_size) {
+  if (!make_directories(directory_)) {
+    LOG_WARNING << "Failed to create cache directory: " << directory_;
+  }
+}
+
+bool FileCache::load(const std::string &key, std::vector<uint8_t> &data) {
+  const std::string path = entry_path(key);
+  const bool hit = read_entry(path, key, data);
+  if (hit) {
+    write_sequence(path);
+  } else {
+    data.clear();
+  }
+  LOG_DEBUG << "Cache " << (hit ? "hit" : "miss") << ": " << path;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++(hit ? statistics_.hits : statistics_.misses);
+  return hit;
+}
+
+bool FileCache::store(const std::string &key,
+                      const std::vector<uint8_t> &data) {
+  const std::string path = entry_path(key);
+  const std::string temporary = temporary_path(path);
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(entry_magic, sizeof(entry_magic));
+    write_value(file, entry_version);
+    write_value(file, next_sequence());
+    write_value(file, static_cast<uint32_t>(key.size()));
+    file.write(key.data(), key.size());
+    write_value(file, static_cast<uint64_t>(data.size()));
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    file.close();
+    if (!file) {
+      LOG_WARNING << "Failed to write cache entry: " << temporary;
+      std::remove(temporary.c_str());
+      return false;
+    }
+  }
+  if (!replace_file(temporary, path)) {
+    // Another process may hold the entry open, which keeps its copy
+    LOG_DEBUG << "Failed to replace cache entry: " << path;
+    std::remove(temporary.c_str());
+    return false;
+  }
+  LOG_DEBUG << "Cache store: " << path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++statistics_.stores;
+  }
+  evict();
+  return true;
+}
+
+void FileCache::remove(const std::string &key) {
+  std::remove(entry_path(key).c_str());
+}
+
+void FileCache::clear() {
+  for (const File &entry : list_files(directory_, entry_extension)) {
+    std::remove(entry.path.c_str());
+  }
+}
+
+uint64_t FileCache::size() const {
+  uint64_t size = 0;
+  for (const File &entry : list_files(directory_, entry_extension)) {
+    size += entry.size;
+  }
+  return size;
+}
+
+FileCacheStatistics FileCache::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+std::string FileCache::entry_path(const std::string &key) const {
+  return directory_ + "/" + sha256(key) + entry_extension;
+}
+
+void FileCache::evict() {
+  const uint64_t now = current_time();
+  for (const File &file : list_files(directory_, temporary_extension)) {
+    if (file.time + stale_temporary_seconds * time_units_per_second < now) {
+      LOG_DEBUG << "Removing stale cache file: " << file.path;
+      std::remove(file.path.c_str());
+    }
+  }
+
+  std::vector<File> entries = list_files(directory_, entry_extension);
+  uint64_t size = 0;
+  for (const File &entry : entries) {
+    size += entry.size;
+  }
+  if (size <= max_size_) {
+    return;
+  }
+  for (File &entry : entries) {
+    entry.sequence = read_sequence(entry.path);
+  }
+  // Modification times and paths make the order total for entries written
+  // by older versions
+  std::sort(entries.begin(), entries.end(),
+            [](const File &a, const File &b) {
+              return std::tie(a.sequence, a.time, a.path) <
+                     std::tie(b.sequence, b.time, b.path);
+            });
+  uint64_t evictions = 0;
+  for (const File &entry : entries) {
+    if (size <= max_size_) {
+      break;
+    }
+    // Entries removed by another process count as freed as well
+    if (std::remove(entry.path.c_str()) == 0) {
+      ++evictions;
+      LOG_DEBUG << "Cache eviction: " << entry.path;
+    }
+    size -= entry.size;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  statistics_.evictions += evictions;
+}
+
+} // namespace compute_samples
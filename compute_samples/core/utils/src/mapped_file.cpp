@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "utils/mapped_file.hpp"
+#include "logging/logging.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace compute_samples {
+
+MappedFile::MappedFile(const std::string &file_path) {
+  if (!open(file_path)) {
+    throw std::runtime_error("Failed to map file: " + file_path);
+  }
+}
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    data_ = other.data_;
+    size_ = other.size_;
+    is_open_ = other.is_open_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.is_open_ = false;
+#if defined(_WIN32)
+    mapping_handle_ = other.mapping_handle_;
+    other.mapping_handle_ = nullptr;
+#endif
+  }
+  return *this;
+}
+
+#if defined(_WIN32)
+bool MappedFile::open(const std::string &file_path) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "File path: " << file_path;
+  close();
+
+  HANDLE file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    LOG_ERROR << "Failed to open file: " << file_path;
+    LOG_EXIT_FUNCTION
+    return false;
+  }
+
+  LARGE_INTEGER file_size;
+  if (GetFileSizeEx(file, &file_size) == 0) {
+    LOG_ERROR << "Failed to query file size: " << file_path;
+    CloseHandle(file);
+    LOG_EXIT_FUNCTION
+    return false;
+  }
+  size_ = static_cast<size_t>(file_size.QuadPart);
+
+  if (size_ != 0) {
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+      LOG_ERROR << "Failed to map file: " << file_path;
+      CloseHandle(file);
+      size_ = 0;
+      LOG_EXIT_FUNCTION
+      return false;
+    }
+    data_ = static_cast<const uint8_t *>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+      LOG_ERROR << "Failed to map view of file: " << file_path;
+      CloseHandle(mapping);
+      CloseHandle(file);
+      size_ = 0;
+      LOG_EXIT_FUNCTION
+      return false;
+    }
+    mapping_handle_ = mapping;
+  }
+  CloseHandle(file);
+
+  is_open_ = true;
+  LOG_DEBUG << "Mapped file size: " << size_;
+  LOG_EXIT_FUNCTION
+  return true;
+}
+
+void MappedFile::close() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_handle_ != nullptr) {
+    CloseHandle(mapping_handle_);
+  }
+  mapping_handle_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+  is_open_ = false;
+}
+
+size_t MappedFile::page_size() {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return static_cast<size_t>(info.dwPageSize);
+}
+
+void MappedFile::prefetch(const size_t offset, const size_t length) const {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+  if (data_ == nullptr || offset >= size_) {
+    return;
+  }
+  WIN32_MEMORY_RANGE_ENTRY range;
+  range.VirtualAddress = const_cast<uint8_t *>(data_) + offset;
+  range.NumberOfBytes = std::min(length, size_ - offset);
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+  // Prefetching needs Windows 8, older systems fault pages in on access
+  (void)offset;
+  (void)length;
+#endif
+}
+#else
+bool MappedFile::open(const std::string &file_path) {
+  LOG_ENTER_FUNCTION
+  LOG_DEBUG << "File path: " << file_path;
+  close();
+
+  const int fd = ::open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG_ERROR << "Failed to open file: " << file_path;
+    LOG_EXIT_FUNCTION
+    return false;
+  }
+
+  struct stat file_status = {};
+  if (fstat(fd, &file_status) != 0 || !S_ISREG(file_status.st_mode)) {
+    LOG_ERROR << "Failed to query regular file size: " << file_path;
+    ::close(fd);
+    LOG_EXIT_FUNCTION
+    return false;
+  }
+  size_ = static_cast<size_t>(file_status.st_size);
+
+  if (size_ != 0) {
+    void *address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      LOG_ERROR << "Failed to map file: " << file_path;
+      ::close(fd);
+      size_ = 0;
+      LOG_EXIT_FUNCTION
+      return false;
+    }
+    data_ = static_cast<const uint8_t *>(address);
+  }
+  // The mapping keeps its own reference to the file
+  ::close(fd);
+
+  is_open_ = true;
+  LOG_DEBUG << "Mapped file size: " << size_;
+  LOG_EXIT_FUNCTION
+  return true;
+}
+
+void MappedFile::close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  is_open_ = false;
+}
+
+size_t MappedFile::page_size() {
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+void MappedFile::prefetch(const size_t offset, const size_t length) const {
+  if (data_ == nullptr || offset >= size_) {
+    return;
+  }
+  // madvise needs a page aligned start address
+  const size_t begin = offset - offset % page_size();
+  const size_t end = offset + std::min(length, size_ - offset);
+  if (madvise(const_cast<uint8_t *>(data_) + begin, end - begin,
+              MADV_WILLNEED) != 0) {
+    LOG_DEBUG << "madvise failed for range " << begin << "-" << end;
+  }
+}
+#endif
+
+void *MappedFile::mapped_data() const { return const_cast<uint8_t *>(data_); }
+
+size_t MappedFile::mapped_size() const {
+  const size_t page = page_size();
+  return ((size_ + page - 1) / page) * page;
+}
+
+} // namespace compute_samples
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "utils/utils.hpp"
+#include "utils/cpu_features.hpp"
+
+#include <cstring>
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+#include <immintrin.h>
+#endif
+
+// pack_vector and unpack_vector move r streams of elements into r-way
+// interleaved rows and back. Both directions are built from one zip stage,
+// which interleaves vector j with vector j + r/2 for every j < r/2:
+// log2(r) stages interleave r vectors and log2(elements per vector) stages
+// deinterleave them.
+
+namespace compute_samples {
+namespace detail {
+
+namespace {
+// Number of columns handled together by the scalar path, so that all streams
+// of a tile stay in L1 while the interleaved output is written.
+const size_t scalar_tile = 64;
+
+template <size_t E>
+void interleave_scalar(const uint8_t *input, uint8_t *output,
+                       const size_t streams, const size_t columns,
+                       const size_t begin, const size_t end) {
+  for (size_t tile = begin; tile < end; tile += scalar_tile) {
+    const size_t tile_end = std::min(end, tile + scalar_tile);
+    for (size_t i = 0; i < streams; ++i) {
+      const uint8_t *src = input + (i * columns + tile) * E;
+      uint8_t *dst = output + (tile * streams + i) * E;
+      for (size_t x = tile; x < tile_end; ++x) {
+        std::memcpy(dst, src, E);
+        src += E;
+        dst += streams * E;
+      }
+    }
+  }
+}
+
+template <size_t E>
+void deinterleave_scalar(const uint8_t *input, uint8_t *output,
+                         const size_t streams, const size_t columns,
+                         const size_t begin, const size_t end) {
+  for (size_t tile = begin; tile < end; tile += scalar_tile) {
+    const size_t tile_end = std::min(end, tile + scalar_tile);
+    for (size_t i = 0; i < streams; ++i) {
+      const uint8_t *src = input + (tile * streams + i) * E;
+      uint8_t *dst = output + (i * columns + tile) * E;
+      for (size_t x = tile; x < tile_end; ++x) {
+        std::memcpy(dst, src, E);
+        src += streams * E;
+        dst += E;
+      }
+    }
+  }
+}
+
+void interleave_scalar_any(const uint8_t *input, uint8_t *output,
+                           const size_t element_size, const size_t streams,
+                           const size_t columns) {
+  for (size_t x = 0; x < columns; ++x) {
+    for (size_t i = 0; i < streams; ++i) {
+      std::memcpy(output + (x * streams + i) * element_size,
+                  input + (i * columns + x) * element_size, element_size);
+    }
+  }
+}
+
+void deinterleave_scalar_any(const uint8_t *input, uint8_t *output,
+                             const size_t element_size, const size_t streams,
+                             const size_t columns) {
+  for (size_t x = 0; x < columns; ++x) {
+    for (size_t i = 0; i < streams; ++i) {
+      std::memcpy(output + (i * columns + x) * element_size,
+                  input + (x * streams + i) * element_size, element_size);
+    }
+  }
+}
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+template <size_t E> struct Sse2;
+template <> struct Sse2<1> {
+  static __m128i lo(__m128i a, __m128i b) { return _mm_unpacklo_epi8(a, b); }
+  static __m128i hi(__m128i a, __m128i b) { return _mm_unpackhi_epi8(a, b); }
+};
+template <> struct Sse2<2> {
+  static __m128i lo(__m128i a, __m128i b) { return _mm_unpacklo_epi16(a, b); }
+  static __m128i hi(__m128i a, __m128i b) { return _mm_unpackhi_epi16(a, b); }
+};
+template <> struct Sse2<4> {
+  static __m128i lo(__m128i a, __m128i b) { return _mm_unpacklo_epi32(a, b); }
+  static __m128i hi(__m128i a, __m128i b) { return _mm_unpackhi_epi32(a, b); }
+};
+template <> struct Sse2<8> {
+  static __m128i lo(__m128i a, __m128i b) { return _mm_unpacklo_epi64(a, b); }
+  static __m128i hi(__m128i a, __m128i b) { return _mm_unpackhi_epi64(a, b); }
+};
+
+template <size_t E, size_t R> void zip_sse2(__m128i *v, const int stages) {
+  __m128i t[R];
+  for (int s = 0; s < stages; ++s) {
+    for (size_t j = 0; j < R / 2; ++j) {
+      t[2 * j] = Sse2<E>::lo(v[j], v[j + R / 2]);
+      t[2 * j + 1] = Sse2<E>::hi(v[j], v[j + R / 2]);
+    }
+    for (size_t j = 0; j < R; ++j) {
+      v[j] = t[j];
+    }
+  }
+}
+
+template <size_t E, size_t R>
+size_t interleave_sse2(const uint8_t *input, uint8_t *output,
+                       const size_t columns, size_t x) {
+  const size_t m = 16 / E;
+  const int stages = R == 2 ? 1 : (R == 4 ? 2 : 3);
+  for (; x + m <= columns; x += m) {
+    __m128i v[R];
+    for (size_t i = 0; i < R; ++i) {
+      v[i] = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(input + (i * columns + x) * E));
+    }
+    zip_sse2<E, R>(v, stages);
+    for (size_t i = 0; i < R; ++i) {
+      _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(output + (x * R + i * m) * E), v[i]);
+    }
+  }
+  return x;
+}
+
+template <size_t E, size_t R>
+size_t deinterleave_sse2(const uint8_t *input, uint8_t *output,
+                         const size_t columns, size_t x) {
+  const size_t m = 16 / E;
+  const int stages = m == 2 ? 1 : (m == 4 ? 2 : (m == 8 ? 3 : 4));
+  for (; x + m <= columns; x += m) {
+    __m128i v[R];
+    for (size_t i = 0; i < R; ++i) {
+      v[i] = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(input + (x * R + i * m) * E));
+    }
+    zip_sse2<E, R>(v, stages);
+    for (size_t i = 0; i < R; ++i) {
+      _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(output + (i * columns + x) * E), v[i]);
+    }
+  }
+  return x;
+}
+
+// AVX2 unpack instructions work within 128-bit lanes, so every lane runs the
+// SSE2 network on its own half of the data and whole lanes are reordered with
+// permute2x128 before (deinterleave) or after (interleave) the network.
+template <size_t E> struct Avx2;
+template <> struct Avx2<1> {
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static __m256i lo(__m256i a, __m256i b) {
+    return _mm256_unpacklo_epi8(a, b);
+  }
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static __m256i hi(__m256i a, __m256i b) {
+    return _mm256_unpackhi_epi8(a, b);
+  }
+};
+template <> struct Avx2<2> {
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static __m256i lo(__m256i a, __m256i b) {
+    return _mm256_unpacklo_epi16(a, b);
+  }
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static __m256i hi(__m256i a, __m256i b) {
+    return _mm256_unpackhi_epi16(a, b);
+  }
+};
+template <> struct Avx2<4> {
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static __m256i lo(__m256i a, __m256i b) {
+    return _mm256_unpacklo_epi32(a, b);
+  }
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static __m256i hi(__m256i a, __m256i b) {
+    return _mm256_unpackhi_epi32(a, b);
+  }
+};
+template <> struct Avx2<8> {
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static __m256i lo(__m256i a, __m256i b) {
+    return _mm256_unpacklo_epi64(a, b);
+  }
+  COMPUTE_SAMPLES_TARGET("avx2")
+  static __m256i hi(__m256i a, __m256i b) {
+    return _mm256_unpackhi_epi64(a, b);
+  }
+};
+
+template <size_t E, size_t R>
+COMPUTE_SAMPLES_TARGET("avx2")
+void zip_avx2(__m256i *v, const int stages) {
+  __m256i t[R];
+  for (int s = 0; s < stages; ++s) {
+    for (size_t j = 0; j < R / 2; ++j) {
+      t[2 * j] = Avx2<E>::lo(v[j], v[j + R / 2]);
+      t[2 * j + 1] = Avx2<E>::hi(v[j], v[j + R / 2]);
+    }
+    for (size_t j = 0; j < R; ++j) {
+      v[j] = t[j];
+    }
+  }
+}
+
+template <size_t E, size_t R>
+COMPUTE_SAMPLES_TARGET("avx2")
+size_t interleave_avx2(const uint8_t *input, uint8_t *output,
+                       const size_t columns, size_t x) {
+  const size_t m = 32 / E;
+  const int stages = R == 2 ? 1 : (R == 4 ? 2 : 3);
+  for (; x + m <= columns; x += m) {
+    __m256i v[R];
+    for (size_t i = 0; i < R; ++i) {
+      v[i] = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(input + (i * columns + x) * E));
+    }
+    zip_avx2<E, R>(v, stages);
+    // Low lanes hold the first half of the output, high lanes the second
+    for (size_t j = 0; j < R / 2; ++j) {
+      const __m256i low =
+          _mm256_permute2x128_si256(v[2 * j], v[2 * j + 1], 0x20);
+      const __m256i high =
+          _mm256_permute2x128_si256(v[2 * j], v[2 * j + 1], 0x31);
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(output + (x * R + j * m) * E), low);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(
+                              output + (x * R + (j + R / 2) * m) * E),
+                          high);
+    }
+  }
+  return x;
+}
+
+template <size_t E, size_t R>
+COMPUTE_SAMPLES_TARGET("avx2")
+size_t deinterleave_avx2(const uint8_t *input, uint8_t *output,
+                         const size_t columns, size_t x) {
+  const size_t m = 32 / E;
+  const int stages = E == 8 ? 1 : (E == 4 ? 2 : (E == 2 ? 3 : 4));
+  for (; x + m <= columns; x += m) {
+    __m256i in[R];
+    for (size_t i = 0; i < R; ++i) {
+      in[i] = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(input + (x * R + i * m) * E));
+    }
+    // Gather 128-bit chunk k into the low lane and chunk k + R into the high
+    // lane, chunk c being stored in lane c % 2 of in[c / 2]
+    __m256i v[R];
+    for (size_t k = 0; k < R; k += 2) {
+      v[k] = _mm256_permute2x128_si256(in[k / 2], in[(k + R) / 2], 0x20);
+      v[k + 1] = _mm256_permute2x128_si256(in[k / 2], in[(k + R) / 2], 0x31);
+    }
+    zip_avx2<E, R>(v, stages);
+    for (size_t i = 0; i < R; ++i) {
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(output + (i * columns + x) * E), v[i]);
+    }
+  }
+  return x;
+}
+
+template <size_t E, size_t R>
+void interleave_rows(const uint8_t *input, uint8_t *output,
+                     const size_t columns, const size_t rows) {
+  const bool avx2 = cpu_features().avx2;
+  for (size_t y = 0; y < rows; ++y) {
+    const uint8_t *in = input + y * R * columns * E;
+    uint8_t *out = output + y * R * columns * E;
+    size_t x = avx2 ? interleave_avx2<E, R>(in, out, columns, 0) : 0;
+    x = interleave_sse2<E, R>(in, out, columns, x);
+    interleave_scalar<E>(in, out, R, columns, x, columns);
+  }
+}
+
+template <size_t E, size_t R>
+void deinterleave_rows(const uint8_t *input, uint8_t *output,
+                       const size_t columns, const size_t rows) {
+  const bool avx2 = cpu_features().avx2;
+  for (size_t y = 0; y < rows; ++y) {
+    const uint8_t *in = input + y * R * columns * E;
+    uint8_t *out = output + y * R * columns * E;
+    size_t x = avx2 ? deinterleave_avx2<E, R>(in, out, columns, 0) : 0;
+    x = deinterleave_sse2<E, R>(in, out, columns, x);
+    deinterleave_scalar<E>(in, out, R, columns, x, columns);
+  }
+}
+#endif
+
+template <size_t E>
+void interleave_rows(const uint8_t *input, uint8_t *output,
+                     const size_t streams, const size_t columns,
+                     const size_t rows) {
+#if defined(COMPUTE_SAMPLES_X86_64)
+  switch (streams) {
+  case 2:
+    return interleave_rows<E, 2>(input, output, columns, rows);
+  case 4:
+    return interleave_rows<E, 4>(input, output, columns, rows);
+  case 8:
+    return interleave_rows<E, 8>(input, output, columns, rows);
+  default:
+    break;
+  }
+#endif
+  for (size_t y = 0; y < rows; ++y) {
+    const size_t offset = y * streams * columns * E;
+    interleave_scalar<E>(input + offset, output + offset, streams, columns, 0,
+                         columns);
+  }
+}
+
+template <size_t E>
+void deinterleave_rows(const uint8_t *input, uint8_t *output,
+                       const size_t streams, const size_t columns,
+                       const size_t rows) {
+#if defined(COMPUTE_SAMPLES_X86_64)
+  switch (streams) {
+  case 2:
+    return deinterleave_rows<E, 2>(input, output, columns, rows);
+  case 4:
+    return deinterleave_rows<E, 4>(input, output, columns, rows);
+  case 8:
+    return deinterleave_rows<E, 8>(input, output, columns, rows);
+  default:
+    break;
+  }
+#endif
+  for (size_t y = 0; y < rows; ++y) {
+    const size_t offset = y * streams * columns * E;
+    deinterleave_scalar<E>(input + offset, output + offset, streams, columns,
+                           0, columns);
+  }
+}
+} // namespace
+
+void interleave_elements(const void *input, void *output,
+                         const size_t element_size, const size_t streams,
+                         const size_t columns, const size_t rows) {
+  const uint8_t *in = static_cast<const uint8_t *>(input);
+  uint8_t *out = static_cast<uint8_t *>(output);
+  if (streams == 1) {
+    std::memcpy(out, in, rows * columns * element_size);
+    return;
+  }
+  switch (element_size) {
+  case 1:
+    return interleave_rows<1>(in, out, streams, columns, rows);
+  case 2:
+    return interleave_rows<2>(in, out, streams, columns, rows);
+  case 4:
+    return interleave_rows<4>(in, out, streams, columns, rows);
+  case 8:
+    return interleave_rows<8>(in, out, streams, columns, rows);
+  default:
+    for (size_t y = 0; y < rows; ++y) {
+      const size_t offset = y * streams * columns * element_size;
+      interleave_scalar_any(in + offset, out + offset, element_size, streams,
+                            columns);
+    }
+  }
+}
+
+void deinterleave_elements(const void *input, void *output,
+                           const size_t element_size, const size_t streams,
+                           const size_t columns, const size_t rows) {
+  const uint8_t *in = static_cast<const uint8_t *>(input);
+  uint8_t *out = static_cast<uint8_t *>(output);
+  if (streams == 1) {
+    std::memcpy(out, in, rows * columns * element_size);
+    return;
+  }
+  switch (element_size) {
+  case 1:
+    return deinterleave_rows<1>(in, out, streams, columns, rows);
+  case 2:
+    return deinterleave_rows<2>(in, out, streams, columns, rows);
+  case 4:
+    return deinterleave_rows<4>(in, out, streams, columns, rows);
+  case 8:
+    return deinterleave_rows<8>(in, out, streams, columns, rows);
+  default:
+    for (size_t y = 0; y < rows; ++y) {
+      const size_t offset = y * streams * columns * element_size;
+      deinterleave_scalar_any(in + offset, out + offset, element_size,
+                              streams, columns);
+    }
+  }
+}
+
+} // namespace detail
+} // namespace compute_samples
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "utils/source_digest.hpp"
+#include "utils/sha256.hpp"
+#include "logging/logging.hpp"
+
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace compute_samples {
+namespace {
+// Bounds recursion through paths which grow on every include, e.g. "../"
+const int max_include_depth = 200;
+
+// Name between the quotes or angle brackets of an include directive, empty
+// for other lines
+std::string included_name(const std::string &line) {
+  size_t i = line.find_first_not_of(" \t");
+  if (i == std::string::npos || line[i] != '#') {
+    return std::string();
+  }
+  i = line.find_first_not_of(" \t", i + 1);
+  if (i == std::string::npos || line.compare(i, 7, "include") != 0) {
+    return std::string();
+  }
+  i = line.find_first_not_of(" \t", i + 7);
+  if (i == std::string::npos || (line[i] != '"' && line[i] != '<')) {
+    return std::string();
+  }
+  const size_t end = line.find(line[i] == '"' ? '"' : '>', i + 1);
+  if (end == std::string::npos) {
+    return std::string();
+  }
+  return line.substr(i + 1, end - i - 1);
+}
+
+bool is_absolute(const std::string &path) {
+  return (!path.empty() && (path[0] == '/' || path[0] == '\\')) ||
+         (path.size() > 1 && path[1] == ':');
+}
+
+std::string join_path(const std::string &directory, const std::string &name) {
+  if (directory.empty() || is_absolute(name)) {
+    return name;
+  }
+  return directory + "/" + name;
+}
+
+std::string directory_of(const std::string &path) {
+  const size_t separator = path.find_last_of("/\\");
+  return separator == std::string::npos ? std::string(".")
+                                        : path.substr(0, separator);
+}
+
+bool read_file(const std::string &path, std::string &contents) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::ostringstream stream;
+  stream << file.rdbuf();
+  contents = stream.str();
+  return true;
+}
+
+void hash_includes(Sha256 &digest, const std::string &source,
+                   const std::vector<std::string> &directories,
+                   std::set<std::string> &visited, const int depth) {
+  if (depth > max_include_depth) {
+    LOG_WARNING << "Includes nested deeper than " << max_include_depth;
+    return;
+  }
+  std::istringstream lines(source);
+  std::string line;
+  while (std::getline(lines, line)) {
+    const std::string name = included_name(line);
+    if (name.empty()) {
+      continue;
+    }
+    digest.update("\ninclude " + name + "\n");
+    for (const std::string &directory : directories) {
+      const std::string path = join_path(directory, name);
+      std::string contents;
+      if (!read_file(path, contents)) {
+        continue;
+      }
+      digest.update(path + "\n");
+      if (visited.insert(path).second) {
+        digest.update(contents);
+        std::vector<std::string> nested_directories = {directory_of(path)};
+        nested_directories.insert(nested_directories.end(),
+                                  directories.begin(), directories.end());
+        hash_includes(digest, contents, nested_directories, visited,
+                      depth + 1);
+      }
+      break;
+    }
+  }
+}
+
+// Splits options at whitespace outside double quotes, which are removed
+// together with the backslashes escaping quotes inside them
+std::vector<std::string> split_options(const std::string &options) {
+  std::vector<std::string> tokens;
+  std::string token;
+  bool in_token = false;
+  bool quoted = false;
+  for (size_t i = 0; i < options.size(); ++i) {
+    const char c = options[i];
+    if (c == '"') {
+      quoted = !quoted;
+      in_token = true;
+    } else if (quoted && c == '\\' && i + 1 < options.size() &&
+               options[i + 1] == '"') {
+      token += options[++i];
+    } else if (!quoted && (c == ' ' || c == '\t' || c == '\n')) {
+      if (in_token) {
+        tokens.push_back(token);
+        token.clear();
+        in_token = false;
+      }
+    } else {
+      token += c;
+      in_token = true;
+    }
+  }
+  if (in_token) {
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+} // namespace
+
+std::vector<std::string> include_directories(const std::string &options) {
+  std::vector<std::string> directories;
+  const std::vector<std::string> tokens = split_options(options);
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    if (tokens[i] == "-I") {
+      if (i + 1 < tokens.size()) {
+        directories.push_back(tokens[++i]);
+      }
+    } else if (tokens[i].compare(0, 2, "-I") == 0) {
+      directories.push_back(tokens[i].substr(2));
+    }
+  }
+  return directories;
+}
+
+std::string source_digest(const std::string &source,
+                          const std::vector<std::string> &directories) {
+  Sha256 digest;
+  digest.update(source);
+  std::set<std::string> visited;
+  hash_includes(digest, source, directories, visited, 0);
+  return digest.hex_digest();
+}
+
+} // namespace compute_samples
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "utils/temporary_directory.hpp"
+#include "logging/logging.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace compute_samples {
+namespace {
+#if defined(_WIN32)
+std::string create_directory(const std::string &prefix) {
+  char base[MAX_PATH + 1];
+  const DWORD size = GetTempPathA(sizeof(base), base);
+  if (size == 0 || size > MAX_PATH) {
+    return std::string();
+  }
+  static std::atomic<unsigned> counter(0);
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    const std::string path =
+        std::string(base) + prefix + "." + std::to_string(_getpid()) + "." +
+        std::to_string(counter++) + "." + std::to_string(GetTickCount());
+    if (_mkdir(path.c_str()) == 0) {
+      return path;
+    }
+  }
+  return std::string();
+}
+
+std::vector<std::string> list_files(const std::string &directory) {
+  std::vector<std::string> files;
+  WIN32_FIND_DATAA data;
+  HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &data);
+  if (find == INVALID_HANDLE_VALUE) {
+    return files;
+  }
+  do {
+    if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+      files.push_back(directory + "/" + data.cFileName);
+    }
+  } while (FindNextFileA(find, &data) != 0);
+  FindClose(find);
+  return files;
+}
+
+bool remove_directory(const std::string &path) {
+  return _rmdir(path.c_str()) == 0;
+}
+#else
+std::string create_directory(const std::string &prefix) {
+  const char *base = std::getenv("TMPDIR");
+  std::string path = std::string(base != nullptr && *base != '\0' ? base
+                                                                  : "/tmp") +
+                     "/" + prefix + ".XXXXXX";
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  if (mkdtemp(name.data()) == nullptr) {
+    return std::string();
+  }
+  return name.data();
+}
+
+std::vector<std::string> list_files(const std::string &directory) {
+  std::vector<std::string> files;
+  DIR *dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    return files;
+  }
+  while (const dirent *file = readdir(dir)) {
+    const std::string path = directory + "/" + file->d_name;
+    struct stat status;
+    if (stat(path.c_str(), &status) == 0 && !S_ISDIR(status.st_mode)) {
+      files.push_back(path);
+    }
+  }
+  closedir(dir);
+  return files;
+}
+
+bool remove_directory(const std::string &path) {
+  return rmdir(path.c_str()) == 0;
+}
+#endif
+} // namespace
+
+TemporaryDirectory::TemporaryDirectory(const std::string &prefix)
+    : path_(create_directory(prefix)) {
+  if (path_.empty()) {
+    throw std::runtime_error("Failed to create temporary directory");
+  }
+  LOG_DEBUG << "Temporary directory created: " << path_;
+}
+
+TemporaryDirectory::~TemporaryDirectory() {
+  for (const std::string &file : list_files(path_)) {
+    if (std::remove(file.c_str()) != 0) {
+      LOG_DEBUG << "Deleting file " << file << " failed";
+    }
+  }
+  if (!remove_directory(path_)) {
+    LOG_WARNING << "Deleting temporary directory " << path_ << " failed";
+  }
+}
+
+std::string TemporaryDirectory::file(const std::string &name) const {
+  return path_ + "/" + name;
+}
+
+} // namespace compute_samples
@@ -6,6 +6,7 @@
  */
 
 #include "utils/utils.hpp"
+#include "utils/mapped_file.hpp"
 #include "logging/logging.hpp"
 
 #include <iostream>
@@ -18,23 +19,36 @@ std::string load_text_file(const std::string &file_path) {
   LOG_ENTER_FUNCTION
   LOG_DEBUG << "File path: " << file_path;
 
-  std::ifstream stream(file_path.c_str());
-
-  std::string text_file;
-  if (!stream.good()) {
+  MappedFile file;
+  if (!file.open(file_path)) {
     LOG_ERROR << "Failed to load text file: " << file_path;
     LOG_EXIT_FUNCTION
-    return text_file;
+    return std::string();
   }
 
-  text_file = std::string((std::istreambuf_iterator<char>(stream)),
-                          std::istreambuf_iterator<char>());
+  const std::string text_file = load_text_file(file);
   LOG_DEBUG << "Text file loaded";
 
   LOG_EXIT_FUNCTION
   return text_file;
 }
 
+std::string load_text_file(const MappedFile &file) {
+#if defined(_WIN32)
+  // Match text mode streams, which translate CRLF line endings
+  std::string text_file;
+  text_file.reserve(file.size());
+  for (size_t i = 0; i < file.size(); ++i) {
+    if (file[i] != '\r' || i + 1 == file.size() || file[i + 1] != '\n') {
+      text_file.push_back(static_cast<char>(file[i]));
+    }
+  }
+  return text_file;
+#else
+  return std::string(file.chars(), file.size());
+#endif
+}
+
 void save_text_file(const std::string data, const std::string &file_path) {
   LOG_ENTER_FUNCTION
   LOG_DEBUG << "File path: " << file_path;
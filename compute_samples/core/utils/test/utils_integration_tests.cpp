@@ -6,9 +6,26 @@
  */
 
 #include "utils/utils.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/async_file_writer.hpp"
+#include "utils/file_cache.hpp"
+#include "utils/sha256.hpp"
+#include "utils/source_digest.hpp"
+#include "utils/temporary_directory.hpp"
+#include "utils/fat_binary.hpp"
 #include "gtest/gtest.h"
 #include "logging/logging.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <ctime>
+
+#if defined(_WIN32)
+#include <sys/utime.h>
+#define utime _utime
+#define utimbuf _utimbuf
+#else
+#include <utime.h>
+#endif
 
 TEST(LoadTextFile, ValidFile) {
   const std::string text = compute_samples::load_text_file("text_file.txt");
@@ -61,3 +78,354 @@ TEST(SaveBinaryFile, ValidFile) {
 
   EXPECT_EQ(bytes, output);
 }
+
+TEST(MappedFile, ValidFile) {
+  const compute_samples::MappedFile file("binary_file.bin");
+  const std::vector<uint8_t> reference = {0x00, 0x11, 0x22, 0x33};
+  EXPECT_TRUE(file.is_open());
+  EXPECT_EQ(reference, std::vector<uint8_t>(file.begin(), file.end()));
+}
+
+TEST(MappedFile, NotExistingFile) {
+  EXPECT_THROW(compute_samples::MappedFile("invalid/path"), std::runtime_error);
+
+  compute_samples::MappedFile file;
+  EXPECT_FALSE(file.open("invalid/path"));
+  EXPECT_FALSE(file.is_open());
+}
+
+TEST(MappedFile, EmptyFile) {
+  const std::string path = "empty.bin";
+  compute_samples::save_binary_file({}, path);
+
+  {
+    const compute_samples::MappedFile file(path);
+    EXPECT_TRUE(file.is_open());
+    EXPECT_TRUE(file.empty());
+    EXPECT_EQ(0u, file.mapped_size());
+  }
+
+  if (std::remove(path.c_str()) != 0) {
+    LOG_DEBUG << "Deleting file " << path.c_str() << " failed";
+  }
+}
+
+TEST(MappedFile, MappingIsPageAligned) {
+  const compute_samples::MappedFile file("binary_file.bin");
+  const size_t page_size = compute_samples::MappedFile::page_size();
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(file.mapped_data()) % page_size);
+  EXPECT_EQ(page_size, file.mapped_size());
+}
+
+TEST(MappedFile, MoveTransfersMapping) {
+  compute_samples::MappedFile file("binary_file.bin");
+  const uint8_t *data = file.data();
+
+  compute_samples::MappedFile moved(std::move(file));
+  EXPECT_FALSE(file.is_open());
+  EXPECT_TRUE(moved.is_open());
+  EXPECT_EQ(data, moved.data());
+  EXPECT_EQ(4u, moved.size());
+}
+
+TEST(MappedFile, PrefetchKeepsContents) {
+  const compute_samples::MappedFile file("binary_file.bin");
+  const std::vector<uint8_t> expected(file.begin(), file.end());
+  file.prefetch(0, file.size());
+  file.prefetch(1, 100);
+  file.prefetch(file.size(), 1);
+  EXPECT_EQ(expected, std::vector<uint8_t>(file.begin(), file.end()));
+}
+
+TEST(LoadTextFile, FromMappedFile) {
+  const compute_samples::MappedFile file("text_file.txt");
+  EXPECT_EQ("abc", compute_samples::load_text_file(file));
+}
+
+namespace {
+std::vector<uint8_t> write_async(const std::string &path, const size_t size,
+                                 const bool direct_io) {
+  std::vector<uint8_t> bytes(size);
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = static_cast<uint8_t>(i * 7 + i / 251);
+  }
+  compute_samples::AsyncFileWriter writer;
+  EXPECT_TRUE(writer.open(path, 0, direct_io));
+  EXPECT_EQ(direct_io, writer.is_direct());
+  // Uneven pieces cross chunk boundaries, and the minimal pool forces waits
+  const size_t piece = 100003;
+  for (size_t offset = 0; offset < bytes.size(); offset += piece) {
+    EXPECT_TRUE(writer.write(bytes.data() + offset,
+                             std::min(piece, bytes.size() - offset)));
+  }
+  EXPECT_EQ(size, writer.size());
+  EXPECT_TRUE(writer.close());
+  EXPECT_FALSE(writer.is_open());
+  return bytes;
+}
+} // namespace
+
+TEST(AsyncFileWriter, WritesDataInOrder) {
+  const std::string path = "async_output.bin";
+  const std::vector<uint8_t> bytes = write_async(path, 5000011, false);
+
+  EXPECT_EQ(bytes, compute_samples::load_binary_file(path));
+  if (std::remove(path.c_str()) != 0) {
+    LOG_DEBUG << "Deleting file " << path.c_str() << " failed";
+  }
+}
+
+TEST(AsyncFileWriter, DirectWritesKeepExactSize) {
+  const std::string path = "async_direct_output.bin";
+  {
+    compute_samples::AsyncFileWriter writer;
+    ASSERT_TRUE(writer.open(path, 0, true));
+    if (!writer.is_direct()) {
+      EXPECT_TRUE(writer.close());
+      std::remove(path.c_str());
+      GTEST_SKIP() << "Direct I/O is not supported in the working directory";
+    }
+  }
+  const std::vector<uint8_t> bytes = write_async(path, 3 << 20 | 123, true);
+
+  EXPECT_EQ(bytes, compute_samples::load_binary_file(path));
+  if (std::remove(path.c_str()) != 0) {
+    LOG_DEBUG << "Deleting file " << path.c_str() << " failed";
+  }
+}
+
+TEST(AsyncFileWriter, NotExistingDirectory) {
+  compute_samples::AsyncFileWriter writer;
+  EXPECT_FALSE(writer.open("invalid/path"));
+  EXPECT_FALSE(writer.is_open());
+  EXPECT_TRUE(writer.close());
+}
+
+class FileCacheTest : public testing::Test {
+protected:
+  void TearDown() override {
+    compute_samples::FileCache(directory_).clear();
+  }
+
+  const std::string directory_ = "file_cache_test";
+  const std::vector<uint8_t> data_ = {1, 2, 3, 4, 5, 6, 7, 8};
+};
+
+TEST_F(FileCacheTest, LoadsStoredData) {
+  compute_samples::FileCache cache(directory_);
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(cache.load("key", data));
+  EXPECT_TRUE(cache.store("key", data_));
+  EXPECT_TRUE(cache.load("key", data));
+  EXPECT_EQ(data_, data);
+
+  // Entries outlive the cache object
+  compute_samples::FileCache other(directory_);
+  EXPECT_TRUE(other.load("key", data));
+  EXPECT_EQ(data_, data);
+
+  const compute_samples::FileCacheStatistics statistics = cache.statistics();
+  EXPECT_EQ(1u, statistics.hits);
+  EXPECT_EQ(1u, statistics.misses);
+  EXPECT_EQ(1u, statistics.stores);
+}
+
+TEST_F(FileCacheTest, KeysAreDistinct) {
+  compute_samples::FileCache cache(directory_);
+  EXPECT_TRUE(cache.store("key", data_));
+  EXPECT_TRUE(cache.store("other key", {}));
+  std::vector<uint8_t> data;
+  EXPECT_TRUE(cache.load("other key", data));
+  EXPECT_TRUE(data.empty());
+  EXPECT_TRUE(cache.load("key", data));
+  EXPECT_EQ(data_, data);
+  cache.remove("key");
+  EXPECT_FALSE(cache.load("key", data));
+}
+
+TEST_F(FileCacheTest, DamagedEntryIsMiss) {
+  compute_samples::FileCache cache(directory_);
+  EXPECT_TRUE(cache.store("key", data_));
+  const std::string path =
+      directory_ + "/" + compute_samples::sha256("key") + ".bin";
+  std::vector<uint8_t> entry = compute_samples::load_binary_file(path);
+  ASSERT_FALSE(entry.empty());
+  entry.pop_back();
+  compute_samples::save_binary_file(entry, path);
+
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(cache.load("key", data));
+  EXPECT_TRUE(data.empty());
+}
+
+TEST_F(FileCacheTest, EvictsLeastRecentlyUsedEntries) {
+  const std::vector<uint8_t> data(1000);
+  compute_samples::FileCache probe(directory_);
+  EXPECT_TRUE(probe.store("p", data));
+  const uint64_t entry_size = probe.size();
+  probe.clear();
+
+  compute_samples::FileCache cache(directory_, 2 * entry_size);
+  std::vector<uint8_t> loaded;
+  EXPECT_TRUE(cache.store("a", data));
+  EXPECT_TRUE(cache.store("b", data));
+  EXPECT_TRUE(cache.load("a", loaded));
+  EXPECT_TRUE(cache.store("c", data));
+
+  EXPECT_TRUE(cache.load("a", loaded));
+  EXPECT_FALSE(cache.load("b", loaded));
+  EXPECT_TRUE(cache.load("c", loaded));
+  EXPECT_EQ(1u, cache.statistics().evictions);
+  EXPECT_EQ(2 * entry_size, cache.size());
+}
+
+namespace {
+// Sets the modification time of a file to the given number of seconds ago
+void set_age(const std::string &path, const time_t seconds) {
+  utimbuf times;
+  times.actime = time(nullptr) - seconds;
+  times.modtime = times.actime;
+  ASSERT_EQ(0, utime(path.c_str(), &times)) << path;
+}
+} // namespace
+
+TEST_F(FileCacheTest, EvictionDoesNotDependOnModificationTimes) {
+  const std::vector<uint8_t> data(1000);
+  compute_samples::FileCache probe(directory_);
+  EXPECT_TRUE(probe.store("p", data));
+  const uint64_t entry_size = probe.size();
+  probe.clear();
+
+  compute_samples::FileCache cache(directory_, 2 * entry_size);
+  std::vector<uint8_t> loaded;
+  EXPECT_TRUE(cache.store("a", data));
+  EXPECT_TRUE(cache.store("b", data));
+  EXPECT_TRUE(cache.load("a", loaded));
+  // Like on file systems with coarse modification times, the entries look
+  // equally old, so only the recorded use tells them apart
+  for (const char *key : {"a", "b"}) {
+    set_age(directory_ + "/" + compute_samples::sha256(key) + ".bin", 10);
+  }
+  EXPECT_TRUE(cache.store("c", data));
+
+  EXPECT_TRUE(cache.load("a", loaded));
+  EXPECT_FALSE(cache.load("b", loaded));
+  EXPECT_TRUE(cache.load("c", loaded));
+}
+
+TEST_F(FileCacheTest, StoreRemovesStaleTemporaryFiles) {
+  compute_samples::FileCache cache(directory_);
+  const std::string stale = directory_ + "/stale.bin.1.0.tmp";
+  const std::string fresh = directory_ + "/fresh.bin.1.1.tmp";
+  compute_samples::save_text_file("stale", stale);
+  compute_samples::save_text_file("fresh", fresh);
+  set_age(stale, 2 * 60 * 60);
+  EXPECT_TRUE(cache.store("key", data_));
+
+  std::FILE *file = std::fopen(stale.c_str(), "r");
+  EXPECT_EQ(nullptr, file);
+  if (file != nullptr) {
+    std::fclose(file);
+  }
+  EXPECT_EQ("fresh", compute_samples::load_text_file(fresh));
+  std::remove(fresh.c_str());
+}
+
+TEST(FileCache, NotExistingDirectoryIsEmpty) {
+  // Directories cannot be created below a file
+  compute_samples::FileCache cache("text_file.txt/cache");
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(cache.load("key", data));
+}
+
+class SourceDigestTest : public testing::Test {
+protected:
+  void SetUp() override {
+    compute_samples::save_text_file("#define VALUE 1\n", "digest_value.cl");
+    compute_samples::save_text_file("#include \"digest_value.cl\"\n",
+                                    "digest_nested.cl");
+  }
+
+  void TearDown() override {
+    for (const char *file :
+         {"digest_value.cl", "digest_nested.cl", "digest_self.cl"}) {
+      std::remove(file);
+    }
+  }
+
+  const std::vector<std::string> directories = {"."};
+};
+
+TEST_F(SourceDigestTest, EditedIncludeChangesDigest) {
+  const std::string source =
+      "#include \"digest_value.cl\"\nkernel void k() {}\n";
+  const std::string digest =
+      compute_samples::source_digest(source, directories);
+  EXPECT_EQ(digest, compute_samples::source_digest(source, directories));
+  compute_samples::save_text_file("#define VALUE 2\n", "digest_value.cl");
+  EXPECT_NE(digest, compute_samples::source_digest(source, directories));
+}
+
+TEST_F(SourceDigestTest, EditedNestedIncludeChangesDigest) {
+  const std::string source = "  #  include <digest_nested.cl>\n";
+  const std::string digest =
+      compute_samples::source_digest(source, directories);
+  compute_samples::save_text_file("#define VALUE 2\n", "digest_value.cl");
+  EXPECT_NE(digest, compute_samples::source_digest(source, directories));
+}
+
+TEST_F(SourceDigestTest, IncludeIsFoundInLaterDirectory) {
+  const std::string source = "#include \"digest_value.cl\"\n";
+  const std::vector<std::string> later = {"not_existing", "."};
+  EXPECT_EQ(compute_samples::source_digest(source, directories),
+            compute_samples::source_digest(source, later));
+  EXPECT_NE(compute_samples::source_digest(source, directories),
+            compute_samples::source_digest(source, {"not_existing"}));
+}
+
+TEST_F(SourceDigestTest, RecursiveIncludesTerminate) {
+  compute_samples::save_text_file("#include \"digest_self.cl\"\n",
+                                  "digest_self.cl");
+  EXPECT_NO_THROW(compute_samples::source_digest(
+      "#include \"digest_self.cl\"\n", directories));
+}
+
+TEST(TemporaryDirectory, DirectoriesAreUnique) {
+  const compute_samples::TemporaryDirectory first;
+  const compute_samples::TemporaryDirectory second;
+  EXPECT_NE(first.path(), second.path());
+  EXPECT_EQ(first.path() + "/file.txt", first.file("file.txt"));
+}
+
+TEST(TemporaryDirectory, RemovesFilesOnDestruction) {
+  std::string file;
+  {
+    const compute_samples::TemporaryDirectory directory("utils_tests");
+    file = directory.file("file.txt");
+    compute_samples::save_text_file("abc", file);
+    EXPECT_EQ("abc", compute_samples::load_text_file(file));
+  }
+  std::FILE *removed = std::fopen(file.c_str(), "r");
+  EXPECT_EQ(nullptr, removed);
+  if (removed != nullptr) {
+    std::fclose(removed);
+  }
+}
+
+TEST(FatBinary, SavedFileIsLoaded) {
+  const compute_samples::TemporaryDirectory directory;
+  const std::string file = directory.file("program.fatbin");
+  compute_samples::FatBinary binary;
+  binary.add(compute_samples::FatBinaryFormat::spirv, "", {1, 2, 3});
+  binary.save(file);
+
+  const compute_samples::FatBinary loaded =
+      compute_samples::FatBinary::load(file);
+  ASSERT_EQ(1u, loaded.entries().size());
+  EXPECT_EQ(binary.entries()[0].data, loaded.entries()[0].data);
+}
+
+TEST(FatBinary, NotExistingFileThrows) {
+  EXPECT_THROW(compute_samples::FatBinary::load("not_existing.fatbin"),
+               std::runtime_error);
+}
@@ -5,9 +5,17 @@
  *
  */
 
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
 #include "gtest/gtest.h"
 
 #include "utils/utils.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/sha256.hpp"
+#include "utils/fat_binary.hpp"
+#include "utils/source_digest.hpp"
 namespace cs = compute_samples;
 
 template <typename T> class SizeInBytes : public testing::Test {};
@@ -235,6 +243,75 @@ TEST(UnpackVector, Input16BitsOutput8BitsStep3) {
   EXPECT_EQ(expected, output);
 }
 
+template <typename T> class PackVectorLarge : public testing::Test {
+protected:
+  using Narrow = typename std::tuple_element<0, T>::type;
+  using Wide = typename std::tuple_element<1, T>::type;
+
+  // Element-by-element definition of the packed layout
+  std::vector<Wide> reference_pack(const std::vector<Narrow> &input,
+                                   const size_t columns) const {
+    const size_t ratio = sizeof(Wide) / sizeof(Narrow);
+    std::vector<Wide> output(input.size() / ratio);
+    const size_t rows = output.size() / columns;
+    for (size_t y = 0; y < rows; ++y) {
+      for (size_t x = 0; x < columns; ++x) {
+        for (size_t i = 0; i < ratio; ++i) {
+          std::memcpy(reinterpret_cast<Narrow *>(&output[y * columns + x]) +
+                          i,
+                      &input[(y * ratio + i) * columns + x], sizeof(Narrow));
+        }
+      }
+    }
+    return output;
+  }
+
+  std::vector<Narrow> input(const size_t size) const {
+    std::vector<Narrow> data(size);
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<Narrow>(i * 2654435761u);
+    }
+    return data;
+  }
+
+  const std::vector<int> steps = {1, 3, 16, 37, 64, 100, 1024};
+  const size_t size = 8 * 1024 + 24;
+};
+typedef testing::Types<
+    std::tuple<uint8_t, uint16_t>, std::tuple<uint8_t, uint32_t>,
+    std::tuple<uint8_t, uint64_t>, std::tuple<uint16_t, uint32_t>,
+    std::tuple<uint16_t, uint64_t>, std::tuple<uint32_t, uint64_t>,
+    std::tuple<uint8_t, uint8_t>, std::tuple<uint8_t, CustomType>>
+    PackTypes;
+TYPED_TEST_SUITE(PackVectorLarge, PackTypes);
+
+TYPED_TEST(PackVectorLarge, MatchesReference) {
+  using Narrow = typename TestFixture::Narrow;
+  using Wide = typename TestFixture::Wide;
+  const std::vector<Narrow> input = this->input(this->size);
+  for (const int step : this->steps) {
+    const std::vector<Wide> expected = this->reference_pack(input, step);
+    const std::vector<Wide> output = cs::pack_vector<Wide>(input, step);
+    ASSERT_EQ(expected.size(), output.size());
+    EXPECT_EQ(0, std::memcmp(expected.data(), output.data(),
+                             expected.size() * sizeof(Wide)))
+        << "step " << step;
+  }
+}
+
+TYPED_TEST(PackVectorLarge, UnpackRestoresInput) {
+  using Narrow = typename TestFixture::Narrow;
+  using Wide = typename TestFixture::Wide;
+  const size_t ratio = sizeof(Wide) / sizeof(Narrow);
+  for (const int step : this->steps) {
+    const size_t rows = this->size / ratio / step;
+    const std::vector<Narrow> input = this->input(rows * step * ratio);
+    const std::vector<Wide> packed = cs::pack_vector<Wide>(input, step);
+    const std::vector<Narrow> output = cs::unpack_vector<Narrow>(packed, step);
+    EXPECT_EQ(input, output) << "step " << step;
+  }
+}
+
 TEST(UUIDToString, ValidValue) {
   const uint8_t uuid[] = {0x78, 0x56, 0x34, 0x12, 0x78, 0x56, 0x34, 0x12,
                           0x78, 0x56, 0x34, 0x12, 0x78, 0x56, 0x34, 0x12};
@@ -408,3 +485,101 @@ TEST(JoinStrings, MultipleTokens) {
   const std::string expected = "abc, def, 123, 456";
   EXPECT_EQ(expected, compute_samples::join_strings(input, delimeter));
 }
+
+TEST(ThreadPool, RunsAllTasks) {
+  compute_samples::ThreadPool pool(4);
+  EXPECT_EQ(4, pool.size());
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; ++i) {
+    results.push_back(pool.submit([i]() { return i * i; }));
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i * i, results[i].get());
+  }
+}
+
+TEST(ThreadPool, PropagatesExceptions) {
+  compute_samples::ThreadPool pool(1);
+  std::future<void> result =
+      pool.submit([]() { throw std::runtime_error("task failed"); });
+  EXPECT_THROW(result.get(), std::runtime_error);
+}
+
+TEST(ThreadPool, DefaultsToHardwareThreads) {
+  compute_samples::ThreadPool pool;
+  EXPECT_EQ(compute_samples::ThreadPool::hardware_threads(), pool.size());
+}
+
+TEST(Sha256, KnownDigests) {
+  EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+            cs::sha256(""));
+  EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+            cs::sha256("abc"));
+  EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+            cs::sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnop"
+                       "nopq"));
+}
+
+TEST(Sha256, IncrementalUpdatesMatchSingleUpdate) {
+  std::string data;
+  for (int i = 0; i < 1000; ++i) {
+    data.push_back(static_cast<char>(i * 7));
+  }
+  // Pieces of every length cross block boundaries at different offsets
+  cs::Sha256 hash;
+  for (size_t offset = 0, piece = 1; offset < data.size(); offset += piece++) {
+    hash.update(data.substr(offset, piece));
+  }
+  EXPECT_EQ(cs::sha256(data), hash.hex_digest());
+}
+
+TEST(FatBinary, SerializedEntriesAreParsed) {
+  cs::FatBinary binary;
+  binary.add(cs::FatBinaryFormat::spirv, "", {1, 2, 3});
+  binary.add(cs::FatBinaryFormat::native, "skl", {4, 5});
+  binary.add(cs::FatBinaryFormat::native, "tgllp", {});
+
+  const cs::FatBinary parsed = cs::FatBinary::parse(binary.serialize());
+  ASSERT_EQ(3u, parsed.entries().size());
+  ASSERT_NE(nullptr, parsed.spirv());
+  EXPECT_EQ(std::vector<uint8_t>({1, 2, 3}), parsed.spirv()->data);
+  const cs::FatBinaryEntry *skl =
+      parsed.find(cs::FatBinaryFormat::native, "skl");
+  ASSERT_NE(nullptr, skl);
+  EXPECT_EQ(std::vector<uint8_t>({4, 5}), skl->data);
+  const cs::FatBinaryEntry *tgllp =
+      parsed.find(cs::FatBinaryFormat::native, "tgllp");
+  ASSERT_NE(nullptr, tgllp);
+  EXPECT_TRUE(tgllp->data.empty());
+  EXPECT_EQ(nullptr, parsed.find(cs::FatBinaryFormat::native, "icllp"));
+}
+
+TEST(FatBinary, InvalidDataThrows) {
+  cs::FatBinary binary;
+  binary.add(cs::FatBinaryFormat::native, "skl", {4, 5});
+  std::vector<uint8_t> data = binary.serialize();
+  data.pop_back();
+  EXPECT_THROW(cs::FatBinary::parse(data), std::runtime_error);
+  EXPECT_THROW(cs::FatBinary::parse({'C', 'S'}), std::runtime_error);
+  EXPECT_THROW(cs::FatBinary::parse({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}),
+               std::runtime_error);
+}
+
+TEST(IncludeDirectories, SeparateAndJoinedOptions) {
+  const std::vector<std::string> expected = {"a", "b/c", "d"};
+  EXPECT_EQ(expected,
+            cs::include_directories("-DX=1 -I a -Ib/c -cl-std=CL2.0 -I d"));
+  EXPECT_TRUE(cs::include_directories("-DINCLUDE -cl-fast-relaxed-math")
+                  .empty());
+}
+
+TEST(IncludeDirectories, QuotedDirectories) {
+  const std::vector<std::string> expected = {"a b", "c \"d\"", "e"};
+  EXPECT_EQ(expected, cs::include_directories(
+                          "-I \"a b\" -I\"c \\\"d\\\"\" -D\"X=1 -I f\" -I e"));
+}
+
+TEST(SourceDigest, SourceWithoutIncludesIsItsHash) {
+  EXPECT_EQ(cs::sha256("kernel void k() {}"),
+            cs::source_digest("kernel void k() {}", {"."}));
+}
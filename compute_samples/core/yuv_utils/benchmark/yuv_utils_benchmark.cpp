@@ -0,0 +1,666 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "yuv_utils/yuv_utils.hpp"
+#include "yuv_utils/color_convert.hpp"
+#include "yuv_utils/vector_overlay.hpp"
+#include "utils/thread_pool.hpp"
+#include "timer/timer.hpp"
+#include "logging/logging.hpp"
+
+namespace po = boost::program_options;
+namespace cs = compute_samples;
+
+namespace {
+struct Arguments {
+  std::string suite;
+  int frames = 0;
+  int prefetch = 0;
+  int write_buffer = 0;
+  int iterations = 0;
+  int max_threads = 0;
+};
+
+struct Resolution {
+  const char *name;
+  int width;
+  int height;
+};
+
+void generate_clip(const std::string &path, const Resolution &resolution,
+                   const int frames,
+                   const cs::PlanarFormat format = cs::PlanarFormat::i420) {
+  const size_t frame_size =
+      cs::packed_frame_size(format, resolution.width, resolution.height);
+  std::vector<char> frame(frame_size);
+  std::ofstream file(path, std::ios::binary);
+  for (int k = 0; k < frames; ++k) {
+    for (size_t i = 0; i < frame_size; ++i) {
+      frame[i] = static_cast<char>((i * 7 + k) & 0xFF);
+    }
+    file.write(frame.data(), frame.size());
+  }
+}
+
+// Touches one byte per cache line, so that views are not free to produce
+size_t touch_view(const cs::yuv_frame_view &view) {
+  size_t sum = 0;
+  for (int y = 0; y < view.height; ++y) {
+    const uint8_t *row = view.y + static_cast<size_t>(y) * view.pitch_y;
+    for (int x = 0; x < view.width; x += 64) {
+      sum += row[x];
+    }
+  }
+  return sum;
+}
+
+void report(const std::string &name, const int frames, const double seconds,
+            const size_t checksum) {
+  LOG_INFO << "  " << name << ": " << frames / seconds << " frames/s"
+           << " (checksum " << checksum << ")";
+}
+
+void benchmark_copy(const Arguments &args, const std::string &path,
+                    const Resolution &resolution, const cs::YuvCaptureMode mode,
+                    const std::string &name) {
+  cs::YuvCapture capture(path, resolution.width, resolution.height, 0, mode);
+  if (mode == cs::YuvCaptureMode::mapped) {
+    capture.set_prefetch_frames(args.prefetch);
+  }
+
+  cs::PlanarImage frame(resolution.width, resolution.height);
+  cs::Timer progressive_timer;
+  size_t checksum = 0;
+  for (int k = 0; k < args.frames; ++k) {
+    capture.get_sample(k, frame);
+    checksum += frame.get_y()[k];
+  }
+  report(name + " progressive", args.frames, progressive_timer.elapsed(),
+         checksum);
+
+  cs::PlanarImage field(resolution.width, resolution.height / 2);
+  cs::Timer interlaced_timer;
+  checksum = 0;
+  for (int k = 0; k < args.frames; ++k) {
+    for (int polarity = 0; polarity < 2; ++polarity) {
+      capture.get_sample(k, field, true, polarity);
+      checksum += field.get_y()[k];
+    }
+  }
+  report(name + " interlaced", args.frames, interlaced_timer.elapsed(),
+         checksum);
+}
+
+void benchmark_views(const Arguments &args, const std::string &path,
+                     const Resolution &resolution) {
+  cs::YuvCapture capture(path, resolution.width, resolution.height, 0,
+                         cs::YuvCaptureMode::mapped);
+  capture.set_prefetch_frames(args.prefetch);
+
+  cs::Timer progressive_timer;
+  size_t checksum = 0;
+  for (int k = 0; k < args.frames; ++k) {
+    checksum += touch_view(capture.get_frame_view(k));
+  }
+  report("mapped view progressive", args.frames, progressive_timer.elapsed(),
+         checksum);
+
+  cs::Timer interlaced_timer;
+  checksum = 0;
+  for (int k = 0; k < args.frames; ++k) {
+    for (int polarity = 0; polarity < 2; ++polarity) {
+      checksum += touch_view(capture.get_field_view(k, polarity));
+    }
+  }
+  report("mapped view interlaced", args.frames, interlaced_timer.elapsed(),
+         checksum);
+}
+
+void benchmark_capture(const Arguments &args) {
+  const Resolution resolutions[] = {
+      {"720p", 1280, 720}, {"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+  for (const Resolution &resolution : resolutions) {
+    const std::string path = "yuv_utils_benchmark.yuv";
+    generate_clip(path, resolution, args.frames);
+    LOG_INFO << resolution.name << ", " << args.frames << " frames, prefetch "
+             << args.prefetch << " frames";
+
+    benchmark_copy(args, path, resolution, cs::YuvCaptureMode::stream,
+                   "stream copy");
+    benchmark_copy(args, path, resolution, cs::YuvCaptureMode::mapped,
+                   "mapped copy");
+    benchmark_views(args, path, resolution);
+
+    if (std::remove(path.c_str()) != 0) {
+      LOG_DEBUG << "Deleting file " << path << " failed";
+    }
+  }
+}
+
+enum class WriteMode { buffered, streaming, direct };
+
+void benchmark_writer(const Arguments &args, const Resolution &resolution,
+                      const WriteMode mode, const std::string &name) {
+  const std::string path = "yuv_utils_benchmark_output.yuv";
+  cs::PlanarImage frame(resolution.width, resolution.height);
+  for (int i = 0; i < resolution.width * resolution.height; ++i) {
+    frame.get_y()[i] = static_cast<uint8_t>(i * 7);
+  }
+
+  cs::Timer timer;
+  cs::YuvWriter writer(resolution.width, resolution.height,
+                       mode == WriteMode::buffered ? args.frames : 0);
+  if (mode != WriteMode::buffered) {
+    writer.open(path, static_cast<size_t>(args.write_buffer) << 20,
+                mode == WriteMode::direct);
+  }
+  for (int k = 0; k < args.frames; ++k) {
+    frame.get_y()[0] = static_cast<uint8_t>(k);
+    writer.append_frame(frame);
+  }
+  writer.write_to_file(path.c_str());
+  report(name, args.frames, timer.elapsed(), 0);
+
+  if (std::remove(path.c_str()) != 0) {
+    LOG_DEBUG << "Deleting file " << path << " failed";
+  }
+}
+
+void benchmark_write(const Arguments &args) {
+  const Resolution resolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+  for (const Resolution &resolution : resolutions) {
+    LOG_INFO << resolution.name << ", " << args.frames
+             << " frames written, streaming buffer " << args.write_buffer
+             << " MB";
+    benchmark_writer(args, resolution, WriteMode::buffered, "buffered");
+    benchmark_writer(args, resolution, WriteMode::streaming, "streaming");
+    benchmark_writer(args, resolution, WriteMode::direct, "streaming direct");
+  }
+}
+
+struct ConvertSource {
+  std::vector<uint8_t> i420;
+  std::vector<uint8_t> nv12;
+  cs::yuv_frame_view i420_view;
+  cs::yuv_frame_view nv12_view;
+};
+
+void generate_source(const Resolution &resolution, ConvertSource &source) {
+  const size_t luma_size =
+      static_cast<size_t>(resolution.width) * resolution.height;
+  const size_t chroma_size = luma_size / 4;
+  source.i420.resize(luma_size + 2 * chroma_size);
+  uint32_t state = 12345;
+  for (uint8_t &value : source.i420) {
+    state = state * 1664525u + 1013904223u;
+    value = static_cast<uint8_t>(state >> 24);
+  }
+  source.nv12.assign(source.i420.begin(), source.i420.begin() + luma_size);
+  for (size_t i = 0; i < chroma_size; ++i) {
+    source.nv12.push_back(source.i420[luma_size + i]);
+    source.nv12.push_back(source.i420[luma_size + chroma_size + i]);
+  }
+
+  cs::yuv_frame_view &view = source.i420_view;
+  view.y = source.i420.data();
+  view.u = view.y + luma_size;
+  view.v = view.u + chroma_size;
+  view.width = resolution.width;
+  view.height = resolution.height;
+  view.pitch_y = resolution.width;
+  view.pitch_u = resolution.width / 2;
+  view.pitch_v = resolution.width / 2;
+  source.nv12_view = view;
+  source.nv12_view.y = source.nv12.data();
+  source.nv12_view.u = source.nv12_view.y + luma_size;
+  source.nv12_view.v = nullptr;
+  source.nv12_view.pitch_u = resolution.width;
+}
+
+// Per pixel float conversion, as previously done for the bitmap output
+void convert_float(const cs::yuv_frame_view &view, uint8_t *output) {
+  for (int i = 0; i < view.height; ++i) {
+    for (int j = 0; j < view.width; ++j) {
+      const float y = view.y[j + view.pitch_y * i];
+      const float u = view.u[j / 2 + view.pitch_u * (i / 2)];
+      const float v = view.v[j / 2 + view.pitch_v * (i / 2)];
+      const auto r = static_cast<int32_t>(1.164f * (y - 16) +
+                                          1.596f * (v - 128));
+      const auto g = static_cast<int32_t>(
+          1.164f * (y - 16) - 0.813f * (v - 128) - 0.391f * (u - 128));
+      const auto b = static_cast<int32_t>(1.164f * (y - 16) +
+                                          2.018f * (u - 128));
+      uint8_t *pixel = output + 4 * (static_cast<size_t>(i) * view.width + j);
+      pixel[0] = static_cast<uint8_t>(std::min(255, std::max(b, 0)));
+      pixel[1] = static_cast<uint8_t>(std::min(255, std::max(g, 0)));
+      pixel[2] = static_cast<uint8_t>(std::min(255, std::max(r, 0)));
+      pixel[3] = 0;
+    }
+  }
+}
+
+int max_difference(const std::vector<uint8_t> &a,
+                   const std::vector<uint8_t> &b) {
+  int difference = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  }
+  return difference;
+}
+
+void report_convert(const std::string &name, const int frames,
+                    const double seconds, const int pixels,
+                    const int difference) {
+  LOG_INFO << "  " << name << ": " << frames / seconds << " frames/s, "
+           << frames * static_cast<double>(pixels) / seconds / 1e6
+           << " Mpixels/s (max difference " << difference << ")";
+}
+
+void benchmark_kernels(const Arguments &args, const ConvertSource &source,
+                       const cs::ColorFormat &format,
+                       const cs::ChromaLayout layout) {
+  const cs::yuv_frame_view &view =
+      layout == cs::ChromaLayout::nv12 ? source.nv12_view : source.i420_view;
+  const ptrdiff_t pitch = static_cast<ptrdiff_t>(view.width) * 4;
+  const int pixels = view.width * view.height;
+  std::vector<uint8_t> reference(static_cast<size_t>(pixels) * 4);
+  cs::ColorConverter scalar(format, 1, cs::ColorKernel::scalar);
+  scalar.convert(view, layout, reference.data(), pitch);
+
+  const cs::ColorKernel kernels[] = {cs::ColorKernel::scalar,
+                                     cs::ColorKernel::sse41,
+                                     cs::ColorKernel::avx2};
+  std::vector<uint8_t> output(reference.size());
+  for (const cs::ColorKernel kernel : kernels) {
+    if (!cs::ColorConverter::is_supported(kernel)) {
+      continue;
+    }
+    cs::ColorConverter converter(format, 1, kernel);
+    cs::Timer timer;
+    for (int i = 0; i < args.iterations; ++i) {
+      converter.convert(view, layout, output.data(), pitch);
+    }
+    report_convert(cs::ColorConverter::kernel_name(kernel), args.iterations,
+                   timer.elapsed(), pixels, max_difference(reference, output));
+  }
+
+  for (int threads = 2; threads <= args.max_threads; threads *= 2) {
+    cs::ColorConverter converter(format, threads);
+    cs::Timer rows_timer;
+    for (int i = 0; i < args.iterations; ++i) {
+      converter.convert(view, layout, output.data(), pitch);
+    }
+    report_convert(std::string(cs::ColorConverter::kernel_name(
+                       converter.kernel())) +
+                       ", " + std::to_string(threads) + " threads on rows",
+                   args.iterations, rows_timer.elapsed(), pixels,
+                   max_difference(reference, output));
+
+    std::vector<std::vector<uint8_t>> frames(
+        args.iterations, std::vector<uint8_t>(reference.size()));
+    std::vector<uint8_t *> outputs;
+    for (std::vector<uint8_t> &frame : frames) {
+      outputs.push_back(frame.data());
+    }
+    const std::vector<cs::yuv_frame_view> views(args.iterations, view);
+    cs::Timer frames_timer;
+    converter.convert(views, layout, outputs, pitch);
+    report_convert(std::string(cs::ColorConverter::kernel_name(
+                       converter.kernel())) +
+                       ", " + std::to_string(threads) + " threads on frames",
+                   args.iterations, frames_timer.elapsed(), pixels,
+                   max_difference(reference, frames.back()));
+  }
+}
+
+void benchmark_convert(const Arguments &args) {
+  const Resolution resolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+  for (const Resolution &resolution : resolutions) {
+    ConvertSource source;
+    generate_source(resolution, source);
+
+    // Baseline against which the fixed-point kernels are compared
+    cs::ColorFormat bitmap_format;
+    bitmap_format.alpha = 0;
+    std::vector<uint8_t> reference(
+        static_cast<size_t>(resolution.width) * resolution.height * 4);
+    std::vector<uint8_t> output(reference.size());
+    cs::ColorConverter(bitmap_format)
+        .convert(source.i420_view, cs::ChromaLayout::i420, output.data(),
+                 resolution.width * 4);
+    LOG_INFO << resolution.name << ", I420 to BGRA, BT.601 limited range";
+    cs::Timer timer;
+    for (int i = 0; i < args.iterations; ++i) {
+      convert_float(source.i420_view, reference.data());
+    }
+    report_convert("float", args.iterations, timer.elapsed(),
+                   resolution.width * resolution.height,
+                   max_difference(reference, output));
+
+    const cs::ColorMatrix matrices[] = {cs::ColorMatrix::bt601,
+                                        cs::ColorMatrix::bt709};
+    const cs::ColorRange ranges[] = {cs::ColorRange::limited,
+                                     cs::ColorRange::full};
+    const cs::ChromaLayout layouts[] = {cs::ChromaLayout::i420,
+                                        cs::ChromaLayout::nv12};
+    for (const cs::ChromaLayout layout : layouts) {
+      for (const cs::ColorMatrix matrix : matrices) {
+        for (const cs::ColorRange range : ranges) {
+          cs::ColorFormat format;
+          format.matrix = matrix;
+          format.range = range;
+          format.order = layout == cs::ChromaLayout::nv12
+                             ? cs::PixelOrder::rgba
+                             : cs::PixelOrder::bgra;
+          LOG_INFO << resolution.name << ", "
+                   << (layout == cs::ChromaLayout::nv12 ? "NV12 to RGBA"
+                                                        : "I420 to BGRA")
+                   << ", "
+                   << (matrix == cs::ColorMatrix::bt709 ? "BT.709" : "BT.601")
+                   << (range == cs::ColorRange::full ? " full" : " limited")
+                   << " range";
+          benchmark_kernels(args, source, format, layout);
+        }
+      }
+    }
+  }
+}
+
+const char *format_name(const cs::PlanarFormat format) {
+  switch (format) {
+  case cs::PlanarFormat::i420:
+    return "I420";
+  case cs::PlanarFormat::nv12:
+    return "NV12";
+  case cs::PlanarFormat::p010:
+    return "P010";
+  }
+  return "unknown";
+}
+
+void benchmark_upload_paths(const Arguments &args,
+                            const Resolution &resolution) {
+  const std::string i420_path = "yuv_utils_benchmark_i420.yuv";
+  const std::string nv12_path = "yuv_utils_benchmark_nv12.yuv";
+  generate_clip(i420_path, resolution, args.frames);
+  generate_clip(nv12_path, resolution, args.frames, cs::PlanarFormat::nv12);
+  cs::YuvCapture i420_capture(i420_path, resolution.width, resolution.height,
+                              0, cs::YuvCaptureMode::mapped);
+  cs::YuvCapture nv12_capture(nv12_path, resolution.width, resolution.height,
+                              0, cs::YuvCaptureMode::mapped,
+                              cs::PlanarFormat::nv12);
+  cs::PlanarImage i420(resolution.width, resolution.height);
+  cs::PlanarImage nv12(resolution.width, resolution.height, 0,
+                       cs::PlanarFormat::nv12);
+
+  cs::Timer repack_timer;
+  size_t checksum = 0;
+  for (int k = 0; k < args.frames; ++k) {
+    i420_capture.get_sample(k, i420);
+    cs::convert_planar(i420.view(), cs::PlanarFormat::i420, nv12);
+    checksum += nv12.get_uv()[k];
+  }
+  report("I420 read, host repack to NV12", args.frames,
+         repack_timer.elapsed(), checksum);
+
+  cs::Timer converting_timer;
+  checksum = 0;
+  for (int k = 0; k < args.frames; ++k) {
+    i420_capture.get_sample(k, nv12);
+    checksum += nv12.get_uv()[k];
+  }
+  report("I420 read into NV12", args.frames, converting_timer.elapsed(),
+         checksum);
+
+  cs::Timer direct_timer;
+  checksum = 0;
+  for (int k = 0; k < args.frames; ++k) {
+    nv12_capture.get_sample(k, nv12);
+    checksum += nv12.get_uv()[k];
+  }
+  report("NV12 read", args.frames, direct_timer.elapsed(), checksum);
+
+  for (const std::string &path : {i420_path, nv12_path}) {
+    if (std::remove(path.c_str()) != 0) {
+      LOG_DEBUG << "Deleting file " << path << " failed";
+    }
+  }
+}
+
+void benchmark_planar(const Arguments &args) {
+  const Resolution resolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+  const cs::PlanarFormat formats[] = {cs::PlanarFormat::i420,
+                                      cs::PlanarFormat::nv12,
+                                      cs::PlanarFormat::p010};
+  for (const Resolution &resolution : resolutions) {
+    LOG_INFO << resolution.name << ", " << args.frames
+             << " frames prepared for an NV12 upload";
+    benchmark_upload_paths(args, resolution);
+
+    LOG_INFO << resolution.name << ", " << args.iterations
+             << " conversions per format pair";
+    for (const cs::PlanarFormat from : formats) {
+      cs::PlanarImage source(resolution.width, resolution.height, 0, from);
+      for (size_t i = 0; i < source.get_size_in_bytes(); ++i) {
+        source.get_y()[i] = static_cast<uint8_t>(i * 7);
+      }
+      for (const cs::PlanarFormat to : formats) {
+        if (from == to) {
+          continue;
+        }
+        cs::PlanarImage destination(resolution.width, resolution.height, 0,
+                                    to);
+        cs::Timer timer;
+        for (int i = 0; i < args.iterations; ++i) {
+          cs::convert_planar(source.view(), from, destination);
+        }
+        const double seconds = timer.elapsed();
+        const double bytes = static_cast<double>(args.iterations) *
+                             (source.get_size_in_bytes() +
+                              destination.get_size_in_bytes());
+        LOG_INFO << "  " << format_name(from) << " to " << format_name(to)
+                 << ": " << args.iterations / seconds << " frames/s, "
+                 << bytes / seconds / 1e9 << " GB/s";
+      }
+    }
+  }
+}
+
+void benchmark_y4m_capture(const Arguments &args, const std::string &path,
+                           const cs::YuvCaptureMode mode,
+                           const std::string &name) {
+  cs::Timer index_timer;
+  cs::YuvCapture capture(path, 0, 0, 0, mode);
+  LOG_INFO << "  " << name << " index of " << capture.get_num_frames()
+           << " frames: " << index_timer.elapsed() * 1e3 << " ms";
+
+  // Frames are visited in a fixed pseudo random order
+  cs::PlanarImage frame(capture.get_width(), capture.get_height());
+  cs::Timer random_timer;
+  size_t checksum = 0;
+  for (int k = 0; k < args.frames; ++k) {
+    const int frame_num = static_cast<int>((k * 7919LL) % args.frames);
+    capture.get_sample(frame_num, frame);
+    checksum += frame.get_y()[frame_num];
+  }
+  report(name + " random access", args.frames, random_timer.elapsed(),
+         checksum);
+}
+
+void benchmark_y4m(const Arguments &args) {
+  const Resolution resolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+  for (const Resolution &resolution : resolutions) {
+    const std::string path = "yuv_utils_benchmark.y4m";
+    cs::PlanarImage frame(resolution.width, resolution.height);
+    cs::YuvWriter writer(resolution.width, resolution.height, 0);
+    writer.open(path);
+    for (int k = 0; k < args.frames; ++k) {
+      std::fill(frame.get_y(), frame.get_y() + frame.get_size_in_bytes(),
+                static_cast<uint8_t>(k));
+      writer.append_frame(frame);
+    }
+    writer.write_to_file(path.c_str());
+    LOG_INFO << resolution.name << ", " << args.frames << " Y4M frames";
+
+    benchmark_y4m_capture(args, path, cs::YuvCaptureMode::stream, "stream");
+    benchmark_y4m_capture(args, path, cs::YuvCaptureMode::mapped, "mapped");
+
+    if (std::remove(path.c_str()) != 0) {
+      LOG_DEBUG << "Deleting file " << path << " failed";
+    }
+  }
+}
+
+struct OverlaySource {
+  std::vector<cs::motion_vector> mvs;
+  std::vector<cs::inter_shape> shapes;
+};
+
+// Vectors of a few pixels and a mix of all macroblock partitions
+void generate_vectors(const Resolution &resolution, OverlaySource &source) {
+  const int mb_count = ((resolution.width + 15) / 16) *
+                       ((resolution.height + 15) / 16);
+  std::mt19937 generator(1);
+  std::normal_distribution<double> length(0.0, 24.0);
+  source.mvs.resize(mb_count * 16);
+  for (cs::motion_vector &mv : source.mvs) {
+    mv.x = static_cast<int16_t>(length(generator));
+    mv.y = static_cast<int16_t>(length(generator));
+  }
+  source.shapes.resize(mb_count);
+  for (cs::inter_shape &shape : source.shapes) {
+    shape.x = static_cast<uint8_t>(generator() % 4);
+    shape.y = static_cast<uint8_t>(generator() % 256);
+  }
+}
+
+size_t count_differences(const cs::PlanarImage &a, const cs::PlanarImage &b) {
+  size_t differences = 0;
+  for (int y = 0; y < a.get_height(); ++y) {
+    for (int x = 0; x < a.get_width(); ++x) {
+      differences += a.get_y()[y * a.get_pitch_y() + x] !=
+                     b.get_y()[y * b.get_pitch_y() + x];
+    }
+  }
+  return differences;
+}
+
+void report_overlay(const std::string &name, const int iterations,
+                    const double seconds, const size_t differences) {
+  LOG_INFO << "  " << name << ": " << seconds / iterations * 1e3
+           << " ms/frame (" << differences << " pixels differ)";
+}
+
+void benchmark_overlay(const Arguments &args) {
+  const Resolution resolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+  for (const Resolution &resolution : resolutions) {
+    LOG_INFO << resolution.name << ", " << args.iterations
+             << " overlays per renderer";
+    OverlaySource source;
+    generate_vectors(resolution, source);
+    cs::PlanarImage frame(resolution.width, resolution.height);
+
+    cs::PlanarImage reference = frame;
+    cs::Timer serial_timer;
+    for (int i = 0; i < args.iterations; ++i) {
+      reference.overlay_vectors(source.mvs.data(), source.shapes.data());
+    }
+    report_overlay("PlanarImage::overlay_vectors", args.iterations,
+                   serial_timer.elapsed(), 0);
+
+    for (int threads = 1; threads <= args.max_threads; threads *= 2) {
+      cs::VectorOverlay overlay(threads);
+      cs::PlanarImage image = frame;
+      cs::Timer timer;
+      for (int i = 0; i < args.iterations; ++i) {
+        overlay.render(source.mvs.data(), source.shapes.data(),
+                       cs::luma_plane(image));
+      }
+      report_overlay(std::to_string(threads) + " threads", args.iterations,
+                     timer.elapsed(), count_differences(reference, image));
+    }
+
+    // The source frame stays untouched until the overlay is composited
+    cs::VectorOverlay overlay(args.max_threads);
+    cs::OverlayPlane plane(resolution.width, resolution.height);
+    cs::PlanarImage image = frame;
+    cs::Timer plane_timer;
+    for (int i = 0; i < args.iterations; ++i) {
+      plane.clear();
+      overlay.render(source.mvs.data(), source.shapes.data(), plane.plane());
+      plane.composite(image);
+    }
+    report_overlay("overlay plane and composite, " +
+                       std::to_string(overlay.thread_count()) + " threads",
+                   args.iterations, plane_timer.elapsed(),
+                   count_differences(reference, image));
+  }
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  std::vector<std::string> command_line(argv + 1, argv + argc);
+  cs::init_logging(command_line);
+
+  Arguments args;
+  po::options_description desc("Allowed options");
+  auto options = desc.add_options();
+  options("help,h", "show help message");
+  options("suite", po::value<std::string>(&args.suite)->default_value("all"),
+          "benchmark to run: all, capture, write, convert, planar, y4m, "
+          "overlay");
+  options("frames", po::value<int>(&args.frames)->default_value(32),
+          "number of frames in each generated clip");
+  options("prefetch", po::value<int>(&args.prefetch)->default_value(4),
+          "frames prefetched ahead in mapped mode, 0 disables prefetching");
+  options("write-buffer",
+          po::value<int>(&args.write_buffer)->default_value(64),
+          "megabytes queued by the streaming writer");
+  options("iterations", po::value<int>(&args.iterations)->default_value(20),
+          "frames converted by each conversion kernel");
+  options("max-threads",
+          po::value<int>(&args.max_threads)
+              ->default_value(cs::ThreadPool::hardware_threads()),
+          "largest thread count, counts are doubled starting from 2");
+  po::variables_map vm;
+  po::store(po::command_line_parser(command_line).options(desc).run(), vm);
+  if (vm.count("help") != 0u) {
+    std::cout << desc;
+    return 0;
+  }
+  po::notify(vm);
+
+  if (args.suite == "all" || args.suite == "capture") {
+    benchmark_capture(args);
+  }
+  if (args.suite == "all" || args.suite == "write") {
+    benchmark_write(args);
+  }
+  if (args.suite == "all" || args.suite == "convert") {
+    benchmark_convert(args);
+  }
+  if (args.suite == "all" || args.suite == "planar") {
+    benchmark_planar(args);
+  }
+  if (args.suite == "all" || args.suite == "y4m") {
+    benchmark_y4m(args);
+  }
+  if (args.suite == "all" || args.suite == "overlay") {
+    benchmark_overlay(args);
+  }
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_COLOR_CONVERT_HPP
+#define COMPUTE_SAMPLES_COLOR_CONVERT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "yuv_utils/yuv_utils.hpp"
+
+namespace compute_samples {
+
+class ThreadPool;
+
+enum class ColorMatrix { bt601, bt709 };
+enum class ColorRange { limited, full };
+// i420 has separate U and V planes, nv12 one plane of interleaved U and V
+enum class ChromaLayout { i420, nv12 };
+// Byte order of the output pixels in memory
+enum class PixelOrder { bgra, rgba };
+enum class ColorKernel { automatic, scalar, sse41, avx2 };
+
+struct ColorFormat {
+  ColorMatrix matrix = ColorMatrix::bt601;
+  ColorRange range = ColorRange::limited;
+  PixelOrder order = PixelOrder::bgra;
+  uint8_t alpha = 255;
+};
+
+// Converts 4:2:0 YUV frames to packed 32-bit pixels.
+// All kernels use the same 13-bit fixed-point arithmetic, so SIMD results are
+// bit-exact with the scalar reference. For nv12 the u pointer and pitch of
+// the view describe the interleaved chroma plane and v is unused. A negative
+// output pitch writes rows bottom-up, starting at the given row pointer.
+// Rows of a frame, or whole frames of a batch, are split across threads.
+class ColorConverter {
+public:
+  explicit ColorConverter(const ColorFormat &format = ColorFormat(),
+                          const int thread_count = 1,
+                          const ColorKernel kernel = ColorKernel::automatic);
+  ~ColorConverter();
+
+  ColorConverter(const ColorConverter &) = delete;
+  ColorConverter &operator=(const ColorConverter &) = delete;
+
+  void convert(const yuv_frame_view &source, const ChromaLayout layout,
+               uint8_t *output, const ptrdiff_t output_pitch);
+  void convert(const std::vector<yuv_frame_view> &sources,
+               const ChromaLayout layout, const std::vector<uint8_t *> &outputs,
+               const ptrdiff_t output_pitch);
+
+  const ColorFormat &format() const { return format_; }
+  ColorKernel kernel() const { return kernel_; }
+  int thread_count() const;
+
+  static bool is_supported(const ColorKernel kernel);
+  static const char *kernel_name(const ColorKernel kernel);
+
+  struct Coefficients {
+    int16_t y_offset;
+    int16_t y_scale;
+    int16_t v_to_r;
+    int16_t u_to_g;
+    int16_t v_to_g;
+    int16_t u_to_b;
+  };
+
+private:
+  void convert_rows(const yuv_frame_view &source, const ChromaLayout layout,
+                    uint8_t *output, const ptrdiff_t output_pitch,
+                    const int begin, const int end) const;
+
+  ColorFormat format_;
+  ColorKernel kernel_;
+  Coefficients coefficients_;
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace compute_samples
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_FRAME_PIPELINE_HPP
+#define COMPUTE_SAMPLES_FRAME_PIPELINE_HPP
+
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+
+namespace compute_samples {
+
+enum class FrameStage { read, upload, compute, readback, overlay, write };
+const int frame_stage_count = 6;
+
+// Runs every frame of a sequence through a fixed list of stages.
+// Each stage has its own thread and handles frames in order, so disk, host
+// and device work of different frames overlap. At most depth() frames are in
+// flight and per frame resources are indexed by slot(frame_idx). There is one
+// slot more than the depth, so the slot of the previous frame stays untouched
+// while the current frame is processed and can be used as a motion estimation
+// reference. The first exception thrown by a stage stops the pipeline and is
+// rethrown by run().
+class FramePipeline {
+public:
+  typedef std::function<void(int frame_idx, int slot)> StageFunction;
+
+  explicit FramePipeline(const int depth);
+
+  FramePipeline(const FramePipeline &) = delete;
+  FramePipeline &operator=(const FramePipeline &) = delete;
+
+  // Stages without a function are skipped
+  void set_stage(const FrameStage stage, StageFunction function);
+  void run(const int frame_count);
+
+  int depth() const { return depth_; }
+  int slot_count() const { return depth_ + 1; }
+  int slot(const int frame_idx) const { return frame_idx % slot_count(); }
+
+  // Statistics of the last run
+  double stage_latency(const FrameStage stage) const;
+  double frames_per_second() const;
+  void log_statistics() const;
+
+  static const char *stage_name(const FrameStage stage);
+
+private:
+  void stage_worker(const int stage, const int frame_count);
+  bool is_ready(const int stage, const int frame_idx) const;
+
+  const int depth_;
+  std::array<StageFunction, frame_stage_count> stages_;
+  std::array<int, frame_stage_count> completed_ = {};
+  std::array<double, frame_stage_count> busy_seconds_ = {};
+  double elapsed_seconds_ = 0.0;
+  int frame_count_ = 0;
+  bool failed_ = false;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+} // namespace compute_samples
+
+#endif
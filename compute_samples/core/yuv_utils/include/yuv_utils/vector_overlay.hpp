@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_VECTOR_OVERLAY_HPP
+#define COMPUTE_SAMPLES_VECTOR_OVERLAY_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "yuv_utils/yuv_utils.hpp"
+
+namespace compute_samples {
+
+class ThreadPool;
+
+// 8-bit plane that vectors are drawn into, either the luma plane of a frame
+// or a separate overlay plane which leaves the frame untouched
+typedef struct {
+  uint8_t *data;
+  int width, height;
+  int pitch;
+} overlay_plane;
+
+overlay_plane luma_plane(PlanarImage &image);
+
+// Owns a zeroed overlay plane of the given size
+class OverlayPlane {
+public:
+  OverlayPlane(int width, int height);
+
+  void clear();
+  // Copies every drawn, non-zero overlay pixel into the luma plane
+  void composite(PlanarImage &image) const;
+
+  overlay_plane plane();
+
+private:
+  std::vector<uint8_t> data_;
+  int width_;
+  int height_;
+};
+
+// Draws the motion vectors and intra shapes of macroblocks like
+// PlanarImage::overlay_vectors. Lines are first generated per macroblock row,
+// then the plane is split into tiles of macroblock rows which are drawn in
+// parallel. Every tile draws the part of each line reaching into it, clipped
+// once per line instead of per pixel. Lines have a single color, so the
+// result does not depend on the order tiles are drawn in.
+class VectorOverlay {
+public:
+  // Zero selects the number of hardware threads
+  explicit VectorOverlay(const int thread_count = 1,
+                         const uint8_t color = 180);
+  ~VectorOverlay();
+
+  VectorOverlay(const VectorOverlay &) = delete;
+  VectorOverlay &operator=(const VectorOverlay &) = delete;
+
+  void render(const motion_vector *mvs, const inter_shape *shapes,
+              const overlay_plane &plane);
+  void render(const motion_vector *mvs, const inter_shape *inter_shapes,
+              const intra_shape *intra_shapes,
+              const residual *inter_residuals,
+              const residual *intra_residuals, const overlay_plane &plane);
+
+  int thread_count() const;
+
+  struct Line {
+    int32_t x0, y0, dx, dy;
+  };
+
+private:
+  void generate(const motion_vector *mvs, const inter_shape *inter_shapes,
+                const intra_shape *intra_shapes,
+                const residual *inter_residuals,
+                const residual *intra_residuals, const overlay_plane &plane);
+  void draw(const overlay_plane &plane);
+  void draw_tile(const overlay_plane &plane, const int first_row,
+                 const int end_row) const;
+
+  uint8_t color_;
+  // Lines of each macroblock row and the rows they reach
+  std::vector<std::vector<Line>> lines_;
+  std::vector<int> top_;
+  std::vector<int> bottom_;
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace compute_samples
+
+#endif
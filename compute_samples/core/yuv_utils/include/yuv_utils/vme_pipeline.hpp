@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_VME_PIPELINE_HPP
+#define COMPUTE_SAMPLES_VME_PIPELINE_HPP
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "align_utils/align_utils.hpp"
+#include "yuv_utils/frame_pipeline.hpp"
+#include "yuv_utils/yuv_utils.hpp"
+
+namespace compute_samples {
+
+// Host resources of a frame in flight through a VmePipeline
+struct VmeFrame {
+  VmeFrame(int width, int height, int mv_count, int mb_count);
+
+  PlanarImage planar_image;
+  align_utils::PageAlignedVector<motion_vector> mvs;
+  align_utils::PageAlignedVector<inter_shape> shapes;
+};
+
+// Motion estimation of a YUV sequence on a FramePipeline with one VmeFrame
+// per slot. Applications enqueue their device work in the upload, compute and
+// readback stages. The compute stage gets the slot of the previous frame as
+// reference, the first frame is its own reference. It has no motion vectors
+// unless set_first_frame_estimated is set, so readback and overlay skip it.
+// By default the overlay draws the vectors read back into a frame on its
+// planar image.
+class VmePipeline {
+public:
+  typedef std::function<void(int slot, const PlanarImage &image)>
+      UploadFunction;
+  typedef std::function<void(int frame_idx, int slot, int reference_slot)>
+      ComputeFunction;
+  typedef std::function<void(int slot, VmeFrame &frame)> ReadbackFunction;
+  typedef std::function<void(int frame_idx, VmeFrame &frame)> FrameFunction;
+
+  VmePipeline(int depth, int width, int height, int mv_count, int mb_count);
+
+  VmePipeline(const VmePipeline &) = delete;
+  VmePipeline &operator=(const VmePipeline &) = delete;
+
+  void set_upload(UploadFunction function);
+  void set_compute(ComputeFunction function);
+  void set_readback(ReadbackFunction function);
+  void set_read(FrameFunction function);
+  void set_overlay(FrameFunction function);
+  void set_write(FrameFunction function);
+  void set_first_frame_estimated(bool estimated);
+
+  // Read stage filling the planar image of frames from the capture
+  void read_from(YuvCapture &capture);
+  // Write stage appending the planar image of frames to the writer
+  void write_to(YuvWriter &writer);
+
+  void run(int frame_count);
+
+  int slot_count() const { return pipeline_.slot_count(); }
+  int slot(int frame_idx) const { return pipeline_.slot(frame_idx); }
+  VmeFrame &frame(int slot) { return *frames_[slot]; }
+
+private:
+  bool is_estimated(int frame_idx) const;
+
+  FramePipeline pipeline_;
+  std::vector<std::unique_ptr<VmeFrame>> frames_;
+  UploadFunction upload_;
+  ComputeFunction compute_;
+  ReadbackFunction readback_;
+  FrameFunction read_;
+  FrameFunction overlay_;
+  FrameFunction write_;
+  bool first_frame_estimated_ = false;
+};
+
+} // namespace compute_samples
+
+#endif
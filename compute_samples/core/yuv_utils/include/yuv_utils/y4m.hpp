@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#ifndef COMPUTE_SAMPLES_Y4M_HPP
+#define COMPUTE_SAMPLES_Y4M_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace compute_samples {
+
+// Stream header of a YUV4MPEG2 file. Unknown X tags are kept verbatim so that
+// they can be written back.
+struct Y4mHeader {
+  int width = 0;
+  int height = 0;
+  int frame_rate_num = 30;
+  int frame_rate_den = 1;
+  // p progressive, t top field first, b bottom field first, m mixed
+  char interlacing = 'p';
+  // 0:0 means unknown
+  int aspect_num = 0;
+  int aspect_den = 0;
+  std::string colorspace = "420jpeg";
+  std::vector<std::string> extensions;
+};
+
+// Checks for the "YUV4MPEG2 " signature at the start of a file
+bool is_y4m_signature(const uint8_t *data, size_t size);
+// True for paths with a .y4m extension
+bool is_y4m_path(const std::string &path);
+
+// Longest header accepted by read_y4m_header
+const size_t y4m_max_header_size = 4096;
+
+// Parses a header line without its terminating newline. Throws
+// std::invalid_argument for malformed lines.
+Y4mHeader parse_y4m_header(const std::string &line);
+// Parses the header at the start of a file. Returns the size of the header
+// including its newline, or zero when the data has no Y4M signature.
+size_t read_y4m_header(const uint8_t *data, size_t size, Y4mHeader &header);
+// Header line including its terminating newline
+std::string format_y4m_header(const Y4mHeader &header);
+// True for the 8-bit 4:2:0 colorspaces, which are stored like I420
+bool is_y4m_420(const Y4mHeader &header);
+
+// Every frame starts with this marker, optionally followed by parameters
+// before the newline
+const char y4m_frame_marker[] = "FRAME\n";
+
+// Offsets of the frame payloads following the header, which ends at
+// first_frame. Scanning stops after max_frames frames when it is non-zero.
+// Throws std::invalid_argument when a frame marker is missing or the last
+// frame is truncated.
+std::vector<uint64_t> index_y4m_frames(const uint8_t *data, uint64_t size,
+                                       uint64_t first_frame,
+                                       uint64_t frame_size, int max_frames);
+std::vector<uint64_t> index_y4m_frames(std::istream &file, uint64_t size,
+                                       uint64_t first_frame,
+                                       uint64_t frame_size, int max_frames);
+
+} // namespace compute_samples
+
+#endif
@@ -10,8 +10,13 @@
 #include <utility>
 #include <vector>
 #include <fstream>
+#include <memory>
 
 #include "align_utils/align_utils.hpp"
+#include "image/image.hpp"
+#include "utils/async_file_writer.hpp"
+#include "utils/mapped_file.hpp"
+#include "yuv_utils/y4m.hpp"
 
 namespace compute_samples {
 
@@ -24,14 +29,54 @@ typedef struct {
 } inter_shape;
 typedef uint8_t intra_shape;
 
+enum class PlanarFormat {
+  // 8-bit Y plane followed by separate U and V planes
+  i420,
+  // 8-bit Y plane followed by one plane of interleaved U and V samples
+  nv12,
+  // Like nv12 with 16-bit samples, which hold 10 bits in their high bits
+  p010
+};
+
+// Bytes of a single sample of the format
+int bytes_per_sample(PlanarFormat format);
+// Size of a frame of the format stored without padding, as in YUV files
+size_t packed_frame_size(PlanarFormat format, int width, int height);
+
+// Read-only planes of a frame or field. Pitches are in bytes. For nv12 and
+// p010 u points to the interleaved chroma plane and v to its first V sample,
+// both with the pitch of the chroma plane.
+typedef struct {
+  const uint8_t *y, *u, *v;
+  int width, height;
+  int pitch_y, pitch_u, pitch_v;
+} yuv_frame_view;
+
+// View of a frame stored without padding, as in YUV files
+yuv_frame_view make_frame_view(const uint8_t *data, PlanarFormat format,
+                               int width, int height);
+
+// Images have a page aligned Y plane and pitches in bytes. For nv12 and p010
+// the chroma plane directly follows the Y plane with the same pitch, so the
+// image can be shared as a single NV12 or P010 surface without repacking.
+// get_u and get_v then point to the first U and V sample of that plane.
 class PlanarImage {
 public:
   PlanarImage()
       : y_(nullptr), u_(nullptr), v_(nullptr), width_(0), height_(0),
-        pitch_y_(0), pitch_u_(0), pitch_v_(0) {}
-  PlanarImage(int width, int height, int pitch_y = 0);
+        pitch_y_(0), pitch_u_(0), pitch_v_(0),
+        format_(PlanarFormat::i420) {}
+  PlanarImage(int width, int height, int pitch_y = 0,
+              PlanarFormat format = PlanarFormat::i420);
   ~PlanarImage() = default;
 
+  // Plane pointers are rebased onto the storage of the copy
+  PlanarImage(const PlanarImage &other);
+  PlanarImage &operator=(const PlanarImage &other);
+  PlanarImage(PlanarImage &&other) noexcept;
+  PlanarImage &operator=(PlanarImage &&other) noexcept;
+
+  // Draws into the luma plane with a single threaded VectorOverlay
   void overlay_vectors(const motion_vector *mvs, const inter_shape *shapes);
   void overlay_vectors(const motion_vector *mvs,
                        const inter_shape *inter_shapes,
@@ -42,6 +87,10 @@ public:
   uint8_t *get_y() const { return y_; }
   uint8_t *get_u() const { return u_; }
   uint8_t *get_v() const { return v_; }
+  // Interleaved chroma plane, nullptr for i420
+  uint8_t *get_uv() const {
+    return format_ == PlanarFormat::i420 ? nullptr : u_;
+  }
 
   int get_pitch_y() const { return pitch_y_; }
   int get_pitch_u() const { return pitch_u_; }
@@ -49,17 +98,14 @@ public:
 
   int get_width() const { return width_; }
   int get_height() const { return height_; }
+  PlanarFormat get_format() const { return format_; }
+  // Bytes from get_y() to the end of the last plane
+  size_t get_size_in_bytes() const { return data_.size(); }
 
-private:
-  void draw_pixel(int32_t x, int32_t y, uint8_t *pic, int pic_width,
-                  int pic_height, uint8_t u8_pixel);
-  void draw_line(int32_t x0, int32_t y0, int32_t dx, int32_t dy, uint8_t *pic,
-                 int pic_width, int pic_height, uint8_t u8_pixel);
-
-  void compute_num_mvs(int pic_width, int pic_height, int &mv_image_width,
-                       int &mv_image_height, int &mb_image_width,
-                       int &mb_image_height) const;
+  yuv_frame_view view() const;
 
+private:
+  void copy_layout(const PlanarImage &other);
   align_utils::AlignedVector<uint8_t, 0x1000> data_;
   uint8_t *y_;
   uint8_t *u_;
@@ -69,24 +115,78 @@ private:
   int pitch_y_;
   int pitch_u_;
   int pitch_v_;
+  PlanarFormat format_;
 };
 
+// Converts a frame to the format of an equally sized image. 8-bit samples
+// become the high byte of P010 samples, and P010 samples are rounded to their
+// high byte.
+void convert_planar(const yuv_frame_view &source, PlanarFormat source_format,
+                    PlanarImage &destination);
+
+enum class YuvCaptureMode {
+  // Frames are read row by row through a file stream
+  stream,
+  // The whole file is memory mapped, frames can be viewed without copying
+  mapped
+};
+
+class YuvPrefetcher;
+class ColorConverter;
+
+// Reads raw YUV files and Y4M files, which are recognized by their signature.
+// The frame size and format of Y4M files come from their header, so width and
+// height may be zero. Frame offsets are indexed when the file is opened,
+// which gives constant time access to any frame of multi-gigabyte files.
 class YuvCapture {
 public:
-  YuvCapture() = default;
-  YuvCapture(const std::string &fn, int width, int height, int frames = 0);
-  ~YuvCapture() = default;
+  YuvCapture();
+  YuvCapture(const std::string &fn, int width, int height, int frames = 0,
+             YuvCaptureMode mode = YuvCaptureMode::stream,
+             PlanarFormat format = PlanarFormat::i420);
+  ~YuvCapture();
+
+  YuvCapture(const YuvCapture &) = delete;
+  YuvCapture &operator=(const YuvCapture &) = delete;
 
+  // Samples are converted when the image has a different format than the
+  // file, so that I420 clips can be read straight into NV12 images.
   void get_sample(int frame_num, PlanarImage &im);
   void get_sample(int frame_num, PlanarImage &im, bool interlaced,
                   int polarity);
 
+  // Mapped mode only. Field views skip every other row of the frame.
+  yuv_frame_view get_frame_view(int frame_num);
+  yuv_frame_view get_field_view(int frame_num, int polarity);
+
+  // Mapped mode only. A background thread advises the operating system to
+  // read the frames following the most recently requested one. Zero frames
+  // stops prefetching.
+  void set_prefetch_frames(int frames);
+
   int get_width() const { return width_; }
   int get_height() const { return height_; }
   int get_num_frames() const { return num_frames_; }
+  YuvCaptureMode get_mode() const { return mode_; }
+  PlanarFormat get_format() const { return format_; }
+  bool is_y4m() const { return y4m_; }
+  // Header of a Y4M file, defaults for raw files
+  const Y4mHeader &get_y4m_header() const { return y4m_header_; }
 
 private:
+  void read_planes(PlanarImage &im, bool interlaced, int polarity);
+  void index_frames(uint64_t file_size, uint64_t first_frame, int frames);
+  uint64_t frame_offset(int frame_num) const;
+
   std::ifstream file_;
+  MappedFile mapped_file_;
+  std::unique_ptr<YuvPrefetcher> prefetcher_;
+  YuvCaptureMode mode_;
+  PlanarFormat format_;
+  PlanarImage scratch_;
+  std::vector<uint64_t> frame_offsets_;
+  Y4mHeader y4m_header_;
+  bool y4m_;
   int width_;
   int height_;
   int num_frames_;
@@ -95,21 +195,50 @@ private:
 class YuvWriter {
 public:
   YuvWriter() = default;
-  YuvWriter(int width, int height, int frame_num_hint, bool b_to_bmps = false);
-  ~YuvWriter() = default;
+  // Frames are written in the given format and converted when appended
+  // images have a different one
+  YuvWriter(int width, int height, int frame_num_hint, bool b_to_bmps = false,
+            PlanarFormat format = PlanarFormat::i420);
+  ~YuvWriter();
+
+  // Streams appended frames to fn through a background writer instead of
+  // keeping the whole clip in memory. write_to_file(fn) then finishes the
+  // stream. Must be called before the first frame is appended.
+  void open(const std::string &fn, size_t max_bytes_in_flight = 64 << 20,
+            bool direct_io = false);
+
+  // Files with a .y4m extension are written as I420 Y4M. Frame rate, aspect
+  // ratio, interlacing and colorspace are taken from the given header, the
+  // frame size from the writer. Must be called before open.
+  void set_y4m_header(const Y4mHeader &header);
 
   void append_frame(const PlanarImage &im);
   void write_to_file(const char *fn);
 
   int get_width() const { return width_; }
   int get_height() const { return height_; }
+  bool is_streaming() const { return writer_ != nullptr; }
+  PlanarFormat get_format() const { return format_; }
 
 private:
+  void pack_frame(const PlanarImage &im, uint8_t *p_dst);
+  void write_bmp(const uint8_t *frame, int index, const std::string &prefix);
+  std::string y4m_header() const;
+
   int width_;
   int height_;
   int curr_frame_;
   bool b_to_bmps_;
+  PlanarFormat format_;
   std::vector<uint8_t> data_;
+  PlanarImage scratch_;
+  std::unique_ptr<AsyncFileWriter> writer_;
+  std::string stream_path_;
+  Y4mHeader y4m_header_;
+  bool y4m_stream_ = false;
+  std::unique_ptr<ColorConverter> bmp_converter_;
+  ImageBMP32Bit bmp_;
+  PlanarImage bmp_scratch_;
 };
 
 } // namespace compute_samples
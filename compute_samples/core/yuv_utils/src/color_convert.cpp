@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "yuv_utils/color_convert.hpp"
+#include "utils/cpu_features.hpp"
+#include "utils/thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+#include <immintrin.h>
+#endif
+
+// Every pixel is computed as
+//   c = clamp((y_scale * (Y - y_offset) + chroma_c + 2^12) >> 13)
+// with chroma_c the weighted sum of U - 128 and V - 128 for channel c.
+// Coefficients are signed 16-bit values in Q13, so that the SIMD kernels can
+// produce the 32-bit products with pmaddwd: chroma terms once per pair of
+// pixels from interleaved (U, V), and the luma term with its rounding
+// constant from interleaved (Y, 1).
+
+namespace compute_samples {
+namespace {
+typedef ColorConverter::Coefficients Coefficients;
+
+const int fraction_bits = 13;
+const int16_t rounding = 1 << (fraction_bits - 1);
+// Rows converted by a single task when a frame is split across threads
+const int band_rows = 32;
+
+int16_t to_fixed(const double value) {
+  return static_cast<int16_t>(std::lround(value * (1 << fraction_bits)));
+}
+
+Coefficients make_coefficients(const ColorFormat &format) {
+  const double kr = format.matrix == ColorMatrix::bt709 ? 0.2126 : 0.299;
+  const double kb = format.matrix == ColorMatrix::bt709 ? 0.0722 : 0.114;
+  const double kg = 1.0 - kr - kb;
+  const bool limited = format.range == ColorRange::limited;
+  const double y_scale = limited ? 255.0 / 219.0 : 1.0;
+  const double c_scale = limited ? 255.0 / 224.0 : 1.0;
+
+  Coefficients c;
+  c.y_offset = limited ? 16 : 0;
+  c.y_scale = to_fixed(y_scale);
+  c.v_to_r = to_fixed(2.0 * (1.0 - kr) * c_scale);
+  c.u_to_g = to_fixed(-2.0 * (1.0 - kb) * kb / kg * c_scale);
+  c.v_to_g = to_fixed(-2.0 * (1.0 - kr) * kr / kg * c_scale);
+  c.u_to_b = to_fixed(2.0 * (1.0 - kb) * c_scale);
+  return c;
+}
+
+uint8_t clamp_channel(const int32_t value) {
+  return static_cast<uint8_t>(std::min(255, std::max(value, 0)));
+}
+
+struct RowArgs {
+  const uint8_t *y;
+  const uint8_t *u;
+  const uint8_t *v;
+  uint8_t *output;
+  int width;
+  bool rgba;
+  uint8_t alpha;
+};
+
+template <bool Nv12>
+void convert_row_scalar(const RowArgs &row, const Coefficients &c, int x) {
+  const int r_index = row.rgba ? 0 : 2;
+  const int b_index = row.rgba ? 2 : 0;
+  for (; x < row.width; ++x) {
+    const int cx = x / 2;
+    const int32_t u = (Nv12 ? row.u[2 * cx] : row.u[cx]) - 128;
+    const int32_t v = (Nv12 ? row.u[2 * cx + 1] : row.v[cx]) - 128;
+    const int32_t luma = c.y_scale * (row.y[x] - c.y_offset) + rounding;
+    uint8_t *pixel = row.output + 4 * static_cast<size_t>(x);
+    pixel[r_index] = clamp_channel((luma + c.v_to_r * v) >> fraction_bits);
+    pixel[1] =
+        clamp_channel((luma + c.u_to_g * u + c.v_to_g * v) >> fraction_bits);
+    pixel[b_index] = clamp_channel((luma + c.u_to_b * u) >> fraction_bits);
+    pixel[3] = row.alpha;
+  }
+}
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+int32_t pair(const int16_t low, const int16_t high) {
+  return static_cast<int32_t>(static_cast<uint16_t>(low) |
+                              static_cast<uint32_t>(high) << 16);
+}
+
+// Converts 8 pixels, u_v holding their 4 chroma pairs as (U, V) words and
+// luma their values as words. Pixels are returned in lo (0-3) and hi (4-7).
+COMPUTE_SAMPLES_TARGET("sse4.1")
+void convert_pixels_sse41(__m128i luma, __m128i u_v, const Coefficients &c,
+                          const bool rgba, const __m128i alpha, __m128i &lo,
+                          __m128i &hi) {
+  luma = _mm_sub_epi16(luma, _mm_set1_epi16(c.y_offset));
+  u_v = _mm_sub_epi16(u_v, _mm_set1_epi16(128));
+  const __m128i luma_scale = _mm_set1_epi32(pair(c.y_scale, rounding));
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i luma_lo =
+      _mm_madd_epi16(_mm_unpacklo_epi16(luma, ones), luma_scale);
+  const __m128i luma_hi =
+      _mm_madd_epi16(_mm_unpackhi_epi16(luma, ones), luma_scale);
+
+  __m128i channels[3];
+  const int32_t weights[3] = {pair(c.u_to_b, 0), pair(c.u_to_g, c.v_to_g),
+                              pair(0, c.v_to_r)};
+  for (int i = 0; i < 3; ++i) {
+    // One chroma value covers two neighbouring pixels
+    const __m128i chroma = _mm_madd_epi16(u_v, _mm_set1_epi32(weights[i]));
+    const __m128i value_lo = _mm_srai_epi32(
+        _mm_add_epi32(luma_lo, _mm_unpacklo_epi32(chroma, chroma)),
+        fraction_bits);
+    const __m128i value_hi = _mm_srai_epi32(
+        _mm_add_epi32(luma_hi, _mm_unpackhi_epi32(chroma, chroma)),
+        fraction_bits);
+    const __m128i words = _mm_packs_epi32(value_lo, value_hi);
+    channels[i] = _mm_packus_epi16(words, words);
+  }
+  const __m128i first = rgba ? channels[2] : channels[0];
+  const __m128i third = rgba ? channels[0] : channels[2];
+  const __m128i first_second = _mm_unpacklo_epi8(first, channels[1]);
+  const __m128i third_alpha = _mm_unpacklo_epi8(third, alpha);
+  lo = _mm_unpacklo_epi16(first_second, third_alpha);
+  hi = _mm_unpackhi_epi16(first_second, third_alpha);
+}
+
+template <bool Nv12>
+COMPUTE_SAMPLES_TARGET("sse4.1")
+int convert_row_sse41(const RowArgs &row, const Coefficients &c, int x) {
+  const __m128i alpha = _mm_set1_epi8(static_cast<char>(row.alpha));
+  for (; x + 8 <= row.width; x += 8) {
+    const __m128i luma = _mm_cvtepu8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(row.y + x)));
+    __m128i u_v;
+    if (Nv12) {
+      u_v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(row.u + x));
+    } else {
+      int32_t u = 0;
+      int32_t v = 0;
+      std::memcpy(&u, row.u + x / 2, sizeof(u));
+      std::memcpy(&v, row.v + x / 2, sizeof(v));
+      u_v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(u), _mm_cvtsi32_si128(v));
+    }
+    __m128i lo;
+    __m128i hi;
+    convert_pixels_sse41(luma, _mm_cvtepu8_epi16(u_v), c, row.rgba, alpha, lo,
+                         hi);
+    __m128i *output = reinterpret_cast<__m128i *>(row.output + 4 * x);
+    _mm_storeu_si128(output, lo);
+    _mm_storeu_si128(output + 1, hi);
+  }
+  return x;
+}
+
+// Same arithmetic as convert_pixels_sse41 for 16 pixels. Instructions work
+// within 128-bit lanes, so lane 0 holds pixels 0-7 and lane 1 pixels 8-15,
+// and lo gets pixels 0-3 and 8-11, hi pixels 4-7 and 12-15.
+COMPUTE_SAMPLES_TARGET("avx2")
+void convert_pixels_avx2(__m256i luma, __m256i u_v, const Coefficients &c,
+                         const bool rgba, const __m256i alpha, __m256i &lo,
+                         __m256i &hi) {
+  luma = _mm256_sub_epi16(luma, _mm256_set1_epi16(c.y_offset));
+  u_v = _mm256_sub_epi16(u_v, _mm256_set1_epi16(128));
+  const __m256i luma_scale = _mm256_set1_epi32(pair(c.y_scale, rounding));
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i luma_lo =
+      _mm256_madd_epi16(_mm256_unpacklo_epi16(luma, ones), luma_scale);
+  const __m256i luma_hi =
+      _mm256_madd_epi16(_mm256_unpackhi_epi16(luma, ones), luma_scale);
+
+  __m256i channels[3];
+  const int32_t weights[3] = {pair(c.u_to_b, 0), pair(c.u_to_g, c.v_to_g),
+                              pair(0, c.v_to_r)};
+  for (int i = 0; i < 3; ++i) {
+    const __m256i chroma =
+        _mm256_madd_epi16(u_v, _mm256_set1_epi32(weights[i]));
+    const __m256i value_lo = _mm256_srai_epi32(
+        _mm256_add_epi32(luma_lo, _mm256_unpacklo_epi32(chroma, chroma)),
+        fraction_bits);
+    const __m256i value_hi = _mm256_srai_epi32(
+        _mm256_add_epi32(luma_hi, _mm256_unpackhi_epi32(chroma, chroma)),
+        fraction_bits);
+    const __m256i words = _mm256_packs_epi32(value_lo, value_hi);
+    channels[i] = _mm256_packus_epi16(words, words);
+  }
+  const __m256i first = rgba ? channels[2] : channels[0];
+  const __m256i third = rgba ? channels[0] : channels[2];
+  const __m256i first_second = _mm256_unpacklo_epi8(first, channels[1]);
+  const __m256i third_alpha = _mm256_unpacklo_epi8(third, alpha);
+  lo = _mm256_unpacklo_epi16(first_second, third_alpha);
+  hi = _mm256_unpackhi_epi16(first_second, third_alpha);
+}
+
+template <bool Nv12>
+COMPUTE_SAMPLES_TARGET("avx2")
+int convert_row_avx2(const RowArgs &row, const Coefficients &c, int x) {
+  const __m256i alpha = _mm256_set1_epi8(static_cast<char>(row.alpha));
+  for (; x + 16 <= row.width; x += 16) {
+    const __m256i luma = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(row.y + x)));
+    __m128i u_v;
+    if (Nv12) {
+      u_v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row.u + x));
+    } else {
+      u_v = _mm_unpacklo_epi8(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(row.u + x / 2)),
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(row.v + x / 2)));
+    }
+    __m256i lo;
+    __m256i hi;
+    convert_pixels_avx2(luma, _mm256_cvtepu8_epi16(u_v), c, row.rgba, alpha,
+                        lo, hi);
+    __m256i *output = reinterpret_cast<__m256i *>(row.output + 4 * x);
+    _mm256_storeu_si256(output, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(output + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  return x;
+}
+#endif
+
+template <bool Nv12>
+void convert_row(const RowArgs &row, const Coefficients &c,
+                 const ColorKernel kernel) {
+  int x = 0;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  if (kernel == ColorKernel::avx2) {
+    x = convert_row_avx2<Nv12>(row, c, x);
+  }
+  if (kernel == ColorKernel::avx2 || kernel == ColorKernel::sse41) {
+    x = convert_row_sse41<Nv12>(row, c, x);
+  }
+#else
+  (void)kernel;
+#endif
+  convert_row_scalar<Nv12>(row, c, x);
+}
+
+ColorKernel best_kernel() {
+  if (ColorConverter::is_supported(ColorKernel::avx2)) {
+    return ColorKernel::avx2;
+  }
+  if (ColorConverter::is_supported(ColorKernel::sse41)) {
+    return ColorKernel::sse41;
+  }
+  return ColorKernel::scalar;
+}
+} // namespace
+
+ColorConverter::ColorConverter(const ColorFormat &format,
+                               const int thread_count, const ColorKernel kernel)
+    : format_(format), kernel_(kernel),
+      coefficients_(make_coefficients(format)) {
+  if (kernel_ == ColorKernel::automatic) {
+    kernel_ = best_kernel();
+  } else if (!is_supported(kernel_)) {
+    throw std::invalid_argument(std::string("Color conversion kernel is not "
+                                            "supported on this processor: ") +
+                                kernel_name(kernel_));
+  }
+  if (thread_count != 1) {
+    pool_.reset(new ThreadPool(thread_count));
+  }
+}
+
+ColorConverter::~ColorConverter() = default;
+
+int ColorConverter::thread_count() const { return pool_ ? pool_->size() : 1; }
+
+bool ColorConverter::is_supported(const ColorKernel kernel) {
+  switch (kernel) {
+  case ColorKernel::automatic:
+  case ColorKernel::scalar:
+    return true;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  case ColorKernel::sse41:
+    return cpu_features().sse41;
+  case ColorKernel::avx2:
+    return cpu_features().avx2;
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *ColorConverter::kernel_name(const ColorKernel kernel) {
+  switch (kernel) {
+  case ColorKernel::automatic:
+    return "automatic";
+  case ColorKernel::scalar:
+    return "scalar";
+  case ColorKernel::sse41:
+    return "sse4.1";
+  case ColorKernel::avx2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+void ColorConverter::convert_rows(const yuv_frame_view &source,
+                                  const ChromaLayout layout, uint8_t *output,
+                                  const ptrdiff_t output_pitch,
+                                  const int begin, const int end) const {
+  RowArgs row;
+  row.width = source.width;
+  row.rgba = format_.order == PixelOrder::rgba;
+  row.alpha = format_.alpha;
+  for (int y = begin; y < end; ++y) {
+    row.y = source.y + static_cast<ptrdiff_t>(y) * source.pitch_y;
+    row.u = source.u + static_cast<ptrdiff_t>(y / 2) * source.pitch_u;
+    row.v = layout == ChromaLayout::nv12
+                ? nullptr
+                : source.v + static_cast<ptrdiff_t>(y / 2) * source.pitch_v;
+    row.output = output + y * output_pitch;
+    if (layout == ChromaLayout::nv12) {
+      convert_row<true>(row, coefficients_, kernel_);
+    } else {
+      convert_row<false>(row, coefficients_, kernel_);
+    }
+  }
+}
+
+void ColorConverter::convert(const yuv_frame_view &source,
+                             const ChromaLayout layout, uint8_t *output,
+                             const ptrdiff_t output_pitch) {
+  if (!pool_ || source.height <= band_rows) {
+    convert_rows(source, layout, output, output_pitch, 0, source.height);
+    return;
+  }
+  std::vector<std::future<void>> bands;
+  for (int y = 0; y < source.height; y += band_rows) {
+    const int end = std::min(source.height, y + band_rows);
+    bands.push_back(pool_->submit([=, &source]() {
+      convert_rows(source, layout, output, output_pitch, y, end);
+    }));
+  }
+  for (std::future<void> &band : bands) {
+    band.get();
+  }
+}
+
+void ColorConverter::convert(const std::vector<yuv_frame_view> &sources,
+                             const ChromaLayout layout,
+                             const std::vector<uint8_t *> &outputs,
+                             const ptrdiff_t output_pitch) {
+  if (sources.size() != outputs.size()) {
+    throw std::invalid_argument(
+        "Color conversion needs one output per source frame");
+  }
+  if (!pool_) {
+    for (size_t i = 0; i < sources.size(); ++i) {
+      convert_rows(sources[i], layout, outputs[i], output_pitch, 0,
+                   sources[i].height);
+    }
+    return;
+  }
+  std::vector<std::future<void>> frames;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    frames.push_back(pool_->submit([=, &sources, &outputs]() {
+      convert_rows(sources[i], layout, outputs[i], output_pitch, 0,
+                   sources[i].height);
+    }));
+  }
+  for (std::future<void> &frame : frames) {
+    frame.get();
+  }
+}
+
+} // namespace compute_samples
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "yuv_utils/frame_pipeline.hpp"
+#include "logging/logging.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace compute_samples {
+
+namespace {
+typedef std::chrono::steady_clock clock_type;
+
+double seconds_since(const clock_type::time_point &begin) {
+  return std::chrono::duration<double>(clock_type::now() - begin).count();
+}
+} // namespace
+
+FramePipeline::FramePipeline(const int depth) : depth_(depth) {
+  if (depth < 1) {
+    throw std::invalid_argument("Frame pipeline depth must be at least 1");
+  }
+}
+
+void FramePipeline::set_stage(const FrameStage stage, StageFunction function) {
+  stages_[static_cast<int>(stage)] = std::move(function);
+}
+
+void FramePipeline::run(const int frame_count) {
+  completed_.fill(0);
+  busy_seconds_.fill(0.0);
+  frame_count_ = frame_count;
+  failed_ = false;
+  error_ = nullptr;
+
+  const clock_type::time_point begin = clock_type::now();
+  std::vector<std::thread> threads;
+  for (int stage = 0; stage < frame_stage_count; ++stage) {
+    threads.emplace_back(&FramePipeline::stage_worker, this, stage,
+                         frame_count);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  elapsed_seconds_ = seconds_since(begin);
+
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+bool FramePipeline::is_ready(const int stage, const int frame_idx) const {
+  if (stage == 0) {
+    return frame_idx - completed_[frame_stage_count - 1] < depth_;
+  }
+  return completed_[stage - 1] > frame_idx;
+}
+
+void FramePipeline::stage_worker(const int stage, const int frame_count) {
+  for (int frame_idx = 0; frame_idx < frame_count; ++frame_idx) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [&] {
+        return failed_ || is_ready(stage, frame_idx);
+      });
+      if (failed_) {
+        return;
+      }
+    }
+
+    if (stages_[stage]) {
+      const clock_type::time_point begin = clock_type::now();
+      try {
+        stages_[stage](frame_idx, slot(frame_idx));
+      } catch (...) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!failed_) {
+            failed_ = true;
+            error_ = std::current_exception();
+          }
+        }
+        condition_.notify_all();
+        return;
+      }
+      // Only this thread updates its own entry until run() joins it
+      busy_seconds_[stage] += seconds_since(begin);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      completed_[stage] = frame_idx + 1;
+    }
+    condition_.notify_all();
+  }
+}
+
+double FramePipeline::stage_latency(const FrameStage stage) const {
+  if (frame_count_ == 0) {
+    return 0.0;
+  }
+  return busy_seconds_[static_cast<int>(stage)] / frame_count_;
+}
+
+double FramePipeline::frames_per_second() const {
+  if (elapsed_seconds_ == 0.0) {
+    return 0.0;
+  }
+  return frame_count_ / elapsed_seconds_;
+}
+
+void FramePipeline::log_statistics() const {
+  LOG_INFO << "Pipeline depth " << depth_ << ", " << frame_count_
+           << " frames, " << frames_per_second() << " frames/s";
+  for (int stage = 0; stage < frame_stage_count; ++stage) {
+    if (stages_[stage]) {
+      const FrameStage frame_stage = static_cast<FrameStage>(stage);
+      LOG_INFO << "  " << stage_name(frame_stage) << ": "
+               << stage_latency(frame_stage) * 1e3 << " ms per frame";
+    }
+  }
+}
+
+const char *FramePipeline::stage_name(const FrameStage stage) {
+  switch (stage) {
+  case FrameStage::read:
+    return "read";
+  case FrameStage::upload:
+    return "upload";
+  case FrameStage::compute:
+    return "compute";
+  case FrameStage::readback:
+    return "readback";
+  case FrameStage::overlay:
+    return "overlay";
+  case FrameStage::write:
+    return "write";
+  }
+  return "unknown";
+}
+
+} // namespace compute_samples
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "yuv_utils/yuv_utils.hpp"
+#include "utils/cpu_features.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(COMPUTE_SAMPLES_X86_64)
+#include <emmintrin.h>
+#endif
+
+// Row kernels for moving between I420, NV12 and P010. SSE2 is part of the
+// x86-64 baseline, so the vector loops need no runtime dispatch. Conversions
+// which change both the chroma layout and the sample size go through a
+// single row buffer.
+
+namespace compute_samples {
+namespace {
+void interleave_row(const uint8_t *u, const uint8_t *v, uint8_t *uv,
+                    const int count) {
+  int x = 0;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  for (; x + 16 <= count; x += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x));
+    __m128i *out = reinterpret_cast<__m128i *>(uv + 2 * x);
+    _mm_storeu_si128(out, _mm_unpacklo_epi8(a, b));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(a, b));
+  }
+#endif
+  for (; x < count; ++x) {
+    uv[2 * x] = u[x];
+    uv[2 * x + 1] = v[x];
+  }
+}
+
+void deinterleave_row(const uint8_t *uv, uint8_t *u, uint8_t *v,
+                      const int count) {
+  int x = 0;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+  for (; x + 16 <= count; x += 16) {
+    const __m128i *in = reinterpret_cast<const __m128i *>(uv + 2 * x);
+    const __m128i a = _mm_loadu_si128(in);
+    const __m128i b = _mm_loadu_si128(in + 1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x),
+                     _mm_packus_epi16(_mm_and_si128(a, low_bytes),
+                                      _mm_and_si128(b, low_bytes)));
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(v + x),
+        _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+  }
+#endif
+  for (; x < count; ++x) {
+    u[x] = uv[2 * x];
+    v[x] = uv[2 * x + 1];
+  }
+}
+
+void widen_row(const uint8_t *in, uint16_t *out, const int count) {
+  int x = 0;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  const __m128i zero = _mm_setzero_si128();
+  for (; x + 16 <= count; x += 16) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + x));
+    __m128i *dst = reinterpret_cast<__m128i *>(out + x);
+    _mm_storeu_si128(dst, _mm_unpacklo_epi8(zero, a));
+    _mm_storeu_si128(dst + 1, _mm_unpackhi_epi8(zero, a));
+  }
+#endif
+  for (; x < count; ++x) {
+    out[x] = static_cast<uint16_t>(in[x] << 8);
+  }
+}
+
+void narrow_row(const uint16_t *in, uint8_t *out, const int count) {
+  int x = 0;
+#if defined(COMPUTE_SAMPLES_X86_64)
+  const __m128i half = _mm_set1_epi16(0x80);
+  for (; x + 16 <= count; x += 16) {
+    const __m128i *src = reinterpret_cast<const __m128i *>(in + x);
+    const __m128i a = _mm_adds_epu16(_mm_loadu_si128(src), half);
+    const __m128i b = _mm_adds_epu16(_mm_loadu_si128(src + 1), half);
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(out + x),
+        _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+  }
+#endif
+  for (; x < count; ++x) {
+    out[x] = static_cast<uint8_t>(std::min(255, (in[x] + 0x80) >> 8));
+  }
+}
+
+void copy_rows(const uint8_t *in, const int in_pitch, uint8_t *out,
+               const int out_pitch, const int row_size, const int rows) {
+  for (int i = 0; i < rows; ++i) {
+    std::memcpy(out + static_cast<ptrdiff_t>(i) * out_pitch,
+                in + static_cast<ptrdiff_t>(i) * in_pitch, row_size);
+  }
+}
+
+// Luma rows and interleaved chroma rows only differ in their sample size
+void convert_samples(const uint8_t *in, const int in_pitch,
+                     const bool in_wide, uint8_t *out, const int out_pitch,
+                     const bool out_wide, const int samples, const int rows) {
+  for (int i = 0; i < rows; ++i) {
+    const uint8_t *src = in + static_cast<ptrdiff_t>(i) * in_pitch;
+    uint8_t *dst = out + static_cast<ptrdiff_t>(i) * out_pitch;
+    if (in_wide == out_wide) {
+      std::memcpy(dst, src, samples * (in_wide ? 2 : 1));
+    } else if (out_wide) {
+      widen_row(src, reinterpret_cast<uint16_t *>(dst), samples);
+    } else {
+      narrow_row(reinterpret_cast<const uint16_t *>(src), dst, samples);
+    }
+  }
+}
+} // namespace
+
+int bytes_per_sample(PlanarFormat format) {
+  return format == PlanarFormat::p010 ? 2 : 1;
+}
+
+size_t packed_frame_size(PlanarFormat format, int width, int height) {
+  return static_cast<size_t>(width) * height * 3 / 2 *
+         bytes_per_sample(format);
+}
+
+yuv_frame_view make_frame_view(const uint8_t *data, PlanarFormat format,
+                               int width, int height) {
+  const int sample = bytes_per_sample(format);
+  yuv_frame_view view;
+  view.y = data;
+  view.u = data + static_cast<size_t>(width) * height * sample;
+  view.width = width;
+  view.height = height;
+  view.pitch_y = width * sample;
+  if (format == PlanarFormat::i420) {
+    view.v = view.u + static_cast<size_t>(width / 2) * (height / 2);
+    view.pitch_u = width / 2;
+    view.pitch_v = width / 2;
+  } else {
+    view.v = view.u + sample;
+    view.pitch_u = width * sample;
+    view.pitch_v = width * sample;
+  }
+  return view;
+}
+
+void convert_planar(const yuv_frame_view &source, PlanarFormat source_format,
+                    PlanarImage &destination) {
+  if (source.width != destination.get_width() ||
+      source.height != destination.get_height()) {
+    throw std::invalid_argument("convert_planar: image size mismatch.");
+  }
+  const PlanarFormat format = destination.get_format();
+  const bool in_wide = source_format == PlanarFormat::p010;
+  const bool out_wide = format == PlanarFormat::p010;
+  const int width = source.width;
+  const int uv_width = source.width / 2;
+  const int uv_height = source.height / 2;
+
+  convert_samples(source.y, source.pitch_y, in_wide, destination.get_y(),
+                  destination.get_pitch_y(), out_wide, width, source.height);
+
+  if (source_format == PlanarFormat::i420 && format == PlanarFormat::i420) {
+    copy_rows(source.u, source.pitch_u, destination.get_u(),
+              destination.get_pitch_u(), uv_width, uv_height);
+    copy_rows(source.v, source.pitch_v, destination.get_v(),
+              destination.get_pitch_v(), uv_width, uv_height);
+  } else if (source_format != PlanarFormat::i420 &&
+             format != PlanarFormat::i420) {
+    convert_samples(source.u, source.pitch_u, in_wide, destination.get_uv(),
+                    destination.get_pitch_u(), out_wide, width, uv_height);
+  } else if (format != PlanarFormat::i420) {
+    // I420 to NV12 or P010
+    std::vector<uint8_t> row(out_wide ? width : 0);
+    for (int i = 0; i < uv_height; ++i) {
+      uint8_t *out =
+          destination.get_uv() +
+          static_cast<ptrdiff_t>(i) * destination.get_pitch_u();
+      uint8_t *interleaved = out_wide ? row.data() : out;
+      interleave_row(source.u + static_cast<ptrdiff_t>(i) * source.pitch_u,
+                     source.v + static_cast<ptrdiff_t>(i) * source.pitch_v,
+                     interleaved, uv_width);
+      if (out_wide) {
+        widen_row(interleaved, reinterpret_cast<uint16_t *>(out), width);
+      }
+    }
+  } else {
+    // NV12 or P010 to I420
+    std::vector<uint8_t> row(in_wide ? width : 0);
+    for (int i = 0; i < uv_height; ++i) {
+      const uint8_t *in = source.u + static_cast<ptrdiff_t>(i) * source.pitch_u;
+      if (in_wide) {
+        narrow_row(reinterpret_cast<const uint16_t *>(in), row.data(), width);
+        in = row.data();
+      }
+      deinterleave_row(
+          in,
+          destination.get_u() +
+              static_cast<ptrdiff_t>(i) * destination.get_pitch_u(),
+          destination.get_v() +
+              static_cast<ptrdiff_t>(i) * destination.get_pitch_v(),
+          uv_width);
+    }
+  }
+}
+
+} // namespace compute_samples
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "yuv_utils/vector_overlay.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "utils/thread_pool.hpp"
+
+namespace compute_samples {
+namespace {
+const int mb_size = 16;
+
+int32_t quarter_to_pixel(const int16_t v) { return (v + 2) >> 2; }
+
+class LineList {
+public:
+  explicit LineList(std::vector<VectorOverlay::Line> &lines) : lines_(lines) {}
+
+  void add(int32_t x0, int32_t y0, int32_t dx, int32_t dy) {
+    lines_.push_back({x0, y0, dx, dy});
+  }
+  void add(int32_t x0, int32_t y0, const motion_vector &mv) {
+    add(x0, y0, quarter_to_pixel(mv.x), quarter_to_pixel(mv.y));
+  }
+
+private:
+  std::vector<VectorOverlay::Line> &lines_;
+};
+
+void add_inter_lines(LineList &lines, const motion_vector *mvs,
+                     const inter_shape shape, const int j0, const int i0,
+                     const bool draw_8x8) {
+  switch (shape.x) {
+  case 0:
+    lines.add(j0 + 8, i0 + 8, mvs[0]);
+    break;
+  case 1:
+    lines.add(j0 + 8, i0 + 4, mvs[0]);
+    lines.add(j0 + 8, i0 + 12, mvs[8]);
+    break;
+  case 2:
+    lines.add(j0 + 4, i0 + 8, mvs[0]);
+    lines.add(j0 + 12, i0 + 8, mvs[8]);
+    break;
+  case 3:
+    for (int m = 0; m < 4; ++m) {
+      const int mdiv = m / 2;
+      const int mmod = m % 2;
+      switch ((shape.y >> (2 * m)) & 0x03) {
+      case 0: // 8 x 8
+        if (draw_8x8) {
+          lines.add(j0 + mmod * 8 + 4, i0 + mdiv * 8 + 4, mvs[m * 4]);
+        }
+        break;
+      case 1: // 8 x 4
+        for (int n = 0; n < 2; ++n) {
+          lines.add(j0 + mmod * 8 + 4, i0 + (mdiv * 8 + n * 4 + 2),
+                    mvs[m * 4 + n * 2]);
+        }
+        break;
+      case 2: // 4 x 8
+        for (int n = 0; n < 2; ++n) {
+          lines.add(j0 + (mmod * 8 + n * 4 + 2), i0 + mdiv * 8 + 4,
+                    mvs[m * 4 + n * 2]);
+        }
+        break;
+      case 3: // 4 x 4
+        for (int n = 0; n < 4; ++n) {
+          lines.add(j0 + n * 4 + 2, i0 + m * 4 + 2, mvs[m * 4 + n]);
+        }
+        break;
+      }
+    }
+    break;
+  }
+}
+
+void add_intra_lines(LineList &lines, const intra_shape shape, const int j0,
+                     const int i0) {
+  if (shape > 2) {
+    throw std::out_of_range("PlanarImage::overlay_vectors: Invalid "
+                            "intra shape value encountered.");
+  }
+  // 16x16 box, split into 8x8 blocks for shape 1 and 4x4 blocks for shape 2
+  lines.add(j0, i0, 16, 0);
+  lines.add(j0, i0, 0, 16);
+  lines.add(j0 + 16, i0, 0, 16);
+  lines.add(j0, i0 + 16, 16, 0);
+  if (shape >= 1) {
+    lines.add(j0 + 8, i0, 0, 16);
+    lines.add(j0, i0 + 8, 16, 0);
+  }
+  if (shape == 2) {
+    lines.add(j0 + 4, i0, 0, 16);
+    lines.add(j0 + 12, i0, 0, 16);
+    lines.add(j0, i0 + 4, 16, 0);
+    lines.add(j0, i0 + 12, 16, 0);
+  }
+}
+
+int64_t floor_div(const int64_t a, const int64_t b) {
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Bresenham's line algorithm, drawing only the steps which fall into the
+// clip rectangle. With the error term starting at half the major distance,
+// the minor coordinate of step k has moved by
+// ceil((k * minor_distance - error0) / major_distance), so the first and last
+// visible step are solved for instead of testing every pixel.
+void draw_line(const VectorOverlay::Line &line, const overlay_plane &plane,
+               const int clip_top, const int clip_bottom,
+               const uint8_t color) {
+  using std::swap;
+
+  int32_t x0 = line.x0;
+  int32_t y0 = line.y0;
+  int32_t x1 = x0 + line.dx;
+  int32_t y1 = y0 + line.dy;
+  const bool b_steep = std::abs(line.dy) > std::abs(line.dx);
+  if (b_steep) {
+    swap(x0, y0);
+    swap(x1, y1);
+  }
+  if (x0 > x1) {
+    swap(x0, x1);
+    swap(y0, y1);
+  }
+  const int64_t delta_x = x1 - x0;
+  const int64_t delta_y = std::abs(y1 - y0);
+  const int64_t error0 = delta_x / 2;
+  const int32_t y_step = y0 < y1 ? 1 : -1;
+
+  // Clip rectangle in the major (x) and minor (y) coordinates of the loop
+  const int64_t major_low = b_steep ? clip_top : 0;
+  const int64_t major_high = b_steep ? clip_bottom - 1 : plane.width - 1;
+  const int64_t minor_low = b_steep ? 0 : clip_top;
+  const int64_t minor_high = b_steep ? plane.width - 1 : clip_bottom - 1;
+
+  int64_t first = 0;
+  int64_t last = delta_x;
+  int64_t error = error0;
+  int32_t minor = y0;
+  if (x0 < major_low || x1 > major_high ||
+      std::min(y0, y1) < minor_low || std::max(y0, y1) > minor_high) {
+    first = std::max<int64_t>(0, major_low - x0);
+    last = std::min<int64_t>(delta_x, major_high - x0);
+    // Range of minor steps which stay within the rectangle
+    const int64_t steps_low = y_step > 0 ? minor_low - y0 : y0 - minor_high;
+    const int64_t steps_high = y_step > 0 ? minor_high - y0 : y0 - minor_low;
+    if (delta_y == 0) {
+      if (steps_low > 0 || steps_high < 0) {
+        return;
+      }
+    } else {
+      first = std::max(
+          first, floor_div((steps_low - 1) * delta_x + error0, delta_y) + 1);
+      last = std::min(last, floor_div(steps_high * delta_x + error0, delta_y));
+    }
+    if (first > last) {
+      return;
+    }
+    const int64_t steps =
+        delta_x == 0 ? 0 : -floor_div(error0 - first * delta_y, delta_x);
+    error = error0 - first * delta_y + steps * delta_x;
+    minor = static_cast<int32_t>(y0 + y_step * steps);
+  }
+
+  // Pixels are visited through strides along the major and minor axes
+  const ptrdiff_t major_stride = b_steep ? plane.pitch : 1;
+  const ptrdiff_t minor_stride = (b_steep ? 1 : plane.pitch) * y_step;
+  const int32_t major = static_cast<int32_t>(x0 + first);
+  const int32_t x = b_steep ? minor : major;
+  const int32_t y = b_steep ? major : minor;
+  uint8_t *pixel = plane.data + static_cast<ptrdiff_t>(y) * plane.pitch + x;
+  for (int64_t k = first; k <= last; ++k) {
+    *pixel = color;
+    pixel += major_stride;
+
+    error -= delta_y;
+    if (error < 0) {
+      pixel += minor_stride;
+      error += delta_x;
+    }
+  }
+}
+
+// Runs task(0) to task(count - 1) and rethrows the first exception once all
+// tasks finished, since they refer to state of the caller
+template <typename F>
+void run_tasks(ThreadPool *pool, const int count, const F &task) {
+  if (pool == nullptr) {
+    for (int i = 0; i < count; ++i) {
+      task(i);
+    }
+    return;
+  }
+  std::vector<std::future<void>> results;
+  results.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    results.push_back(pool->submit([&task, i]() { task(i); }));
+  }
+  std::exception_ptr error;
+  for (std::future<void> &result : results) {
+    try {
+      result.get();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+} // namespace
+
+overlay_plane luma_plane(PlanarImage &image) {
+  if (image.get_format() == PlanarFormat::p010) {
+    throw std::logic_error(
+        "PlanarImage: vectors are drawn on 8-bit luma only.");
+  }
+  overlay_plane plane;
+  plane.data = image.get_y();
+  plane.width = image.get_width();
+  plane.height = image.get_height();
+  plane.pitch = image.get_pitch_y();
+  return plane;
+}
+
+OverlayPlane::OverlayPlane(int width, int height)
+    : data_(static_cast<size_t>(width) * height), width_(width),
+      height_(height) {}
+
+void OverlayPlane::clear() { std::fill(data_.begin(), data_.end(), 0); }
+
+void OverlayPlane::composite(PlanarImage &image) const {
+  const overlay_plane target = luma_plane(image);
+  if (target.width != width_ || target.height != height_) {
+    throw std::invalid_argument("OverlayPlane: image size mismatch.");
+  }
+  for (int y = 0; y < height_; ++y) {
+    const uint8_t *in = data_.data() + static_cast<size_t>(y) * width_;
+    uint8_t *out = target.data + static_cast<ptrdiff_t>(y) * target.pitch;
+    // Branchless, so that the loop is vectorized
+    for (int x = 0; x < width_; ++x) {
+      const uint8_t keep = static_cast<uint8_t>(in[x] == 0 ? 0xFF : 0x00);
+      out[x] = static_cast<uint8_t>(in[x] | (out[x] & keep));
+    }
+  }
+}
+
+overlay_plane OverlayPlane::plane() {
+  overlay_plane plane;
+  plane.data = data_.data();
+  plane.width = width_;
+  plane.height = height_;
+  plane.pitch = width_;
+  return plane;
+}
+
+VectorOverlay::VectorOverlay(const int thread_count, const uint8_t color)
+    : color_(color) {
+  if (thread_count != 1) {
+    pool_.reset(new ThreadPool(thread_count));
+  }
+}
+
+VectorOverlay::~VectorOverlay() = default;
+
+int VectorOverlay::thread_count() const { return pool_ ? pool_->size() : 1; }
+
+void VectorOverlay::render(const motion_vector *mvs, const inter_shape *shapes,
+                           const overlay_plane &plane) {
+  generate(mvs, shapes, nullptr, nullptr, nullptr, plane);
+  draw(plane);
+}
+
+void VectorOverlay::render(const motion_vector *mvs,
+                           const inter_shape *inter_shapes,
+                           const intra_shape *intra_shapes,
+                           const residual *inter_residuals,
+                           const residual *intra_residuals,
+                           const overlay_plane &plane) {
+  generate(mvs, inter_shapes, intra_shapes, inter_residuals, intra_residuals,
+           plane);
+  draw(plane);
+}
+
+void VectorOverlay::generate(const motion_vector *mvs,
+                             const inter_shape *inter_shapes,
+                             const intra_shape *intra_shapes,
+                             const residual *inter_residuals,
+                             const residual *intra_residuals,
+                             const overlay_plane &plane) {
+  const int mb_width = (plane.width + mb_size - 1) / mb_size;
+  const int mb_height = (plane.height + mb_size - 1) / mb_size;
+  lines_.resize(mb_height);
+  top_.resize(mb_height);
+  bottom_.resize(mb_height);
+
+  run_tasks(pool_.get(), mb_height, [&](const int i) {
+    std::vector<Line> &row = lines_[i];
+    row.clear();
+    LineList lines(row);
+    for (int j = 0; j < mb_width; ++j) {
+      const int mb_index = j + i * mb_width;
+      const int j0 = j * mb_size;
+      const int i0 = i * mb_size;
+      const motion_vector *mb_mvs = mvs + mb_index * 16;
+      if (intra_shapes == nullptr) {
+        add_inter_lines(lines, mb_mvs, inter_shapes[mb_index], j0, i0, true);
+      } else if (inter_residuals[mb_index] < intra_residuals[mb_index]) {
+        // Combined overlays leave 8x8 sub-blocks out
+        add_inter_lines(lines, mb_mvs, inter_shapes[mb_index], j0, i0, false);
+      } else {
+        add_intra_lines(lines, intra_shapes[mb_index], j0, i0);
+      }
+    }
+
+    int top = std::numeric_limits<int>::max();
+    int bottom = std::numeric_limits<int>::min();
+    for (const Line &line : row) {
+      top = std::min(top, std::min(line.y0, line.y0 + line.dy));
+      bottom = std::max(bottom, std::max(line.y0, line.y0 + line.dy));
+    }
+    top_[i] = top;
+    bottom_[i] = bottom;
+  });
+}
+
+void VectorOverlay::draw(const overlay_plane &plane) {
+  // A few tiles per thread balance the load, fewer tiles clip fewer lines
+  const int rows = static_cast<int>(lines_.size());
+  const int tile_rows =
+      pool_ ? std::max(1, rows / (4 * pool_->size())) : std::max(1, rows);
+  const int tiles = (rows + tile_rows - 1) / tile_rows;
+  run_tasks(pool_.get(), tiles, [&](const int tile) {
+    draw_tile(plane, tile * tile_rows,
+              std::min(rows, (tile + 1) * tile_rows));
+  });
+}
+
+void VectorOverlay::draw_tile(const overlay_plane &plane, const int first_row,
+                              const int end_row) const {
+  const int clip_top = first_row * mb_size;
+  const int clip_bottom = std::min(plane.height, end_row * mb_size);
+  for (size_t i = 0; i < lines_.size(); ++i) {
+    if (bottom_[i] < clip_top || top_[i] >= clip_bottom) {
+      continue;
+    }
+    for (const Line &line : lines_[i]) {
+      const int32_t end_y = line.y0 + line.dy;
+      if (std::max(line.y0, end_y) >= clip_top &&
+          std::min(line.y0, end_y) < clip_bottom) {
+        draw_line(line, plane, clip_top, clip_bottom, color_);
+      }
+    }
+  }
+}
+
+} // namespace compute_samples
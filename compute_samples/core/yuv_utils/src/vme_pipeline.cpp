@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "yuv_utils/vme_pipeline.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace au = compute_samples::align_utils;
+
+namespace compute_samples {
+
+VmeFrame::VmeFrame(int width, int height, int mv_count, int mb_count)
+    : planar_image(width, height), mvs(au::align64(mv_count)),
+      shapes(au::align64(mb_count)) {}
+
+VmePipeline::VmePipeline(int depth, int width, int height, int mv_count,
+                         int mb_count)
+    : pipeline_(depth) {
+  for (int i = 0; i < pipeline_.slot_count(); ++i) {
+    frames_.emplace_back(new VmeFrame(width, height, mv_count, mb_count));
+  }
+}
+
+void VmePipeline::set_upload(UploadFunction function) {
+  upload_ = std::move(function);
+}
+
+void VmePipeline::set_compute(ComputeFunction function) {
+  compute_ = std::move(function);
+}
+
+void VmePipeline::set_readback(ReadbackFunction function) {
+  readback_ = std::move(function);
+}
+
+void VmePipeline::set_read(FrameFunction function) {
+  read_ = std::move(function);
+}
+
+void VmePipeline::set_overlay(FrameFunction function) {
+  overlay_ = std::move(function);
+}
+
+void VmePipeline::set_write(FrameFunction function) {
+  write_ = std::move(function);
+}
+
+void VmePipeline::set_first_frame_estimated(bool estimated) {
+  first_frame_estimated_ = estimated;
+}
+
+bool VmePipeline::is_estimated(int frame_idx) const {
+  return frame_idx > 0 || first_frame_estimated_;
+}
+
+void VmePipeline::read_from(YuvCapture &capture) {
+  read_ = [&capture](int frame_idx, VmeFrame &frame) {
+    capture.get_sample(frame_idx, frame.planar_image);
+  };
+}
+
+void VmePipeline::write_to(YuvWriter &writer) {
+  write_ = [&writer](int, VmeFrame &frame) {
+    writer.append_frame(frame.planar_image);
+  };
+}
+
+void VmePipeline::run(int frame_count) {
+  FramePipeline::StageFunction read;
+  if (read_) {
+    read = [&](int frame_idx, int slot) { read_(frame_idx, frame(slot)); };
+  }
+  pipeline_.set_stage(FrameStage::read, read);
+  FramePipeline::StageFunction upload;
+  if (upload_) {
+    upload = [&](int, int slot) { upload_(slot, frame(slot).planar_image); };
+  }
+  pipeline_.set_stage(FrameStage::upload, upload);
+  FramePipeline::StageFunction compute;
+  if (compute_) {
+    compute = [&](int frame_idx, int slot) {
+      compute_(frame_idx, slot, pipeline_.slot(std::max(frame_idx - 1, 0)));
+    };
+  }
+  pipeline_.set_stage(FrameStage::compute, compute);
+  FramePipeline::StageFunction readback;
+  if (readback_) {
+    readback = [&](int frame_idx, int slot) {
+      if (is_estimated(frame_idx)) {
+        readback_(slot, frame(slot));
+      }
+    };
+  }
+  pipeline_.set_stage(FrameStage::readback, readback);
+  pipeline_.set_stage(FrameStage::overlay, [&](int frame_idx, int slot) {
+    if (!is_estimated(frame_idx)) {
+      return;
+    }
+    VmeFrame &src = frame(slot);
+    if (overlay_) {
+      overlay_(frame_idx, src);
+    } else {
+      src.planar_image.overlay_vectors(src.mvs.data(), src.shapes.data());
+    }
+  });
+  FramePipeline::StageFunction write;
+  if (write_) {
+    write = [&](int frame_idx, int slot) { write_(frame_idx, frame(slot)); };
+  }
+  pipeline_.set_stage(FrameStage::write, write);
+
+  pipeline_.run(frame_count);
+  pipeline_.log_statistics();
+}
+
+} // namespace compute_samples
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "yuv_utils/y4m.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace compute_samples {
+namespace {
+const char signature[] = "YUV4MPEG2";
+const size_t signature_size = sizeof(signature) - 1;
+const size_t marker_size = sizeof(y4m_frame_marker) - 2;
+// Frame parameters are rarely used, anything longer is a corrupt file
+const size_t max_frame_line = 1024;
+
+// Frame parameters are separated from the marker by a space, so that e.g.
+// "FRAMES" is not a marker
+void check_marker_end(const int c) {
+  if (c != ' ' && c != '\n') {
+    throw std::invalid_argument("Y4M file: invalid frame marker.");
+  }
+}
+
+int parse_int(const std::string &text, const std::string &tag) {
+  size_t end = 0;
+  int value = 0;
+  try {
+    value = std::stoi(text, &end);
+  } catch (const std::exception &) {
+    end = 0;
+  }
+  if (end == 0 || end != text.size()) {
+    throw std::invalid_argument("Y4M header: invalid " + tag + " tag.");
+  }
+  return value;
+}
+
+void parse_ratio(const std::string &text, const std::string &tag, int &num,
+                 int &den) {
+  const size_t colon = text.find(':');
+  if (colon == std::string::npos) {
+    throw std::invalid_argument("Y4M header: invalid " + tag + " tag.");
+  }
+  num = parse_int(text.substr(0, colon), tag);
+  den = parse_int(text.substr(colon + 1), tag);
+}
+
+size_t frame_limit(int max_frames) {
+  return max_frames == 0 ? std::numeric_limits<size_t>::max()
+                         : static_cast<size_t>(max_frames);
+}
+
+void check_payload(uint64_t payload, uint64_t frame_size, uint64_t size) {
+  if (payload > size || size - payload < frame_size) {
+    throw std::invalid_argument("Y4M file: truncated frame.");
+  }
+}
+} // namespace
+
+bool is_y4m_signature(const uint8_t *data, size_t size) {
+  return size > signature_size &&
+         std::memcmp(data, signature, signature_size) == 0 &&
+         data[signature_size] == ' ';
+}
+
+bool is_y4m_path(const std::string &path) {
+  const size_t dot = path.rfind('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string extension = path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) {
+                   return static_cast<char>(std::tolower(c));
+                 });
+  return extension == "y4m";
+}
+
+Y4mHeader parse_y4m_header(const std::string &line) {
+  std::istringstream tags(line);
+  std::string tag;
+  if (!(tags >> tag) || tag != signature) {
+    throw std::invalid_argument("Y4M header: missing YUV4MPEG2 signature.");
+  }
+
+  Y4mHeader header;
+  while (tags >> tag) {
+    const std::string value = tag.substr(1);
+    switch (tag[0]) {
+    case 'W':
+      header.width = parse_int(value, "W");
+      break;
+    case 'H':
+      header.height = parse_int(value, "H");
+      break;
+    case 'F':
+      parse_ratio(value, "F", header.frame_rate_num, header.frame_rate_den);
+      break;
+    case 'I':
+      if (value.size() != 1 || std::strchr("ptbm", value[0]) == nullptr) {
+        throw std::invalid_argument("Y4M header: invalid I tag.");
+      }
+      header.interlacing = value[0];
+      break;
+    case 'A':
+      parse_ratio(value, "A", header.aspect_num, header.aspect_den);
+      break;
+    case 'C':
+      header.colorspace = value;
+      break;
+    case 'X':
+      header.extensions.push_back(value);
+      break;
+    default:
+      throw std::invalid_argument("Y4M header: unknown tag " + tag + ".");
+    }
+  }
+
+  if (header.width <= 0 || header.height <= 0) {
+    throw std::invalid_argument("Y4M header: missing frame size.");
+  }
+  if (header.frame_rate_num <= 0 || header.frame_rate_den <= 0) {
+    throw std::invalid_argument("Y4M header: invalid frame rate.");
+  }
+  return header;
+}
+
+size_t read_y4m_header(const uint8_t *data, size_t size, Y4mHeader &header) {
+  if (!is_y4m_signature(data, size)) {
+    return 0;
+  }
+  const void *newline =
+      std::memchr(data, '\n', std::min(size, y4m_max_header_size));
+  if (newline == nullptr) {
+    throw std::invalid_argument("Y4M header: unterminated header line.");
+  }
+  const size_t line_size =
+      static_cast<size_t>(static_cast<const uint8_t *>(newline) - data);
+  header = parse_y4m_header(
+      std::string(reinterpret_cast<const char *>(data), line_size));
+  return line_size + 1;
+}
+
+std::string format_y4m_header(const Y4mHeader &header) {
+  std::stringstream ss;
+  ss << signature << " W" << header.width << " H" << header.height << " F"
+     << header.frame_rate_num << ":" << header.frame_rate_den << " I"
+     << header.interlacing << " A" << header.aspect_num << ":"
+     << header.aspect_den << " C" << header.colorspace;
+  for (const std::string &extension : header.extensions) {
+    ss << " X" << extension;
+  }
+  ss << "\n";
+  return ss.str();
+}
+
+bool is_y4m_420(const Y4mHeader &header) {
+  return header.colorspace == "420jpeg" || header.colorspace == "420paldv" ||
+         header.colorspace == "420mpeg2" || header.colorspace == "420";
+}
+
+std::vector<uint64_t> index_y4m_frames(const uint8_t *data, uint64_t size,
+                                       uint64_t first_frame,
+                                       uint64_t frame_size, int max_frames) {
+  std::vector<uint64_t> offsets;
+  uint64_t position = first_frame;
+  const size_t limit = frame_limit(max_frames);
+  while (position < size && offsets.size() < limit) {
+    if (size - position < marker_size ||
+        std::memcmp(data + position, y4m_frame_marker, marker_size) != 0) {
+      throw std::invalid_argument("Y4M file: missing frame marker.");
+    }
+    if (size - position > marker_size) {
+      check_marker_end(data[position + marker_size]);
+    }
+    const uint64_t line_end =
+        std::min<uint64_t>(size, position + max_frame_line);
+    const uint8_t *newline = static_cast<const uint8_t *>(
+        std::memchr(data + position + marker_size, '\n',
+                    static_cast<size_t>(line_end - position - marker_size)));
+    if (newline == nullptr) {
+      throw std::invalid_argument("Y4M file: unterminated frame marker.");
+    }
+    const uint64_t payload = static_cast<uint64_t>(newline - data) + 1;
+    check_payload(payload, frame_size, size);
+    offsets.push_back(payload);
+    position = payload + frame_size;
+  }
+  return offsets;
+}
+
+std::vector<uint64_t> index_y4m_frames(std::istream &file, uint64_t size,
+                                       uint64_t first_frame,
+                                       uint64_t frame_size, int max_frames) {
+  std::vector<uint64_t> offsets;
+  uint64_t position = first_frame;
+  char marker[sizeof(y4m_frame_marker)] = {};
+  const size_t limit = frame_limit(max_frames);
+  while (position < size && offsets.size() < limit) {
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(position));
+    if (!file.read(marker, marker_size) ||
+        std::memcmp(marker, y4m_frame_marker, marker_size) != 0) {
+      throw std::invalid_argument("Y4M file: missing frame marker.");
+    }
+    uint64_t payload = position + marker_size;
+    if (file.peek() != std::char_traits<char>::eof()) {
+      check_marker_end(file.peek());
+    }
+    int c = 0;
+    while ((c = file.get()) != '\n') {
+      if (c == std::char_traits<char>::eof() ||
+          payload - position >= max_frame_line) {
+        throw std::invalid_argument("Y4M file: unterminated frame marker.");
+      }
+      ++payload;
+    }
+    ++payload;
+    check_payload(payload, frame_size, size);
+    offsets.push_back(payload);
+    position = payload + frame_size;
+  }
+  file.clear();
+  return offsets;
+}
+
+} // namespace compute_samples
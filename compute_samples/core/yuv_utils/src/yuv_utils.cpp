@@ -8,183 +8,123 @@
 #include "yuv_utils/yuv_utils.hpp"
 
 #include <algorithm>
-#include <cassert>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "image/image.hpp"
+#include "logging/logging.hpp"
+#include "yuv_utils/color_convert.hpp"
+#include "yuv_utils/vector_overlay.hpp"
 
 namespace compute_samples {
-PlanarImage::PlanarImage(int width, int height, int pitch_y) {
+PlanarImage::PlanarImage(int width, int height, int pitch_y,
+                         PlanarFormat format) {
+  const int sample = bytes_per_sample(format);
   if (pitch_y == 0) {
-    pitch_y = width;
+    pitch_y = width * sample;
   }
 
-  const int num_pixels = pitch_y * height + width * height / 2;
-  data_.resize(num_pixels);
-
-  y_ = data_.data();
-  u_ = y_ + pitch_y * height;
-  v_ = u_ + width * height / 4;
-
   width_ = width;
   height_ = height;
   pitch_y_ = pitch_y;
-  pitch_u_ = width / 2;
-  pitch_v_ = width / 2;
+  format_ = format;
+  if (format == PlanarFormat::i420) {
+    const int num_pixels = pitch_y * height + width * height / 2;
+    data_.resize(num_pixels);
+
+    y_ = data_.data();
+    u_ = y_ + pitch_y * height;
+    v_ = u_ + width * height / 4;
+    pitch_u_ = width / 2;
+    pitch_v_ = width / 2;
+  } else {
+    // Chroma rows share the luma pitch, as in a single NV12 surface
+    data_.resize(static_cast<size_t>(pitch_y) * (height + height / 2));
+
+    y_ = data_.data();
+    u_ = y_ + static_cast<size_t>(pitch_y) * height;
+    v_ = u_ + sample;
+    pitch_u_ = pitch_y;
+    pitch_v_ = pitch_y;
+  }
 }
 
-void PlanarImage::draw_pixel(int32_t x, int32_t y, uint8_t *pic, int pic_width,
-                             int pic_height, uint8_t u8_pixel) {
-  int32_t pix_pos;
+PlanarImage::PlanarImage(const PlanarImage &other) : data_(other.data_) {
+  copy_layout(other);
+}
 
-  // Don't draw out of bound pixels
-  if (x < 0 || x >= pic_width || y < 0 || y >= pic_height) {
-    return;
+PlanarImage &PlanarImage::operator=(const PlanarImage &other) {
+  if (this != &other) {
+    data_ = other.data_;
+    copy_layout(other);
   }
+  return *this;
+}
 
-  pix_pos = y * pic_width + x;
-  *(pic + pix_pos) = u8_pixel;
+PlanarImage::PlanarImage(PlanarImage &&other) noexcept
+    : PlanarImage() {
+  *this = std::move(other);
 }
 
-// Bresenham's line algorithm
-void PlanarImage::draw_line(int32_t x0, int32_t y0, int32_t dx, int32_t dy,
-                            uint8_t *pic, int pic_width, int pic_height,
-                            uint8_t u8_pixel) {
-  using std::swap;
-
-  int32_t x1 = x0 + dx;
-  int32_t y1 = y0 + dy;
-  bool b_steep = abs(dy) > abs(dx);
-  if (b_steep) {
-    swap(x0, y0);
-    swap(x1, y1);
-  }
-  if (x0 > x1) {
-    swap(x0, x1);
-    swap(y0, y1);
-  }
-  int32_t delta_x = x1 - x0;
-  int32_t delta_y = abs(y1 - y0);
-  int32_t error = delta_x / 2;
-  int32_t y_step;
-  if (y0 < y1) {
-    y_step = 1;
-  } else {
-    y_step = -1;
+PlanarImage &PlanarImage::operator=(PlanarImage &&other) noexcept {
+  if (this != &other) {
+    // The moved storage keeps its address, so the planes stay valid
+    data_ = std::move(other.data_);
+    width_ = other.width_;
+    height_ = other.height_;
+    pitch_y_ = other.pitch_y_;
+    pitch_u_ = other.pitch_u_;
+    pitch_v_ = other.pitch_v_;
+    format_ = other.format_;
+    y_ = other.y_;
+    u_ = other.u_;
+    v_ = other.v_;
+    other.data_.clear();
+    other.y_ = nullptr;
+    other.u_ = nullptr;
+    other.v_ = nullptr;
   }
+  return *this;
+}
 
-  for (; x0 <= x1; x0++) {
-    if (b_steep) {
-      draw_pixel(y0, x0, pic, pic_width, pic_height, u8_pixel);
-    } else {
-      draw_pixel(x0, y0, pic, pic_width, pic_height, u8_pixel);
-    }
-
-    error -= delta_y;
-    if (error < 0) {
-      y0 += y_step;
-      error += delta_x;
-    }
+void PlanarImage::copy_layout(const PlanarImage &other) {
+  width_ = other.width_;
+  height_ = other.height_;
+  pitch_y_ = other.pitch_y_;
+  pitch_u_ = other.pitch_u_;
+  pitch_v_ = other.pitch_v_;
+  format_ = other.format_;
+  if (other.y_ == nullptr) {
+    y_ = u_ = v_ = nullptr;
+    return;
   }
+  y_ = data_.data() + (other.y_ - other.data_.data());
+  u_ = data_.data() + (other.u_ - other.data_.data());
+  v_ = data_.data() + (other.v_ - other.data_.data());
 }
 
-typedef struct {
-  uint8_t s[4];
-} uchar4_t;
-
-void PlanarImage::compute_num_mvs(int pic_width, int pic_height,
-                                  int &mv_image_width, int &mv_image_height,
-                                  int &mb_image_width,
-                                  int &mb_image_height) const {
-  int pic_width_in_blk = (pic_width + 16 - 1) / 16;
-  int pic_height_in_blk = (pic_height + 16 - 1) / 16;
-
-  mb_image_width = pic_width_in_blk;
-  mb_image_height = pic_height_in_blk;
-  mv_image_width = pic_width_in_blk * 4;
-  mv_image_height = pic_height_in_blk * 4;
+yuv_frame_view PlanarImage::view() const {
+  yuv_frame_view view;
+  view.y = y_;
+  view.u = u_;
+  view.v = v_;
+  view.width = width_;
+  view.height = height_;
+  view.pitch_y = pitch_y_;
+  view.pitch_u = pitch_u_;
+  view.pitch_v = pitch_v_;
+  return view;
 }
 
 void PlanarImage::overlay_vectors(const motion_vector *mvs,
                                   const inter_shape *shapes) {
-  int mv_image_width, mv_image_height;
-  int mb_image_width, mb_image_height;
-  compute_num_mvs(width_, height_, mv_image_width, mv_image_height,
-                  mb_image_width, mb_image_height);
-
-#define OFF(P) ((P) + 2) >> 2
-
-  for (int i = 0; i < mb_image_height; i++) {
-    for (int j = 0; j < mb_image_width; j++) {
-      int mb_index = j + i * mb_image_width;
-      // Selectively Draw motion vectors for different sub block sizes
-      int j0 = j * 16;
-      int i0 = i * 16;
-      int m0 = mb_index * 16;
-      switch (shapes[mb_index].x) {
-      case 0:
-        draw_line(j0 + 8, i0 + 8, OFF(mvs[m0].x), OFF(mvs[m0].y), y_, width_,
-                  height_, 180);
-        break;
-      case 1:
-        draw_line(j0 + 8, i0 + 4, OFF(mvs[m0].x), OFF(mvs[m0].y), y_, width_,
-                  height_, 180);
-        draw_line(j0 + 8, i0 + 12, OFF(mvs[m0 + 8].x), OFF(mvs[m0 + 8].y), y_,
-                  width_, height_, 180);
-        break;
-      case 2:
-        draw_line(j0 + 4, i0 + 8, OFF(mvs[m0].x), OFF(mvs[m0].y), y_, width_,
-                  height_, 180);
-        draw_line(j0 + 12, i0 + 8, OFF(mvs[m0 + 8].x), OFF(mvs[m0 + 8].y), y_,
-                  width_, height_, 180);
-        break;
-      case 3:
-        uchar4_t minor_shapes;
-        minor_shapes.s[0] = (shapes[mb_index].y) & 0x03;
-        minor_shapes.s[1] = (shapes[mb_index].y >> 2) & 0x03;
-        minor_shapes.s[2] = (shapes[mb_index].y >> 4) & 0x03;
-        minor_shapes.s[3] = (shapes[mb_index].y >> 6) & 0x03;
-        for (int m = 0; m < 4; ++m) {
-          int mdiv = m / 2;
-          int mmod = m % 2;
-          switch (minor_shapes.s[m]) {
-          case 0: // 8 x 8
-            draw_line(j0 + mmod * 8 + 4, i0 + mdiv * 8 + 4,
-                      OFF(mvs[m0 + m * 4].x), OFF(mvs[m0 + m * 4].y), y_,
-                      width_, height_, 180);
-            break;
-          case 1: // 8 x 4
-            for (int n = 0; n < 2; ++n) {
-              draw_line(j0 + mmod * 8 + 4, i0 + (mdiv * 8 + n * 4 + 2),
-                        OFF(mvs[m0 + m * 4 + n * 2].x),
-                        OFF(mvs[m0 + m * 4 + n * 2].y), y_, width_, height_,
-                        180);
-            }
-            break;
-          case 2: // 4 x 8
-            for (int n = 0; n < 2; ++n) {
-              draw_line(j0 + (mmod * 8 + n * 4 + 2), i0 + mdiv * 8 + 4,
-                        OFF(mvs[m0 + m * 4 + n * 2].x),
-                        OFF(mvs[m0 + m * 4 + n * 2].y), y_, width_, height_,
-                        180);
-            }
-            break;
-          case 3: // 4 x 4
-            for (int n = 0; n < 4; ++n) {
-              draw_line(j0 + n * 4 + 2, i0 + m * 4 + 2,
-                        OFF(mvs[m0 + m * 4 + n].x), OFF(mvs[m0 + m * 4 + n].y),
-                        y_, width_, height_, 180);
-            }
-            break;
-          }
-        }
-        break;
-      }
-    }
-  }
+  VectorOverlay overlay;
+  overlay.render(mvs, shapes, luma_plane(*this));
 }
 
 void PlanarImage::overlay_vectors(const motion_vector *mvs,
@@ -192,189 +132,250 @@ void PlanarImage::overlay_vectors(const motion_vector *mvs,
                                   const intra_shape *intra_shapes,
                                   const residual *inter_residuals,
                                   const residual *intra_residuals) {
-  int mv_image_width, mv_image_height;
-  int mb_image_width, mb_image_height;
-  compute_num_mvs(width_, height_, mv_image_width, mv_image_height,
-                  mb_image_width, mb_image_height);
-
-#define OFF(P) ((P) + 2) >> 2
-
-  for (int i = 0; i < mb_image_height; i++) {
-    for (int j = 0; j < mb_image_width; j++) {
-      int mb_index = j + i * mb_image_width;
-      // Selectively Draw motion vectors for different sub block sizes
-      int j0 = j * 16;
-      int i0 = i * 16;
-      int m0 = mb_index * 16;
-
-      if (inter_residuals[mb_index] < intra_residuals[mb_index]) {
-        switch (inter_shapes[mb_index].x) {
-        case 0: {
-          draw_line(j0 + 8, i0 + 8, OFF(mvs[m0].x), OFF(mvs[m0].y), y_, width_,
-                    height_, 180);
-          break;
-        }
-        case 1: {
-          draw_line(j0 + 8, i0 + 4, OFF(mvs[m0].x), OFF(mvs[m0].y), y_, width_,
-                    height_, 180);
-          draw_line(j0 + 8, i0 + 12, OFF(mvs[m0 + 8].x), OFF(mvs[m0 + 8].y), y_,
-                    width_, height_, 180);
-          break;
-        }
-        case 2: {
-          draw_line(j0 + 4, i0 + 8, OFF(mvs[m0].x), OFF(mvs[m0].y), y_, width_,
-                    height_, 180);
-          draw_line(j0 + 12, i0 + 8, OFF(mvs[m0 + 8].x), OFF(mvs[m0 + 8].y), y_,
-                    width_, height_, 180);
-          break;
-        }
-        case 3: {
-          uchar4_t minor_shapes;
-          minor_shapes.s[0] = (inter_shapes[mb_index].y) & 0x03;
-          minor_shapes.s[1] = (inter_shapes[mb_index].y >> 2) & 0x03;
-          minor_shapes.s[2] = (inter_shapes[mb_index].y >> 4) & 0x03;
-          minor_shapes.s[3] = (inter_shapes[mb_index].y >> 6) & 0x03;
-          for (int m = 0; m < 4; ++m) {
-            int mdiv = m / 2;
-            int mmod = m % 2;
-            switch (minor_shapes.s[m]) {
-            case 0: {
-              break;
-            }
-            case 1: {
-              for (int n = 0; n < 2; ++n) {
-                draw_line(j0 + mmod * 8 + 4, i0 + (mdiv * 8 + n * 4 + 2),
-                          OFF(mvs[m0 + m * 4 + n * 2].x),
-                          OFF(mvs[m0 + m * 4 + n * 2].y), y_, width_, height_,
-                          180);
-              }
-              break;
-            }
-            case 2: {
-              for (int n = 0; n < 2; ++n) {
-                draw_line(j0 + (mmod * 8 + n * 4 + 2), i0 + mdiv * 8 + 4,
-                          OFF(mvs[m0 + m * 4 + n * 2].x),
-                          OFF(mvs[m0 + m * 4 + n * 2].y), y_, width_, height_,
-                          180);
-              }
-              break;
-            }
-            case 3: {
-              for (int n = 0; n < 4; ++n) {
-                draw_line(j0 + n * 4 + 2, i0 + m * 4 + 2,
-                          OFF(mvs[m0 + m * 4 + n].x),
-                          OFF(mvs[m0 + m * 4 + n].y), y_, width_, height_, 180);
-              }
-              break;
-            }
-            }
-          }
-          break;
-        }
-        }
-      } else {
-        switch (intra_shapes[mb_index]) {
-        case 0: {
-          draw_line(j0, i0, 16, 0, y_, width_, height_, 180);
-          draw_line(j0, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0 + 16, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0, i0 + 16, 16, 0, y_, width_, height_, 180);
-
-          break;
-        }
-        case 1: {
-          draw_line(j0, i0, 16, 0, y_, width_, height_, 180);
-          draw_line(j0, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0 + 16, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0, i0 + 16, 16, 0, y_, width_, height_, 180);
-
-          draw_line(j0 + 8, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0, i0 + 8, 16, 0, y_, width_, height_, 180);
-
-          break;
-        }
-        case 2: {
-          draw_line(j0, i0, 16, 0, y_, width_, height_, 180);
-          draw_line(j0, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0 + 16, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0, i0 + 16, 16, 0, y_, width_, height_, 180);
+  VectorOverlay overlay;
+  overlay.render(mvs, inter_shapes, intra_shapes, inter_residuals,
+                 intra_residuals, luma_plane(*this));
+}
 
-          draw_line(j0 + 8, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0, i0 + 8, 16, 0, y_, width_, height_, 180);
+// Advises the operating system to read the frames following the most
+// recently requested one, so that mapped frames are resident when accessed
+class YuvPrefetcher {
+public:
+  YuvPrefetcher(const MappedFile &file, const std::vector<uint64_t> &offsets,
+                size_t frame_size, int frames)
+      : file_(file), offsets_(offsets), frame_size_(frame_size),
+        frames_(frames), thread_(&YuvPrefetcher::worker, this) {}
+
+  ~YuvPrefetcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    condition_.notify_one();
+    thread_.join();
+  }
 
-          draw_line(j0 + 4, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0 + 12, i0, 0, 16, y_, width_, height_, 180);
-          draw_line(j0, i0 + 4, 16, 0, y_, width_, height_, 180);
-          draw_line(j0, i0 + 12, 16, 0, y_, width_, height_, 180);
+  void request(int frame_num) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      requested_ = frame_num;
+    }
+    condition_.notify_one();
+  }
 
-          break;
-        }
-        default:
-          throw std::out_of_range("PlanarImage::overlay_vectors: Invalid "
-                                  "intra shape value encountered.");
+private:
+  void worker() {
+    int prefetched = -1;
+    for (;;) {
+      int frame_num = 0;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock,
+                        [&] { return stopping_ || requested_ != prefetched; });
+        if (stopping_) {
+          return;
         }
+        frame_num = requested_;
       }
+      const size_t first = static_cast<size_t>(frame_num) + 1;
+      if (first < offsets_.size()) {
+        const size_t last = std::min(offsets_.size() - 1,
+                                     static_cast<size_t>(frame_num) + frames_);
+        file_.prefetch(static_cast<size_t>(offsets_[first]),
+                       static_cast<size_t>(offsets_[last] - offsets_[first]) +
+                           frame_size_);
+      }
+      prefetched = frame_num;
+    }
+  }
+
+  const MappedFile &file_;
+  const std::vector<uint64_t> &offsets_;
+  const size_t frame_size_;
+  const int frames_;
+  int requested_ = -1;
+  bool stopping_ = false;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::thread thread_;
+};
+
+YuvCapture::YuvCapture()
+    : mode_(YuvCaptureMode::stream), format_(PlanarFormat::i420), y4m_(false),
+      width_(0), height_(0), num_frames_(0) {}
+
+YuvCapture::YuvCapture(const std::string &fn, int width, int height, int frames,
+                       YuvCaptureMode mode, PlanarFormat format)
+    : mode_(mode), format_(format), y4m_(false), width_(width),
+      height_(height), num_frames_(0) {
+  uint64_t file_size = 0;
+  std::vector<uint8_t> head;
+  const uint8_t *head_data = nullptr;
+  if (mode_ == YuvCaptureMode::mapped) {
+    if (!mapped_file_.open(fn)) {
+      std::stringstream ss;
+      ss << "Unable to map YUV file: " << fn;
+      throw std::invalid_argument(ss.str().c_str());
+    }
+    file_size = mapped_file_.size();
+    head_data = mapped_file_.data();
+  } else {
+    file_ = std::ifstream(fn.c_str(), std::ios::binary | std::ios::ate);
+    if (!file_.good()) {
+      std::stringstream ss;
+      ss << "Unable to load YUV file: " << fn;
+      throw std::invalid_argument(ss.str().c_str());
+    }
+    file_size = static_cast<uint64_t>(file_.tellg());
+    file_.seekg(0, std::ios::beg);
+    head.resize(static_cast<size_t>(
+        std::min<uint64_t>(file_size, y4m_max_header_size)));
+    file_.read(reinterpret_cast<char *>(head.data()), head.size());
+    head_data = head.data();
+  }
+
+  const size_t head_size = static_cast<size_t>(
+      std::min<uint64_t>(file_size, y4m_max_header_size));
+  const size_t header_size = read_y4m_header(head_data, head_size, y4m_header_);
+  if (header_size != 0) {
+    if (!is_y4m_420(y4m_header_)) {
+      throw std::invalid_argument("Unsupported Y4M colorspace: " +
+                                  y4m_header_.colorspace);
+    }
+    if (format_ != PlanarFormat::i420) {
+      throw std::invalid_argument("Y4M files are stored as I420.");
+    }
+    if ((width_ != 0 && width_ != y4m_header_.width) ||
+        (height_ != 0 && height_ != y4m_header_.height)) {
+      LOG_DEBUG << "Using the Y4M frame size " << y4m_header_.width << "x"
+                << y4m_header_.height << " instead of " << width_ << "x"
+                << height_ << ".";
     }
+    y4m_ = true;
+    width_ = y4m_header_.width;
+    height_ = y4m_header_.height;
   }
+
+  index_frames(file_size, header_size, frames);
+  num_frames_ = static_cast<int>(frame_offsets_.size());
 }
 
-YuvCapture::YuvCapture(const std::string &fn, int width, int height,
-                       int frames) {
+YuvCapture::~YuvCapture() {
+  // The prefetcher reads frame_offsets_, so it stops before members go away
+  prefetcher_.reset();
+}
 
-  file_ = std::ifstream(fn.c_str(), std::ios::binary | std::ios::ate);
-  if (!file_.good()) {
-    std::stringstream ss;
-    ss << "Unable to load YUV file: " << fn;
-    throw std::invalid_argument(ss.str().c_str());
+void YuvCapture::index_frames(uint64_t file_size, uint64_t first_frame,
+                              int frames) {
+  const uint64_t frame_size = packed_frame_size(format_, width_, height_);
+  if (frame_size == 0) {
+    throw std::invalid_argument("YUV file file size error. Wrong dimensions?");
   }
 
-  const int file_size = static_cast<int>(file_.tellg());
-  const int frame_size = width * height * 3 / 2 * sizeof(uint8_t);
+  if (y4m_) {
+    // Frame markers may carry parameters, so every frame has to be visited
+    frame_offsets_ =
+        mode_ == YuvCaptureMode::mapped
+            ? index_y4m_frames(mapped_file_.data(), file_size, first_frame,
+                               frame_size, frames)
+            : index_y4m_frames(file_, file_size, first_frame, frame_size,
+                               frames);
+    return;
+  }
 
   if ((file_size % frame_size) != 0) {
     throw std::invalid_argument("YUV file file size error. Wrong dimensions?");
   }
+  uint64_t count = file_size / frame_size;
+  if (frames > 0) {
+    count = std::min<uint64_t>(count, static_cast<uint64_t>(frames));
+  }
+  frame_offsets_.resize(static_cast<size_t>(count));
+  for (size_t i = 0; i < frame_offsets_.size(); ++i) {
+    frame_offsets_[i] = i * frame_size;
+  }
+}
 
-  file_.seekg(0, std::ios::beg);
-
-  num_frames_ = (frames == 0) ? (file_size / frame_size) : frames;
-  width_ = width;
-  height_ = height;
+uint64_t YuvCapture::frame_offset(int frame_num) const {
+  if (frame_num < 0 || frame_num >= num_frames_) {
+    throw std::out_of_range("YuvCapture: frame number out of range.");
+  }
+  return frame_offsets_[frame_num];
 }
 
-void YuvCapture::get_sample(int frame_num, PlanarImage &im) {
-  if (im.get_width() != width_ || im.get_height() != height_) {
-    throw std::runtime_error("Capture::get_frame: output image size mismatch.");
+yuv_frame_view YuvCapture::get_frame_view(int frame_num) {
+  if (mode_ != YuvCaptureMode::mapped) {
+    throw std::logic_error("YuvCapture: frame views require mapped mode.");
+  }
+  const uint64_t offset = frame_offset(frame_num);
+  if (prefetcher_) {
+    prefetcher_->request(frame_num);
   }
 
-  const int frame_size = width_ * height_ * 3 / 2 * sizeof(uint8_t);
-  file_.clear();
-  file_.seekg(frame_num * frame_size);
+  return make_frame_view(mapped_file_.data() + offset, format_, width_,
+                         height_);
+}
 
-  int in_row_size = width_ * sizeof(uint8_t);
-  int out_row_size = im.get_pitch_y() * sizeof(uint8_t);
-  uint8_t *out_ptr = im.get_y();
-  for (int i = 0; i < height_; ++i) {
-    file_.read(reinterpret_cast<char *>(out_ptr), in_row_size);
-    out_ptr += out_row_size;
+yuv_frame_view YuvCapture::get_field_view(int frame_num, int polarity) {
+  yuv_frame_view view = get_frame_view(frame_num);
+  if (polarity == 1) {
+    view.y += view.pitch_y;
+    view.u += view.pitch_u;
+    view.v += view.pitch_v;
   }
-  assert(out_ptr == im.get_u());
-  out_ptr = im.get_u();
-  in_row_size = (width_ / 2) * sizeof(uint8_t);
-  out_row_size = im.get_pitch_u() * sizeof(uint8_t);
-  for (int i = 0; i < height_ / 2; ++i) {
-    file_.read(reinterpret_cast<char *>(out_ptr), in_row_size);
-    out_ptr += out_row_size;
+  view.height /= 2;
+  view.pitch_y *= 2;
+  view.pitch_u *= 2;
+  view.pitch_v *= 2;
+  return view;
+}
+
+void YuvCapture::set_prefetch_frames(int frames) {
+  if (mode_ != YuvCaptureMode::mapped) {
+    throw std::logic_error("YuvCapture: prefetching requires mapped mode.");
+  }
+  prefetcher_.reset();
+  if (frames > 0) {
+    prefetcher_.reset(new YuvPrefetcher(
+        mapped_file_, frame_offsets_,
+        packed_frame_size(format_, width_, height_), frames));
   }
-  assert(out_ptr == im.get_v());
-  out_ptr = im.get_v();
-  in_row_size = (width_ / 2) * sizeof(uint8_t);
-  out_row_size = im.get_pitch_v() * sizeof(uint8_t);
-  for (int i = 0; i < height_ / 2; ++i) {
-    file_.read(reinterpret_cast<char *>(out_ptr), in_row_size);
+}
+
+namespace {
+void read_rows(std::ifstream &file, uint8_t *out_ptr, int out_row_size,
+               int in_row_size, int rows, bool interlaced, int polarity) {
+  for (int i = 0; i < rows; ++i) {
+    if (interlaced && (polarity == 1)) {
+      file.ignore(in_row_size);
+    }
+    file.read(reinterpret_cast<char *>(out_ptr), in_row_size);
+    if (interlaced && (polarity == 0)) {
+      file.ignore(in_row_size);
+    }
     out_ptr += out_row_size;
   }
 }
+} // namespace
+
+void YuvCapture::read_planes(PlanarImage &im, bool interlaced, int polarity) {
+  const int row_size = width_ * bytes_per_sample(format_);
+  read_rows(file_, im.get_y(), im.get_pitch_y(), row_size, im.get_height(),
+            interlaced, polarity);
+  if (format_ == PlanarFormat::i420) {
+    read_rows(file_, im.get_u(), im.get_pitch_u(), width_ / 2,
+              im.get_height() / 2, interlaced, polarity);
+    read_rows(file_, im.get_v(), im.get_pitch_v(), width_ / 2,
+              im.get_height() / 2, interlaced, polarity);
+  } else {
+    read_rows(file_, im.get_uv(), im.get_pitch_u(), row_size,
+              im.get_height() / 2, interlaced, polarity);
+  }
+}
+
+void YuvCapture::get_sample(int frame_num, PlanarImage &im) {
+  get_sample(frame_num, im, false, 0);
+}
 
 void YuvCapture::get_sample(int frame_num, PlanarImage &im, bool interlaced,
                             int polarity) {
@@ -383,169 +384,226 @@ void YuvCapture::get_sample(int frame_num, PlanarImage &im, bool interlaced,
     throw std::runtime_error("Capture::get_frame: output image size mismatch.");
   }
 
-  const int frame_size = width_ * height_ * 3 / 2 * sizeof(uint8_t);
+  if (mode_ == YuvCaptureMode::mapped) {
+    convert_planar(interlaced ? get_field_view(frame_num, polarity)
+                              : get_frame_view(frame_num),
+                   format_, im);
+    return;
+  }
+
   file_.clear();
-  file_.seekg(frame_num * frame_size);
+  file_.seekg(static_cast<std::streamoff>(frame_offset(frame_num)));
 
-  int in_row_size = width_ * sizeof(uint8_t);
-  int out_row_size = im.get_pitch_y() * sizeof(uint8_t);
-  uint8_t *out_ptr = im.get_y();
-  for (int i = 0; i < im.get_height(); ++i) {
-    if (interlaced && (polarity == 1)) {
-      file_.ignore(in_row_size);
-    }
-    file_.read(reinterpret_cast<char *>(out_ptr), in_row_size);
-    if (interlaced && (polarity == 0)) {
-      file_.ignore(in_row_size);
-    }
-    out_ptr += out_row_size;
+  if (im.get_format() == format_) {
+    read_planes(im, interlaced, polarity);
+    return;
   }
-  assert(out_ptr == im.get_u());
-  out_ptr = im.get_u();
-  in_row_size = (width_ / 2) * sizeof(uint8_t);
-  out_row_size = im.get_pitch_u() * sizeof(uint8_t);
-  for (int i = 0; i < im.get_height() / 2; ++i) {
-    if (interlaced && (polarity == 1)) {
-      file_.ignore(in_row_size);
-    }
-    file_.read(reinterpret_cast<char *>(out_ptr), in_row_size);
-    if (interlaced && (polarity == 0)) {
-      file_.ignore(in_row_size);
-    }
-    out_ptr += out_row_size;
+  // Rows are read in the file format and converted afterwards
+  if (scratch_.get_width() != im.get_width() ||
+      scratch_.get_height() != im.get_height() ||
+      scratch_.get_format() != format_) {
+    scratch_ = PlanarImage(im.get_width(), im.get_height(), 0, format_);
   }
-  assert(out_ptr == im.get_v());
-  out_ptr = im.get_v();
-  in_row_size = (width_ / 2) * sizeof(uint8_t);
-  out_row_size = im.get_pitch_v() * sizeof(uint8_t);
-  for (int i = 0; i < im.get_height() / 2; ++i) {
-    if (interlaced && (polarity == 1)) {
-      file_.ignore(in_row_size);
-    }
-    file_.read(reinterpret_cast<char *>(out_ptr), in_row_size);
-    if (interlaced && (polarity == 0)) {
-      file_.ignore(in_row_size);
+  read_planes(scratch_, interlaced, polarity);
+  convert_planar(scratch_.view(), format_, im);
+}
+
+namespace {
+// Bitmap names are the output name cropped at the first dot plus the index
+std::string bmp_prefix(const std::string &fn) {
+  return fn.substr(0, fn.find('.'));
+}
+} // namespace
+
+void YuvWriter::write_bmp(const uint8_t *frame, int index,
+                          const std::string &prefix) {
+  if (!bmp_converter_) {
+    // Matches the previous float conversion, which left alpha cleared
+    ColorFormat format;
+    format.alpha = 0;
+    bmp_converter_.reset(new ColorConverter(format, 0));
+    bmp_ = ImageBMP32Bit(width_, height_);
+  }
+  yuv_frame_view view = make_frame_view(frame, format_, width_, height_);
+  if (format_ == PlanarFormat::p010) {
+    if (bmp_scratch_.get_width() != width_) {
+      bmp_scratch_ = PlanarImage(width_, height_, 0, PlanarFormat::nv12);
     }
-    out_ptr += out_row_size;
+    convert_planar(view, format_, bmp_scratch_);
+    view = bmp_scratch_.view();
+  }
+
+  // Bitmap rows are stored bottom-up
+  const ptrdiff_t pitch = static_cast<ptrdiff_t>(bmp_.pitch()) * 4;
+  uint8_t *last_row = reinterpret_cast<uint8_t *>(bmp_.raw_data()) +
+                      (height_ - 1) * pitch;
+  bmp_converter_->convert(view,
+                          format_ == PlanarFormat::i420 ? ChromaLayout::i420
+                                                        : ChromaLayout::nv12,
+                          last_row, -pitch);
+
+  std::stringstream number;
+  number << index;
+  std::string filename = prefix + number.str() + std::string(".bmp");
+  if (bmp_.write(filename)) {
+    throw std::runtime_error("Failed to write output bitmap file.");
   }
 }
 
 void YuvWriter::write_to_file(const char *fn) {
+  if (writer_) {
+    if (stream_path_ != fn) {
+      throw std::invalid_argument(
+          "YuvWriter: streaming output was opened for a different file.");
+    }
+    const bool ok = writer_->close();
+    writer_.reset();
+    if (!ok) {
+      throw std::runtime_error("Failed writing output file.");
+    }
+    return;
+  }
+
   if (b_to_bmps_) {
-    std::string out_file(fn);
-    int found = static_cast<int>(out_file.find('.'));
-    // crop the name
-    out_file = out_file.substr(0, found);
-    std::vector<uchar4_t> frame(width_ * height_);
-    const int uv_width = width_ / 2;
-    const int uv_height = height_ / 2;
+    const std::string prefix = bmp_prefix(fn);
+    const size_t frame_size = packed_frame_size(format_, width_, height_);
     for (int k = 0; k < curr_frame_; ++k) {
-      // Y (a value per pixel)
-      const uint8_t *p_img_y = &data_[k * width_ * height_ * 3 / 2];
-      // U (a value per 4 pixels) and V (a value per 4 pixels)
-      const uint8_t *p_img_u =
-          p_img_y +
-          width_ *
-              height_; // U plane is after Y plane (which is width_ * height_)
-      const uint8_t *p_img_v =
-          p_img_u + uv_width * uv_height; // V plane is after U plane (which is
-                                          // uv_width * uv_height)
-
-      std::fill(frame.begin(), frame.end(), uchar4_t{0});
-      for (int i = 0; i < height_; ++i) {
-        for (int j = 0; j < width_; ++j) {
-          // Y value
-          uint8_t y = p_img_y[j + width_ * (height_ - 1 - i)];
-          // the same U value 4 times, thus both i and j are divided by 2
-          uint8_t u = p_img_u[j / 2 + uv_width * (uv_height - 1 - i / 2)];
-          uint8_t v = p_img_v[j / 2 + uv_width * (uv_height - 1 - i / 2)];
-
-          // R is the 3rd component in the bitmap (which is actualy stored as
-          // BGRA)
-          const auto r = static_cast<int32_t>(1.164f * (float(y) - 16) +
-                                              1.596f * (float(v) - 128));
-          frame[j + width_ * i].s[2] =
-              static_cast<uint8_t>(std::min(255, std::max(r, 0)));
-          // G
-          const auto g = static_cast<int32_t>(1.164f * (float(y) - 16) -
-                                              0.813f * (float(v) - 128) -
-                                              0.391f * (float(u) - 128));
-          frame[j + width_ * i].s[1] =
-              static_cast<uint8_t>(std::min(255, std::max(g, 0)));
-          // B
-          const auto b = static_cast<int32_t>(1.164f * (float(y) - 16) +
-                                              2.018f * (float(u) - 128));
-          frame[j + width_ * i].s[0] =
-              static_cast<uint8_t>(std::min(255, std::max(b, 0)));
-        }
-      }
-      std::stringstream number;
-      number << k;
-      std::string filename = out_file + number.str() + std::string(".bmp");
-      ImageBMP32Bit image(width_, height_);
-      if (image.write(filename, reinterpret_cast<uint32_t *>(frame.data()))) {
-        throw std::runtime_error("Failed to write output bitmap file.");
-      }
+      write_bmp(&data_[k * frame_size], k, prefix);
     }
   }
 
   // YUV file
+  const bool y4m = is_y4m_path(fn);
+  const std::string header = y4m ? y4m_header() : std::string();
   std::ofstream out_file(fn, std::ios::binary);
   if (!out_file.good()) {
     throw std::runtime_error("Failed opening output file.");
   }
-  out_file.write(reinterpret_cast<char *>(&data_[0]), data_.size());
+  if (y4m) {
+    out_file.write(header.data(), header.size());
+    const size_t frame_size = packed_frame_size(format_, width_, height_);
+    for (int k = 0; k < curr_frame_; ++k) {
+      out_file.write(y4m_frame_marker, sizeof(y4m_frame_marker) - 1);
+      out_file.write(reinterpret_cast<char *>(&data_[k * frame_size]),
+                     frame_size);
+    }
+  } else {
+    out_file.write(reinterpret_cast<char *>(&data_[0]), data_.size());
+  }
   out_file.close();
 }
 
-void YuvWriter::append_frame(const PlanarImage &im) {
-  data_.resize((curr_frame_ + 1) * width_ * height_ * 3 / 2);
-
-  uint8_t *p_src = im.get_y();
-  uint8_t *p_dst = &data_[curr_frame_ * width_ * height_ * 3 / 2];
-  int p_dst_size = width_ * height_ * 3 / 2;
-  for (int y = 0; y < im.get_height(); ++y) {
-    if (im.get_width() <= p_dst_size) {
-      std::copy(p_src, p_src + im.get_width(), p_dst);
-    } else {
-      throw std::runtime_error("Failed to append frame.");
-    }
-    p_src += im.get_pitch_y();
-    p_dst += im.get_width();
-    p_dst_size -= im.get_width();
+void YuvWriter::set_y4m_header(const Y4mHeader &header) {
+  if (writer_) {
+    throw std::logic_error(
+        "YuvWriter: the Y4M header must be set before open.");
   }
+  y4m_header_ = header;
+}
 
-  p_src = im.get_u();
-  for (int y = 0; y < im.get_height() / 2; ++y) {
-    if (im.get_width() / 2 <= p_dst_size) {
-      std::copy(p_src, p_src + im.get_width() / 2, p_dst);
+std::string YuvWriter::y4m_header() const {
+  if (format_ != PlanarFormat::i420) {
+    throw std::invalid_argument("YuvWriter: Y4M files are written as I420.");
+  }
+  Y4mHeader header = y4m_header_;
+  header.width = width_;
+  header.height = height_;
+  return format_y4m_header(header);
+}
+
+void YuvWriter::open(const std::string &fn, size_t max_bytes_in_flight,
+                     bool direct_io) {
+  if (curr_frame_ != 0 || writer_) {
+    throw std::logic_error(
+        "YuvWriter: streaming must start before the first frame.");
+  }
+  y4m_stream_ = is_y4m_path(fn);
+  const std::string header = y4m_stream_ ? y4m_header() : std::string();
+  writer_.reset(new AsyncFileWriter());
+  if (!writer_->open(fn, max_bytes_in_flight, direct_io) ||
+      !writer_->write(header.data(), header.size())) {
+    writer_.reset();
+    throw std::runtime_error("Failed opening output file.");
+  }
+  stream_path_ = fn;
+  // Frames are packed one at a time, so the clip is never kept in memory
+  data_.clear();
+  data_.shrink_to_fit();
+}
+
+namespace {
+uint8_t *pack_rows(const uint8_t *p_src, int pitch, int row_size, int rows,
+                   uint8_t *p_dst, size_t &p_dst_size) {
+  for (int y = 0; y < rows; ++y) {
+    if (static_cast<size_t>(row_size) <= p_dst_size) {
+      std::copy(p_src, p_src + row_size, p_dst);
     } else {
       throw std::runtime_error("Failed to append frame.");
     }
-    p_src += im.get_pitch_u();
-    p_dst += im.get_width() / 2;
-    p_dst_size -= im.get_width() / 2;
+    p_src += pitch;
+    p_dst += row_size;
+    p_dst_size -= row_size;
+  }
+  return p_dst;
+}
+} // namespace
+
+void YuvWriter::pack_frame(const PlanarImage &im, uint8_t *p_dst) {
+  const PlanarImage *frame = &im;
+  if (im.get_format() != format_) {
+    if (scratch_.get_width() != im.get_width() ||
+        scratch_.get_height() != im.get_height()) {
+      scratch_ = PlanarImage(im.get_width(), im.get_height(), 0, format_);
+    }
+    convert_planar(im.view(), im.get_format(), scratch_);
+    frame = &scratch_;
   }
 
-  p_src = im.get_v();
-  for (int y = 0; y < im.get_height() / 2; ++y) {
-    if (im.get_width() / 2 <= p_dst_size) {
-      std::copy(p_src, p_src + im.get_width() / 2, p_dst);
-    } else {
-      throw std::runtime_error("Failed to append frame.");
+  size_t p_dst_size = packed_frame_size(format_, width_, height_);
+  const int row_size = frame->get_width() * bytes_per_sample(format_);
+  p_dst = pack_rows(frame->get_y(), frame->get_pitch_y(), row_size,
+                    frame->get_height(), p_dst, p_dst_size);
+  if (format_ == PlanarFormat::i420) {
+    p_dst = pack_rows(frame->get_u(), frame->get_pitch_u(),
+                      frame->get_width() / 2, frame->get_height() / 2, p_dst,
+                      p_dst_size);
+    pack_rows(frame->get_v(), frame->get_pitch_v(), frame->get_width() / 2,
+              frame->get_height() / 2, p_dst, p_dst_size);
+  } else {
+    pack_rows(frame->get_uv(), frame->get_pitch_u(), row_size,
+              frame->get_height() / 2, p_dst, p_dst_size);
+  }
+}
+
+void YuvWriter::append_frame(const PlanarImage &im) {
+  const size_t frame_size = packed_frame_size(format_, width_, height_);
+  if (writer_) {
+    data_.resize(frame_size);
+    pack_frame(im, data_.data());
+    if (b_to_bmps_) {
+      write_bmp(data_.data(), curr_frame_, bmp_prefix(stream_path_));
+    }
+    if ((y4m_stream_ && !writer_->write(y4m_frame_marker,
+                                        sizeof(y4m_frame_marker) - 1)) ||
+        !writer_->write(data_.data(), data_.size())) {
+      throw std::runtime_error("Failed writing output file.");
     }
-    p_src += im.get_pitch_v();
-    p_dst += im.get_width() / 2;
-    p_dst_size -= im.get_width() / 2;
+  } else {
+    data_.resize((curr_frame_ + 1) * frame_size);
+    pack_frame(im, &data_[curr_frame_ * frame_size]);
   }
 
   ++curr_frame_;
 }
 
-YuvWriter::YuvWriter(int width, int height, int frame_num_hint, bool b_to_bmps)
-    : width_(width), height_(height), curr_frame_(0), b_to_bmps_(b_to_bmps) {
+YuvWriter::~YuvWriter() = default;
+
+YuvWriter::YuvWriter(int width, int height, int frame_num_hint, bool b_to_bmps,
+                     PlanarFormat format)
+    : width_(width), height_(height), curr_frame_(0), b_to_bmps_(b_to_bmps),
+      format_(format) {
   if (frame_num_hint > 0) {
-    data_.reserve(frame_num_hint * width_ * height_ * 3 / 2);
+    data_.reserve(frame_num_hint * packed_frame_size(format_, width_, height_));
   }
 }
 
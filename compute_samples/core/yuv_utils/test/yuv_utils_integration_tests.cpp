@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "yuv_utils/vme_pipeline.hpp"
+#include "yuv_utils/yuv_utils.hpp"
+#include "utils/temporary_directory.hpp"
+#include "utils/utils.hpp"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cs = compute_samples;
+
+namespace {
+// Raw I420 clip whose frames are filled with their index
+std::vector<uint8_t> numbered_frames(const int width, const int height,
+                                     const int frames) {
+  const size_t frame_size = width * height * 3 / 2;
+  std::vector<uint8_t> data(frame_size * frames);
+  for (int i = 0; i < frames; ++i) {
+    std::fill(data.begin() + i * frame_size,
+              data.begin() + (i + 1) * frame_size, static_cast<uint8_t>(i));
+  }
+  return data;
+}
+} // namespace
+
+class VmePipelineTest : public testing::TestWithParam<int> {
+protected:
+  void SetUp() override {
+    input_ = directory_.file("input.yuv");
+    output_ = directory_.file("output.yuv");
+    cs::save_binary_file(numbered_frames(width_, height_, frames_), input_);
+  }
+
+  const int width_ = 32;
+  const int height_ = 16;
+  const int frames_ = 9;
+  const int mb_count_ = 2;
+  const int mv_count_ = 32;
+  const cs::TemporaryDirectory directory_{"yuv_utils_tests"};
+  std::string input_;
+  std::string output_;
+};
+
+TEST_P(VmePipelineTest, HooksSeeFramesAndReferencesInTheirSlots) {
+  cs::YuvCapture capture(input_, width_, height_);
+  cs::YuvWriter writer(width_, height_, frames_);
+  writer.open(output_);
+
+  cs::VmePipeline pipeline(GetParam(), width_, height_, mv_count_,
+                           mb_count_);
+  // Frame index uploaded into each slot, as a device would hold it
+  std::vector<int> device(pipeline.slot_count(), -1);
+  std::vector<std::string> errors;
+  std::vector<int> read_back;
+  std::vector<int> drawn;
+  std::mutex mutex;
+  pipeline.read_from(capture);
+  pipeline.write_to(writer);
+  pipeline.set_upload([&](int slot, const cs::PlanarImage &image) {
+    std::lock_guard<std::mutex> lock(mutex);
+    device[slot] = image.get_y()[0];
+  });
+  pipeline.set_compute([&](int frame_idx, int slot, int reference_slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (device[slot] != frame_idx ||
+        device[reference_slot] != std::max(frame_idx - 1, 0)) {
+      errors.push_back("frame " + std::to_string(frame_idx));
+    }
+  });
+  pipeline.set_readback([&](int slot, cs::VmeFrame &frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    read_back.push_back(device[slot]);
+    frame.mvs[0].x = static_cast<int16_t>(device[slot]);
+  });
+  pipeline.set_overlay([&](int frame_idx, cs::VmeFrame &frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (frame.mvs[0].x != frame_idx) {
+      errors.push_back("vectors of frame " + std::to_string(frame_idx));
+    }
+    drawn.push_back(frame_idx);
+  });
+  pipeline.run(frames_);
+  writer.write_to_file(output_.c_str());
+
+  EXPECT_TRUE(errors.empty()) << errors.front();
+  const std::vector<int> estimated = {1, 2, 3, 4, 5, 6, 7, 8};
+  EXPECT_EQ(estimated, read_back);
+  EXPECT_EQ(estimated, drawn);
+  EXPECT_EQ(numbered_frames(width_, height_, frames_),
+            cs::load_binary_file(output_));
+}
+
+TEST_P(VmePipelineTest, FirstFrameIsEstimatedOnRequest) {
+  cs::YuvCapture capture(input_, width_, height_);
+  cs::VmePipeline pipeline(GetParam(), width_, height_, mv_count_,
+                           mb_count_);
+  std::vector<int> drawn;
+  pipeline.read_from(capture);
+  pipeline.set_first_frame_estimated(true);
+  pipeline.set_overlay([&](int frame_idx, cs::VmeFrame &) {
+    drawn.push_back(frame_idx);
+  });
+  pipeline.run(3);
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), drawn);
+}
+
+TEST_P(VmePipelineTest, DefaultOverlayDrawsVectors) {
+  cs::YuvCapture capture(input_, width_, height_);
+  cs::YuvWriter writer(width_, height_, 2);
+  writer.open(output_);
+  cs::VmePipeline pipeline(GetParam(), width_, height_, mv_count_,
+                           mb_count_);
+  pipeline.read_from(capture);
+  pipeline.write_to(writer);
+  pipeline.set_readback([&](int, cs::VmeFrame &frame) {
+    for (cs::motion_vector &mv : frame.mvs) {
+      mv.x = 16;
+      mv.y = 8;
+    }
+  });
+  pipeline.run(2);
+  writer.write_to_file(output_.c_str());
+
+  const cs::VmeFrame &frame = pipeline.frame(pipeline.slot(1));
+  cs::PlanarImage expected(width_, height_);
+  capture.get_sample(1, expected);
+  expected.overlay_vectors(frame.mvs.data(), frame.shapes.data());
+  const std::vector<uint8_t> output = cs::load_binary_file(output_);
+  const size_t frame_size = width_ * height_ * 3 / 2;
+  ASSERT_EQ(2 * frame_size, output.size());
+  const std::vector<uint8_t> luma(output.begin() + frame_size,
+                                  output.begin() + frame_size +
+                                      width_ * height_);
+  std::vector<uint8_t> expected_luma;
+  for (int y = 0; y < height_; ++y) {
+    const uint8_t *row = expected.get_y() + y * expected.get_pitch_y();
+    expected_luma.insert(expected_luma.end(), row, row + width_);
+  }
+  EXPECT_EQ(expected_luma, luma);
+  EXPECT_NE(std::vector<uint8_t>(width_ * height_, 1), luma);
+}
+
+TEST_P(VmePipelineTest, StageExceptionIsRethrownByRun) {
+  cs::YuvCapture capture(input_, width_, height_);
+  cs::VmePipeline pipeline(GetParam(), width_, height_, mv_count_,
+                           mb_count_);
+  pipeline.read_from(capture);
+  pipeline.set_compute([](int frame_idx, int, int) {
+    if (frame_idx == 2) {
+      throw std::runtime_error("kernel failed");
+    }
+  });
+  EXPECT_THROW(pipeline.run(frames_), std::runtime_error);
+}
+
+INSTANTIATE_TEST_SUITE_P(Depths, VmePipelineTest, testing::Values(1, 2, 4));
+
+namespace {
+// Rows of the planes of a view without padding, as stored in YUV files
+std::vector<uint8_t> packed_planes(const cs::yuv_frame_view &view,
+                                   const cs::PlanarFormat format) {
+  const int sample_size = cs::bytes_per_sample(format);
+  const int chroma_width = (view.width + 1) / 2;
+  const int chroma_height = (view.height + 1) / 2;
+  std::vector<uint8_t> planes;
+  auto append_rows = [&](const uint8_t *plane, int pitch, int row_size,
+                         int rows) {
+    for (int y = 0; y < rows; ++y) {
+      planes.insert(planes.end(), plane + y * pitch,
+                    plane + y * pitch + row_size);
+    }
+  };
+  append_rows(view.y, view.pitch_y, view.width * sample_size, view.height);
+  if (format == cs::PlanarFormat::i420) {
+    append_rows(view.u, view.pitch_u, chroma_width, chroma_height);
+    append_rows(view.v, view.pitch_v, chroma_width, chroma_height);
+  } else {
+    append_rows(view.u, view.pitch_u, 2 * chroma_width * sample_size,
+                chroma_height);
+  }
+  return planes;
+}
+
+std::vector<uint8_t> random_bytes(const size_t size) {
+  std::mt19937 generator(2020);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<uint8_t> data(size);
+  for (uint8_t &value : data) {
+    value = static_cast<uint8_t>(distribution(generator));
+  }
+  return data;
+}
+} // namespace
+
+class YuvCaptureModes : public testing::TestWithParam<cs::PlanarFormat> {
+protected:
+  void SetUp() override {
+    path_ = directory_.file("capture.yuv");
+    data_ = random_bytes(cs::packed_frame_size(GetParam(), width_, height_) *
+                         frames_);
+    cs::save_binary_file(data_, path_);
+  }
+
+  // Bytes of a frame in the file
+  std::vector<uint8_t> frame(const int frame_num) const {
+    const size_t size = cs::packed_frame_size(GetParam(), width_, height_);
+    return std::vector<uint8_t>(data_.begin() + frame_num * size,
+                                data_.begin() + (frame_num + 1) * size);
+  }
+
+  const int width_ = 36;
+  const int height_ = 20;
+  const int frames_ = 5;
+  const cs::TemporaryDirectory directory_{"yuv_utils_tests"};
+  std::string path_;
+  std::vector<uint8_t> data_;
+};
+
+TEST_P(YuvCaptureModes, MappedFramesMatchStreamedFrames) {
+  const cs::PlanarFormat format = GetParam();
+  cs::YuvCapture stream(path_, width_, height_, 0, cs::YuvCaptureMode::stream,
+                        format);
+  cs::YuvCapture mapped(path_, width_, height_, 0, cs::YuvCaptureMode::mapped,
+                        format);
+  ASSERT_EQ(frames_, stream.get_num_frames());
+  ASSERT_EQ(frames_, mapped.get_num_frames());
+
+  // Frames are visited out of order to test seeking
+  for (const int frame_num : {0, 3, 1, 4, 2, 2}) {
+    cs::PlanarImage streamed(width_, height_, 0, format);
+    cs::PlanarImage copied(width_, height_, 0, format);
+    stream.get_sample(frame_num, streamed);
+    mapped.get_sample(frame_num, copied);
+    EXPECT_EQ(frame(frame_num), packed_planes(streamed.view(), format))
+        << frame_num;
+    EXPECT_EQ(frame(frame_num), packed_planes(copied.view(), format))
+        << frame_num;
+    EXPECT_EQ(frame(frame_num),
+              packed_planes(mapped.get_frame_view(frame_num), format))
+        << frame_num;
+  }
+}
+
+TEST_P(YuvCaptureModes, FieldViewsHoldEveryOtherRow) {
+  const cs::PlanarFormat format = GetParam();
+  cs::YuvCapture stream(path_, width_, height_, 0, cs::YuvCaptureMode::stream,
+                        format);
+  cs::YuvCapture mapped(path_, width_, height_, 0, cs::YuvCaptureMode::mapped,
+                        format);
+  const int sample_size = cs::bytes_per_sample(format);
+  for (int frame_num = 0; frame_num < frames_; ++frame_num) {
+    const cs::yuv_frame_view frame_view = mapped.get_frame_view(frame_num);
+    for (int polarity = 0; polarity < 2; ++polarity) {
+      const cs::yuv_frame_view field =
+          mapped.get_field_view(frame_num, polarity);
+      ASSERT_EQ(height_ / 2, field.height);
+      ASSERT_EQ(width_, field.width);
+      for (int y = 0; y < field.height; ++y) {
+        const uint8_t *field_row = field.y + y * field.pitch_y;
+        const uint8_t *frame_row =
+            frame_view.y + (2 * y + polarity) * frame_view.pitch_y;
+        EXPECT_TRUE(std::equal(field_row, field_row + width_ * sample_size,
+                               frame_row))
+            << "frame " << frame_num << ", polarity " << polarity
+            << ", row " << y;
+      }
+      EXPECT_EQ(frame_view.u + polarity * frame_view.pitch_u, field.u);
+      EXPECT_EQ(2 * frame_view.pitch_u, field.pitch_u);
+
+      cs::PlanarImage streamed(width_, height_ / 2, 0, format);
+      cs::PlanarImage copied(width_, height_ / 2, 0, format);
+      stream.get_sample(frame_num, streamed, true, polarity);
+      mapped.get_sample(frame_num, copied, true, polarity);
+      EXPECT_EQ(packed_planes(field, format),
+                packed_planes(streamed.view(), format))
+          << "frame " << frame_num << ", polarity " << polarity;
+      EXPECT_EQ(packed_planes(field, format),
+                packed_planes(copied.view(), format))
+          << "frame " << frame_num << ", polarity " << polarity;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Formats, YuvCaptureModes,
+                         testing::Values(cs::PlanarFormat::i420,
+                                         cs::PlanarFormat::nv12,
+                                         cs::PlanarFormat::p010));
+
+TEST(YuvCapture, FrameViewsRequireMappedMode) {
+  const cs::TemporaryDirectory directory("yuv_utils_tests");
+  const std::string path = directory.file("capture.yuv");
+  cs::save_binary_file(random_bytes(16 * 16 * 3 / 2), path);
+  cs::YuvCapture capture(path, 16, 16);
+  EXPECT_THROW(capture.get_frame_view(0), std::logic_error);
+  EXPECT_THROW(capture.get_field_view(0, 0), std::logic_error);
+  EXPECT_THROW(capture.set_prefetch_frames(2), std::logic_error);
+}
+
+TEST(YuvCapture, CaptureIsDestroyedWhilePrefetching) {
+  const int width = 64;
+  const int height = 64;
+  const int frames = 32;
+  const cs::TemporaryDirectory directory("yuv_utils_tests");
+  const std::string path = directory.file("capture.yuv");
+  const std::vector<uint8_t> data = random_bytes(
+      cs::packed_frame_size(cs::PlanarFormat::i420, width, height) * frames);
+  cs::save_binary_file(data, path);
+
+  // The prefetcher is still advising frames when the capture goes away
+  for (int iteration = 0; iteration < 50; ++iteration) {
+    std::unique_ptr<cs::YuvCapture> capture(new cs::YuvCapture(
+        path, width, height, 0, cs::YuvCaptureMode::mapped));
+    capture->set_prefetch_frames(frames);
+    for (int frame_num = 0; frame_num <= iteration % frames; ++frame_num) {
+      capture->get_frame_view(frame_num);
+    }
+    capture.reset();
+  }
+
+  // Prefetching can be restarted and stopped while frames are read
+  const size_t frame_size =
+      cs::packed_frame_size(cs::PlanarFormat::i420, width, height);
+  cs::YuvCapture capture(path, width, height, 0, cs::YuvCaptureMode::mapped);
+  cs::PlanarImage image(width, height);
+  for (int frame_num = 0; frame_num < frames; ++frame_num) {
+    capture.set_prefetch_frames(frame_num % 3);
+    capture.get_sample(frame_num, image);
+    const std::vector<uint8_t> expected(
+        data.begin() + frame_num * frame_size,
+        data.begin() + (frame_num + 1) * frame_size);
+    EXPECT_EQ(expected, packed_planes(image.view(), cs::PlanarFormat::i420))
+        << frame_num;
+  }
+}
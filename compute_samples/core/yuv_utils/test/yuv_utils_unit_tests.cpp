@@ -0,0 +1,1011 @@
+/*
+ * Copyright (C) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#include "yuv_utils/color_convert.hpp"
+#include "yuv_utils/frame_pipeline.hpp"
+#include "yuv_utils/vector_overlay.hpp"
+#include "yuv_utils/y4m.hpp"
+#include "yuv_utils/yuv_utils.hpp"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cs = compute_samples;
+
+namespace {
+// Frame with padded rows of random samples, padding included, so that reads
+// past the end of a row change the output
+class RandomFrame {
+public:
+  RandomFrame(const int width, const int height, const cs::ChromaLayout layout,
+              std::mt19937 &generator)
+      : layout_(layout) {
+    const int chroma_width = (width + 1) / 2;
+    const int chroma_height = (height + 1) / 2;
+    view_.width = width;
+    view_.height = height;
+    view_.pitch_y = width + 5;
+    const bool nv12 = layout == cs::ChromaLayout::nv12;
+    view_.pitch_u = (nv12 ? 2 : 1) * chroma_width + 3;
+    view_.pitch_v = nv12 ? 0 : chroma_width + 7;
+    y_ = random_bytes(view_.pitch_y * height, generator);
+    u_ = random_bytes(view_.pitch_u * chroma_height, generator);
+    v_ = random_bytes(view_.pitch_v * chroma_height, generator);
+    view_.y = y_.data();
+    view_.u = u_.data();
+    view_.v = nv12 ? nullptr : v_.data();
+  }
+
+  const cs::yuv_frame_view &view() const { return view_; }
+  cs::ChromaLayout layout() const { return layout_; }
+
+private:
+  static std::vector<uint8_t> random_bytes(const int size,
+                                           std::mt19937 &generator) {
+    std::uniform_int_distribution<int> distribution(0, 255);
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t &byte : bytes) {
+      byte = static_cast<uint8_t>(distribution(generator));
+    }
+    return bytes;
+  }
+
+  cs::ChromaLayout layout_;
+  cs::yuv_frame_view view_;
+  std::vector<uint8_t> y_;
+  std::vector<uint8_t> u_;
+  std::vector<uint8_t> v_;
+};
+
+// Output rows are padded and the padding is filled with a marker, so that
+// writes past the last pixel of a row are detected
+const int output_padding = 12;
+const uint8_t output_marker = 0xa5;
+
+std::vector<uint8_t> convert(cs::ColorConverter &converter,
+                             const RandomFrame &frame, const bool bottom_up) {
+  const cs::yuv_frame_view &view = frame.view();
+  const int pitch = 4 * view.width + output_padding;
+  std::vector<uint8_t> output(static_cast<size_t>(pitch) * view.height,
+                              output_marker);
+  uint8_t *first_row =
+      bottom_up ? output.data() + (view.height - 1) * pitch : output.data();
+  converter.convert(view, frame.layout(), first_row,
+                    bottom_up ? -pitch : pitch);
+  return output;
+}
+
+std::vector<cs::ColorFormat> color_formats() {
+  std::vector<cs::ColorFormat> formats(4);
+  formats[1].matrix = cs::ColorMatrix::bt709;
+  formats[2].range = cs::ColorRange::full;
+  formats[2].order = cs::PixelOrder::rgba;
+  formats[3].matrix = cs::ColorMatrix::bt709;
+  formats[3].range = cs::ColorRange::full;
+  formats[3].alpha = 17;
+  return formats;
+}
+} // namespace
+
+TEST(ColorConverter, ScalarKernelIsAlwaysSupported) {
+  EXPECT_TRUE(cs::ColorConverter::is_supported(cs::ColorKernel::scalar));
+  const cs::ColorConverter converter(cs::ColorFormat(), 1,
+                                     cs::ColorKernel::scalar);
+  EXPECT_EQ(cs::ColorKernel::scalar, converter.kernel());
+}
+
+TEST(ColorConverter, ScalarKernelConvertsKnownColors) {
+  // Limited range BT.601 white, black and saturated red
+  const uint8_t y[] = {235, 16, 81, 81};
+  const uint8_t u[] = {128, 90};
+  const uint8_t v[] = {128, 240};
+  cs::yuv_frame_view view;
+  view.y = y;
+  view.u = u;
+  view.v = v;
+  view.width = 4;
+  view.height = 1;
+  view.pitch_y = 4;
+  view.pitch_u = 2;
+  view.pitch_v = 2;
+  cs::ColorConverter converter(cs::ColorFormat(), 1, cs::ColorKernel::scalar);
+  std::vector<uint8_t> output(16);
+  converter.convert(view, cs::ChromaLayout::i420, output.data(), 16);
+
+  EXPECT_EQ((std::vector<uint8_t>{255, 255, 255, 255}),
+            std::vector<uint8_t>(output.begin(), output.begin() + 4));
+  EXPECT_EQ((std::vector<uint8_t>{0, 0, 0, 255}),
+            std::vector<uint8_t>(output.begin() + 4, output.begin() + 8));
+  // BGRA order, red within a step of the fixed-point rounding
+  EXPECT_LE(output[8], 1);
+  EXPECT_LE(output[9], 1);
+  EXPECT_GE(output[10], 254);
+  EXPECT_EQ(255, output[11]);
+}
+
+TEST(ColorConverter, UnsupportedKernelThrows) {
+  for (const cs::ColorKernel kernel :
+       {cs::ColorKernel::sse41, cs::ColorKernel::avx2}) {
+    if (!cs::ColorConverter::is_supported(kernel)) {
+      EXPECT_THROW(cs::ColorConverter(cs::ColorFormat(), 1, kernel),
+                   std::invalid_argument);
+    }
+  }
+}
+
+class ColorConverterKernel : public testing::TestWithParam<cs::ColorKernel> {
+protected:
+  void SetUp() override {
+    if (!cs::ColorConverter::is_supported(GetParam())) {
+      GTEST_SKIP() << cs::ColorConverter::kernel_name(GetParam())
+                   << " is not supported on this processor";
+    }
+  }
+
+  std::mt19937 generator{2020};
+};
+
+TEST_P(ColorConverterKernel, MatchesScalarReference) {
+  // Widths cover empty SIMD loops, odd chroma samples and every length of
+  // the scalar tail after 8 and 16 pixel blocks
+  const std::vector<int> widths = {1,  2,  3,  5,  7,  8,  9,  15, 16,
+                                   17, 23, 24, 31, 32, 33, 47, 63, 65};
+  for (const cs::ColorFormat &format : color_formats()) {
+    cs::ColorConverter reference(format, 1, cs::ColorKernel::scalar);
+    cs::ColorConverter converter(format, 1, GetParam());
+    for (const cs::ChromaLayout layout :
+         {cs::ChromaLayout::i420, cs::ChromaLayout::nv12}) {
+      for (const int width : widths) {
+        for (const int height : {1, 2, 3}) {
+          const RandomFrame frame(width, height, layout, generator);
+          EXPECT_EQ(convert(reference, frame, false),
+                    convert(converter, frame, false))
+              << "width " << width << ", height " << height << ", "
+              << (layout == cs::ChromaLayout::nv12 ? "nv12" : "i420");
+        }
+      }
+    }
+  }
+}
+
+TEST_P(ColorConverterKernel, BottomUpOutputMatchesScalarReference) {
+  cs::ColorConverter reference(cs::ColorFormat(), 1, cs::ColorKernel::scalar);
+  cs::ColorConverter converter(cs::ColorFormat(), 1, GetParam());
+  for (const cs::ChromaLayout layout :
+       {cs::ChromaLayout::i420, cs::ChromaLayout::nv12}) {
+    const RandomFrame frame(37, 9, layout, generator);
+    EXPECT_EQ(convert(reference, frame, true), convert(converter, frame, true));
+  }
+}
+
+TEST_P(ColorConverterKernel, ThreadedConversionMatchesScalarReference) {
+  cs::ColorConverter reference(cs::ColorFormat(), 1, cs::ColorKernel::scalar);
+  cs::ColorConverter converter(cs::ColorFormat(), 3, GetParam());
+  // Taller than a band of rows, with a partial last band
+  const RandomFrame frame(71, 101, cs::ChromaLayout::nv12, generator);
+  EXPECT_EQ(convert(reference, frame, false),
+            convert(converter, frame, false));
+}
+
+TEST_P(ColorConverterKernel, BatchMatchesScalarReference) {
+  cs::ColorConverter reference(cs::ColorFormat(), 1, cs::ColorKernel::scalar);
+  cs::ColorConverter converter(cs::ColorFormat(), 2, GetParam());
+  const int width = 19;
+  const int height = 5;
+  const int pitch = 4 * width;
+  std::vector<cs::yuv_frame_view> views;
+  std::vector<RandomFrame> frames;
+  frames.reserve(3);
+  for (int i = 0; i < 3; ++i) {
+    frames.emplace_back(width, height, cs::ChromaLayout::i420, generator);
+  }
+  std::vector<std::vector<uint8_t>> outputs(
+      frames.size(), std::vector<uint8_t>(pitch * height));
+  std::vector<uint8_t *> output_pointers;
+  for (size_t i = 0; i < frames.size(); ++i) {
+    views.push_back(frames[i].view());
+    output_pointers.push_back(outputs[i].data());
+  }
+  converter.convert(views, cs::ChromaLayout::i420, output_pointers, pitch);
+
+  for (size_t i = 0; i < frames.size(); ++i) {
+    std::vector<uint8_t> expected(pitch * height);
+    reference.convert(views[i], cs::ChromaLayout::i420, expected.data(), pitch);
+    EXPECT_EQ(expected, outputs[i]) << "frame " << i;
+  }
+}
+
+std::string kernel_test_name(
+    const testing::TestParamInfo<cs::ColorKernel> &info) {
+  return info.param == cs::ColorKernel::avx2 ? "avx2" : "sse41";
+}
+
+INSTANTIATE_TEST_SUITE_P(SimdKernels, ColorConverterKernel,
+                         testing::Values(cs::ColorKernel::sse41,
+                                         cs::ColorKernel::avx2),
+                         kernel_test_name);
+
+TEST(Y4mHeader, ParsesAllTags) {
+  const cs::Y4mHeader header = cs::parse_y4m_header(
+      "YUV4MPEG2 W352 H288 F30000:1001 It A128:117 C420mpeg2 XYSCSS=420MPEG2 "
+      "XCOLORRANGE=FULL");
+  EXPECT_EQ(352, header.width);
+  EXPECT_EQ(288, header.height);
+  EXPECT_EQ(30000, header.frame_rate_num);
+  EXPECT_EQ(1001, header.frame_rate_den);
+  EXPECT_EQ('t', header.interlacing);
+  EXPECT_EQ(128, header.aspect_num);
+  EXPECT_EQ(117, header.aspect_den);
+  EXPECT_EQ("420mpeg2", header.colorspace);
+  EXPECT_EQ((std::vector<std::string>{"YSCSS=420MPEG2", "COLORRANGE=FULL"}),
+            header.extensions);
+  EXPECT_TRUE(cs::is_y4m_420(header));
+}
+
+TEST(Y4mHeader, AcceptsEveryInterlacingMode) {
+  for (const char mode : {'p', 't', 'b', 'm'}) {
+    const cs::Y4mHeader header = cs::parse_y4m_header(
+        std::string("YUV4MPEG2 W2 H2 I") + mode);
+    EXPECT_EQ(mode, header.interlacing);
+  }
+  EXPECT_THROW(cs::parse_y4m_header("YUV4MPEG2 W2 H2 Ix"),
+               std::invalid_argument);
+  EXPECT_THROW(cs::parse_y4m_header("YUV4MPEG2 W2 H2 Ipt"),
+               std::invalid_argument);
+}
+
+TEST(Y4mHeader, OptionalTagsHaveDefaults) {
+  const cs::Y4mHeader header = cs::parse_y4m_header("YUV4MPEG2 W4 H2");
+  EXPECT_EQ(30, header.frame_rate_num);
+  EXPECT_EQ(1, header.frame_rate_den);
+  EXPECT_EQ('p', header.interlacing);
+  EXPECT_EQ(0, header.aspect_num);
+  EXPECT_EQ(0, header.aspect_den);
+  EXPECT_EQ("420jpeg", header.colorspace);
+  EXPECT_TRUE(header.extensions.empty());
+}
+
+TEST(Y4mHeader, MissingFrameSizeThrows) {
+  EXPECT_THROW(cs::parse_y4m_header("YUV4MPEG2 H2 F25:1"),
+               std::invalid_argument);
+  EXPECT_THROW(cs::parse_y4m_header("YUV4MPEG2 W2 F25:1"),
+               std::invalid_argument);
+  EXPECT_THROW(cs::parse_y4m_header("YUV4MPEG2 W0 H2"), std::invalid_argument);
+  EXPECT_THROW(cs::parse_y4m_header("YUV4MPEG2"), std::invalid_argument);
+}
+
+TEST(Y4mHeader, MalformedTagsThrow) {
+  const std::vector<std::string> lines = {
+      "YUV4MPEG W2 H2",         "YUV4MPEG2 W2x H2",
+      "YUV4MPEG2 W2 H",         "YUV4MPEG2 W2 H2 F25",
+      "YUV4MPEG2 W2 H2 F25:0",  "YUV4MPEG2 W2 H2 F0:1",
+      "YUV4MPEG2 W2 H2 F25:x",  "YUV4MPEG2 W2 H2 F:1",
+      "YUV4MPEG2 W2 H2 A1",     "YUV4MPEG2 W2 H2 A1:1:1",
+      "YUV4MPEG2 W2 H2 Z1"};
+  for (const std::string &line : lines) {
+    EXPECT_THROW(cs::parse_y4m_header(line), std::invalid_argument) << line;
+  }
+}
+
+TEST(Y4mHeader, FormattedHeaderIsParsedBack) {
+  cs::Y4mHeader header;
+  header.width = 64;
+  header.height = 48;
+  header.frame_rate_num = 25;
+  header.interlacing = 'b';
+  header.aspect_num = 1;
+  header.aspect_den = 1;
+  header.extensions = {"VENDOR=1"};
+  const std::string line = cs::format_y4m_header(header);
+  ASSERT_EQ('\n', line.back());
+
+  const cs::Y4mHeader parsed =
+      cs::parse_y4m_header(line.substr(0, line.size() - 1));
+  EXPECT_EQ(header.width, parsed.width);
+  EXPECT_EQ(header.height, parsed.height);
+  EXPECT_EQ(header.frame_rate_num, parsed.frame_rate_num);
+  EXPECT_EQ(header.frame_rate_den, parsed.frame_rate_den);
+  EXPECT_EQ(header.interlacing, parsed.interlacing);
+  EXPECT_EQ(header.aspect_num, parsed.aspect_num);
+  EXPECT_EQ(header.colorspace, parsed.colorspace);
+  EXPECT_EQ(header.extensions, parsed.extensions);
+}
+
+namespace {
+std::vector<uint8_t> bytes(const std::string &text) {
+  return std::vector<uint8_t>(text.begin(), text.end());
+}
+} // namespace
+
+TEST(ReadY4mHeader, ReturnsSizeIncludingNewline) {
+  const std::string line = "YUV4MPEG2 W4 H2 F25:1 Im\n";
+  const std::vector<uint8_t> data = bytes(line + "FRAME\n");
+  cs::Y4mHeader header;
+  EXPECT_EQ(line.size(), cs::read_y4m_header(data.data(), data.size(), header));
+  EXPECT_EQ(4, header.width);
+  EXPECT_EQ('m', header.interlacing);
+}
+
+TEST(ReadY4mHeader, DataWithoutSignatureIsNotY4m) {
+  const std::vector<uint8_t> data = bytes("YUV4MPEG2W4 H2\n");
+  cs::Y4mHeader header;
+  EXPECT_EQ(0u, cs::read_y4m_header(data.data(), data.size(), header));
+  const std::vector<uint8_t> raw(64, 0x10);
+  EXPECT_EQ(0u, cs::read_y4m_header(raw.data(), raw.size(), header));
+}
+
+TEST(ReadY4mHeader, UnterminatedHeaderThrows) {
+  const std::vector<uint8_t> data = bytes("YUV4MPEG2 W4 H2");
+  cs::Y4mHeader header;
+  EXPECT_THROW(cs::read_y4m_header(data.data(), data.size(), header),
+               std::invalid_argument);
+
+  // The newline has to be within the longest accepted header
+  std::vector<uint8_t> long_header =
+      bytes("YUV4MPEG2 W4 H2 X" + std::string(cs::y4m_max_header_size, 'a'));
+  long_header.push_back('\n');
+  EXPECT_THROW(
+      cs::read_y4m_header(long_header.data(), long_header.size(), header),
+      std::invalid_argument);
+}
+
+namespace {
+const uint64_t y4m_frame_size = 12;
+
+// Y4M data of 4x2 I420 frames, each with the given frame line
+std::string y4m_file(const std::vector<std::string> &frame_lines) {
+  std::string file = "YUV4MPEG2 W4 H2\n";
+  char sample = 0;
+  for (const std::string &line : frame_lines) {
+    file += line;
+    for (uint64_t i = 0; i < y4m_frame_size; ++i) {
+      file.push_back(sample++);
+    }
+  }
+  return file;
+}
+
+const uint64_t y4m_first_frame = 16;
+
+// Indexes through both overloads, which have to agree on offsets and errors
+std::vector<uint64_t> index_frames(const std::string &file,
+                                   const int max_frames = 0) {
+  const std::vector<uint8_t> data = bytes(file);
+  std::vector<uint64_t> mapped;
+  bool mapped_throws = false;
+  try {
+    mapped = cs::index_y4m_frames(data.data(), data.size(), y4m_first_frame,
+                                  y4m_frame_size, max_frames);
+  } catch (const std::invalid_argument &) {
+    mapped_throws = true;
+  }
+
+  std::istringstream stream(file);
+  std::vector<uint64_t> streamed;
+  bool stream_throws = false;
+  try {
+    streamed = cs::index_y4m_frames(stream, file.size(), y4m_first_frame,
+                                    y4m_frame_size, max_frames);
+  } catch (const std::invalid_argument &) {
+    stream_throws = true;
+  }
+
+  EXPECT_EQ(mapped_throws, stream_throws);
+  EXPECT_EQ(mapped, streamed);
+  if (mapped_throws) {
+    throw std::invalid_argument("Y4M file is invalid");
+  }
+  return mapped;
+}
+} // namespace
+
+TEST(IndexY4mFrames, FindsPayloadOfEveryFrame) {
+  const std::vector<uint64_t> expected = {22, 40, 58};
+  EXPECT_EQ(expected,
+            index_frames(y4m_file({"FRAME\n", "FRAME\n", "FRAME\n"})));
+}
+
+TEST(IndexY4mFrames, SkipsFrameParameters) {
+  const std::vector<uint64_t> expected = {22, 46};
+  EXPECT_EQ(expected, index_frames(y4m_file({"FRAME\n", "FRAME Ib X1\n"})));
+}
+
+TEST(IndexY4mFrames, StopsAfterMaxFrames) {
+  const std::vector<uint64_t> expected = {22, 40};
+  EXPECT_EQ(expected,
+            index_frames(y4m_file({"FRAME\n", "FRAME\n", "FRAME\n"}), 2));
+}
+
+TEST(IndexY4mFrames, FileWithoutFramesIsEmpty) {
+  EXPECT_TRUE(index_frames(y4m_file({})).empty());
+}
+
+TEST(IndexY4mFrames, MissingFrameMarkerThrows) {
+  EXPECT_THROW(index_frames(y4m_file({"FRAME\n", "FRAMX\n"})),
+               std::invalid_argument);
+  EXPECT_THROW(index_frames(y4m_file({"FRAME\n", "\n"})),
+               std::invalid_argument);
+  // Trailing bytes too short for a marker
+  EXPECT_THROW(index_frames(y4m_file({"FRAME\n"}) + "FRA"),
+               std::invalid_argument);
+}
+
+TEST(IndexY4mFrames, MarkerFollowedByOtherCharacterThrows) {
+  EXPECT_THROW(index_frames(y4m_file({"FRAME\n", "FRAMES\n"})),
+               std::invalid_argument);
+  EXPECT_THROW(index_frames(y4m_file({"FRAMEIp\n"})), std::invalid_argument);
+  EXPECT_THROW(index_frames(y4m_file({"FRAME\tIp\n"})),
+               std::invalid_argument);
+}
+
+TEST(IndexY4mFrames, LongFrameMarkerThrows) {
+  const std::string parameters(2000, 'X');
+  EXPECT_THROW(index_frames(y4m_file({"FRAME " + parameters + "\n"})),
+               std::invalid_argument);
+  // Marker without a newline before the end of the file
+  EXPECT_THROW(index_frames(y4m_file({"FRAME\n"}) + "FRAME Ip"),
+               std::invalid_argument);
+}
+
+TEST(IndexY4mFrames, TruncatedLastFrameThrows) {
+  const std::string file = y4m_file({"FRAME\n", "FRAME\n"});
+  EXPECT_THROW(index_frames(file.substr(0, file.size() - 1)),
+               std::invalid_argument);
+  EXPECT_THROW(index_frames(y4m_file({"FRAME\n"}) + "FRAME\n"),
+               std::invalid_argument);
+}
+
+namespace {
+cs::PlanarImage random_image(const cs::PlanarFormat format,
+                             std::mt19937 &generator) {
+  // Width is not a multiple of the SIMD block, rows are padded
+  const int width = 38;
+  const int height = 6;
+  const int pitch = width * cs::bytes_per_sample(format) + 10;
+  cs::PlanarImage image(width, height, pitch, format);
+  std::uniform_int_distribution<int> distribution(0, 255);
+  uint8_t *data = image.get_y();
+  for (size_t i = 0; i < image.get_size_in_bytes(); ++i) {
+    data[i] = static_cast<uint8_t>(distribution(generator));
+  }
+  if (format == cs::PlanarFormat::p010) {
+    // Only the high byte of P010 samples survives conversion to 8 bits
+    for (size_t i = 0; i < image.get_size_in_bytes(); i += 2) {
+      data[i] = 0;
+    }
+  }
+  return image;
+}
+
+// Samples of the visible area, in I420 plane order
+std::vector<uint8_t> samples(const cs::PlanarImage &image) {
+  const cs::yuv_frame_view view = image.view();
+  const int sample = cs::bytes_per_sample(image.get_format());
+  const bool i420 = image.get_format() == cs::PlanarFormat::i420;
+  std::vector<uint8_t> result;
+  for (int y = 0; y < view.height; ++y) {
+    const uint8_t *row = view.y + y * view.pitch_y;
+    result.insert(result.end(), row, row + view.width * sample);
+  }
+  for (int y = 0; y < view.height / 2; ++y) {
+    const uint8_t *row = view.u + y * view.pitch_u;
+    result.insert(result.end(), row,
+                  row + (i420 ? view.width / 2 : view.width * sample));
+  }
+  for (int y = 0; i420 && y < view.height / 2; ++y) {
+    const uint8_t *row = view.v + y * view.pitch_v;
+    result.insert(result.end(), row, row + view.width / 2);
+  }
+  return result;
+}
+
+cs::PlanarImage converted(const cs::PlanarImage &image,
+                          const cs::PlanarFormat format) {
+  cs::PlanarImage result(image.get_width(), image.get_height(), 0, format);
+  cs::convert_planar(image.view(), image.get_format(), result);
+  return result;
+}
+} // namespace
+
+TEST(ConvertPlanar, RoundTripsKeepSamples) {
+  const std::vector<cs::PlanarFormat> formats = {
+      cs::PlanarFormat::i420, cs::PlanarFormat::nv12, cs::PlanarFormat::p010};
+  std::mt19937 generator(2020);
+  for (const cs::PlanarFormat from : formats) {
+    for (const cs::PlanarFormat to : formats) {
+      const cs::PlanarImage image = random_image(from, generator);
+      const cs::PlanarImage round_trip = converted(converted(image, to), from);
+      EXPECT_EQ(samples(image), samples(round_trip))
+          << static_cast<int>(from) << " to " << static_cast<int>(to);
+    }
+  }
+}
+
+TEST(ConvertPlanar, InterleavesAndWidensChroma) {
+  cs::PlanarImage i420(2, 2, 0, cs::PlanarFormat::i420);
+  i420.get_y()[0] = 1;
+  i420.get_y()[1] = 2;
+  i420.get_y()[2] = 3;
+  i420.get_y()[3] = 4;
+  i420.get_u()[0] = 5;
+  i420.get_v()[0] = 6;
+
+  const cs::PlanarImage nv12 = converted(i420, cs::PlanarFormat::nv12);
+  EXPECT_EQ((std::vector<uint8_t>{1, 2, 3, 4, 5, 6}), samples(nv12));
+  const cs::PlanarImage p010 = converted(nv12, cs::PlanarFormat::p010);
+  EXPECT_EQ((std::vector<uint8_t>{0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6}),
+            samples(p010));
+}
+
+TEST(ConvertPlanar, RoundsP010ToNearest8BitSample) {
+  cs::PlanarImage p010(2, 2, 0, cs::PlanarFormat::p010);
+  uint16_t *y = reinterpret_cast<uint16_t *>(p010.get_y());
+  y[0] = 0x127f;
+  y[1] = 0x1280;
+  y[2] = 0xff80;
+  y[3] = 0x0000;
+  uint16_t *uv = reinterpret_cast<uint16_t *>(p010.get_uv());
+  uv[0] = 0x8040;
+  uv[1] = 0x80c0;
+
+  const cs::PlanarImage i420 = converted(p010, cs::PlanarFormat::i420);
+  EXPECT_EQ((std::vector<uint8_t>{0x12, 0x13, 0xff, 0x00, 0x80, 0x81}),
+            samples(i420));
+}
+
+TEST(ConvertPlanar, SizeMismatchThrows) {
+  const cs::PlanarImage source(4, 2, 0, cs::PlanarFormat::i420);
+  cs::PlanarImage destination(2, 2, 0, cs::PlanarFormat::nv12);
+  EXPECT_THROW(
+      cs::convert_planar(source.view(), cs::PlanarFormat::i420, destination),
+      std::invalid_argument);
+}
+
+namespace {
+// Macroblock data of a frame, intra shapes and residuals are empty for
+// overlays of motion vectors only
+struct motion_vector_data {
+  std::vector<cs::motion_vector> mvs;
+  std::vector<cs::inter_shape> inter_shapes;
+  std::vector<cs::intra_shape> intra_shapes;
+  std::vector<cs::residual> inter_residuals;
+  std::vector<cs::residual> intra_residuals;
+};
+
+// Vectors reach up to max_vector quarter pixels, far beyond the frame for
+// large values
+motion_vector_data random_vectors(const int width, const int height,
+                                  const int max_vector, const bool intra,
+                                  std::mt19937 &generator) {
+  const size_t macroblocks =
+      static_cast<size_t>((width + 15) / 16) * ((height + 15) / 16);
+  std::uniform_int_distribution<int> vector(-max_vector, max_vector);
+  std::uniform_int_distribution<int> byte(0, 255);
+  motion_vector_data data;
+  data.mvs.resize(macroblocks * 16);
+  for (cs::motion_vector &mv : data.mvs) {
+    mv.x = static_cast<int16_t>(vector(generator));
+    mv.y = static_cast<int16_t>(vector(generator));
+  }
+  data.inter_shapes.resize(macroblocks);
+  for (cs::inter_shape &shape : data.inter_shapes) {
+    shape.x = static_cast<uint8_t>(byte(generator) % 4);
+    shape.y = static_cast<uint8_t>(byte(generator));
+  }
+  if (intra) {
+    for (size_t i = 0; i < macroblocks; ++i) {
+      data.intra_shapes.push_back(static_cast<uint8_t>(byte(generator) % 3));
+      data.inter_residuals.push_back(static_cast<uint16_t>(byte(generator)));
+      data.intra_residuals.push_back(static_cast<uint16_t>(byte(generator)));
+    }
+  }
+  return data;
+}
+
+// Serial renderer which VectorOverlay replaced. Every pixel of every line is
+// tested against the frame, so it serves as the reference for clipping.
+class ReferenceOverlay {
+public:
+  ReferenceOverlay(const int width, const int height)
+      : width_(width), height_(height),
+        data_(static_cast<size_t>(width) * height) {}
+
+  void render(const motion_vector_data &data) {
+    const int mb_width = (width_ + 15) / 16;
+    const int mb_height = (height_ + 15) / 16;
+    for (int i = 0; i < mb_height; ++i) {
+      for (int j = 0; j < mb_width; ++j) {
+        const int mb_index = j + i * mb_width;
+        const cs::motion_vector *mvs = data.mvs.data() + mb_index * 16;
+        if (data.intra_shapes.empty()) {
+          draw_inter(mvs, data.inter_shapes[mb_index], j * 16, i * 16, true);
+        } else if (data.inter_residuals[mb_index] <
+                   data.intra_residuals[mb_index]) {
+          draw_inter(mvs, data.inter_shapes[mb_index], j * 16, i * 16, false);
+        } else {
+          draw_intra(data.intra_shapes[mb_index], j * 16, i * 16);
+        }
+      }
+    }
+  }
+
+  const std::vector<uint8_t> &data() const { return data_; }
+
+private:
+  void draw_pixel(const int32_t x, const int32_t y) {
+    if (x < 0 || x >= width_ || y < 0 || y >= height_) {
+      return;
+    }
+    data_[static_cast<size_t>(y) * width_ + x] = 180;
+  }
+
+  // Bresenham's line algorithm
+  void draw_line(int32_t x0, int32_t y0, const int32_t dx, const int32_t dy) {
+    using std::swap;
+    int32_t x1 = x0 + dx;
+    int32_t y1 = y0 + dy;
+    const bool b_steep = std::abs(dy) > std::abs(dx);
+    if (b_steep) {
+      swap(x0, y0);
+      swap(x1, y1);
+    }
+    if (x0 > x1) {
+      swap(x0, x1);
+      swap(y0, y1);
+    }
+    const int32_t delta_x = x1 - x0;
+    const int32_t delta_y = std::abs(y1 - y0);
+    int32_t error = delta_x / 2;
+    const int32_t y_step = y0 < y1 ? 1 : -1;
+    for (; x0 <= x1; ++x0) {
+      if (b_steep) {
+        draw_pixel(y0, x0);
+      } else {
+        draw_pixel(x0, y0);
+      }
+      error -= delta_y;
+      if (error < 0) {
+        y0 += y_step;
+        error += delta_x;
+      }
+    }
+  }
+
+  void draw_vector(const int32_t x0, const int32_t y0,
+                   const cs::motion_vector &mv) {
+    draw_line(x0, y0, (mv.x + 2) >> 2, (mv.y + 2) >> 2);
+  }
+
+  void draw_inter(const cs::motion_vector *mvs, const cs::inter_shape shape,
+                  const int j0, const int i0, const bool draw_8x8) {
+    switch (shape.x) {
+    case 0:
+      draw_vector(j0 + 8, i0 + 8, mvs[0]);
+      break;
+    case 1:
+      draw_vector(j0 + 8, i0 + 4, mvs[0]);
+      draw_vector(j0 + 8, i0 + 12, mvs[8]);
+      break;
+    case 2:
+      draw_vector(j0 + 4, i0 + 8, mvs[0]);
+      draw_vector(j0 + 12, i0 + 8, mvs[8]);
+      break;
+    case 3:
+      for (int m = 0; m < 4; ++m) {
+        const int x = j0 + (m % 2) * 8;
+        const int y = i0 + (m / 2) * 8;
+        switch ((shape.y >> (2 * m)) & 0x03) {
+        case 0:
+          if (draw_8x8) {
+            draw_vector(x + 4, y + 4, mvs[m * 4]);
+          }
+          break;
+        case 1:
+          draw_vector(x + 4, y + 2, mvs[m * 4]);
+          draw_vector(x + 4, y + 6, mvs[m * 4 + 2]);
+          break;
+        case 2:
+          draw_vector(x + 2, y + 4, mvs[m * 4]);
+          draw_vector(x + 6, y + 4, mvs[m * 4 + 2]);
+          break;
+        case 3:
+          for (int n = 0; n < 4; ++n) {
+            draw_vector(j0 + n * 4 + 2, i0 + m * 4 + 2, mvs[m * 4 + n]);
+          }
+          break;
+        }
+      }
+      break;
+    }
+  }
+
+  void draw_intra(const cs::intra_shape shape, const int j0, const int i0) {
+    draw_line(j0, i0, 16, 0);
+    draw_line(j0, i0, 0, 16);
+    draw_line(j0 + 16, i0, 0, 16);
+    draw_line(j0, i0 + 16, 16, 0);
+    if (shape >= 1) {
+      draw_line(j0 + 8, i0, 0, 16);
+      draw_line(j0, i0 + 8, 16, 0);
+    }
+    if (shape == 2) {
+      draw_line(j0 + 4, i0, 0, 16);
+      draw_line(j0 + 12, i0, 0, 16);
+      draw_line(j0, i0 + 4, 16, 0);
+      draw_line(j0, i0 + 12, 16, 0);
+    }
+  }
+
+  int width_;
+  int height_;
+  std::vector<uint8_t> data_;
+};
+
+std::vector<uint8_t> render(cs::VectorOverlay &overlay,
+                            const motion_vector_data &data, const int width,
+                            const int height) {
+  cs::OverlayPlane plane(width, height);
+  if (data.intra_shapes.empty()) {
+    overlay.render(data.mvs.data(), data.inter_shapes.data(), plane.plane());
+  } else {
+    overlay.render(data.mvs.data(), data.inter_shapes.data(),
+                   data.intra_shapes.data(), data.inter_residuals.data(),
+                   data.intra_residuals.data(), plane.plane());
+  }
+  const cs::overlay_plane view = plane.plane();
+  return std::vector<uint8_t>(view.data,
+                              view.data + static_cast<size_t>(width) * height);
+}
+
+std::vector<uint8_t> reference_render(const motion_vector_data &data,
+                                      const int width, const int height) {
+  ReferenceOverlay reference(width, height);
+  reference.render(data);
+  return reference.data();
+}
+} // namespace
+
+TEST(VectorOverlay, MatchesSerialRendererOnRandomVectors) {
+  std::mt19937 generator(2020);
+  // Frame sizes include partial macroblocks, vector lengths reach from
+  // within a macroblock to far outside the frame
+  const std::vector<std::pair<int, int>> sizes = {
+      {64, 48}, {100, 70}, {17, 33}};
+  for (const int threads : {1, 3}) {
+    cs::VectorOverlay overlay(threads);
+    for (const std::pair<int, int> &size : sizes) {
+      for (const int max_vector : {32, 512, 8000}) {
+        for (const bool intra : {false, true}) {
+          const motion_vector_data data = random_vectors(
+              size.first, size.second, max_vector, intra, generator);
+          EXPECT_EQ(reference_render(data, size.first, size.second),
+                    render(overlay, data, size.first, size.second))
+              << size.first << "x" << size.second << ", vectors up to "
+              << max_vector << ", " << threads << " threads"
+              << (intra ? ", intra" : "");
+        }
+      }
+    }
+  }
+}
+
+TEST(VectorOverlay, LinesCrossingTileBoundariesMatchSerialRenderer) {
+  // With 4 threads every macroblock row is a tile of its own, so long steep
+  // lines are clipped by many tiles
+  const int width = 48;
+  const int height = 160;
+  cs::VectorOverlay overlay(4);
+  std::mt19937 generator(2020);
+  motion_vector_data data = random_vectors(width, height, 0, false, generator);
+  std::uniform_int_distribution<int> length(-4 * height, 4 * height);
+  std::uniform_int_distribution<int> slant(-64, 64);
+  for (cs::inter_shape &shape : data.inter_shapes) {
+    shape.x = 0;
+  }
+  for (size_t i = 0; i < data.mvs.size(); i += 16) {
+    data.mvs[i].x = static_cast<int16_t>(slant(generator));
+    data.mvs[i].y = static_cast<int16_t>(length(generator));
+  }
+  EXPECT_EQ(reference_render(data, width, height),
+            render(overlay, data, width, height));
+}
+
+TEST(VectorOverlay, ExtremeVectorsMatchSerialRenderer) {
+  const int width = 40;
+  const int height = 40;
+  const int16_t low = std::numeric_limits<int16_t>::min();
+  const int16_t high = std::numeric_limits<int16_t>::max();
+  const std::vector<cs::motion_vector> extremes = {
+      {low, low}, {high, high}, {low, high}, {high, low},
+      {0, low},   {high, 0},    {low, 3},    {-5, high}, {1, 0}};
+  cs::VectorOverlay overlay(2);
+  std::mt19937 generator(2020);
+  motion_vector_data data = random_vectors(width, height, 0, false, generator);
+  for (size_t i = 0; i < data.mvs.size(); ++i) {
+    data.mvs[i] = extremes[i % extremes.size()];
+  }
+  EXPECT_EQ(reference_render(data, width, height),
+            render(overlay, data, width, height));
+}
+
+namespace {
+const cs::FrameStage frame_stages[] = {
+    cs::FrameStage::read,     cs::FrameStage::upload,
+    cs::FrameStage::compute,  cs::FrameStage::readback,
+    cs::FrameStage::overlay,  cs::FrameStage::write};
+
+// Records the stages every frame went through and the frames occupying each
+// slot, while stages sleep for varying times to let frames overlap
+class PipelineRecorder {
+public:
+  PipelineRecorder(cs::FramePipeline &pipeline, const int frame_count)
+      : pipeline_(pipeline), stages_(frame_count),
+        slot_frames_(pipeline.slot_count(), -1) {
+    for (const cs::FrameStage stage : frame_stages) {
+      pipeline.set_stage(stage, [this, stage](int frame_idx, int slot) {
+        record(stage, frame_idx, slot);
+      });
+    }
+  }
+
+  const std::vector<std::vector<cs::FrameStage>> &stages() const {
+    return stages_;
+  }
+  int max_frames_in_flight() const { return max_frames_in_flight_; }
+  const std::vector<std::string> &errors() const { return errors_; }
+
+private:
+  void record(const cs::FrameStage stage, const int frame_idx,
+              const int slot) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stages_[frame_idx].push_back(stage);
+      if (slot != pipeline_.slot(frame_idx)) {
+        errors_.push_back("frame " + std::to_string(frame_idx) +
+                          " got slot " + std::to_string(slot));
+      }
+      if (stage == cs::FrameStage::read) {
+        if (slot_frames_[slot] != -1) {
+          errors_.push_back("frame " + std::to_string(frame_idx) +
+                            " reuses the slot of frame " +
+                            std::to_string(slot_frames_[slot]));
+        }
+        slot_frames_[slot] = frame_idx;
+        ++frames_in_flight_;
+        max_frames_in_flight_ =
+            std::max(max_frames_in_flight_, frames_in_flight_);
+      }
+      if (stage == cs::FrameStage::compute && frame_idx > 0 &&
+          slot_frames_[pipeline_.slot(frame_idx - 1)] != frame_idx - 1 &&
+          slot_frames_[pipeline_.slot(frame_idx - 1)] != -1) {
+        errors_.push_back("reference of frame " + std::to_string(frame_idx) +
+                          " was overwritten");
+      }
+    }
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(50 * ((frame_idx * 7 + slot * 3) % 5)));
+    if (stage == cs::FrameStage::write) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slot_frames_[slot] = -1;
+      --frames_in_flight_;
+    }
+  }
+
+  cs::FramePipeline &pipeline_;
+  std::vector<std::vector<cs::FrameStage>> stages_;
+  std::vector<int> slot_frames_;
+  int frames_in_flight_ = 0;
+  int max_frames_in_flight_ = 0;
+  std::vector<std::string> errors_;
+  std::mutex mutex_;
+};
+} // namespace
+
+TEST(FramePipeline, InvalidDepthThrows) {
+  EXPECT_THROW(cs::FramePipeline(0), std::invalid_argument);
+}
+
+TEST(FramePipeline, FramesPassStagesInOrder) {
+  const int frame_count = 12;
+  cs::FramePipeline pipeline(3);
+  PipelineRecorder recorder(pipeline, frame_count);
+  pipeline.run(frame_count);
+
+  const std::vector<cs::FrameStage> expected(std::begin(frame_stages),
+                                             std::end(frame_stages));
+  for (int frame_idx = 0; frame_idx < frame_count; ++frame_idx) {
+    EXPECT_EQ(expected, recorder.stages()[frame_idx]) << frame_idx;
+  }
+  EXPECT_TRUE(recorder.errors().empty()) << recorder.errors().front();
+}
+
+TEST(FramePipeline, SlotsAreNotReusedBeforeWriteFinishes) {
+  const int frame_count = 40;
+  cs::FramePipeline pipeline(2);
+  PipelineRecorder recorder(pipeline, frame_count);
+  pipeline.run(frame_count);
+
+  EXPECT_TRUE(recorder.errors().empty()) << recorder.errors().front();
+  EXPECT_LE(recorder.max_frames_in_flight(), pipeline.depth());
+}
+
+TEST(FramePipeline, EveryDepthProcessesAllFrames) {
+  for (int depth = 1; depth <= 8; ++depth) {
+    for (const int frame_count : {0, 1, depth, 3 * depth + 1}) {
+      cs::FramePipeline pipeline(depth);
+      EXPECT_EQ(depth + 1, pipeline.slot_count());
+      PipelineRecorder recorder(pipeline, frame_count);
+      pipeline.run(frame_count);
+
+      for (int frame_idx = 0; frame_idx < frame_count; ++frame_idx) {
+        EXPECT_EQ(static_cast<size_t>(cs::frame_stage_count),
+                  recorder.stages()[frame_idx].size())
+            << "depth " << depth << ", frame " << frame_idx;
+      }
+      EXPECT_LE(recorder.max_frames_in_flight(), depth) << depth;
+      EXPECT_TRUE(recorder.errors().empty())
+          << "depth " << depth << ": " << recorder.errors().front();
+    }
+  }
+}
+
+TEST(FramePipeline, StagesWithoutFunctionAreSkipped) {
+  cs::FramePipeline pipeline(2);
+  std::vector<int> written;
+  pipeline.set_stage(cs::FrameStage::write,
+                     [&](int frame_idx, int) { written.push_back(frame_idx); });
+  pipeline.run(5);
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4}), written);
+}
+
+TEST(FramePipeline, StageExceptionIsRethrownByRun) {
+  for (const cs::FrameStage stage : frame_stages) {
+    cs::FramePipeline pipeline(3);
+    int written = 0;
+    pipeline.set_stage(stage, [](int frame_idx, int) {
+      if (frame_idx == 4) {
+        throw std::runtime_error("stage failed");
+      }
+    });
+    if (stage != cs::FrameStage::write) {
+      pipeline.set_stage(cs::FrameStage::write,
+                         [&](int, int) { ++written; });
+    }
+    EXPECT_THROW(pipeline.run(100), std::runtime_error)
+        << cs::FramePipeline::stage_name(stage);
+    EXPECT_LT(written, 100);
+  }
+}
+
+TEST(FramePipeline, RunsAgainAfterFailure) {
+  cs::FramePipeline pipeline(2);
+  bool fail = true;
+  int written = 0;
+  pipeline.set_stage(cs::FrameStage::compute, [&](int, int) {
+    if (fail) {
+      throw std::runtime_error("stage failed");
+    }
+  });
+  pipeline.set_stage(cs::FrameStage::write, [&](int, int) { ++written; });
+  EXPECT_THROW(pipeline.run(10), std::runtime_error);
+  fail = false;
+  written = 0;
+  pipeline.run(10);
+  EXPECT_EQ(10, written);
+}
@@ -7,6 +7,7 @@
 
 #include "gmock/gmock.h"
 #include "logging/logging.hpp"
+#include "ocl_utils/program_registry.hpp"
 #include "test_harness/test_harness.hpp"
 
 int main(int argc, char **argv) {
@@ -14,5 +15,7 @@ int main(int argc, char **argv) {
   std::vector<std::string> command_line(argv + 1, argv + argc);
   compute_samples::init_logging(command_line);
   compute_samples::init_test_harness(command_line);
-  return RUN_ALL_TESTS();
+  const int result = RUN_ALL_TESTS();
+  compute_samples::ProgramRegistry::instance().log_statistics();
+  return result;
 }
@@ -10,11 +10,16 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "ocl_utils/ocl_utils.hpp"
+#include "ocl_utils/program_registry.hpp"
 
 #include <boost/compute/core.hpp>
 #include <boost/compute/utility.hpp>
 namespace compute = boost::compute;
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "logging/logging.hpp"
 #include "utils/utils.hpp"
 #include "test_harness/test_harness.hpp"
@@ -23,7 +28,77 @@ namespace cs = compute_samples;
 
 namespace {
 
-HWTEST(TestCLVisaInjectionRtBasic, TemplateEmpty) {
+// Programs built with default options, by the tests using them
+const std::vector<std::pair<std::string, std::string>> test_programs = {
+    {"TemplateEmpty", "test_cl_visa_injection_rt_basic_template_empty.cl"},
+    {"TemplateNoOperands",
+     "test_cl_visa_injection_rt_basic_template_no_operands.cl"},
+    {"TemplateOperandsWithArbitraryOrder",
+     "test_cl_visa_injection_rt_basic_template_operands_ao.cl"},
+    {"TemplateNoInputs",
+     "test_cl_visa_injection_rt_basic_template_no_inputs.cl"},
+    {"TemplateNoOutputs",
+     "test_cl_visa_injection_rt_basic_template_no_outputs.cl"},
+    {"TemplateMultipleInstructions",
+     "test_cl_visa_injection_rt_basic_template_mltpl_insts.cl"},
+    {"TemplateVariableDeclaration",
+     "test_cl_visa_injection_rt_basic_template_var_decl.cl"},
+    {"TemplateVariableScope",
+     "test_cl_visa_injection_rt_basic_template_var_scope.cl"},
+    {"ConstraintsSameInputOutputWithPlus",
+     "test_cl_visa_injection_rt_basic_constraints_same_io.cl"},
+    {"ConstraintsSameInputOutputWithEqual",
+     "test_cl_visa_injection_rt_basic_constraints_same_io.cl"},
+    {"ConstraintsSingleInput",
+     "test_cl_visa_injection_rt_basic_constraints_single_input.cl"},
+    {"ConstraintsMultipleInputs",
+     "test_cl_visa_injection_rt_basic_constraints_multiple_inputs.cl"},
+    {"ConstraintsSingleOutput",
+     "test_cl_visa_injection_rt_basic_constraints_single_output.cl"},
+    {"ConstraintsMultipleOutputs",
+     "test_cl_visa_injection_rt_basic_constraints_multiple_outputs.cl"},
+    {"ConstraintsLoadStorePointer",
+     "test_cl_visa_injection_rt_basic_constraints_load_store_pointer.cl"},
+    {"ConstraintsFloat",
+     "test_cl_visa_injection_rt_basic_constraints_float.cl"},
+    {"FunctionBody", "test_cl_visa_injection_rt_basic_func_body.cl"},
+    {"PragmaUnroll", "test_cl_visa_injection_rt_basic_pragma_unroll.cl"},
+    {"WholeKernel", "test_cl_visa_injection_rt_basic_median_filter.cl"},
+    {"WholeKernel", "test_cl_visa_injection_rt_basic_whole_kernel.cl"},
+    {"SingleBasicBlock", "test_cl_visa_injection_rt_basic_median_filter.cl"},
+    {"SingleBasicBlock",
+     "test_cl_visa_injection_rt_basic_single_basic_block.cl"},
+    {"Region", "test_cl_visa_injection_rt_basic_median_filter.cl"},
+    {"Region", "test_cl_visa_injection_rt_basic_region.cl"},
+    {"ForLoop", "test_cl_visa_injection_rt_basic_median_filter.cl"},
+    {"ForLoop", "test_cl_visa_injection_rt_basic_for_loop.cl"},
+};
+
+// The programs of the tests selected to run are built concurrently before
+// the first test, which finds them in the registry
+class TestCLVisaInjectionRtBasic : public testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    const testing::TestSuite *suite =
+        testing::UnitTest::GetInstance()->current_test_suite();
+    std::vector<std::string> files;
+    for (int i = 0; i < suite->total_test_count(); ++i) {
+      const testing::TestInfo *info = suite->GetTestInfo(i);
+      if (!info->should_run()) {
+        continue;
+      }
+      for (const auto &program : test_programs) {
+        if (info->name() == program.first + "_HWTEST") {
+          files.push_back(program.second);
+        }
+      }
+    }
+    cs::ProgramRegistry::instance().warm_up(compute::system::default_context(),
+                                            files);
+  }
+};
+
+HWTEST_F(TestCLVisaInjectionRtBasic, TemplateEmpty) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -42,7 +117,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateEmpty) {
   compute::buffer out_buffer(context, cs::size_in_bytes(data),
                              compute::memory_object::write_only);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_template_empty.cl");
 
   compute::kernel kernel0 = program.create_kernel("test_template_empty0");
@@ -78,7 +153,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateEmpty) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, TemplateNoOperands) {
+HWTEST_F(TestCLVisaInjectionRtBasic, TemplateNoOperands) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -97,7 +172,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateNoOperands) {
   compute::buffer out_buffer(context, cs::size_in_bytes(data),
                              compute::memory_object::write_only);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_template_no_operands.cl");
 
   compute::kernel kernel0 = program.create_kernel("test_template_no_operands0");
@@ -133,7 +208,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateNoOperands) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, TemplateOperandsWithArbitraryOrder) {
+HWTEST_F(TestCLVisaInjectionRtBasic, TemplateOperandsWithArbitraryOrder) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -152,7 +227,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateOperandsWithArbitraryOrder) {
   compute::buffer out_buffer(context, cs::size_in_bytes(data),
                              compute::memory_object::write_only);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_template_operands_ao.cl");
 
   compute::kernel kernel =
@@ -175,7 +250,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateOperandsWithArbitraryOrder) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, TemplateNoInputs) {
+HWTEST_F(TestCLVisaInjectionRtBasic, TemplateNoInputs) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -184,7 +259,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateNoInputs) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::write_only);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_template_no_inputs.cl");
 
   compute::kernel kernel = program.create_kernel("test_template_no_inputs");
@@ -206,7 +281,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateNoInputs) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, TemplateNoOutputs) {
+HWTEST_F(TestCLVisaInjectionRtBasic, TemplateNoOutputs) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -215,7 +290,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateNoOutputs) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::write_only);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_template_no_outputs.cl");
 
   compute::kernel kernel = program.create_kernel("test_template_no_outputs");
@@ -237,14 +312,14 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateNoOutputs) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, TemplateMultipleInstructions) {
+HWTEST_F(TestCLVisaInjectionRtBasic, TemplateMultipleInstructions) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
   const int seed = 0;
 
   auto s1 = cs::generate_vector<int>(size, seed);
-  auto s2 = cs::generate_vector<int>(size, seed);
+  auto s2 = cs::generate_vector<int>(size, seed + 1);
 
   const compute::context context = compute::system::default_context();
 
@@ -259,7 +334,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateMultipleInstructions) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::write_only);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_template_mltpl_insts.cl");
 
   compute::kernel kernel = program.create_kernel("test_template_mltpl_insts");
@@ -281,14 +356,14 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateMultipleInstructions) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, TemplateVariableDeclaration) {
+HWTEST_F(TestCLVisaInjectionRtBasic, TemplateVariableDeclaration) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
   const int seed = 0;
 
   auto s1 = cs::generate_vector<int>(size, seed);
-  auto s2 = cs::generate_vector<int>(size, seed);
+  auto s2 = cs::generate_vector<int>(size, seed + 1);
 
   const compute::context context = compute::system::default_context();
 
@@ -303,7 +378,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateVariableDeclaration) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::write_only);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_template_var_decl.cl");
 
   compute::kernel kernel = program.create_kernel("test_template_var_decl");
@@ -325,14 +400,14 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateVariableDeclaration) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, TemplateVariableScope) {
+HWTEST_F(TestCLVisaInjectionRtBasic, TemplateVariableScope) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
   const int seed = 0;
 
   auto s1 = cs::generate_vector<int>(size, seed);
-  auto s2 = cs::generate_vector<int>(size, seed);
+  auto s2 = cs::generate_vector<int>(size, seed + 1);
 
   const compute::context context = compute::system::default_context();
 
@@ -347,7 +422,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateVariableScope) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::write_only);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_template_var_scope.cl");
 
   compute::kernel kernel = program.create_kernel("test_template_var_scope");
@@ -369,7 +444,7 @@ HWTEST(TestCLVisaInjectionRtBasic, TemplateVariableScope) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSameInputOutputWithPlus) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsSameInputOutputWithPlus) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -382,7 +457,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSameInputOutputWithPlus) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_constraints_same_io.cl");
 
   compute::kernel kernel =
@@ -406,7 +481,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSameInputOutputWithPlus) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSameInputOutputWithEqual) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsSameInputOutputWithEqual) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -419,7 +494,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSameInputOutputWithEqual) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_constraints_same_io.cl");
 
   compute::kernel kernel =
@@ -443,13 +518,13 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSameInputOutputWithEqual) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsImmediateOperand) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsImmediateOperand) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
   const int seed = 0;
 
-  const auto const_argument = cs::generate_value<uint32_t>(seed);
+  const auto const_argument = cs::generate_value<uint32_t>(seed + 1);
   auto dst = cs::generate_vector<int>(size, seed);
 
   const compute::context context = compute::system::default_context();
@@ -490,7 +565,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsImmediateOperand) {
   if (check_supported_subgroup_size(8)) {
     kernel = program.create_kernel("test_constraints_immediate_simd8");
 
-    auto src = cs::generate_vector<int>(size, seed);
+    auto src = cs::generate_vector<int>(size, seed + 1);
     compute::buffer in_buffer(context, cs::size_in_bytes(src),
                               compute::memory_object::read_only |
                                   compute::memory_object::use_host_ptr,
@@ -515,7 +590,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsImmediateOperand) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSingleInput) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsSingleInput) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -528,7 +603,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSingleInput) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_constraints_single_input.cl");
 
   compute::kernel kernel =
@@ -549,7 +624,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSingleInput) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsMultipleInputs) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsMultipleInputs) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -572,7 +647,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsMultipleInputs) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context,
       "test_cl_visa_injection_rt_basic_constraints_multiple_inputs.cl");
 
@@ -597,7 +672,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsMultipleInputs) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSingleOutput) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsSingleOutput) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -610,7 +685,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSingleOutput) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_constraints_single_output.cl");
 
   compute::kernel kernel =
@@ -634,7 +709,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsSingleOutput) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsMultipleOutputs) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsMultipleOutputs) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -647,7 +722,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsMultipleOutputs) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context,
       "test_cl_visa_injection_rt_basic_constraints_multiple_outputs.cl");
 
@@ -678,7 +753,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsMultipleOutputs) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsLoadStorePointer) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsLoadStorePointer) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -696,7 +771,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsLoadStorePointer) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context,
       "test_cl_visa_injection_rt_basic_constraints_load_store_pointer.cl");
 
@@ -721,7 +796,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsLoadStorePointer) {
   }
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ConstraintsFloat) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ConstraintsFloat) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -739,7 +814,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ConstraintsFloat) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_constraints_float.cl");
 
   compute::kernel kernel = program.create_kernel("test_constraints_float");
@@ -772,7 +847,7 @@ compute::buffer create_input_buffer(const compute::context &context, T &data) {
                          data.data());
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, FunctionBody) {
+HWTEST_F(TestCLVisaInjectionRtBasic, FunctionBody) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -793,7 +868,7 @@ HWTEST(TestCLVisaInjectionRtBasic, FunctionBody) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_func_body.cl");
   compute::command_queue queue = compute::system::default_queue();
 
@@ -814,7 +889,7 @@ HWTEST(TestCLVisaInjectionRtBasic, FunctionBody) {
   EXPECT_THAT(dst1, ::testing::ElementsAreArray(dst2));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, PragmaUnroll) {
+HWTEST_F(TestCLVisaInjectionRtBasic, PragmaUnroll) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t width = 64;
@@ -836,7 +911,7 @@ HWTEST(TestCLVisaInjectionRtBasic, PragmaUnroll) {
   compute::buffer out_buffer(context, size * 4,
                              compute::memory_object::read_write);
 
-  compute::program program = compute_samples::build_program(
+  compute::program program = cs::ProgramRegistry::instance().program(
       context, "test_cl_visa_injection_rt_basic_pragma_unroll.cl");
   compute::command_queue queue = compute::system::default_queue();
 
@@ -860,7 +935,7 @@ HWTEST(TestCLVisaInjectionRtBasic, PragmaUnroll) {
   EXPECT_THAT(dst1, ::testing::ElementsAreArray(dst3));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, WholeKernel) {
+HWTEST_F(TestCLVisaInjectionRtBasic, WholeKernel) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t width = 64;
@@ -881,11 +956,10 @@ HWTEST(TestCLVisaInjectionRtBasic, WholeKernel) {
 
   auto run_kernel = [&](const char *file_name, const char *kernel_name,
                         std::vector<uint32_t> &dst) -> void {
-    compute::program program =
-        compute_samples::build_program(context, file_name);
+    compute::kernel kernel =
+        cs::ProgramRegistry::instance().kernel(context, file_name, kernel_name);
     compute::command_queue queue = compute::system::default_queue();
 
-    compute::kernel kernel = program.create_kernel(kernel_name);
     kernel.set_args(src_buffer, out_buffer);
     queue.enqueue_write_buffer(out_buffer, 0, cs::size_in_bytes(dst),
                                dst.data());
@@ -903,7 +977,7 @@ HWTEST(TestCLVisaInjectionRtBasic, WholeKernel) {
   EXPECT_THAT(dst1, ::testing::ElementsAreArray(dst2));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, SingleBasicBlock) {
+HWTEST_F(TestCLVisaInjectionRtBasic, SingleBasicBlock) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t width = 64;
@@ -924,11 +998,10 @@ HWTEST(TestCLVisaInjectionRtBasic, SingleBasicBlock) {
 
   auto run_kernel = [&](const char *file_name, const char *kernel_name,
                         std::vector<uint32_t> &dst) -> void {
-    compute::program program =
-        compute_samples::build_program(context, file_name);
+    compute::kernel kernel =
+        cs::ProgramRegistry::instance().kernel(context, file_name, kernel_name);
     compute::command_queue queue = compute::system::default_queue();
 
-    compute::kernel kernel = program.create_kernel(kernel_name);
     kernel.set_args(src_buffer, out_buffer);
     queue.enqueue_write_buffer(out_buffer, 0, cs::size_in_bytes(dst),
                                dst.data());
@@ -946,7 +1019,7 @@ HWTEST(TestCLVisaInjectionRtBasic, SingleBasicBlock) {
   EXPECT_THAT(dst1, ::testing::ElementsAreArray(dst2));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, Region) {
+HWTEST_F(TestCLVisaInjectionRtBasic, Region) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t width = 64;
@@ -967,11 +1040,10 @@ HWTEST(TestCLVisaInjectionRtBasic, Region) {
 
   auto run_kernel = [&](const char *file_name, const char *kernel_name,
                         std::vector<uint32_t> &dst) -> void {
-    compute::program program =
-        compute_samples::build_program(context, file_name);
+    compute::kernel kernel =
+        cs::ProgramRegistry::instance().kernel(context, file_name, kernel_name);
     compute::command_queue queue = compute::system::default_queue();
 
-    compute::kernel kernel = program.create_kernel(kernel_name);
     kernel.set_args(src_buffer, out_buffer);
     queue.enqueue_write_buffer(out_buffer, 0, cs::size_in_bytes(dst),
                                dst.data());
@@ -988,7 +1060,7 @@ HWTEST(TestCLVisaInjectionRtBasic, Region) {
   EXPECT_THAT(dst1, ::testing::ElementsAreArray(dst2));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, ForLoop) {
+HWTEST_F(TestCLVisaInjectionRtBasic, ForLoop) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t width = 64;
@@ -1009,11 +1081,10 @@ HWTEST(TestCLVisaInjectionRtBasic, ForLoop) {
 
   auto run_kernel = [&](const char *file_name, const char *kernel_name,
                         std::vector<uint32_t> &dst) -> void {
-    compute::program program =
-        compute_samples::build_program(context, file_name);
+    compute::kernel kernel =
+        cs::ProgramRegistry::instance().kernel(context, file_name, kernel_name);
     compute::command_queue queue = compute::system::default_queue();
 
-    compute::kernel kernel = program.create_kernel(kernel_name);
     kernel.set_args(src_buffer, out_buffer);
     queue.enqueue_write_buffer(out_buffer, 0, cs::size_in_bytes(dst),
                                dst.data());
@@ -1031,7 +1102,7 @@ HWTEST(TestCLVisaInjectionRtBasic, ForLoop) {
   EXPECT_THAT(dst1, ::testing::ElementsAreArray(dst2));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, SGEMM) {
+HWTEST_F(TestCLVisaInjectionRtBasic, SGEMM) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t m = 16 * 16;
@@ -1083,7 +1154,7 @@ HWTEST(TestCLVisaInjectionRtBasic, SGEMM) {
   EXPECT_THAT(dst1, ::testing::Pointwise(::testing::FloatEq(), dst2));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, StencilFloat) {
+HWTEST_F(TestCLVisaInjectionRtBasic, StencilFloat) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 256;
@@ -1125,7 +1196,7 @@ HWTEST(TestCLVisaInjectionRtBasic, StencilFloat) {
   EXPECT_THAT(dst1, ::testing::Pointwise(::testing::FloatNear(0.00001f), dst2));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, F32ToTf32) {
+HWTEST_F(TestCLVisaInjectionRtBasic, F32ToTf32) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;
@@ -1167,7 +1238,7 @@ HWTEST(TestCLVisaInjectionRtBasic, F32ToTf32) {
   EXPECT_THAT(dst1, ::testing::ElementsAreArray(dst2));
 }
 
-HWTEST(TestCLVisaInjectionRtBasic, Fp16ToBf8Srnd) {
+HWTEST_F(TestCLVisaInjectionRtBasic, Fp16ToBf8Srnd) {
   EXPECT_TRUE(check_supported_subgroup_size(16));
 
   const size_t size = 64;